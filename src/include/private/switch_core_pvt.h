@@ -83,10 +83,24 @@ typedef enum {
 	SSF_MEDIA_BUG_TAP_ONLY = (1 << 10)
 } switch_session_flag_t;
 
+/* Bump allocator carved out of the session pool.  pos/end are only touched by the
+   session thread, so its allocations never take the pool mutex; everybody else
+   goes through the locked pool and is counted in the shared_ counters. */
+typedef struct switch_session_arena_s {
+	char *pos;
+	char *end;
+	switch_size_t reserved;
+	switch_size_t bytes;
+	uint32_t allocs;
+	switch_atomic_t shared_bytes;
+	switch_atomic_t shared_allocs;
+} switch_session_arena_t;
+
 struct switch_core_session {
 	switch_memory_pool_t *pool;
 	switch_thread_t *thread;
 	switch_thread_id_t thread_id;
+	switch_session_arena_t arena;
 	switch_endpoint_interface_t *endpoint_interface;
 	switch_size_t id;
 	switch_session_flag_t flags;
@@ -284,6 +298,7 @@ struct switch_runtime {
 	char *core_db_inner_post_trans_execute;
 	int events_use_dispatch;
 	uint32_t port_alloc_flags;
+	int core_db_channels;
 	char *event_channel_key_separator;
 	uint32_t max_audio_channels;
 	switch_call_cause_t shutdown_cause;
@@ -315,6 +330,13 @@ switch_status_t switch_core_sqldb_start(switch_memory_pool_t *pool, switch_bool_
 void switch_core_sqldb_stop(void);
 void switch_core_session_init(switch_memory_pool_t *pool);
 void switch_core_session_uninit(void);
+void switch_core_session_pool_stats(switch_stream_handle_t *stream);
 void switch_core_state_machine_init(switch_memory_pool_t *pool);
 switch_memory_pool_t *switch_core_memory_init(void);
 void switch_core_memory_stop(void);
+
+#define SWITCH_REGEX_CACHE_SIZE 4096
+void switch_regex_cache_init(switch_memory_pool_t *pool, uint32_t max);
+void switch_regex_cache_destroy(void);
+void switch_channel_registry_init(switch_memory_pool_t *pool);
+void switch_channel_registry_destroy(void);
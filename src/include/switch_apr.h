@@ -424,6 +424,16 @@ SWITCH_DECLARE(void) switch_atomic_inc(volatile switch_atomic_t *mem);
  */
 SWITCH_DECLARE(int)  switch_atomic_dec(volatile switch_atomic_t *mem);
 
+/**
+ * Compare the pointer value at mem with cmp and swap in the value with if
+ * they are equal.
+ * @param mem The location of the pointer to swap.
+ * @param with The value to swap in.
+ * @param cmp The value to compare against.
+ * @return The old value of the pointer at mem.
+ */
+SWITCH_DECLARE(void *) switch_atomic_casptr(volatile void **mem, void *with, const void *cmp);
+
 /** @} */
 
 /**
@@ -874,6 +884,25 @@ SWITCH_DECLARE(switch_status_t) switch_file_read(switch_file_t *thefile, void *b
 SWITCH_DECLARE(switch_status_t) switch_file_write(switch_file_t *thefile, const void *buf, switch_size_t *nbytes);
 SWITCH_DECLARE(int) switch_file_printf(switch_file_t *thefile, const char *format, ...);
 
+/** the most buffers switch_file_writev() takes at once */
+#define SWITCH_FILE_IOVEC_MAX 64
+
+/**
+ * Write several buffers to the specified file in one call, retrying until all of them are written.
+ * @param thefile The file descriptor to write to.
+ * @param bufs The buffers to write.
+ * @param lens The length of each buffer.
+ * @param count The number of buffers, at most SWITCH_FILE_IOVEC_MAX.
+ * @param nbytes The number of bytes written.
+ */
+SWITCH_DECLARE(switch_status_t) switch_file_writev(switch_file_t *thefile, const void * const *bufs, const switch_size_t *lens, int count, switch_size_t *nbytes);
+
+/**
+ * Flush the data written to the specified file to the disk, without forcing out the metadata where the OS allows it.
+ * @param thefile The file descriptor to flush.
+ */
+SWITCH_DECLARE(switch_status_t) switch_file_datasync(switch_file_t *thefile);
+
 SWITCH_DECLARE(switch_status_t) switch_file_mktemp(switch_file_t ** thefile, char *templ, int32_t flags, switch_memory_pool_t *pool);
 
 SWITCH_DECLARE(switch_size_t) switch_file_get_size(switch_file_t *thefile);
@@ -1188,6 +1217,34 @@ SWITCH_DECLARE(switch_status_t) switch_socket_send_nonblock(switch_socket_t *soc
  */
 SWITCH_DECLARE(switch_status_t) switch_socket_recvfrom(switch_sockaddr_t *from, switch_socket_t *sock, int32_t flags, char *buf, size_t *len);
 
+/** The most datagrams moved by one call to the batch socket functions */
+#define SWITCH_SOCKET_BATCH_MAX 32
+
+/**
+ * Receive up to *count datagrams with a single system call (recvmmsg where available).
+ * The first datagram honours the blocking mode of the socket, the rest are only taken if already queued.
+ * @param from  Array of *count sockaddrs to fill in the sender of each datagram
+ * @param sock  The socket to use
+ * @param flags The flags to use
+ * @param bufs  Array of *count buffers to use
+ * @param lens  On entry the size of each buffer, on exit the length of each datagram (0 if it was truncated)
+ * @param count On entry the number of buffers, on exit the number of datagrams received
+ */
+SWITCH_DECLARE(switch_status_t) switch_socket_recvfrom_batch(switch_sockaddr_t **from, switch_socket_t *sock, int32_t flags,
+															 char **bufs, switch_size_t *lens, int *count);
+
+/**
+ * Send *count datagrams to one destination with a single system call (sendmmsg where available).
+ * @param sock  The socket to send from
+ * @param where The fspr_sockaddr_t describing where to send the data
+ * @param flags The flags to use
+ * @param bufs  Array of *count datagrams to send
+ * @param lens  Array of *count datagram lengths
+ * @param count On entry the number of datagrams, on exit the number actually sent
+ */
+SWITCH_DECLARE(switch_status_t) switch_socket_sendto_batch(switch_socket_t *sock, switch_sockaddr_t *where, int32_t flags,
+														   const void * const *bufs, const switch_size_t *lens, int *count);
+
 SWITCH_DECLARE(switch_status_t) switch_socket_atmark(switch_socket_t *sock, int *atmark);
 
 /**
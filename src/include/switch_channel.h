@@ -725,6 +725,44 @@ SWITCH_DECLARE(switch_status_t) switch_channel_unbind_device_state_handler(switc
 SWITCH_DECLARE(const char *) switch_channel_device_state2str(switch_device_state_t device_state);
 SWITCH_DECLARE(switch_status_t) switch_channel_pass_sdp(switch_channel_t *from_channel, switch_channel_t *to_channel, const char *sdp);
 
+/*!
+  \brief Shapes of the rows the channel registry can return, named after the core db table and views they replace
+*/
+typedef enum {
+	SWITCH_CHANNEL_REGISTRY_CHANNELS,
+	SWITCH_CHANNEL_REGISTRY_CALLS,
+	SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS
+} switch_channel_registry_view_t;
+
+typedef struct {
+	/*! channels, basic_calls or detailed_calls */
+	switch_channel_registry_view_t view;
+	/*! sql LIKE pattern matched against uuid, name, cid_name, cid_num, presence_data and accountcode, NULL for all rows */
+	const char *like;
+	/*! only calls that have a b leg */
+	switch_bool_t bridged_only;
+	/*! order by call_created_epoch instead of by when the channel was created */
+	switch_bool_t order_by_call;
+	/*! return one row holding the number of matches instead of the rows */
+	switch_bool_t count_only;
+	/*! NULL terminated list of the columns to return, NULL for all of them */
+	const char **columns;
+} switch_channel_registry_query_t;
+
+/*!
+  \brief Run a query against the in memory index of the live channels
+  \param query what to return
+  \param callback called once per row with the same arguments a core db callback gets, returning non zero stops the query
+  \param pArg user data for the callback
+  \return the number of matching rows or -1 on error
+*/
+SWITCH_DECLARE(int) switch_channel_registry_query(const switch_channel_registry_query_t *query, switch_core_db_callback_func_t callback, void *pArg);
+
+/*!
+  \brief Number of channels in the registry
+*/
+SWITCH_DECLARE(uint32_t) switch_channel_registry_count(void);
+
 SWITCH_END_EXTERN_C
 #endif
 /* For Emacs:
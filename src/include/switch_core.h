@@ -620,6 +620,24 @@ SWITCH_DECLARE(void) switch_core_memory_pool_tag(switch_memory_pool_t *pool, con
 
 SWITCH_DECLARE(void) switch_core_pool_stats(switch_stream_handle_t *stream);
 
+typedef struct {
+	/*! bytes and allocations served lock-free to the session thread */
+	switch_size_t arena_bytes;
+	uint32_t arena_allocs;
+	/*! pool memory reserved for the arena */
+	switch_size_t arena_reserved;
+	/*! bytes and allocations that went through the locked pool */
+	switch_size_t pool_bytes;
+	uint32_t pool_allocs;
+} switch_memory_stats_t;
+
+/*!
+  \brief Get the allocation counters of a session's pool
+  \param session the session to inspect
+  \param stats the structure to fill in
+*/
+SWITCH_DECLARE(void) switch_core_session_memory_stats(switch_core_session_t *session, switch_memory_stats_t *stats);
+
 SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(_Out_ switch_memory_pool_t **pool,
 																	_In_z_ const char *file, _In_z_ const char *func, _In_ int line);
 
@@ -2839,6 +2857,28 @@ SWITCH_DECLARE(void) switch_sql_queue_manager_resume(switch_sql_queue_manager_t
 SWITCH_DECLARE(int) switch_sql_queue_manager_size(switch_sql_queue_manager_t *qm, uint32_t index);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup);
+/*!
+  \brief Register a statement with ? placeholders that switch_sql_queue_manager_push_params() can queue values for
+  \param qm the queue manager
+  \param sql the statement, single quoted ? are left alone
+  \param stmt_id the id to push with, the same sql always gets the same id
+  \return SWITCH_STATUS_SUCCESS or SWITCH_STATUS_FALSE when the queue manager has no room for more statements
+*/
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_add_statement(switch_sql_queue_manager_t *qm, const char *sql, uint32_t *stmt_id);
+/*!
+  \brief Queue a registered statement with its values, the values are copied and NULL ones are sent as NULL
+*/
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_params(switch_sql_queue_manager_t *qm, uint32_t stmt_id, uint32_t pos, int argc, const char **argv);
+/*!
+  \brief Render a registered statement the way it is sent to backends without prepared statements
+  \param qm the queue manager
+  \param stmt_id the id from switch_sql_queue_manager_add_statement()
+  \param rows how many sets of values argv holds, more than one renders a multi-row insert
+  \param argc values per row
+  \param argv rows * argc values, NULL ones are rendered as NULL
+  \return the sql, free() it, or NULL when the statement is unknown, argc is wrong or it can't take several rows
+*/
+SWITCH_DECLARE(char *) switch_sql_queue_manager_render_params(switch_sql_queue_manager_t *qm, uint32_t stmt_id, uint32_t rows, int argc, const char **argv);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queue_manager_t **qmp);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *name,
 																   switch_sql_queue_manager_t **qmp,
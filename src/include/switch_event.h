@@ -76,6 +76,22 @@ SWITCH_BEGIN_EXTERN_C
 	struct switch_event_header *next;
 };
 
+typedef enum {
+	SWITCH_EVENT_FORMAT_PLAIN,
+	SWITCH_EVENT_FORMAT_JSON,
+	SWITCH_EVENT_FORMAT_XML,
+	SWITCH_EVENT_FORMAT_MAX
+} switch_event_format_t;
+
+typedef enum {
+	SEBF_NONE = 0,
+	/*! deliver on a dedicated queue and thread instead of the dispatch thread */
+	SEBF_QUEUED = (1 << 0),
+	/*! block the dispatcher when the queue is full instead of dropping the event */
+	SEBF_BLOCK = (1 << 1)
+} switch_event_bind_flag_enum_t;
+typedef uint32_t switch_event_bind_flag_t;
+
 /*! \brief Representation of an event */
 struct switch_event {
 	/*! the event id (descriptor) */
@@ -100,6 +116,16 @@ struct switch_event {
 	unsigned long key;
 	struct switch_event *next;
 	int flags;
+	/*! number of headers in the list */
+	uint32_t header_count;
+	/*! open addressing index of the first header for each name, built once the list gets long */
+	switch_event_header_t **header_index;
+	/*! slots in the index (power of two) */
+	uint32_t header_index_size;
+	/*! slots in use */
+	uint32_t header_index_used;
+	/*! reference count and serialized forms shared by every switch_event_ref() of this event */
+	struct switch_event_share *share;
 };
 
 typedef struct switch_serial_event_s {
@@ -216,6 +242,31 @@ SWITCH_DECLARE(int) switch_event_add_array(switch_event_t *event, const char *va
   \param event pointer to the pointer to event to destroy
 */
 SWITCH_DECLARE(void) switch_event_destroy(switch_event_t **event);
+
+/*!
+  \brief Take another reference to an event without copying its headers
+  \param event the event to reference
+  \return a new handle sharing the headers and body of the event, release it with switch_event_unref()
+  \note whichever handle is modified first gets its own copy of the headers (copy on write)
+*/
+SWITCH_DECLARE(switch_event_t *) switch_event_ref(switch_event_t *event);
+#define switch_event_unref(_e) switch_event_destroy(_e)
+
+/*!
+  \brief Give a referenced event its own copy of the headers and body
+  \param event the event to make private
+  \note the add/del/rename/body functions do this on their own, call it before changing header values in place
+*/
+SWITCH_DECLARE(void) switch_event_unshare(switch_event_t *event);
+
+/*!
+  \brief Get an event serialized as url encoded plain text, JSON or XML
+  \param event the event to serialize
+  \param format the format to use
+  \return the serialized event, built on first use and shared by every reference to the event
+  \note the string belongs to the event, it is valid until this handle is modified or released
+*/
+SWITCH_DECLARE(const char *) switch_event_get_serialized(switch_event_t *event, switch_event_format_t format);
 #define switch_event_safe_destroy(_event) if (_event) switch_event_destroy(&_event)
 
 /*!
@@ -269,6 +320,30 @@ SWITCH_DECLARE(switch_status_t) switch_event_get_custom_events(switch_console_ca
 */
 SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, switch_event_types_t event, const char *subclass_name,
 															switch_event_callback_t callback, void *user_data, switch_event_node_t **node);
+/*!
+  \brief Bind an event callback to a specific event with delivery options
+  \param id an identifier token of the binder
+  \param event the event enumeration to bind to
+  \param subclass_name the event subclass to bind to in the case if SWITCH_EVENT_CUSTOM
+  \param callback the callback functon to bind
+  \param user_data optional user specific data to pass whenever the callback is invoked
+  \param flags SEBF_QUEUED to run the callback on a dedicated thread fed by a bounded queue,
+         SEBF_BLOCK to make the dispatcher wait instead of dropping when that queue is full
+  \param queue_len the depth of the queue (0 for the default)
+  \param node bind handle to later remove the binding (optional)
+  \return SWITCH_STATUS_SUCCESS if the event was binded
+  \note with SEBF_BLOCK the callback must not bind or unbind events
+*/
+SWITCH_DECLARE(switch_status_t) switch_event_bind_flags(const char *id, switch_event_types_t event, const char *subclass_name,
+														switch_event_callback_t callback, void *user_data, switch_event_bind_flag_t flags,
+														uint32_t queue_len, switch_event_node_t **node);
+
+/*!
+  \brief Write the event bindings and the queue depth, drop count and lag of the queued ones to a stream
+  \param stream the stream to write to
+*/
+SWITCH_DECLARE(void) switch_event_bindings_report(switch_stream_handle_t *stream);
+
 /*!
   \brief Unbind a bound event consumer
   \param node node to unbind
@@ -201,6 +201,13 @@ SWITCH_DECLARE(void) switch_log_meta_vprintf(_In_ switch_text_channel_t channel,
 SWITCH_DECLARE(switch_status_t) switch_log_bind_logger(_In_ switch_log_function_t function, _In_ switch_log_level_t level, _In_ switch_bool_t is_console);
 SWITCH_DECLARE(switch_status_t) switch_log_unbind_logger(_In_ switch_log_function_t function);
 
+/*!
+  \brief Narrow the levels a logger is called for, lines no binding wants are dropped before they are formatted
+  \param function the bound logger
+  \param mask the wanted levels, see switch_log_str2mask(), limited to the level the logger was bound with
+*/
+SWITCH_DECLARE(switch_status_t) switch_log_binding_set_mask(_In_ switch_log_function_t function, _In_ uint32_t mask);
+
 /*!
   \brief Return the name of the specified log level
   \param level the level
@@ -50,6 +50,42 @@ SWITCH_DECLARE(int) switch_regex_copy_substring(const char *subject, int *ovecto
 SWITCH_DECLARE(void) switch_regex_free(void *data);
 
 SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expression, switch_regex_t **new_re, int *ovector, uint32_t olen);
+
+/*!
+ \brief Compile an expression the way switch_regex_perform() does (/re/flags, _ast syntax) so it can be run many times
+ \param expression The regular expression
+ \return The compiled expression, free it with switch_regex_safe_free(), or NULL on error
+*/
+SWITCH_DECLARE(switch_regex_t *) switch_regex_compile_expression(const char *expression);
+
+/*!
+ \brief Run a compiled expression against a string
+ \param re The compiled expression
+ \param field The string to match
+ \param ovector The vector filled with the substring offsets
+ \param olen The number of elements in ovector
+ \return The number of matches, 0 when there is none
+*/
+SWITCH_DECLARE(int) switch_regex_exec(switch_regex_t *re, const char *field, int *ovector, uint32_t olen);
+
+typedef struct {
+	uint32_t entries;
+	uint32_t max;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+} switch_regex_cache_stats_t;
+
+/*!
+ \brief Forget every expression compiled by switch_regex_perform() and switch_regex_match(), done on reloadxml
+*/
+SWITCH_DECLARE(void) switch_regex_cache_flush(void);
+
+/*!
+ \brief Read the counters of the compiled expression cache
+ \param stats filled with the current size and counters
+*/
+SWITCH_DECLARE(void) switch_regex_cache_stats(switch_regex_cache_stats_t *stats);
 SWITCH_DECLARE(void) switch_perform_substitution(switch_regex_t *re, int match_count, const char *data, const char *field_data,
 												 char *substituted, switch_size_t len, int *ovector);
 
@@ -48,6 +48,8 @@ SWITCH_BEGIN_EXTERN_C
 	void *cmd_arg;
 	uint32_t task_id;
 	unsigned long hash;
+	/* runtime in microseconds since the epoch, a callback may move it to reschedule with sub-second precision */
+	int64_t runtime_us;
 };
 
 
@@ -83,6 +85,21 @@ SWITCH_DECLARE(uint32_t) switch_scheduler_add_task_ex(time_t task_runtime,
 	switch_scheduler_func_t func,
 	const char *desc, const char *group, uint32_t cmd_id, void *cmd_arg, switch_scheduler_flag_t flags, uint32_t *task_id);
 
+/*!
+  \brief Schedule a task in the future with microsecond resolution
+  \param task_runtime the time in epoch microseconds to execute the task, as returned by switch_micro_time_now().
+  \param func the callback function to execute when the task is executed.
+  \param desc an arbitrary description of the task.
+  \param group a group id tag to link multiple tasks to a single entity.
+  \param cmd_id an arbitrary index number be used in the callback.
+  \param cmd_arg user data to be passed to the callback.
+  \param flags flags to alter behaviour
+  \return the id of the task
+*/
+SWITCH_DECLARE(uint32_t) switch_scheduler_add_task_us(switch_time_t task_runtime,
+													  switch_scheduler_func_t func,
+													  const char *desc, const char *group, uint32_t cmd_id, void *cmd_arg, switch_scheduler_flag_t flags);
+
 /*!
   \brief Delete a scheduled task
   \param task_id the id of the task
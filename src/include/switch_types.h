@@ -694,6 +694,8 @@ typedef struct {
 	switch_size_t cng_packet_count;
 	switch_size_t flush_packet_count;
 	switch_size_t largest_jb_size;
+	switch_size_t io_call_count;
+	switch_size_t io_packet_count;
 	/* Jitter */
 	int64_t last_proc_time;
 	int64_t jitter_n;
@@ -691,6 +691,28 @@ SWITCH_STANDARD_API(pool_stats_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_STANDARD_API(event_bindings_function)
+{
+	switch_event_bindings_report(stream);
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_STANDARD_API(regex_cache_function)
+{
+	switch_regex_cache_stats_t stats;
+
+	if (!zstr(cmd) && !strcasecmp(cmd, "flush")) {
+		switch_regex_cache_flush();
+		stream->write_function(stream, "+OK\n");
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_regex_cache_stats(&stats);
+	stream->write_function(stream, "entries: %u/%u\nhits: %" SWITCH_UINT64_T_FMT "\nmisses: %" SWITCH_UINT64_T_FMT "\nevictions: %" SWITCH_UINT64_T_FMT "\n",
+						   stats.entries, stats.max, stats.hits, stats.misses, stats.evictions);
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_API(db_cache_function)
 {
 	int argc;
@@ -3465,6 +3487,8 @@ static void jsonify_stats(cJSON *json, const char *name, switch_rtp_stats_t *sta
 	add_stat(stats->inbound.cng_packet_count, "in_cng_packet_count");
 	add_stat(stats->inbound.flush_packet_count, "in_flush_packet_count");
 	add_stat(stats->inbound.largest_jb_size, "in_largest_jb_size");
+	add_stat(stats->inbound.io_call_count, "in_io_call_count");
+	add_stat(stats->inbound.io_packet_count, "in_io_packet_count");
 
 	add_stat (stats->inbound.min_variance, "in_jitter_min_variance");
 	add_stat (stats->inbound.max_variance, "in_jitter_max_variance");
@@ -3485,6 +3509,8 @@ static void jsonify_stats(cJSON *json, const char *name, switch_rtp_stats_t *sta
 	add_stat(stats->outbound.skip_packet_count, "out_skip_packet_count");
 	add_stat(stats->outbound.dtmf_packet_count, "out_dtmf_packet_count");
 	add_stat(stats->outbound.cng_packet_count, "out_cng_packet_count");
+	add_stat(stats->outbound.io_call_count, "out_io_call_count");
+	add_stat(stats->outbound.io_packet_count, "out_io_packet_count");
 
 	add_stat(stats->rtcp.packet_count, "rtcp_packet_count");
 	add_stat(stats->rtcp.octet_count, "rtcp_octet_count");
@@ -5686,12 +5712,24 @@ SWITCH_STANDARD_API(coalesce_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+static void show_execute(switch_cache_db_handle_t *db, const char *sql, switch_channel_registry_query_t *query,
+						 switch_core_db_callback_func_t callback, struct holder *holder, char **errmsg)
+{
+	if (query) {
+		switch_channel_registry_query(query, callback, holder);
+	} else {
+		switch_cache_db_execute_sql_callback(db, sql, callback, holder, errmsg);
+	}
+}
+
 #define SHOW_SYNTAX "codec|endpoint|application|api|dialplan|file|timer|calls [count]|channels [count|like <match string>]|calls|detailed_calls|bridged_calls|detailed_bridged_calls|aliases|complete|chat|management|modules|nat_map|say|interfaces|interface_types|tasks|limits|status"
 SWITCH_STANDARD_API(show_function)
 {
-	char sql[1024];
-	char *errmsg;
-	switch_cache_db_handle_t *db;
+	char sql[1024] = "";
+	char *errmsg = NULL;
+	switch_cache_db_handle_t *db = NULL;
+	switch_channel_registry_query_t query = { 0 }, *rq = NULL;
+	char *like = NULL;
 	struct holder holder = { 0 };
 	int help = 0;
 	char *mydata = NULL, *argv[6] = { 0 };
@@ -5706,16 +5744,6 @@ SWITCH_STANDARD_API(show_function)
 	set_format(holder.format, stream);
 	html = holder.format->html; /* html is just a shortcut */
 
-	if (!(cflags & SCF_USE_SQL)) {
-		stream->write_function(stream, "-ERR SQL disabled, no data available!\n");
-		return SWITCH_STATUS_SUCCESS;
-	}
-
-	if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
-		stream->write_function(stream, "%s", "-ERR Database error!\n");
-		return SWITCH_STATUS_SUCCESS;
-	}
-
 	holder.justcount = 0;
 
 	if (cmd && *cmd && (mydata = strdup(cmd))) {
@@ -5814,10 +5842,13 @@ SWITCH_STANDARD_API(show_function)
 			}
 		}
 
+		/* channels and calls come from the channel registry, the rest from the core db */
 		if (!strcasecmp(command, "calls")) {
-			switch_snprintfv(sql, sizeof(sql), "select * from basic_calls where hostname='%q' order by call_created_epoch", switch_core_get_switchname());
+			rq = &query;
+			rq->view = SWITCH_CHANNEL_REGISTRY_CALLS;
+			rq->order_by_call = SWITCH_TRUE;
 			if (argv[1] && !strcasecmp(argv[1], "count")) {
-				switch_snprintfv(sql, sizeof(sql), "select count(*) from basic_calls where hostname='%q'", switch_core_get_switchname());
+				rq->count_only = SWITCH_TRUE;
 				holder.justcount = 1;
 				if (argv[2] && argv[3] && !strcasecmp(argv[2], "as")) {
 					as = argv[3];
@@ -5833,49 +5864,45 @@ SWITCH_STANDARD_API(show_function)
 				}
 			}
 		} else if (!strcasecmp(command, "channels") && argv[1] && !strcasecmp(argv[1], "like")) {
+			rq = &query;
+			rq->view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
 			if (argv[2]) {
-				char *p;
-				for (p = argv[2]; p && *p; p++) {
-					if (*p == '\'' || *p == ';') {
-						*p = ' ';
-					}
-				}
 				if (strchr(argv[2], '%')) {
-					switch_snprintfv(sql, sizeof(sql),
-						"select * from channels where hostname='%q' and uuid like '%q' or name like '%q' or cid_name like '%q' or cid_num like '%q' or presence_data like '%q' or accountcode like '%q' order by created_epoch",
-						switch_core_get_switchname(), argv[2], argv[2], argv[2], argv[2], argv[2], argv[2]);
+					rq->like = argv[2];
 				} else {
-					switch_snprintfv(sql, sizeof(sql),
-						"select * from channels where hostname='%q' and uuid like '%%%q%%' or name like '%%%q%%' or cid_name like '%%%q%%' or cid_num like '%%%q%%' or presence_data like '%%%q%%' or accountcode like '%%%q%%' order by created_epoch",
-						switch_core_get_switchname(), argv[2], argv[2], argv[2], argv[2], argv[2], argv[2]);
+					rq->like = like = switch_mprintf("%%%s%%", argv[2]);
 				}
 				if (argv[4] && !strcasecmp(argv[3], "as")) {
 					as = argv[4];
 				}
-			} else {
-				switch_snprintfv(sql, sizeof(sql), "select * from channels where hostname='%q' order by created_epoch", switch_core_get_switchname());
 			}
 		} else if (!strcasecmp(command, "channels")) {
-			switch_snprintfv(sql, sizeof(sql), "select * from channels where hostname='%q' order by created_epoch", switch_core_get_switchname());
+			rq = &query;
+			rq->view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
 			if (argv[1] && !strcasecmp(argv[1], "count")) {
-				switch_snprintfv(sql, sizeof(sql), "select count(*) from channels where hostname='%q'", switch_core_get_switchname());
+				rq->count_only = SWITCH_TRUE;
 				holder.justcount = 1;
 				if (argv[2] && argv[3] && !strcasecmp(argv[2], "as")) {
 					as = argv[3];
 				}
 			}
 		} else if (!strcasecmp(command, "detailed_calls")) {
-			switch_snprintfv(sql, sizeof(sql), "select * from detailed_calls where hostname='%q' order by created_epoch", switch_core_get_switchname());
+			rq = &query;
+			rq->view = SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS;
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
 		} else if (!strcasecmp(command, "bridged_calls")) {
-			switch_snprintfv(sql, sizeof(sql), "select * from basic_calls where b_uuid is not null and hostname='%q' order by created_epoch", switch_core_get_switchname());
+			rq = &query;
+			rq->view = SWITCH_CHANNEL_REGISTRY_CALLS;
+			rq->bridged_only = SWITCH_TRUE;
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
 		} else if (!strcasecmp(command, "detailed_bridged_calls")) {
-			switch_snprintfv(sql, sizeof(sql), "select * from detailed_calls where b_uuid is not null and hostname='%q' order by created_epoch", switch_core_get_switchname());
+			rq = &query;
+			rq->view = SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS;
+			rq->bridged_only = SWITCH_TRUE;
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
@@ -5886,6 +5913,18 @@ SWITCH_STANDARD_API(show_function)
 		}
 	}
 
+	if (!rq) {
+		if (!(cflags & SCF_USE_SQL)) {
+			stream->write_function(stream, "-ERR SQL disabled, no data available!\n");
+			goto end;
+		}
+
+		if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
+			stream->write_function(stream, "%s", "-ERR Database error!\n");
+			goto end;
+		}
+	}
+
 	holder.stream = stream;
 	holder.count = 0;
 
@@ -5912,7 +5951,7 @@ SWITCH_STANDARD_API(show_function)
 				holder.delim = ",";
 			}
 		}
-		switch_cache_db_execute_sql_callback(db, sql, show_callback, &holder, &errmsg);
+		show_execute(db, sql, rq, show_callback, &holder, &errmsg);
 		if (html) {
 			holder.stream->write_function(holder.stream, "</table>");
 		}
@@ -5928,7 +5967,7 @@ SWITCH_STANDARD_API(show_function)
 			stream->write_function(stream, "%s%u total.%s", nl, holder.count, nl);
 		}
 	} else if (!strcasecmp(as, "xml")) {
-		switch_cache_db_execute_sql_callback(db, sql, show_as_xml_callback, &holder, &errmsg);
+		show_execute(db, sql, rq, show_as_xml_callback, &holder, &errmsg);
 
 		if (errmsg) {
 			stream->write_function(stream, "-ERR SQL error [%s]\n", errmsg);
@@ -5956,7 +5995,7 @@ SWITCH_STANDARD_API(show_function)
 		}
 	} else if (!strcasecmp(as, "json")) {
 
-		switch_cache_db_execute_sql_callback(db, sql, show_as_json_callback, &holder, &errmsg);
+		show_execute(db, sql, rq, show_as_json_callback, &holder, &errmsg);
 
 		if (errmsg) {
 			stream->write_function(stream, "-ERR SQL Error [%s]\n", errmsg);
@@ -6001,6 +6040,7 @@ SWITCH_STANDARD_API(show_function)
   end:
 
 	switch_safe_free(mydata);
+	switch_safe_free(like);
 	switch_cache_db_release_db_handle(&db);
 
 	return status;
@@ -7605,6 +7645,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "echo", "Echo", echo_function, "<data>");
 	SWITCH_ADD_API(commands_api_interface, "event_channel_broadcast", "Broadcast", event_channel_broadcast_api_function, "<channel> <json>");
 	SWITCH_ADD_API(commands_api_interface, "escape", "Escape a string", escape_function, "<data>");
+	SWITCH_ADD_API(commands_api_interface, "event_bindings", "Show event bindings and their queues", event_bindings_function, "");
+	SWITCH_ADD_API(commands_api_interface, "regex_cache", "Show or flush the compiled regex cache", regex_cache_function, "[flush]");
 	SWITCH_ADD_API(commands_api_interface, "eval", "eval (noop)", eval_function, "[uuid:<uuid> ]<expression>");
 	SWITCH_ADD_API(commands_api_interface, "expand", "Execute an api with variable expansion", expand_function, "[uuid:<uuid> ]<cmd> <args>");
 	SWITCH_ADD_API(commands_api_interface, "find_user_xml", "Find a user", find_user_function, "<key> <user> <domain>");
@@ -872,6 +872,7 @@ SWITCH_STANDARD_APP(intercept_function)
 struct e_data {
 	char *uuid_list[MAX_SPY];
 	int total;
+	const char *self;
 };
 
 static int e_callback(void *pArg, int argc, char **argv, char **columnNames)
@@ -879,8 +880,10 @@ static int e_callback(void *pArg, int argc, char **argv, char **columnNames)
 	char *uuid = argv[0];
 	struct e_data *e_data = (struct e_data *) pArg;
 
-	if (uuid && e_data) {
-		e_data->uuid_list[e_data->total++] = strdup(uuid);
+	if (uuid && e_data && e_data->total < MAX_SPY) {
+		if (strcmp(uuid, e_data->self)) {
+			e_data->uuid_list[e_data->total++] = strdup(uuid);
+		}
 		return 0;
 	}
 
@@ -951,10 +954,9 @@ SWITCH_STANDARD_APP(eavesdrop_function)
 		}
 
 		if (!strcasecmp((char *) data, "all")) {
-			switch_cache_db_handle_t *db = NULL;
-			char *errmsg = NULL;
+			const char *columns[] = { "uuid", NULL };
+			switch_channel_registry_query_t query = { 0 };
 			struct e_data e_data = { {0} };
-			char *sql = switch_mprintf("select uuid from channels where uuid != '%q'", switch_core_session_get_uuid(session));
 			const char *file = NULL;
 			int x = 0;
 			char buf[2] = "";
@@ -962,21 +964,18 @@ SWITCH_STANDARD_APP(eavesdrop_function)
 			char terminator;
 			switch_status_t status;
 
+			query.view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
+			query.columns = columns;
+			e_data.self = switch_core_session_get_uuid(session);
+
 			while (switch_channel_ready(channel)) {
 				for (x = 0; x < MAX_SPY; x++) {
 					switch_safe_free(e_data.uuid_list[x]);
 				}
 				e_data.total = 0;
 
-				if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
-					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Database Error!\n");
-					break;
-				}
-				switch_cache_db_execute_sql_callback(db, sql, e_callback, &e_data, &errmsg);
-				switch_cache_db_release_db_handle(&db);
-				if (errmsg) {
-					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Error: %s\n", errmsg);
-					free(errmsg);
+				if (switch_channel_registry_query(&query, e_callback, &e_data) < 0) {
+					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Error: channel registry query failed\n");
 					if ((file = switch_channel_get_variable(channel, "eavesdrop_indicate_failed"))) {
 						switch_ivr_play_file(session, NULL, file, NULL);
 					}
@@ -1018,8 +1017,6 @@ SWITCH_STANDARD_APP(eavesdrop_function)
 				switch_safe_free(e_data.uuid_list[x]);
 			}
 
-			free(sql);
-
 		} else {
 			switch_ivr_eavesdrop_session(session, data, require_group, flags);
 		}
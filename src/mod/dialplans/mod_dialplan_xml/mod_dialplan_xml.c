@@ -35,7 +35,8 @@
 #include <fcntl.h>
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_dialplan_xml_load);
-SWITCH_MODULE_DEFINITION(mod_dialplan_xml, mod_dialplan_xml_load, NULL, NULL);
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_dialplan_xml_shutdown);
+SWITCH_MODULE_DEFINITION(mod_dialplan_xml, mod_dialplan_xml_load, mod_dialplan_xml_shutdown, NULL);
 
 typedef enum {
 	BREAK_ON_TRUE,
@@ -44,6 +45,42 @@ typedef enum {
 	BREAK_NEVER
 } break_t;
 
+/* longest destination_number prefix we bother to index, a shorter required prefix is still exact */
+#define DP_PREFIX_MAX 32
+
+typedef struct dp_link {
+	uint32_t idx;
+	struct dp_link *next;
+} dp_link_t;
+
+typedef struct dp_bucket {
+	dp_link_t *head;
+	dp_link_t *tail;
+} dp_bucket_t;
+
+typedef struct dp_context {
+	switch_xml_t xcontext;
+	switch_xml_t *extens;
+	uint32_t count;
+	dp_bucket_t open;
+	switch_hash_t *prefixes;
+	switch_size_t max_prefix;
+} dp_context_t;
+
+typedef struct dp_index {
+	switch_memory_pool_t *pool;
+	switch_xml_t root;
+	switch_hash_t *contexts;
+	uint32_t refs;
+} dp_index_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	switch_mutex_t *build_mutex;
+	dp_index_t *index;
+	switch_event_node_t *reload_node;
+} globals;
+
 
 static switch_status_t exec_app(switch_core_session_t *session, const char *app, const char *arg)
 {
@@ -600,6 +637,339 @@ static int parse_exten(switch_core_session_t *session, switch_caller_profile_t *
 	return proceed;
 }
 
+/*
+ * The prefix index only ever skips extensions that parse_exten would reject on their first condition
+ * without side effects: a plain destination_number test against an anchored expression with a literal
+ * head, no variables, no time rules, no anti-actions and a break mode that stops on a false result.
+ * Everything else stays a candidate and is evaluated exactly as before.
+ */
+static const char *dp_time_attrs[] = {
+	"date-time", "year", "yday", "mon", "mday", "week", "mweek", "wday", "hour",
+	"minute", "minute-of-day", "time-of-day", "tz-offset", "dst", NULL
+};
+
+static switch_size_t dp_expression_prefix(const char *expression, char *buf, switch_size_t len)
+{
+	const char *p, *next;
+	switch_size_t n = 0;
+	char c;
+
+	if (zstr(expression) || *expression != '^' || strchr(expression, '|') ||
+		switch_string_var_check_const(expression) || switch_string_has_escaped_data(expression)) {
+		return 0;
+	}
+
+	for (p = expression + 1; *p && n < len; p = next) {
+		c = *p;
+		next = p + 1;
+
+		if (c == '\\') {
+			if (!*next || isalnum((unsigned char) *next)) {
+				break;
+			}
+			c = *next++;
+		} else if (strchr("^$.[]|()?*+{}", c)) {
+			break;
+		}
+
+		/* a quantifier that allows zero occurrences makes this character optional */
+		if (*next == '?' || *next == '*' || *next == '{') {
+			break;
+		}
+
+		buf[n++] = c;
+	}
+
+	buf[n] = '\0';
+
+	return n;
+}
+
+static switch_size_t dp_exten_prefix(switch_xml_t xexten, char *buf, switch_size_t len)
+{
+	switch_xml_t xcond, xexpression;
+	const char *field, *do_break, *expression;
+	int i;
+
+	if (!(xcond = switch_xml_child(xexten, "condition"))) {
+		return 0;
+	}
+
+	if (!(field = switch_xml_attr(xcond, "field")) || strcasecmp(field, "destination_number") ||
+		switch_xml_attr(xcond, "regex") || switch_xml_child(xcond, "anti-action")) {
+		return 0;
+	}
+
+	if ((do_break = switch_xml_attr(xcond, "break")) && (!strcasecmp(do_break, "on-true") || !strcasecmp(do_break, "never"))) {
+		return 0;
+	}
+
+	for (i = 0; dp_time_attrs[i]; i++) {
+		if (switch_xml_attr(xcond, dp_time_attrs[i])) {
+			return 0;
+		}
+	}
+
+	if ((xexpression = switch_xml_child(xcond, "expression"))) {
+		expression = switch_str_nil(xexpression->txt);
+	} else {
+		expression = switch_xml_attr_soft(xcond, "expression");
+	}
+
+	return dp_expression_prefix(expression, buf, len);
+}
+
+static void dp_bucket_append(switch_memory_pool_t *pool, dp_bucket_t *bucket, uint32_t idx)
+{
+	dp_link_t *link = switch_core_alloc(pool, sizeof(*link));
+
+	link->idx = idx;
+
+	if (bucket->tail) {
+		bucket->tail->next = link;
+	} else {
+		bucket->head = link;
+	}
+	bucket->tail = link;
+}
+
+static void dp_index_add_context(dp_index_t *index, switch_xml_t xcontext)
+{
+	dp_context_t *ctx;
+	switch_xml_t xexten;
+	const char *name = switch_xml_attr(xcontext, "name");
+	char prefix[DP_PREFIX_MAX + 1];
+	switch_size_t plen;
+	uint32_t i = 0, indexed = 0;
+
+	/* switch_xml_find_child returns the first match so the first definition wins here too */
+	if (!name || switch_core_hash_find(index->contexts, name)) {
+		return;
+	}
+
+	ctx = switch_core_alloc(index->pool, sizeof(*ctx));
+	ctx->xcontext = xcontext;
+	switch_core_hash_init(&ctx->prefixes);
+
+	for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next) {
+		ctx->count++;
+	}
+
+	ctx->extens = switch_core_alloc(index->pool, sizeof(switch_xml_t) * (ctx->count + 1));
+
+	for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next, i++) {
+		ctx->extens[i] = xexten;
+
+		if ((plen = dp_exten_prefix(xexten, prefix, DP_PREFIX_MAX))) {
+			dp_bucket_t *bucket;
+
+			if (!(bucket = switch_core_hash_find(ctx->prefixes, prefix))) {
+				bucket = switch_core_alloc(index->pool, sizeof(*bucket));
+				switch_core_hash_insert(ctx->prefixes, prefix, bucket);
+			}
+
+			dp_bucket_append(index->pool, bucket, i);
+
+			if (plen > ctx->max_prefix) {
+				ctx->max_prefix = plen;
+			}
+			indexed++;
+		} else {
+			dp_bucket_append(index->pool, &ctx->open, i);
+		}
+	}
+
+	switch_core_hash_insert(index->contexts, name, ctx);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Dialplan index: context %s, %u extensions, %u indexed by destination prefix\n",
+					  name, ctx->count, indexed);
+}
+
+static void dp_index_destroy(dp_index_t *index)
+{
+	switch_hash_index_t *hi;
+	void *val;
+
+	for (hi = switch_core_hash_first(index->contexts); hi; hi = switch_core_hash_next(&hi)) {
+		dp_context_t *ctx;
+
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		ctx = (dp_context_t *) val;
+		switch_core_hash_destroy(&ctx->prefixes);
+	}
+
+	switch_core_hash_destroy(&index->contexts);
+	switch_xml_free(index->root);
+	switch_core_destroy_memory_pool(&index->pool);
+}
+
+/* takes over the caller's reference on root */
+static dp_index_t *dp_index_create(switch_xml_t root)
+{
+	switch_memory_pool_t *pool = NULL;
+	dp_index_t *index;
+	switch_xml_t xsection, xcontext;
+
+	switch_core_new_memory_pool(&pool);
+	index = switch_core_alloc(pool, sizeof(*index));
+	index->pool = pool;
+	index->root = root;
+	index->refs = 1;
+	switch_core_hash_init_nocase(&index->contexts);
+
+	if ((xsection = switch_xml_find_child(root, "section", "name", "dialplan"))) {
+		for (xcontext = switch_xml_child(xsection, "context"); xcontext; xcontext = xcontext->next) {
+			dp_index_add_context(index, xcontext);
+		}
+	}
+
+	return index;
+}
+
+static void dp_index_release(dp_index_t *index)
+{
+	int destroy;
+
+	switch_mutex_lock(globals.mutex);
+	destroy = !--index->refs;
+	switch_mutex_unlock(globals.mutex);
+
+	if (destroy) {
+		dp_index_destroy(index);
+	}
+}
+
+static void dp_index_rebuild(void)
+{
+	dp_index_t *old, *index = NULL;
+	switch_xml_t root;
+
+	switch_mutex_lock(globals.build_mutex);
+
+	if ((root = switch_xml_root())) {
+		if (globals.index && globals.index->root == root) {
+			/* somebody beat us to it */
+			switch_xml_free(root);
+			goto end;
+		}
+		index = dp_index_create(root);
+	}
+
+	switch_mutex_lock(globals.mutex);
+	old = globals.index;
+	globals.index = index;
+	switch_mutex_unlock(globals.mutex);
+
+	if (old) {
+		dp_index_release(old);
+	}
+
+  end:
+
+	switch_mutex_unlock(globals.build_mutex);
+}
+
+static void dp_index_reload_handler(switch_event_t *event)
+{
+	dp_index_rebuild();
+}
+
+/*
+ * Only the live root is indexed, documents handed back by a binding (xml_curl and friends) or loaded from an
+ * alternate path are walked the old way.  The index keeps a reference on its root so the comparison cannot be
+ * fooled by a freed root whose address got reused.
+ */
+static dp_index_t *dp_index_acquire(switch_xml_t xml)
+{
+	dp_index_t *index = NULL;
+	int stale;
+
+	switch_mutex_lock(globals.mutex);
+	if (globals.index && globals.index->root == xml) {
+		index = globals.index;
+		index->refs++;
+	}
+	stale = !index;
+	switch_mutex_unlock(globals.mutex);
+
+	if (stale) {
+		switch_xml_t root = switch_xml_root();
+
+		if (root == xml) {
+			/* the RELOADXML event has not reached us yet */
+			dp_index_rebuild();
+		}
+		switch_xml_free(root);
+
+		switch_mutex_lock(globals.mutex);
+		if (globals.index && globals.index->root == xml) {
+			index = globals.index;
+			index->refs++;
+		}
+		switch_mutex_unlock(globals.mutex);
+	}
+
+	return index;
+}
+
+static dp_context_t *dp_index_find_context(dp_index_t *index, switch_xml_t xcontext)
+{
+	const char *name = switch_xml_attr(xcontext, "name");
+	dp_context_t *ctx = NULL;
+
+	if (name && (ctx = switch_core_hash_find(index->contexts, name)) && ctx->xcontext != xcontext) {
+		ctx = NULL;
+	}
+
+	return ctx;
+}
+
+static int dp_idx_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static uint32_t dp_context_candidates(dp_context_t *ctx, const char *dest, uint32_t start, uint32_t *cand)
+{
+	char key[DP_PREFIX_MAX + 1];
+	switch_size_t len, i;
+	dp_link_t *link;
+	uint32_t n = 0;
+
+	for (link = ctx->open.head; link; link = link->next) {
+		if (link->idx >= start) {
+			cand[n++] = link->idx;
+		}
+	}
+
+	if ((len = strlen(dest)) > ctx->max_prefix) {
+		len = ctx->max_prefix;
+	}
+
+	for (i = 1; i <= len; i++) {
+		dp_bucket_t *bucket;
+
+		memcpy(key, dest, i);
+		key[i] = '\0';
+
+		if ((bucket = switch_core_hash_find(ctx->prefixes, key))) {
+			for (link = bucket->head; link; link = link->next) {
+				if (link->idx >= start) {
+					cand[n++] = link->idx;
+				}
+			}
+		}
+	}
+
+	if (n > 1) {
+		qsort(cand, n, sizeof(*cand), dp_idx_cmp);
+	}
+
+	return n;
+}
+
 static switch_status_t dialplan_xml_locate(switch_core_session_t *session, switch_caller_profile_t *caller_profile, switch_xml_t *root,
 										   switch_xml_t *node)
 {
@@ -617,6 +987,76 @@ static switch_status_t dialplan_xml_locate(switch_core_session_t *session, switc
 	return status;
 }
 
+/* returns true once an extension matched and does not want the hunt to continue */
+static int hunt_exten(switch_core_session_t *session, switch_caller_profile_t *caller_profile, switch_xml_t xexten,
+					  switch_caller_extension_t **extension)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	int proceed = 0;
+	const char *cont = switch_xml_attr(xexten, "continue");
+	const char *exten_name = switch_xml_attr(xexten, "name");
+
+	if (!exten_name) {
+		exten_name = "UNKNOWN";
+	}
+
+	if ( switch_core_test_flag(SCF_DIALPLAN_TIMESTAMPS) ) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG,
+					  "Dialplan: %s parsing [%s->%s] continue=%s\n",
+					  switch_channel_get_name(channel), caller_profile->context, exten_name, cont ? cont : "false");
+	} else {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
+					  "Dialplan: %s parsing [%s->%s] continue=%s\n",
+					  switch_channel_get_name(channel), caller_profile->context, exten_name, cont ? cont : "false");
+	}
+
+	proceed = parse_exten(session, caller_profile, xexten, extension, exten_name, 0);
+
+	return proceed && !switch_true(cont);
+}
+
+/* same walk as the plain loop in dialplan_hunt, only visiting the extensions the prefix index cannot rule out */
+static void dp_context_hunt(switch_core_session_t *session, switch_caller_profile_t *caller_profile, dp_context_t *ctx, switch_xml_t xstart,
+							switch_caller_extension_t **extension)
+{
+	uint32_t *cand = NULL, ncand, start = 0, i = 0;
+	char *dest = NULL;
+
+	if (!ctx->count) {
+		return;
+	}
+
+	while (start < ctx->count && ctx->extens[start] != xstart) {
+		start++;
+	}
+
+	switch_zmalloc(cand, sizeof(*cand) * ctx->count);
+	dest = strdup(switch_str_nil(caller_profile->destination_number));
+	switch_assert(dest);
+
+	ncand = dp_context_candidates(ctx, dest, start, cand);
+
+	while (i < ncand) {
+		uint32_t pos = cand[i++];
+
+		if (hunt_exten(session, caller_profile, ctx->extens[pos], extension)) {
+			break;
+		}
+
+		if (strcmp(dest, switch_str_nil(caller_profile->destination_number))) {
+			/* an inline application changed the destination, the rest is judged against the new one */
+			free(dest);
+			dest = strdup(switch_str_nil(caller_profile->destination_number));
+			switch_assert(dest);
+			ncand = dp_context_candidates(ctx, dest, pos + 1, cand);
+			i = 0;
+		}
+	}
+
+	free(dest);
+	free(cand);
+}
+
 SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 {
 	switch_caller_extension_t *extension = NULL;
@@ -624,6 +1064,8 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 	switch_xml_t alt_root = NULL, cfg, xml = NULL, xcontext, xexten = NULL;
 	char *alt_path = (char *) arg;
 	const char *hunt = NULL;
+	dp_index_t *index = NULL;
+	dp_context_t *ctx = NULL;
 
 	if (!caller_profile) {
 		if (!(caller_profile = switch_channel_get_caller_profile(channel))) {
@@ -679,38 +1121,25 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 		xexten = switch_xml_child(xcontext, "extension");
 	}
 
-	while (xexten) {
-		int proceed = 0;
-		const char *cont = switch_xml_attr(xexten, "continue");
-		const char *exten_name = switch_xml_attr(xexten, "name");
-
-		if (!exten_name) {
-			exten_name = "UNKNOWN";
-		}
-
-		if ( switch_core_test_flag(SCF_DIALPLAN_TIMESTAMPS) ) {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG,
-						  "Dialplan: %s parsing [%s->%s] continue=%s\n",
-						  switch_channel_get_name(channel), caller_profile->context, exten_name, cont ? cont : "false");
-		} else {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
-						  "Dialplan: %s parsing [%s->%s] continue=%s\n",
-						  switch_channel_get_name(channel), caller_profile->context, exten_name, cont ? cont : "false");
-		}
-
-		proceed = parse_exten(session, caller_profile, xexten, &extension, exten_name, 0);
+	if (!alt_root && (index = dp_index_acquire(xml)) && (ctx = dp_index_find_context(index, xcontext))) {
+		dp_context_hunt(session, caller_profile, ctx, xexten, &extension);
+	} else {
+		while (xexten) {
+			if (hunt_exten(session, caller_profile, xexten, &extension)) {
+				break;
+			}
 
-		if (proceed && !switch_true(cont)) {
-			break;
+			xexten = xexten->next;
 		}
-
-		xexten = xexten->next;
 	}
 
 	switch_xml_free(xml);
 	xml = NULL;
 
   done:
+	if (index) {
+		dp_index_release(index);
+	}
 	switch_xml_free(xml);
 	return extension;
 }
@@ -723,10 +1152,38 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_dialplan_xml_load)
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 	SWITCH_ADD_DIALPLAN(dp_interface, "XML", dialplan_hunt);
 
+	memset(&globals, 0, sizeof(globals));
+	switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_mutex_init(&globals.build_mutex, SWITCH_MUTEX_NESTED, pool);
+
+	if (switch_event_bind_removable(modname, SWITCH_EVENT_RELOADXML, NULL, dp_index_reload_handler, NULL, &globals.reload_node) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind reloadxml, the dialplan index will be rebuilt on demand\n");
+	}
+
+	dp_index_rebuild();
+
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_dialplan_xml_shutdown)
+{
+	dp_index_t *index;
+
+	switch_event_unbind(&globals.reload_node);
+
+	switch_mutex_lock(globals.mutex);
+	index = globals.index;
+	globals.index = NULL;
+	switch_mutex_unlock(globals.mutex);
+
+	if (index) {
+		dp_index_release(index);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 /* For Emacs:
  * Local Variables:
  * mode:c
@@ -0,0 +1,155 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2020, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ *
+ * test_mod_dialplan_xml.c -- checks the destination prefix index against a full scan
+ *
+ */
+#include <switch.h>
+#include <test/switch_test.h>
+
+/*
+ * Dialplans loaded from an alternate path are never indexed, so a copy of the context written to a file
+ * gives the result of the plain walk to compare with.
+ */
+static char *write_scan_copy(const char *context_name)
+{
+	switch_xml_t root, xsection, xcontext;
+	char *path = NULL, *txt = NULL;
+	FILE *f;
+
+	if (!(root = switch_xml_root())) {
+		return NULL;
+	}
+
+	if ((xsection = switch_xml_find_child(root, "section", "name", "dialplan")) &&
+		(xcontext = switch_xml_find_child(xsection, "context", "name", context_name)) &&
+		(txt = switch_xml_toxml(xcontext, SWITCH_FALSE))) {
+		path = switch_mprintf("%s%sdp_index_scan_%lu.xml", SWITCH_GLOBAL_dirs.temp_dir, SWITCH_PATH_SEPARATOR, (unsigned long) switch_getpid());
+
+		if ((f = fopen(path, "w"))) {
+			fprintf(f, "<document type=\"freeswitch/xml\">\n<section name=\"dialplan\">\n<dialplan>\n%s\n</dialplan>\n</section>\n</document>\n", txt);
+			fclose(f);
+		} else {
+			switch_safe_free(path);
+		}
+	}
+
+	switch_safe_free(txt);
+	switch_xml_free(root);
+
+	return path;
+}
+
+/* runs the XML dialplan for dest and flattens the resulting extension to "app(data);..." */
+static char *hunt(switch_core_session_t *session, const char *context, const char *dest, const char *alt_path)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	switch_dialplan_interface_t *dp;
+	switch_caller_extension_t *extension;
+	switch_caller_application_t *app;
+	switch_stream_handle_t stream = { 0 };
+
+	switch_channel_set_profile_var(channel, "context", context);
+	switch_channel_set_profile_var(channel, "destination_number", dest);
+
+	if (!(dp = switch_loadable_module_get_dialplan_interface("XML"))) {
+		return NULL;
+	}
+
+	extension = dp->hunt_function(session, (void *) alt_path, switch_channel_get_caller_profile(channel));
+	UNPROTECT_INTERFACE(dp);
+
+	SWITCH_STANDARD_STREAM(stream);
+
+	for (app = extension ? extension->applications : NULL; app; app = app->next) {
+		stream.write_function(&stream, "%s(%s);", app->application_name, switch_str_nil(app->application_data));
+	}
+
+	return (char *) stream.data;
+}
+
+FST_CORE_BEGIN("./conf")
+{
+	FST_MODULE_BEGIN(mod_dialplan_xml, mod_dialplan_xml_test)
+	{
+		FST_SETUP_BEGIN()
+		{
+			fst_requires_module("mod_loopback");
+			fst_requires_module("mod_dptools");
+		}
+		FST_SETUP_END()
+
+		FST_TEARDOWN_BEGIN()
+		{
+		}
+		FST_TEARDOWN_END()
+
+		FST_SESSION_BEGIN(prefix_index_matches_full_scan)
+		{
+			const char *dests[] = { "1000", "1001", "+4420", "+45", "2000", "2555", "3000", "4555", "5000", "9999", "71000", "72000", "" };
+			const char *expect[][2] = {
+				{ "1000", "set(hit=exact_1000);" },
+				{ "+4420", "set(hit=uk_20);" },
+				{ "2000", "set(hit=two_000);set(hit=alternation_2000);" },
+				{ "2555", "set(hit=two_555);set(hit=unanchored);" },
+				{ "4555", "set(hit=unanchored);" },
+				{ "5000", "set(hit=5000);" },
+				{ "9999", "set(hit=not_5000);" },
+				{ "71000", "set(hit=rewrite_1000);set(hit=after_rewrite_1000);" },
+				{ "72000", "set(hit=rewrite_2000);set(hit=not_5000);" },
+				{ NULL, NULL }
+			};
+			char *alt_path, *indexed, *scanned;
+			int i, j;
+
+			alt_path = write_scan_copy("dp_index");
+			fst_requires(alt_path);
+
+			for (i = 0; i < (int) (sizeof(dests) / sizeof(dests[0])); i++) {
+				indexed = hunt(fst_session, "dp_index", dests[i], NULL);
+				scanned = hunt(fst_session, "dp_index", dests[i], alt_path);
+
+				fst_requires(indexed && scanned);
+				fst_xcheck(!strcmp(indexed, scanned), dests[i]);
+
+				for (j = 0; expect[j][0]; j++) {
+					if (!strcmp(expect[j][0], dests[i])) {
+						fst_check_string_equals(indexed, expect[j][1]);
+					}
+				}
+
+				switch_safe_free(indexed);
+				switch_safe_free(scanned);
+			}
+
+			unlink(alt_path);
+			switch_safe_free(alt_path);
+		}
+		FST_SESSION_END()
+	}
+	FST_MODULE_END()
+}
+FST_CORE_END()
@@ -1,23 +1,17 @@
 #include <switch.h>
 
 #include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
 #include <gst/audio/audio-channels.h>
 #include <gst/net/net.h>
 #include "aes67_api.h"
+#include "aes67_pcm.h"
 
 #define ELEMENT_NAME_SIZE 30 + SESSION_ID_LEN
 #define STR_SIZE 15
 #define NAME_ELEMENT(name, element, ch_idx) \
     g_snprintf(name, ELEMENT_NAME_SIZE, "%s-ch%u", element, ch_idx)
 
-#define NAME_SESSION_ELEMENT(name, element, ch_idx, sess_id) \
-  do { \
-    if (sess_id != NULL) \
-      g_snprintf(name, ELEMENT_NAME_SIZE, "%s-ch%u-sess%s", element, ch_idx, sess_id); \
-    else \
-      g_snprintf(name, ELEMENT_NAME_SIZE, "%s-ch%u", element, ch_idx); \
-  } while (0)
-
 #define RTP_DEPAY "rx-depay"
 
 #ifdef _WIN32
@@ -53,6 +47,14 @@ channel_remap_t channel_remaps[] = {
   },
 };
 
+static inline gboolean
+stream_is_flowing (g_stream_t *stream)
+{
+  GstState state = g_atomic_int_get (&stream->state);
+
+  return state == GST_STATE_PAUSED || state == GST_STATE_PLAYING;
+}
+
 static void
 dump_pipeline (GstPipeline *pipe, const char *name)
 {
@@ -75,6 +77,7 @@ bus_callback (GstBus * bus, GstMessage * msg, gpointer data)
     case GST_MESSAGE_EOS:
       switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO,
           "End of stream\n");
+      g_atomic_int_set (&stream->state, GST_STATE_NULL);
       gst_element_set_state (pipeline, GST_STATE_NULL);
       break;
 
@@ -91,6 +94,7 @@ bus_callback (GstBus * bus, GstMessage * msg, gpointer data)
         stream->error_cb (error->message, stream);
       g_error_free (error);
 
+      g_atomic_int_set (&stream->state, GST_STATE_NULL);
       gst_element_set_state (pipeline, GST_STATE_NULL);
       break;
     }
@@ -101,6 +105,8 @@ bus_callback (GstBus * bus, GstMessage * msg, gpointer data)
       if (msg->src == (GstObject *) pipe) {
         gchar *old_state, *new_state, *transition;
         guint len = 0;
+
+        g_atomic_int_set (&stream->state, new);
         old_state = g_strdup (gst_element_state_get_name (old));
         new_state = g_strdup (gst_element_state_get_name (new));
         len = strlen (old_state) + strlen (new_state) + strlen ("_to_") + 5;
@@ -143,39 +149,6 @@ destroy_caps(void *data, GClosure G_GNUC_UNUSED *closure)
 }
 #endif
 
-static void
-deinterleave_pad_added (GstElement * deinterleave, GstPad * pad,
-    gpointer userdata)
-{
-  GstElement *pipeline =
-      GST_ELEMENT (gst_element_get_parent (deinterleave)), *tee;
-  GstPad *tee_sink_pad;
-  gchar name[ELEMENT_NAME_SIZE];
-  gchar *pad_name;
-  guint ch_idx;
-
-  pad_name = gst_pad_get_name (pad);
-  sscanf (pad_name, "src_%u", &ch_idx);
-
-  NAME_ELEMENT (name, "tee", ch_idx);
-  tee = gst_bin_get_by_name (GST_BIN (pipeline), name);
-  g_assert_nonnull (tee);
-
-  tee_sink_pad = gst_element_get_static_pad (tee, "sink");
-
-  if (gst_pad_link (pad, tee_sink_pad) != GST_PAD_LINK_OK) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to link deinterleave %s pad in the rx pipeline", pad_name);
-  }
-
-  dump_pipeline(GST_PIPELINE(pipeline), pad_name);
-
-  gst_object_unref (tee_sink_pad);
-  gst_object_unref(tee);
-  gst_object_unref(pipeline);
-  g_free (pad_name);
-}
-
 gboolean update_clock (gpointer userdata) {
   g_stream_t *stream = (g_stream_t *) userdata;
   GstStructure *stats = NULL;
@@ -211,236 +184,293 @@ gboolean update_clock (gpointer userdata) {
   return G_SOURCE_CONTINUE;
 }
 
+static gint
+find_listener (g_stream_t *stream, guint ch_idx, const gchar *session)
+{
+  g_listener_t *listeners = g_atomic_pointer_get (&stream->ch[ch_idx].listeners);
+
+  if (listeners == NULL)
+    return -1;
+
+  for (gint slot = 0; slot < MAX_CHANNEL_LISTENERS; slot++) {
+    if (g_atomic_int_get (&listeners[slot].active) &&
+        !strcmp (listeners[slot].session, session))
+      return slot;
+  }
+
+  return -1;
+}
+
 /*
-  Creates a new queue and appsink and links them to a new branch (sink pad)
-  of the tee in the Rx pipeline. These are associated to a particular session
-  calling on an endpoint.
+  Registers a session as a reader of a RX channel. The audio is read from the
+  shared RX ring, so this does not touch the pipeline.
   This allows to accept multiple listeners on single endpoint
 
+  Returns the listener slot to be passed to `pull_buffers`, or -1 on failure.
+  If the session already listens to the channel its slot is returned.
+
   Note: The caller needs to lock the `stream` using `STREAM_READER_LOCK` before
   calling this function and unlock the `stream` using `STREAM_READER_UNLOCK` after
   returning from this function
 
 */
 
-gboolean
-add_appsink (g_stream_t *stream, guint ch_idx, gchar *session)
+gint
+add_listener (g_stream_t *stream, guint ch_idx, gchar *session)
 {
-  gchar name[ELEMENT_NAME_SIZE];
-  gchar dot_name[ELEMENT_NAME_SIZE+10];
-  GstPad *tee_src_pad = NULL, *queue_sink_pad = NULL;
-  GstElement *tee = NULL, *queue = NULL, *appsink = NULL;
-  gboolean ret = FALSE;
-
-  NAME_ELEMENT(name, "tee", ch_idx);
-  tee = gst_bin_get_by_name (GST_BIN(stream->pipeline), name);
-  if (tee == NULL) {
+  g_listener_t *listeners;
+  gint slot = -1;
+
+  if (ch_idx >= MAX_IO_CHANNELS || session == NULL)
+    return -1;
+
+  if (stream->rx_ring == NULL || ch_idx >= (guint) stream->rx_ring->channels) {
     switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to get %s element in the pipeline\n", name);
-    goto error;
+        "No rx ch: %d in the pipeline\n", ch_idx);
+    return -1;
   }
 
-  NAME_SESSION_ELEMENT(name, "queue", ch_idx, session);
-  if (NULL != (queue = gst_bin_get_by_name(GST_BIN (stream->pipeline), name))) {
+  if ((slot = find_listener (stream, ch_idx, session)) >= 0) {
     switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE,
-        "%s already exists in the pipeline ch: %d, session %s", name, ch_idx, session);
-    goto error;
+        "listener already exists in the pipeline ch: %d, session %s\n", ch_idx, session);
+    return slot;
   }
-#ifndef ENABLE_THREADSHARE
-      queue = gst_element_factory_make ("queue", name);
-#else
-      MAKE_TS_ELEMENT(queue, "ts-queue", name, stream->ts_ctx);
-#endif
 
-  NAME_SESSION_ELEMENT(name, "appsink", ch_idx, session);
-  appsink = gst_element_factory_make ("appsink", name);
+  if (NULL == (listeners = g_atomic_pointer_get (&stream->ch[ch_idx].listeners))) {
+    g_listener_t *fresh = g_new0 (g_listener_t, MAX_CHANNEL_LISTENERS);
 
-  if (!queue || !appsink ) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-            "Failed to create appsink or queue element for ch: %d, session %s", ch_idx, session);
-    goto error;
+    /* Endpoints sharing the channel may get here at the same time */
+    if (!g_atomic_pointer_compare_and_exchange (&stream->ch[ch_idx].listeners,
+            NULL, fresh))
+      g_free (fresh);
+    listeners = g_atomic_pointer_get (&stream->ch[ch_idx].listeners);
   }
 
-  g_object_set (appsink, "emit-signals", FALSE, "sync", FALSE, "async", FALSE,
-      "drop", TRUE, "max-buffers", 1, "enable-last-sample", FALSE, NULL);
-
-  if (!gst_bin_add(GST_BIN(stream->pipeline), appsink)) {
-	  switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-			"Failed to add appsink to the pipeline ch: %d, session: %s", ch_idx, session);
-    goto error;
+  for (slot = 0; slot < MAX_CHANNEL_LISTENERS; slot++) {
+    if (g_atomic_int_compare_and_exchange (&listeners[slot].active, 0, 1))
+      break;
   }
 
-  if(!gst_bin_add(GST_BIN(stream->pipeline), queue)) {
-	  switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-			"Failed to add queue to the pipeline ch: %d, session: %s", ch_idx, session);
-    goto error;
+  if (slot == MAX_CHANNEL_LISTENERS) {
+    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+        "Too many listeners on ch: %d, session %s\n", ch_idx, session);
+    return -1;
   }
 
-  if (!gst_element_link(queue, appsink)) {
-	  switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-						"Failed to link appsink and queue ch: %d, session: %s", ch_idx, session);
-    goto error;
-  }
+  g_strlcpy (listeners[slot].session, session, SESSION_ID_LEN);
+  listeners[slot].cursor = 0;
+  listeners[slot].offset = 0;
+  listeners[slot].synced = FALSE;
 
-  if (NULL == (tee_src_pad = gst_element_request_pad_simple (tee, "src_%u"))) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-            "Failed to get src pad from the tee element ch: %d, session: %s", ch_idx, session);
-    goto error;
-  }
+  return slot;
+}
 
-  if (NULL == (queue_sink_pad = gst_element_get_static_pad (queue, "sink"))) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-            "Failed to get sink pad from the queue element ch: %d, session: %s", ch_idx, session);
-    goto error;
-  }
+/*
+  Drops a session from the readers of a RX channel.
 
-  if (!gst_element_sync_state_with_parent (queue)) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-            "Failed to sync queue state with pipeline. ch: %d, session: %s", ch_idx, session);
-    goto error;
-  }
+  Note: The caller needs to lock the `stream` using `STREAM_READER_LOCK` before
+  calling this function and unlock the `stream` using `STREAM_READER_UNLOCK` after
+  returning from this function
 
-  if (!gst_element_sync_state_with_parent(appsink)) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-            "Failed to sync appsink state with pipeline. ch: %d, session: %s", ch_idx, session);
-    goto error;
-  }
+*/
 
-  if (GST_PAD_LINK_OK != (gst_pad_link(tee_src_pad, queue_sink_pad))) {
+gboolean
+remove_listener (g_stream_t *stream, guint ch_idx, gchar *session)
+{
+  gint slot;
+
+  if (ch_idx >= MAX_IO_CHANNELS || session == NULL)
+    return FALSE;
+
+  if ((slot = find_listener (stream, ch_idx, session)) < 0) {
     switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-            "Failed to link the queue and tee. ch: %d, session: %s", ch_idx, session);
-    goto error;
+        "No listener in the pipeline for ch: %d, session: %s\n", ch_idx, session);
+    return FALSE;
   }
 
-  g_snprintf(dot_name, ELEMENT_NAME_SIZE+10, "%s-add", name);
-  dump_pipeline(GST_PIPELINE(stream->pipeline), dot_name);
+  stream->ch[ch_idx].listeners[slot].session[0] = '\0';
+  g_atomic_int_set (&stream->ch[ch_idx].listeners[slot].active, 0);
 
-  ret = TRUE;
-  goto exit;
+  return TRUE;
+}
 
-  error:
-    if (NULL != appsink)
-      gst_object_unref(appsink);
-    if (NULL != queue)
-      gst_object_unref(queue);
-    if (NULL != tee)
-      gst_object_unref(tee);
+static g_rx_ring_t *
+rx_ring_new (gint channels, guint samples)
+{
+  g_rx_ring_t *ring = g_new0 (g_rx_ring_t, 1);
+
+  ring->channels = channels;
+  ring->samples = samples;
+  ring->data = g_new0 (gint16, (gsize) RX_RING_PACKETS * channels * samples);
+  ring->seq = g_new (guint, RX_RING_PACKETS);
+  for (guint i = 0; i < RX_RING_PACKETS; i++)
+    ring->seq[i] = RX_SLOT_BUSY;
+  g_mutex_init (&ring->lock);
+  g_cond_init (&ring->cond);
+
+  return ring;
+}
 
-  exit:
-    if (NULL != tee_src_pad)
-      gst_object_unref(tee_src_pad);
-    if (NULL != queue_sink_pad)
-      gst_object_unref(queue_sink_pad);
+static void
+rx_ring_free (g_rx_ring_t *ring)
+{
+  if (!ring)
+    return;
 
-  return ret;
+  g_mutex_clear (&ring->lock);
+  g_cond_clear (&ring->cond);
+  g_free (ring->scratch);
+  g_free ((gpointer) ring->seq);
+  g_free (ring->data);
+  g_free (ring);
 }
 
 /*
-  Unlinks a session's associated queue and appsink from the tee and removes them
-  from the Rx pipeline.
-
-  Note: The caller needs to lock the `stream` using `STREAM_READER_LOCK` before
-  calling this function and unlock the `stream` using `STREAM_READER_UNLOCK` after
-  returning from this function
-
+  rx appsink new-sample callback, runs in the streaming thread and is the
+  only writer of the ring. Stores the packet de-interleaved in the slot of
+  its packet number. Buffers without a usable timestamp, or going
+  backwards, are stored as the packet following the latest one.
 */
+static GstFlowReturn
+rx_new_sample (GstAppSink *appsink, gpointer userdata)
+{
+  g_stream_t *stream = (g_stream_t *) userdata;
+  g_rx_ring_t *ring = stream->rx_ring;
+  GstSample *sample;
+  GstBuffer *buf;
+  GstMapInfo info;
+  guint pkt, slot, frames;
+  gint16 *dst;
+  const gint16 *src;
 
-gboolean
-remove_appsink(g_stream_t *stream, guint ch_idx, gchar *session) {
-  gchar name[ELEMENT_NAME_SIZE];
-  gchar dot_name[ELEMENT_NAME_SIZE + 10];
-
-  GstElement *queue = NULL, *appsink = NULL, *tee = NULL;
-  GstPad *tee_src_pad = NULL, *queue_sink_pad = NULL;
-  gboolean ret = FALSE;
-
-  /*
-   * tee -> queue -> appsink
-   *
-   * We unlink the tee and queue first and then remove the queue and
-   * appsink.
-   */
-  NAME_SESSION_ELEMENT(name, "queue", ch_idx, session);
-  queue = gst_bin_get_by_name (GST_BIN (stream->pipeline), name);
-  if (queue == NULL ) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to find %s in the pipeline\n", name);
-    goto exit;
-  }
+  if (NULL == (sample = gst_app_sink_pull_sample (appsink)))
+    return GST_FLOW_OK;
 
-  NAME_ELEMENT(name, "tee", ch_idx);
-	tee = gst_bin_get_by_name (GST_BIN (stream->pipeline), name);
-  if (tee == NULL ) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to find %s in the pipeline\n", name);
-    goto exit;
+  buf = gst_sample_get_buffer (sample);
+  if (!buf || !gst_buffer_map (buf, &info, GST_MAP_READ)) {
+    gst_sample_unref (sample);
+    return GST_FLOW_OK;
   }
 
-  if (NULL == (queue_sink_pad = gst_element_get_static_pad (queue, "sink"))) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-            "Failed to get sink pad from the queue element ch: %d, session: %s", ch_idx, session);
-    goto exit;
+  if (GST_BUFFER_PTS_IS_VALID (buf))
+    pkt = gst_util_uint64_scale (GST_BUFFER_PTS (buf), stream->sample_rate,
+        GST_SECOND) / ring->samples;
+  else
+    pkt = ring->latest + 1;
+
+  if (g_atomic_int_get (&ring->primed) && (gint) (pkt - ring->latest) <= 0)
+    pkt = ring->latest + 1;
+
+  slot = pkt % RX_RING_PACKETS;
+  if (ring->l24) {
+    frames = MIN (info.size / (3 * ring->channels), ring->samples);
+    aes67_unpack_l24 (ring->scratch, info.data, frames * ring->channels);
+    src = ring->scratch;
+  } else {
+    frames = MIN (info.size / (sizeof (gint16) * ring->channels), ring->samples);
+    src = (const gint16 *) info.data;
   }
+  dst = ring->data + (gsize) slot * ring->channels * ring->samples;
 
-  if (NULL == (tee_src_pad = gst_pad_get_peer (queue_sink_pad))) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-            "Failed to get src pad from the tee element ch: %d, session: %s", ch_idx, session);
-    goto exit;
+  g_atomic_int_set (&ring->seq[slot], RX_SLOT_BUSY);
+  for (gint ch = 0; ch < ring->channels; ch++) {
+    gint16 *out = dst + (gsize) ch * ring->samples;
+
+    for (guint i = 0; i < frames; i++)
+      out[i] = src[i * ring->channels + ch];
+    if (frames < ring->samples)
+      memset (out + frames, 0, (ring->samples - frames) * sizeof (gint16));
   }
+  g_atomic_int_set (&ring->seq[slot], pkt);
 
-  if (!gst_pad_unlink(tee_src_pad, queue_sink_pad)) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-            "Failed to unlink tee and queue ch: %d, session: %s", ch_idx, session);
+  if (stream->metering) {
+    g_mutex_lock (&stream->level_lock);
+    for (gint ch = 0; ch < ring->channels; ch++) {
+      g_level_t *level = &stream->ch[ch].rx_level;
+
+      aes67_level_s16 (dst + (gsize) ch * ring->samples, frames, &level->peak,
+          &level->sumsq);
+      level->samples += frames;
+    }
+    g_mutex_unlock (&stream->level_lock);
   }
-  gst_element_release_request_pad (tee, tee_src_pad);
 
-  gst_object_unref(tee_src_pad);
-  tee_src_pad = NULL;
+  g_mutex_lock (&ring->lock);
+  g_atomic_int_set (&ring->latest, pkt);
+  g_atomic_int_set (&ring->primed, 1);
+  g_cond_broadcast (&ring->cond);
+  g_mutex_unlock (&ring->lock);
 
-  gst_object_unref(queue_sink_pad);
-  queue_sink_pad = NULL;
+  gst_buffer_unmap (buf, &info);
+  gst_sample_unref (sample);
 
-  NAME_SESSION_ELEMENT(name, "appsink", ch_idx, session);
-  appsink = gst_bin_get_by_name (GST_BIN (stream->pipeline), name);
-  if (appsink == NULL ) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to find %s in the pipeline\n", name);
-    goto exit;
-  }
+  return GST_FLOW_OK;
+}
 
-  gst_element_unlink(queue, appsink);
+/*
+  Copies up to `max_bytes` of `ch_idx` for the listener into `out`, starting
+  where its previous read stopped so that a partial packet never needs to be
+  carried over. Waits up to 10ms for the writer when the listener caught up
+  with it. A packet that was lost, or overwritten while being copied, reads
+  as silence. Returns the number of bytes copied, 0 if nothing arrived in
+  time.
+*/
+static guint
+rx_ring_read (g_rx_ring_t *ring, guint ch_idx, g_listener_t *listener,
+    unsigned char *out, guint max_bytes)
+{
+  guint latest, slot, seq, bytes;
+  guint packet_bytes = ring->samples * sizeof (gint16);
+
+  if (listener->offset == 0) {
+    if (!g_atomic_int_get (&ring->primed) ||
+        g_atomic_int_get (&ring->latest) + 1 == listener->cursor) {
+      gint64 end_time = g_get_monotonic_time () + 10 * G_TIME_SPAN_MILLISECOND;
+
+      g_mutex_lock (&ring->lock);
+      while (!g_atomic_int_get (&ring->primed) ||
+          (listener->synced && ring->latest + 1 == listener->cursor)) {
+        if (!g_cond_wait_until (&ring->cond, &ring->lock, end_time))
+          break;
+      }
+      g_mutex_unlock (&ring->lock);
 
-  if (!gst_bin_remove(GST_BIN(stream->pipeline), queue)) {
-    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to remove queue from the pipeline ch: %d, session: %s", ch_idx, session);
-  }
+      if (!g_atomic_int_get (&ring->primed))
+        return 0;
+    }
 
-  if (!gst_bin_remove(GST_BIN(stream->pipeline), appsink)) {
-    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to remove appsink from the pipeline ch: %d, session: %s", ch_idx, session);
-  }
+    latest = g_atomic_int_get (&ring->latest);
 
-  gst_element_set_state(queue, GST_STATE_NULL);
-  gst_element_set_state(appsink, GST_STATE_NULL);
+    /* First read, fell too far behind or the writer restarted: jump to the
+       newest packet */
+    if (!listener->synced || (gint) (latest - listener->cursor) >= RX_RING_PACKETS ||
+        (gint) (listener->cursor - latest) > 1) {
+      listener->cursor = latest;
+      listener->synced = TRUE;
+    }
 
-  g_snprintf(dot_name, ELEMENT_NAME_SIZE+10, "%s-del", name);
-  dump_pipeline(GST_PIPELINE(stream->pipeline), dot_name);
+    if (listener->cursor == latest + 1)
+      return 0;
+  }
 
-  ret = TRUE;
+  bytes = MIN (max_bytes, packet_bytes - listener->offset);
+  slot = listener->cursor % RX_RING_PACKETS;
+  seq = g_atomic_int_get (&ring->seq[slot]);
+  if (seq == listener->cursor) {
+    memcpy (out, (unsigned char *) (ring->data + ((gsize) slot * ring->channels
+                + ch_idx) * ring->samples) + listener->offset, bytes);
+    seq = g_atomic_int_get (&ring->seq[slot]);
+  }
+  if (seq != listener->cursor)
+    memset (out, 0, bytes);
 
-exit:
-  if (NULL != tee_src_pad)
-    gst_object_unref(tee_src_pad);
-  if (NULL != queue_sink_pad)
-    gst_object_unref(queue_sink_pad);
-  if (NULL != appsink)
-    gst_object_unref(appsink);
-  if (NULL != queue)
-    gst_object_unref(queue);
-  if (NULL != tee)
-    gst_object_unref(tee);
+  listener->offset += bytes;
+  if (listener->offset == packet_bytes) {
+    listener->offset = 0;
+    listener->cursor++;
+  }
 
-  return ret;
+  return bytes;
 }
 
 static gboolean
@@ -520,12 +550,209 @@ backup_sender_timeout_cb(gpointer userdata)
   return TRUE;
 }
 
+static g_tx_ring_t *
+tx_ring_new (guint min_samples)
+{
+  g_tx_ring_t *ring = g_new0 (g_tx_ring_t, 1);
+  guint size = 1;
+
+  while (size < min_samples)
+    size <<= 1;
+
+  ring->data = g_new0 (gint16, size);
+  ring->mask = size - 1;
+
+  return ring;
+}
+
+static void
+tx_ring_free (g_tx_ring_t *ring)
+{
+  if (!ring)
+    return;
+
+  g_free (ring->data);
+  g_free (ring);
+}
+
+/* Session side: queues as many of `count` samples as fit, returns how many */
+static guint
+tx_ring_write (g_tx_ring_t *ring, const gint16 *samples, guint count)
+{
+  guint head = ring->head;
+  guint space = ring->mask + 1 - (head - g_atomic_int_get (&ring->tail));
+
+  count = MIN (count, space);
+  for (guint i = 0; i < count; i++)
+    ring->data[(head + i) & ring->mask] = samples[i];
+
+  /* Publish the samples only once they are written */
+  g_atomic_int_set (&ring->head, head + count);
+
+  return count;
+}
+
+/*
+  Pacing thread side: copies up to `count` samples into every `stride`-th
+  slot of `out`, returns how many were available
+*/
+static guint
+tx_ring_read (g_tx_ring_t *ring, gint16 *out, guint stride, guint count)
+{
+  guint tail = ring->tail;
+  guint avail = g_atomic_int_get (&ring->head) - tail;
+
+  count = MIN (count, avail);
+  for (guint i = 0; i < count; i++)
+    out[i * stride] = ring->data[(tail + i) & ring->mask];
+
+  g_atomic_int_set (&ring->tail, tail + count);
+
+  return count;
+}
+
+static gboolean
+tx_ring_push (g_stream_t *stream, guint ch_idx, unsigned char *payload,
+    guint len)
+{
+  guint samples = len / sizeof (gint16);
+
+  if (ch_idx >= (guint) stream->channels || !stream->ch[ch_idx].ring)
+    return FALSE;
+
+  if (!g_atomic_int_get (&stream->clock_sync) || !stream_is_flowing (stream))
+    return FALSE;
+
+  return tx_ring_write (stream->ch[ch_idx].ring, (gint16 *) payload,
+      samples) == samples;
+}
+
+/*
+  Interleaved TX mode: wakes up once per packet on the pipeline clock (the
+  PTP clock once it is synced), drains one packet worth of samples from each
+  channel ring into a single interleaved buffer and pushes it. Channels that
+  are short of samples are padded with silence.
+*/
+static gpointer
+tx_pacing_thread (gpointer data)
+{
+  g_stream_t *stream = data;
+  GstClock *clock = NULL;
+  GstClockTime next = GST_CLOCK_TIME_NONE;
+  GstClockTime period = stream->codec_ms * GST_MSECOND;
+  guint samples = stream->codec_ms * stream->sample_rate / 1000;
+  GstBufferPoolAcquireParams params = { 0, };
+
+  params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+
+  while (g_atomic_int_get (&stream->tx_running)) {
+    GstClock *current;
+    GstClockID id;
+    GstBuffer *buf = NULL;
+    GstMapInfo map;
+    GstClockTime base;
+    gboolean underrun = FALSE;
+
+    /* The clock changes when PTP gets synced, follow it */
+    current = gst_element_get_clock (GST_ELEMENT (stream->pipeline));
+    if (current != clock) {
+      if (clock)
+        gst_object_unref (clock);
+      clock = current;
+      next = GST_CLOCK_TIME_NONE;
+    } else if (current) {
+      gst_object_unref (current);
+    }
+
+    if (!clock || !g_atomic_int_get (&stream->clock_sync) ||
+        !stream_is_flowing (stream)) {
+      next = GST_CLOCK_TIME_NONE;
+      g_usleep (stream->codec_ms * 1000);
+      continue;
+    }
+
+    if (next == GST_CLOCK_TIME_NONE)
+      next = gst_clock_get_time (clock);
+    next += period;
+
+    id = gst_clock_new_single_shot_id (clock, next);
+    gst_clock_id_wait (id, NULL);
+    gst_clock_id_unref (id);
+
+    if (!stream->tx_pool || gst_buffer_pool_acquire_buffer (stream->tx_pool,
+            &buf, &params) != GST_FLOW_OK) {
+      g_atomic_int_inc (&stream->tx_allocs);
+      buf = gst_buffer_new_allocate (NULL,
+          samples * stream->channels * (stream->tx_l24 ? 3 : sizeof (gint16)), NULL);
+    }
+
+    if (!buf || !gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+      if (buf)
+        gst_buffer_unref (buf);
+      continue;
+    }
+
+    for (guint ch = 0; ch < stream->channels; ch++) {
+      gint16 *out = (stream->tx_l24 ? stream->tx_scratch : (gint16 *) map.data) + ch;
+      guint got = tx_ring_read (stream->ch[ch].ring, out, stream->channels,
+          samples);
+
+      for (guint i = got; i < samples; i++)
+        out[i * stream->channels] = 0;
+      underrun |= (got < samples);
+    }
+    if (stream->tx_l24)
+      aes67_pack_l24 (map.data, stream->tx_scratch, samples * stream->channels);
+    gst_buffer_unmap (buf, &map);
+
+    if (underrun)
+      g_atomic_int_inc (&stream->tx_underruns);
+
+    /* Stamp one packet ahead, the latency audiointerleave has in the
+       per-channel mode */
+    base = gst_element_get_base_time (GST_ELEMENT (stream->pipeline));
+    GST_BUFFER_PTS (buf) = next + period > base ? next + period - base : 0;
+    GST_BUFFER_DURATION (buf) = period;
+
+    gst_app_src_push_buffer (GST_APP_SRC (stream->tx_appsrc), buf);
+  }
+
+  if (clock)
+    gst_object_unref (clock);
+
+  return NULL;
+}
+
+static void
+free_tx_resources (g_stream_t *stream)
+{
+  for (guint ch = 0; ch < MAX_IO_CHANNELS; ch++) {
+    if (stream->ch[ch].pool) {
+      /* Buffers still in flight are freed when they come back */
+      gst_buffer_pool_set_active (stream->ch[ch].pool, FALSE);
+      gst_object_unref (stream->ch[ch].pool);
+      stream->ch[ch].pool = NULL;
+    }
+    tx_ring_free (stream->ch[ch].ring);
+    stream->ch[ch].ring = NULL;
+  }
+
+  if (stream->tx_pool) {
+    gst_buffer_pool_set_active (stream->tx_pool, FALSE);
+    gst_object_unref (stream->tx_pool);
+    stream->tx_pool = NULL;
+  }
+
+  g_free (stream->tx_scratch);
+  stream->tx_scratch = NULL;
+}
+
 g_stream_t *
 create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
 {
   GstBus *bus;
   GstElement *pipeline, *rtp_pay = NULL, *rtpdepay = NULL, *rtpjitbuf = NULL;
-  g_stream_t *stream = g_new (g_stream_t, 1);
+  g_stream_t *stream = g_new0 (g_stream_t, 1);
   char fixed_name[25] = { "pipeline" };
   char *ts_ctx = DEFAULT_CONTEXT_NAME;
   char *pipeline_name;
@@ -538,16 +765,21 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
     ts_ctx = data->ts_context_name;
 
   stream->ts_ctx = ts_ctx;
+  stream->channels = MIN (data->channels, MAX_IO_CHANNELS);
+  g_atomic_int_set (&stream->state, GST_STATE_NULL);
   pipeline = gst_pipeline_new (pipeline_name);
   if (!pipeline) {
     switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
         "Failed to create the pipeline\n");
+    g_free (stream);
     return NULL;
   }
+  g_mutex_init (&stream->level_lock);
+  stream->metering = data->metering;
 
   if (data->direction & DIRECTION_RX) {
-    GstElement *udp_source, *deinterleave, *rx_audioconv,
-        *capsfilter, *split, *tee;
+    GstElement *udp_source, *rx_audioconv = NULL, *capsfilter = NULL, *split, *appsink;
+    GstAppSinkCallbacks callbacks = { NULL, };
     GstCaps *udp_caps = NULL, *rx_caps = NULL;
 
 #ifndef ENABLE_THREADSHARE
@@ -582,44 +814,41 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
     g_object_set(rtpjitbuf, "latency", data->rtp_jitbuf_latency,
         "mode", 0 /* none */,
         NULL);
-    rx_audioconv = gst_element_factory_make ("audioconvert", "rx-aconv");
-    g_object_set(rx_audioconv, "dithering", 0 /* none */, NULL);
+    /*Always feed S16LE to the FS, L24 gets unpacked in rx_new_sample*/
+    if (data->rx_codec == L16) {
+      rx_audioconv = gst_element_factory_make ("audioconvert", "rx-aconv");
+      g_object_set(rx_audioconv, "dithering", 0 /* none */, NULL);
 
-    capsfilter = gst_element_factory_make ("capsfilter", "rx-caps");
+      capsfilter = gst_element_factory_make ("capsfilter", "rx-caps");
 
-    /*Always feed S16LE to the FS*/
-    rx_caps = gst_caps_new_simple ("audio/x-raw",
-        "channels", G_TYPE_INT, data->channels,
-        "format", G_TYPE_STRING, "S16LE",
-        "layout", G_TYPE_STRING, "interleaved", NULL);
+      rx_caps = gst_caps_new_simple ("audio/x-raw",
+          "channels", G_TYPE_INT, data->channels,
+          "format", G_TYPE_STRING, "S16LE",
+          "layout", G_TYPE_STRING, "interleaved", NULL);
 
-    g_object_set (capsfilter, "caps", rx_caps, NULL);
-    gst_caps_unref (rx_caps);
+      g_object_set (capsfilter, "caps", rx_caps, NULL);
+      gst_caps_unref (rx_caps);
+    }
 
     split = gst_element_factory_make ("audiobuffersplit", "rx-split");
     g_object_set (split, "output-buffer-duration", data->codec_ms, 1000, NULL);
 
-    deinterleave = gst_element_factory_make ("deinterleave", "rx-deinterleave");
-
-    for (guint ch = 0; ch < data->channels; ch++) {
-      gchar name[ELEMENT_NAME_SIZE];
-
-      NAME_ELEMENT(name, "tee", ch);
-      tee = gst_element_factory_make ("tee", name);
-
-      if (!tee) {
-        switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-            "Failed to create tee element in rx pipeline\n");
-        continue;
-      }
-      g_object_set(tee, "allow-not-linked", TRUE, NULL);
-
-      gst_bin_add (GST_BIN(pipeline), tee);
-      // The deinterleave will be linked to the tee dynamically
+    /* All the listeners read their channel out of the shared ring */
+    appsink = gst_element_factory_make ("appsink", "rx-sink");
+    if (appsink) {
+      g_object_set (appsink, "sync", FALSE, "async", FALSE, "drop", TRUE,
+          "max-buffers", RX_RING_PACKETS, "enable-last-sample", FALSE, NULL);
+      callbacks.new_sample = rx_new_sample;
+      gst_app_sink_set_callbacks (GST_APP_SINK (appsink), &callbacks, stream,
+          NULL);
+    }
+    stream->rx_ring = rx_ring_new (stream->channels,
+        data->codec_ms * data->sample_rate / 1000);
+    if (data->rx_codec == L24) {
+      stream->rx_ring->l24 = TRUE;
+      stream->rx_ring->scratch = g_new (gint16,
+          (gsize) stream->channels * stream->rx_ring->samples);
     }
-
-    g_signal_connect (deinterleave, "pad-added",
-        G_CALLBACK (deinterleave_pad_added), NULL);
 
     g_object_set (udp_source, "address", data->rx_ip_addr, "port", data->rx_port,
         "multicast-iface", data->rtp_iface,
@@ -628,18 +857,31 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
     g_object_set (udp_source, "caps", udp_caps, NULL);
     gst_caps_unref (udp_caps);
 
-    if (!udp_source || !rtpdepay || !rtpjitbuf || !rx_audioconv || !capsfilter
-        || !split || !deinterleave) {
+    if (!udp_source || !rtpdepay || !rtpjitbuf || !split || !appsink ||
+        (data->rx_codec == L16 && (!rx_audioconv || !capsfilter))) {
       switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
           "Failed to create rx elements\n");
       goto error;
     }
 
-    gst_bin_add_many (GST_BIN (pipeline), udp_source, rtpdepay, rtpjitbuf, rx_audioconv,
-        capsfilter, split, deinterleave, NULL);
+    gst_bin_add_many (GST_BIN (pipeline), udp_source, rtpdepay, rtpjitbuf,
+        split, appsink, NULL);
 
-    if (!gst_element_link_many (udp_source, rtpjitbuf, rtpdepay, split, rx_audioconv, capsfilter,
-            deinterleave, NULL)) {
+    if (!gst_element_link_many (udp_source, rtpjitbuf, rtpdepay, split, NULL)) {
+      switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+          "Failed to link elements in the rx pipeline");
+      goto error;
+    }
+
+    if (rx_audioconv) {
+      gst_bin_add_many (GST_BIN (pipeline), rx_audioconv, capsfilter, NULL);
+      if (!gst_element_link_many (split, rx_audioconv, capsfilter, appsink,
+              NULL)) {
+        switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+            "Failed to link elements in the rx pipeline");
+        goto error;
+      }
+    } else if (!gst_element_link (split, appsink)) {
       switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
           "Failed to link elements in the rx pipeline");
       goto error;
@@ -647,15 +889,59 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
   }
 
   if (data->direction & DIRECTION_TX) {
-    GstElement *udpsink, *tx_audioconv, *audiointerleave, *capsfilter, *tx_valve;
-    GstElement *appsrc;
+    GstElement *udpsink, *tx_audioconv = NULL, *audiointerleave = NULL, *capsfilter, *tx_valve;
+    GstElement *appsrc, *tx_head;
     GstCaps *caps = NULL;
+    /* L24 is packed by the module, audioconvert only handles L16 */
+    const gchar *tx_format = data->tx_codec == L24 ? "S24BE" : "S16LE";
+    gint sample_bytes = data->tx_codec == L24 ? 3 : 2;
 
-    audiointerleave =
-        gst_element_factory_make ("audiointerleave", "audiointerleave");
-    gst_bin_add (GST_BIN (pipeline), audiointerleave);
-    g_object_set(audiointerleave, "start-time-selection", GST_AGGREGATOR_START_TIME_SELECTION_FIRST, NULL);
-    g_object_set(audiointerleave, "output-buffer-duration", data->codec_ms * GST_MSECOND, NULL);
+    stream->tx_l24 = data->tx_codec == L24;
+
+    if (data->tx_interleaved) {
+      /* One appsrc carrying all the channels, filled by tx_pacing_thread */
+      appsrc = gst_element_factory_make ("appsrc", "tx-appsrc");
+      if (!appsrc) {
+        switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+            "Failed to create tx-appsrc\n");
+        goto error;
+      }
+
+      caps = gst_caps_new_simple ("audio/x-raw",
+          "rate", G_TYPE_INT, data->sample_rate,
+          "channels", G_TYPE_INT, data->channels,
+          "format", G_TYPE_STRING, tx_format,
+          "layout", G_TYPE_STRING, "interleaved",
+          "channel-mask", GST_TYPE_BITMASK, (guint64) 0, NULL);
+      g_object_set (appsrc, "format", GST_FORMAT_TIME, NULL);
+      /* Buffers are stamped by the pacing thread */
+      g_object_set (appsrc, "do-timestamp", FALSE, NULL);
+      g_object_set (appsrc, "is-live", TRUE, NULL);
+      g_object_set (appsrc, "max-bytes",
+          data->codec_ms * data->sample_rate * sample_bytes * data->channels * 3 / 1000, NULL);
+      g_object_set (appsrc, "caps", caps, NULL);
+      gst_caps_unref (caps);
+      gst_bin_add (GST_BIN (pipeline), appsrc);
+
+      stream->tx_interleaved = TRUE;
+      stream->tx_appsrc = appsrc;
+      stream->tx_pool = create_tx_pool (data->sample_rate, data->codec_ms,
+          stream->channels, sample_bytes);
+      if (stream->tx_l24)
+        stream->tx_scratch = g_new (gint16,
+            (gsize) stream->channels * data->codec_ms * data->sample_rate / 1000);
+      for (guint ch = 0; ch < stream->channels; ch++)
+        stream->ch[ch].ring = tx_ring_new (TX_RING_PACKETS *
+            data->codec_ms * data->sample_rate / 1000);
+      tx_head = appsrc;
+    } else {
+      audiointerleave =
+          gst_element_factory_make ("audiointerleave", "audiointerleave");
+      gst_bin_add (GST_BIN (pipeline), audiointerleave);
+      g_object_set(audiointerleave, "start-time-selection", GST_AGGREGATOR_START_TIME_SELECTION_FIRST, NULL);
+      g_object_set(audiointerleave, "output-buffer-duration", data->codec_ms * GST_MSECOND, NULL);
+      tx_head = audiointerleave;
+    }
 
     if (data->tx_codec == L16) {
       rtp_pay = gst_element_factory_make ("rtpL16pay", "rtp-pay");
@@ -670,7 +956,7 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
           "min-ptime", (gint64) (data->ptime_ms * 1000000), NULL);
     }
 
-    for (guint ch = 0; ch < data->channels; ch++) {
+    for (guint ch = 0; audiointerleave && ch < data->channels; ch++) {
       gchar name[ELEMENT_NAME_SIZE];
       gchar pad_name[STR_SIZE];
 
@@ -684,22 +970,25 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
         continue;
       }
 
-      /*Always accept S16LE from the FS*/
+      /*Always accept S16LE from the FS, packed to L24 in push_buffer if needed*/
       caps = gst_caps_new_simple ("audio/x-raw",
           "rate", G_TYPE_INT, data->sample_rate,
           "channels", G_TYPE_INT, 1,
-          "format", G_TYPE_STRING, "S16LE",
+          "format", G_TYPE_STRING, tx_format,
           "layout", G_TYPE_STRING, "interleaved",
           "channel-mask", GST_TYPE_BITMASK, (guint64) 0, NULL);
       g_object_set (appsrc, "format", GST_FORMAT_TIME, NULL);
       g_object_set (appsrc, "do-timestamp", TRUE, NULL);
       g_object_set (appsrc, "is-live", TRUE, NULL);
       /* Second * 3 allows a little bit of headroom */
-      g_object_set (appsrc, "max-bytes", data->codec_ms * data->sample_rate * 2 * 3 / 1000,  NULL);
+      g_object_set (appsrc, "max-bytes", data->codec_ms * data->sample_rate * sample_bytes * 3 / 1000,  NULL);
 
       g_object_set (appsrc, "caps", caps, NULL);
       gst_caps_unref (caps);
       gst_bin_add (GST_BIN (pipeline), appsrc);
+      stream->ch[ch].appsrc = appsrc;
+      stream->ch[ch].pool = create_tx_pool (data->sample_rate, data->codec_ms, 1,
+          sample_bytes);
 
       if (!gst_element_link_pads (appsrc, "src", audiointerleave, pad_name)) {
         switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
@@ -714,15 +1003,17 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
 
     capsfilter = gst_element_factory_make ("capsfilter", "tx-capsf");
 
-    tx_audioconv = gst_element_factory_make ("audioconvert", "tx-audioconv");
-    g_object_set(tx_audioconv, "dithering", 0 /* none */, NULL);
+    if (!stream->tx_l24) {
+      tx_audioconv = gst_element_factory_make ("audioconvert", "tx-audioconv");
+      g_object_set(tx_audioconv, "dithering", 0 /* none */, NULL);
+    }
 
     udpsink = gst_element_factory_make ("udpsink", "tx-sink");
 
     caps = gst_caps_new_simple ("audio/x-raw",
         "rate", G_TYPE_INT, data->sample_rate,
         "channels", G_TYPE_INT, data->channels,
-        "format", G_TYPE_STRING, "S16LE",
+        "format", G_TYPE_STRING, tx_format,
         "layout", G_TYPE_STRING, "interleaved",
         "channel-mask", GST_TYPE_BITMASK, (guint64) 0,
         NULL);
@@ -741,17 +1032,23 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
 #endif
     }
 
-    if (!audiointerleave || !tx_valve || !tx_audioconv || !rtp_pay || !udpsink) {
+    if (!tx_head || !tx_valve || !rtp_pay || !udpsink ||
+        (!stream->tx_l24 && !tx_audioconv)) {
       switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
           "Failed to create tx elements\n");
       goto error;
     }
 
-    gst_bin_add_many (GST_BIN (pipeline), tx_valve, capsfilter, tx_audioconv, rtp_pay,
+    gst_bin_add_many (GST_BIN (pipeline), tx_valve, capsfilter, rtp_pay,
         udpsink, NULL);
-
-    if (!gst_element_link_many (audiointerleave, tx_valve, capsfilter, tx_audioconv,
-            rtp_pay, udpsink, NULL)) {
+    if (tx_audioconv)
+      gst_bin_add (GST_BIN (pipeline), tx_audioconv);
+
+    if (!gst_element_link_many (tx_head, tx_valve, capsfilter, NULL) ||
+        (tx_audioconv && !gst_element_link_many (capsfilter, tx_audioconv,
+                rtp_pay, NULL)) ||
+        (!tx_audioconv && !gst_element_link (capsfilter, rtp_pay)) ||
+        !gst_element_link (rtp_pay, udpsink)) {
       switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
           "Failed to link elements");
       goto error;
@@ -831,6 +1128,7 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
   stream->mainloop = g_main_loop_new (NULL, FALSE);
   stream->thread = g_thread_new (pipeline_name, start_pipeline, stream);
   stream->sample_rate = data->sample_rate;
+  stream->codec_ms = data->codec_ms;
 
   g_atomic_int_set (&stream->clock_sync, 0);
 
@@ -838,7 +1136,8 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
   gst_element_set_base_time(pipeline, 0);
 
   if (rtp_pay) {
-    /* We have data->codec_ms of latency in the audiointerleave, so add that in */
+    /* We have data->codec_ms of latency in the audiointerleave, so add that in.
+       The interleaved mode stamps its buffers one packet ahead to match. */
     /* FIXME: we should be cleverer and apply the pipeline latency as computed instead */
     g_object_set (rtp_pay, "timestamp-offset",
         gst_util_uint64_scale_int ((data->codec_ms + data->rtp_ts_offset) * GST_MSECOND, data->sample_rate, GST_SECOND)
@@ -857,13 +1156,20 @@ create_pipeline (pipeline_data_t *data, event_callback_t * error_cb)
     g_atomic_int_set (&stream->clock_sync, 1);
   }
 
-  for (guint ch = 0; ch < MAX_IO_CHANNELS; ch++)
-    stream->leftover_bytes[ch] = 0;
+  if (stream->tx_interleaved) {
+    g_atomic_int_set (&stream->tx_running, 1);
+    stream->tx_thread = g_thread_new ("aes67-tx", tx_pacing_thread, stream);
+  }
 
   return stream;
 
 error:
   gst_object_unref (pipeline);
+  free_tx_resources (stream);
+  rx_ring_free (stream->rx_ring);
+  for (guint ch = 0; ch < MAX_IO_CHANNELS; ch++)
+    g_free (stream->ch[ch].listeners);
+  g_mutex_clear (&stream->level_lock);
   g_free (stream);
   return NULL;
 
@@ -913,6 +1219,12 @@ stop_pipeline (g_stream_t * stream)
 
   dump_pipeline(stream->pipeline, "pipeline-stop");
 
+  if (stream->tx_thread) {
+    g_atomic_int_set (&stream->tx_running, 0);
+    g_thread_join (stream->tx_thread);
+    stream->tx_thread = NULL;
+  }
+
   gst_element_set_state (GST_ELEMENT (stream->pipeline), GST_STATE_NULL);
 
   /* cb_rx_stats_id will be non zero only when
@@ -927,11 +1239,18 @@ stop_pipeline (g_stream_t * stream)
   gst_bus_remove_watch (bus);
   gst_object_unref (bus);
 
+  g_atomic_int_set (&stream->state, GST_STATE_NULL);
+  free_tx_resources (stream);
+  rx_ring_free (stream->rx_ring);
+  for (guint ch = 0; ch < MAX_IO_CHANNELS; ch++)
+    g_free (stream->ch[ch].listeners);
+
   gst_object_unref (stream->pipeline);
   if (stream->clock)
     gst_object_unref (stream->clock);
   teardown_mainloop (stream->mainloop);
   g_thread_join (stream->thread);
+  g_mutex_clear (&stream->level_lock);
   g_free (stream);
   switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG,
       "Pipeline and mainloop cleaned up\n");
@@ -956,152 +1275,196 @@ start_mainloop (GMainLoop * mainloop)
 }
 
 
-gboolean
-push_buffer (g_stream_t *stream, unsigned char *payload, guint len,
-    guint ch_idx, switch_timer_t * timer)
+/*
+  Creates a pool of TX_POOL_BUFFERS buffers, each holding one packet
+  (`codec_ms` worth of interleaved samples). The pool is bounded so that
+  every allocation done outside of it shows up in `tx_allocs`.
+*/
+GstBufferPool *
+create_tx_pool (gint sample_rate, gint codec_ms, gint channels,
+    gint sample_bytes)
 {
-  GstState cur_state = GST_STATE_NULL, pending_state;
-  GstBuffer *buf;
-  GstMapInfo info;
-  GstFlowReturn ret;
-  gchar name[ELEMENT_NAME_SIZE];
-  GstElement *appsrc = NULL;
-  GstPipeline *pipeline = stream->pipeline;
-  gboolean res = FALSE;
+  GstBufferPool *pool;
+  GstStructure *config;
+  guint size = codec_ms * sample_rate * sample_bytes * channels / 1000;
+
+  pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, NULL, size, TX_POOL_BUFFERS,
+      TX_POOL_BUFFERS);
+
+  if (!gst_buffer_pool_set_config (pool, config) ||
+      !gst_buffer_pool_set_active (pool, TRUE)) {
+    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+        "Failed to setup the tx buffer pool\n");
+    gst_object_unref (pool);
+    return NULL;
+  }
 
-  NAME_ELEMENT (name, "appsrc", ch_idx);
-  appsrc = gst_bin_get_by_name (GST_BIN (pipeline), name);
+  return pool;
+}
 
-  switch_core_timer_next (timer);
+/* Returns the channel appsrc if the pipeline can take buffers right now */
+static GstElement *
+tx_appsrc (g_stream_t *stream, guint ch_idx)
+{
+  GstElement *appsrc;
 
-  if (appsrc == NULL) {
+  if (ch_idx >= MAX_IO_CHANNELS || NULL == (appsrc = stream->ch[ch_idx].appsrc)) {
     switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG,
         "Failed to find appsrc in the pipeline\n");
-    return FALSE;
+    return NULL;
   }
 
-  if (!g_atomic_int_get(&stream->clock_sync)) {
-    ret = TRUE;
-    goto done;
+  if (!g_atomic_int_get(&stream->clock_sync))
+    return NULL;
+
+  if (!stream_is_flowing (stream))
+    return NULL;
+
+  return appsrc;
+}
+
+static gboolean
+tx_push (GstElement *appsrc, GstBuffer *buf)
+{
+  /* Takes ownership of buf */
+  if (gst_app_src_push_buffer (GST_APP_SRC (appsrc), buf) == GST_FLOW_ERROR) {
+    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+        "Failed to do 'push-buffer' \n");
+    return FALSE;
   }
 
-  gst_element_get_state (GST_ELEMENT (pipeline), &cur_state, &pending_state, 0);
-  if (cur_state != GST_STATE_PAUSED && cur_state != GST_STATE_PLAYING) {
-    ret = TRUE;
-    goto done;
+  return TRUE;
+}
+
+/*
+  Copies `len` bytes of S16 `payload` into a buffer from the channel pool,
+  packing it to L24 if the stream sends that, and pushes it to the channel
+  appsrc. Falls back to a fresh allocation when the pool is exhausted or the
+  payload is bigger than a pool buffer.
+*/
+static gboolean
+tx_copy (g_stream_t *stream, unsigned char *payload, guint len, guint ch_idx)
+{
+  GstBufferPool *pool;
+  GstBuffer *buf = NULL;
+  GstElement *appsrc;
+  guint samples = len / sizeof (gint16);
+
+  if (stream->tx_interleaved)
+    return tx_ring_push (stream, ch_idx, payload, len);
+
+  if (NULL == (appsrc = tx_appsrc (stream, ch_idx)))
+    return FALSE;
+
+  if (stream->tx_l24)
+    len = samples * 3;
+
+  if (NULL != (pool = stream->ch[ch_idx].pool)) {
+    GstBufferPoolAcquireParams params = { 0, };
+
+    params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+    if (gst_buffer_pool_acquire_buffer (pool, &buf, &params) != GST_FLOW_OK) {
+      buf = NULL;
+    } else if (gst_buffer_get_size (buf) < len) {
+      gst_buffer_unref (buf);
+      buf = NULL;
+    }
   }
 
-  buf = gst_buffer_new_allocate (NULL, len, NULL);
   if (buf == NULL) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to allocate buffer\n");
-    goto done;
+    g_atomic_int_inc (&stream->tx_allocs);
+    buf = gst_buffer_new_allocate (NULL, len, NULL);
+    if (buf == NULL) {
+      switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+          "Failed to allocate buffer\n");
+      return FALSE;
+    }
   }
 
-  if (!gst_buffer_map (buf, &info, GST_MAP_WRITE)) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to get buffer map\n");
-    goto done;
+  if (stream->tx_l24) {
+    GstMapInfo map;
+
+    gst_buffer_set_size (buf, len);
+    if (!gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+      switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+          "Failed to map buffer\n");
+      gst_buffer_unref (buf);
+      return FALSE;
+    }
+    aes67_pack_l24 (map.data, (const gint16 *) payload, samples);
+    gst_buffer_unmap (buf, &map);
+  } else {
+    gst_buffer_fill (buf, 0, payload, len);
+    gst_buffer_set_size (buf, len);
   }
-  memcpy (info.data, payload, len);
-  gst_buffer_unmap (buf, &info);
 
-  g_signal_emit_by_name (appsrc, "push-buffer", buf, &ret);
-  // switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Pushed buffer\n");
+  return tx_push (appsrc, buf);
+}
 
-  gst_buffer_unref (buf);
-  if (ret == GST_FLOW_ERROR) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to do 'push-buffer' \n");
-    goto done;
-  }
+static void
+tx_meter (g_stream_t *stream, guint ch_idx, unsigned char *payload, guint len)
+{
+  g_level_t *level;
 
-  res = TRUE;
+  if (!stream->metering || ch_idx >= (guint) stream->channels)
+    return;
 
-done:
-  gst_object_unref (GST_OBJECT (appsrc));
-  return res;
+  level = &stream->ch[ch_idx].tx_level;
+  g_mutex_lock (&stream->level_lock);
+  aes67_level_s16 ((const gint16 *) payload, len / sizeof (gint16),
+      &level->peak, &level->sumsq);
+  level->samples += len / sizeof (gint16);
+  g_mutex_unlock (&stream->level_lock);
 }
 
+/*
+  `timer` paces the caller before the push, NULL when the caller is already
+  paced on the stream media clock.
+*/
+gboolean
+push_buffer (g_stream_t *stream, unsigned char *payload, guint len,
+    guint ch_idx, switch_timer_t * timer)
+{
+  if (timer)
+    switch_core_timer_next (timer);
+
+  tx_meter (stream, ch_idx, payload, len);
+  return tx_copy (stream, payload, len, ch_idx);
+}
 
+/*
+  Pulls `needed_bytes` of the channel `ch_idx` out of the shared RX ring for
+  the listener `slot` as returned by `add_listener`. The slot is owned by the
+  calling session, so its read cursor needs no locking.
+*/
 int
 pull_buffers (g_stream_t * stream, unsigned char *payload, guint needed_bytes,
-    guint ch_idx, switch_timer_t * timer, gchar *session)
+    guint ch_idx, switch_timer_t * timer, gint slot)
 {
-  GstState cur_state = GST_STATE_NULL, pending_state;
-  GstBuffer *buf;
-  GstSample *sample;
-  GstMapInfo info;
   int total_bytes = 0;
-  gchar name[ELEMENT_NAME_SIZE];
-  GstElement *appsink;
+  g_listener_t *listeners;
+  g_rx_ring_t *ring = stream->rx_ring;
 
-  if (session == NULL)
-    NAME_ELEMENT (name, "appsink", ch_idx);
-  else
-    NAME_SESSION_ELEMENT(name, "appsink", ch_idx, session);
-
-  appsink = gst_bin_get_by_name (GST_BIN (stream->pipeline), name);
+  if (ch_idx >= MAX_IO_CHANNELS || slot < 0 || slot >= MAX_CHANNEL_LISTENERS)
+    return 0;
 
-  if (appsink == NULL) {
-    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-        "Failed to find %s in the pipeline\n", name);
+  if (ring == NULL || ch_idx >= (guint) ring->channels ||
+      NULL == (listeners = g_atomic_pointer_get (&stream->ch[ch_idx].listeners)) ||
+      !g_atomic_int_get (&listeners[slot].active))
     return 0;
-  }
 
-  gst_element_get_state (GST_ELEMENT (stream->pipeline), &cur_state,
-      &pending_state, 0);
-  if (cur_state != GST_STATE_PAUSED && cur_state != GST_STATE_PLAYING)
-    goto out;
-
-  if (gst_app_sink_is_eos (GST_APP_SINK (appsink)))
-    goto out;
-
-  // Note: assumes leftover_bytes will never be more than buflen, which is
-  // likely true (packet is limited to MTU, while buflen is 8192)
-  // FIXME: revisit this to check whether we need this anymore
-  if (stream->leftover_bytes[ch_idx]) {
-    int copy =
-        stream->leftover_bytes[ch_idx] <=
-        needed_bytes ? stream->leftover_bytes[ch_idx] : needed_bytes;
-    memcpy (payload, stream->leftover[ch_idx], copy);
-    total_bytes += copy;
-    stream->leftover_bytes[ch_idx] -= copy;
-  }
+  if (!stream_is_flowing (stream))
+    return 0;
 
   while (total_bytes < needed_bytes) {
-    // switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "pulling buffer\n");
-    sample =
-        gst_app_sink_try_pull_sample (GST_APP_SINK (appsink),
-        10 * GST_MSECOND);
-    if (!sample) {
-      // switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Failed to pull sample\n");
-      switch_cond_next ();
-      break;
-    }
-    buf = gst_sample_get_buffer (sample);
-
-    if (!buf)
-      continue;
-
-    if (gst_buffer_map (buf, &info, GST_MAP_READ)) {
-      if (total_bytes + info.size > needed_bytes) {
-        int want = needed_bytes - total_bytes;
-
-        stream->leftover_bytes[ch_idx] = info.size - want;
-        memcpy (stream->leftover[ch_idx], info.data + want,
-            stream->leftover_bytes[ch_idx]);
-
-        info.size = want;
-      }
-
-      memcpy (payload + total_bytes, info.data, info.size);
-      total_bytes += info.size;
-    }
-    gst_buffer_unmap (buf, &info);
-    gst_sample_unref (sample);
+    guint got = rx_ring_read (ring, ch_idx, &listeners[slot],
+        payload + total_bytes, needed_bytes - total_bytes);
 
-    // switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Got %d\n", total_bytes);
+    if (!got)
+      break;
+    total_bytes += got;
   }
 
 #if 0
@@ -1119,10 +1482,7 @@ pull_buffers (g_stream_t * stream, unsigned char *payload, guint needed_bytes,
 #endif
 
   // switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%u Returning needed %d, total_bytes: %d\n", ch_idx, needed_bytes, total_bytes);
-  // switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Leftover %lu\n", stream->leftover_bytes[ch_idx]);
 
-out:
-  gst_object_unref(appsink);
   return total_bytes;
 }
 
@@ -1180,3 +1540,225 @@ void drop_output_buffers (gboolean drop, g_stream_t *stream)
 
   gst_object_unref(tx_valve);
 }
+
+/*
+  Heap owned by the stream: the struct itself, the rings and the TX buffer
+  pools. GStreamer elements are not accounted for.
+*/
+gsize
+get_stream_memory (g_stream_t *stream)
+{
+  gsize total = sizeof (g_stream_t);
+  gsize samples = stream->codec_ms * stream->sample_rate / 1000;
+  gsize sample_bytes = stream->tx_l24 ? 3 : sizeof (gint16);
+  g_rx_ring_t *ring = stream->rx_ring;
+
+  if (ring) {
+    total += sizeof (g_rx_ring_t) + RX_RING_PACKETS * sizeof (guint) +
+        (gsize) RX_RING_PACKETS * ring->channels * ring->samples * sizeof (gint16);
+    if (ring->scratch)
+      total += (gsize) ring->channels * ring->samples * sizeof (gint16);
+  }
+
+  for (guint ch = 0; ch < MAX_IO_CHANNELS; ch++) {
+    if (stream->ch[ch].listeners)
+      total += MAX_CHANNEL_LISTENERS * sizeof (g_listener_t);
+    if (stream->ch[ch].ring)
+      total += sizeof (g_tx_ring_t) +
+          (stream->ch[ch].ring->mask + 1) * sizeof (gint16);
+    if (stream->ch[ch].pool)
+      total += TX_POOL_BUFFERS * samples * sample_bytes;
+  }
+
+  if (stream->tx_pool)
+    total += TX_POOL_BUFFERS * samples * sample_bytes * stream->channels;
+  if (stream->tx_scratch)
+    total += samples * stream->channels * sizeof (gint16);
+
+  return total;
+}
+
+g_media_clock_t *
+media_clock_new (void)
+{
+  g_media_clock_t *mclock = g_new0 (g_media_clock_t, 1);
+
+  g_mutex_init (&mclock->lock);
+  g_cond_init (&mclock->cond);
+  mclock->period = 20 * GST_MSECOND;
+
+  return mclock;
+}
+
+void
+media_clock_free (g_media_clock_t *mclock)
+{
+  if (!mclock)
+    return;
+
+  g_mutex_lock (&mclock->lock);
+  mclock->users = 0;
+  mclock->running = FALSE;
+  g_mutex_unlock (&mclock->lock);
+
+  if (mclock->thread)
+    g_thread_join (mclock->thread);
+  if (mclock->pipeline)
+    gst_object_unref (mclock->pipeline);
+
+  g_cond_clear (&mclock->cond);
+  g_mutex_clear (&mclock->lock);
+  g_free (mclock);
+}
+
+/*
+  Follows `pipeline` from now on. Called whenever the stream pipeline is
+  (re)created or torn down, sessions keep waiting on the same clock.
+*/
+void
+media_clock_set_pipeline (g_media_clock_t *mclock, GstElement *pipeline,
+    gint codec_ms)
+{
+  g_mutex_lock (&mclock->lock);
+  if (mclock->pipeline)
+    gst_object_unref (mclock->pipeline);
+  mclock->pipeline = pipeline ? gst_object_ref (pipeline) : NULL;
+  if (codec_ms > 0)
+    mclock->period = codec_ms * GST_MSECOND;
+  g_mutex_unlock (&mclock->lock);
+}
+
+static gpointer
+media_clock_thread (gpointer data)
+{
+  g_media_clock_t *mclock = data;
+  GstClock *clock = NULL;
+  GstClockTime next = GST_CLOCK_TIME_NONE;
+
+  /* A detach drops mclock->thread before joining, so a thread being joined
+     never mistakes a new attach for its own */
+  g_mutex_lock (&mclock->lock);
+  while (mclock->running && mclock->thread == g_thread_self ()) {
+    GstClock *current = NULL;
+    GstClockTime period = mclock->period;
+    GstClockTime now;
+    GstClockID id;
+
+    if (mclock->pipeline)
+      current = gst_element_get_clock (mclock->pipeline);
+    g_mutex_unlock (&mclock->lock);
+
+    /* The clock changes when PTP gets synced, follow it */
+    if (!current)
+      current = gst_system_clock_obtain ();
+    if (current != clock) {
+      if (clock)
+        gst_object_unref (clock);
+      clock = current;
+      next = GST_CLOCK_TIME_NONE;
+    } else {
+      gst_object_unref (current);
+    }
+
+    /* Start over rather than spin or stall if the clock stepped */
+    now = gst_clock_get_time (clock);
+    if (next == GST_CLOCK_TIME_NONE || now > next + 4 * period ||
+        next > now + 4 * period)
+      next = now;
+    next += period;
+
+    id = gst_clock_new_single_shot_id (clock, next);
+    gst_clock_id_wait (id, NULL);
+    gst_clock_id_unref (id);
+
+    g_mutex_lock (&mclock->lock);
+    mclock->tick++;
+    g_cond_broadcast (&mclock->cond);
+  }
+  g_mutex_unlock (&mclock->lock);
+
+  if (clock)
+    gst_object_unref (clock);
+
+  return NULL;
+}
+
+/*
+  Sessions attach while they hold a channel of the stream. The first one
+  starts the clock thread and the last one stops it.
+*/
+void
+media_clock_attach (g_media_clock_t *mclock)
+{
+  g_mutex_lock (&mclock->lock);
+  if (mclock->users++ == 0) {
+    mclock->running = TRUE;
+    mclock->thread = g_thread_new ("aes67-clock", media_clock_thread, mclock);
+  }
+  g_mutex_unlock (&mclock->lock);
+}
+
+void
+media_clock_detach (g_media_clock_t *mclock)
+{
+  GThread *thread = NULL;
+
+  g_mutex_lock (&mclock->lock);
+  if (mclock->users > 0 && --mclock->users == 0) {
+    mclock->running = FALSE;
+    thread = mclock->thread;
+    mclock->thread = NULL;
+  }
+  g_mutex_unlock (&mclock->lock);
+
+  /* At most one period away from noticing */
+  if (thread)
+    g_thread_join (thread);
+}
+
+/*
+  Blocks until the clock ticks past `cursor`, the caller's own count of the
+  periods it has served, and advances it by one. A caller more than a couple
+  of periods late is resynced instead of bursting to catch up. If the clock
+  is stalled the caller is still let through every other period.
+*/
+void
+media_clock_wait (g_media_clock_t *mclock, guint64 *cursor)
+{
+  gint64 deadline;
+
+  g_mutex_lock (&mclock->lock);
+  deadline = g_get_monotonic_time () + 2 * mclock->period / GST_USECOND;
+
+  if (mclock->tick > *cursor + 2)
+    *cursor = mclock->tick - 1;
+
+  while (mclock->tick <= *cursor) {
+    if (!g_cond_wait_until (&mclock->cond, &mclock->lock, deadline)) {
+      *cursor = mclock->tick;
+      g_mutex_unlock (&mclock->lock);
+      return;
+    }
+  }
+  (*cursor)++;
+  g_mutex_unlock (&mclock->lock);
+}
+
+/*
+  Copies the meters of every channel of the stream into `rx` and `tx`,
+  either may be NULL, and starts the next interval.
+*/
+void
+take_stream_levels (g_stream_t *stream, g_level_t *rx, g_level_t *tx)
+{
+  g_mutex_lock (&stream->level_lock);
+  for (gint ch = 0; ch < stream->channels; ch++) {
+    if (rx)
+      rx[ch] = stream->ch[ch].rx_level;
+    if (tx)
+      tx[ch] = stream->ch[ch].tx_level;
+    memset (&stream->ch[ch].rx_level, 0, sizeof (g_level_t));
+    memset (&stream->ch[ch].tx_level, 0, sizeof (g_level_t));
+  }
+  g_mutex_unlock (&stream->level_lock);
+}
@@ -15,6 +15,19 @@
 #define TS_CONTEXT_NAME_LEN 100
 #define SESSION_ID_LEN 20
 
+/* Upper bound of listen-only sessions sharing one RX channel */
+#define MAX_CHANNEL_LISTENERS 128
+
+/* Packets kept by the shared RX ring */
+#define RX_RING_PACKETS 8
+
+/* Buffers preallocated per TX appsrc, enough to cover the appsrc queue
+   and what audiointerleave holds on to */
+#define TX_POOL_BUFFERS 16
+
+/* Packets each channel can queue ahead of the interleaved TX pacing thread */
+#define TX_RING_PACKETS 4
+
 typedef enum
 { L16, L24 } aes67_codec_t;
 
@@ -46,15 +59,116 @@ typedef struct
   char *ts_context_name;
   gboolean is_backup_sender;
   int backup_sender_idle_wait_ms;
+  gboolean tx_interleaved;
+  gboolean metering;
 } pipeline_data_t;
 
+/* A session reading a RX channel out of the shared ring */
+typedef struct
+{
+  gchar session[SESSION_ID_LEN];
+  volatile gint active;
+  /* Next packet to read and how much of it was already consumed, only
+     touched by the owning session */
+  guint cursor;
+  guint offset;
+  gboolean synced;
+} g_listener_t;
+
+/*
+  Shared RX ring, written by the rx appsink and read by every listener
+  without relinking the pipeline. Each slot holds one packet de-interleaved
+  so that a channel is a contiguous run of `samples` S16 samples. Slots are
+  indexed by packet number, derived from the buffer timestamps, which keeps
+  the listeners aligned across packet loss. `seq[slot]` is the packet number
+  held by the slot and RX_SLOT_BUSY while the writer is filling it.
+*/
+#define RX_SLOT_BUSY G_MAXUINT
+
+typedef struct
+{
+  gint16 *data;
+  volatile guint *seq;
+  guint samples;
+  gint channels;
+  volatile guint latest;
+  volatile gint primed;
+  /* L24 streams come in big endian 24 bit, unpacked here before
+     de-interleaving */
+  gboolean l24;
+  gint16 *scratch;
+  /* Listeners that caught up with the writer wait here */
+  GMutex lock;
+  GCond cond;
+} g_rx_ring_t;
+
+/*
+  Single producer / single consumer sample ring used by the interleaved TX
+  mode. The session owning the channel moves `head`, the pacing thread moves
+  `tail`; both only ever grow and wrap through `mask`.
+*/
+typedef struct
+{
+  gint16 *data;
+  guint mask;
+  volatile guint head;
+  volatile guint tail;
+} g_tx_ring_t;
+
+/*
+  Stream-level media clock. One thread per shared stream waits on the
+  pipeline clock (the PTP clock once synced) and bumps `tick` once per
+  packet time; every session on the stream paces its reads and writes on
+  that tick instead of running timers of its own. The clock only runs while
+  it has users, and outlives the pipelines it follows across reloads.
+*/
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  GThread *thread;
+  /* Pipeline whose clock drives the ticks, NULL to use the system clock */
+  GstElement *pipeline;
+  GstClockTime period;
+  guint64 tick;
+  gint users;
+  gboolean running;
+} g_media_clock_t;
+
+/* Level meter of one direction of a channel, since the last snapshot */
+typedef struct
+{
+  guint32 peak;
+  guint64 sumsq;
+  guint64 samples;
+} g_level_t;
+
+/*
+  Per-channel element handles, so that the per-frame path does not have to
+  walk the bin with gst_bin_get_by_name(). The pipeline owns the elements,
+  these are borrowed pointers that are cleared before the element leaves the
+  bin.
+*/
+typedef struct
+{
+  /* TX: appsrc feeding audiointerleave */
+  GstElement *appsrc;
+  /* TX: packet sized buffers recycled for the appsrc */
+  GstBufferPool *pool;
+  /* TX: samples waiting for the pacing thread, interleaved mode only */
+  g_tx_ring_t *ring;
+  /* RX: allocated on the first listener, MAX_CHANNEL_LISTENERS entries */
+  g_listener_t *listeners;
+  /* Meters, under the stream level_lock */
+  g_level_t rx_level;
+  g_level_t tx_level;
+} g_channel_t;
+
 struct g_stream
 {
   GstPipeline *pipeline;
   GMainLoop *mainloop;
   GThread *thread;
-  unsigned char leftover[MAX_IO_CHANNELS][SWITCH_RECOMMENDED_BUFFER_SIZE];
-  size_t leftover_bytes[MAX_IO_CHANNELS];
   event_callback_t *error_cb;
   guint cb_rx_stats_id;
   volatile gint clock_sync;
@@ -65,6 +179,29 @@ struct g_stream
   gboolean txdrop;
   guint backup_sender_idle_timer;
   int backup_sender_idle_wait_ms;
+  /* Pipeline GstState, tracked from the bus */
+  volatile gint state;
+  /* TX buffers allocated outside of the pools */
+  volatile gint tx_allocs;
+  gint channels;
+  gint codec_ms;
+  g_channel_t ch[MAX_IO_CHANNELS];
+  /* RX: all channels, filled from the rx appsink */
+  g_rx_ring_t *rx_ring;
+  /* TX appsrcs take L24 packed by the module rather than S16 */
+  gboolean tx_l24;
+  /* Interleaved TX: one appsrc for all channels, fed by the pacing thread */
+  gboolean tx_interleaved;
+  gint16 *tx_scratch;
+  GstElement *tx_appsrc;
+  GstBufferPool *tx_pool;
+  GThread *tx_thread;
+  volatile gint tx_running;
+  /* Interleaved TX: packets sent with at least one channel short of samples */
+  volatile gint tx_underruns;
+  /* Meter every RX packet and TX frame, read with take_stream_levels */
+  gboolean metering;
+  GMutex level_lock;
 };
 
 g_stream_t *create_pipeline (pipeline_data_t *data, event_callback_t * error_cb);
@@ -75,13 +212,25 @@ void start_mainloop (GMainLoop * loop);
 
 gboolean push_buffer (g_stream_t *stream, unsigned char *payload, guint len,
     guint ch_idx, switch_timer_t * timer);
+GstBufferPool *create_tx_pool (gint sample_rate, gint codec_ms, gint channels,
+    gint sample_bytes);
 int pull_buffers (g_stream_t * stream, unsigned char *payload, guint buflen,
-    guint ch_idx, switch_timer_t * timer, gchar *session);
+    guint ch_idx, switch_timer_t * timer, gint slot);
 void drop_input_buffers (gboolean drop, g_stream_t * stream, guint32 ch_idx);
 gchar *get_rtp_stats (g_stream_t *stream);
 void drop_output_buffers (gboolean drop, g_stream_t * stream);
-gboolean add_appsink(g_stream_t *stream, guint ch_idx, gchar *session);
-gboolean remove_appsink(g_stream_t *stream, guint ch_idx, gchar *session);
+gint add_listener(g_stream_t *stream, guint ch_idx, gchar *session);
+gboolean remove_listener(g_stream_t *stream, guint ch_idx, gchar *session);
 void use_ptp_clock(g_stream_t *stream, GstClock *ptp_clock);
+gsize get_stream_memory (g_stream_t *stream);
+void take_stream_levels (g_stream_t *stream, g_level_t *rx, g_level_t *tx);
+
+g_media_clock_t *media_clock_new (void);
+void media_clock_free (g_media_clock_t *mclock);
+void media_clock_set_pipeline (g_media_clock_t *mclock, GstElement *pipeline,
+    gint codec_ms);
+void media_clock_attach (g_media_clock_t *mclock);
+void media_clock_detach (g_media_clock_t *mclock);
+void media_clock_wait (g_media_clock_t *mclock, guint64 *cursor);
 
 #endif /*__GSTREAMER_API__*/
@@ -0,0 +1,267 @@
+#include <string.h>
+
+#include "aes67_pcm.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AES67_PCM_X86
+#include <immintrin.h>
+#endif
+
+static void
+unpack_l24_scalar (gint16 * dst, const guint8 * src, gsize samples)
+{
+  for (gsize i = 0; i < samples; i++, src += 3)
+    dst[i] = (gint16) ((src[0] << 8) | src[1]);
+}
+
+static void
+pack_l24_scalar (guint8 * dst, const gint16 * src, gsize samples)
+{
+  for (gsize i = 0; i < samples; i++, dst += 3) {
+    guint16 s = (guint16) src[i];
+
+    dst[0] = s >> 8;
+    dst[1] = s & 0xff;
+    dst[2] = 0;
+  }
+}
+
+static void
+level_s16_scalar (const gint16 * src, gsize samples, guint32 * peak,
+    guint64 * sumsq)
+{
+  guint32 max = *peak;
+  guint64 sum = 0;
+
+  for (gsize i = 0; i < samples; i++) {
+    gint32 s = src[i];
+    guint32 mag = s < 0 ? -s : s;
+
+    if (mag > max)
+      max = mag;
+    sum += (guint32) (s * s);
+  }
+
+  *peak = max;
+  *sumsq += sum;
+}
+
+#ifdef AES67_PCM_X86
+/*
+  Byte shuffles are SSSE3, plain SSE2 has no way to gather the 3 byte
+  samples. 8 samples (24 bytes) are read as two overlapping 16 byte loads,
+  at offsets 0 and 8, so that nothing past the input is touched.
+*/
+#define UNPACK_MASK_LO \
+  0x01, 0x00, 0x04, 0x03, 0x07, 0x06, 0x0a, 0x09, \
+  0x0d, 0x0c, -1, -1, -1, -1, -1, -1
+#define UNPACK_MASK_HI \
+  -1, -1, -1, -1, -1, -1, -1, -1, \
+  -1, -1, 0x08, 0x07, 0x0b, 0x0a, 0x0e, 0x0d
+
+__attribute__ ((target ("ssse3")))
+static void
+unpack_l24_ssse3 (gint16 * dst, const guint8 * src, gsize samples)
+{
+  const __m128i lo = _mm_setr_epi8 (UNPACK_MASK_LO);
+  const __m128i hi = _mm_setr_epi8 (UNPACK_MASK_HI);
+  gsize i = 0;
+
+  for (; i + 8 <= samples; i += 8, src += 24) {
+    __m128i a = _mm_loadu_si128 ((const __m128i *) src);
+    __m128i b = _mm_loadu_si128 ((const __m128i *) (src + 8));
+
+    _mm_storeu_si128 ((__m128i *) (dst + i),
+        _mm_or_si128 (_mm_shuffle_epi8 (a, lo), _mm_shuffle_epi8 (b, hi)));
+  }
+
+  unpack_l24_scalar (dst + i, src, samples - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+unpack_l24_avx2 (gint16 * dst, const guint8 * src, gsize samples)
+{
+  const __m256i lo = _mm256_setr_epi8 (UNPACK_MASK_LO, UNPACK_MASK_LO);
+  const __m256i hi = _mm256_setr_epi8 (UNPACK_MASK_HI, UNPACK_MASK_HI);
+  gsize i = 0;
+
+  /* 16 samples, one group of 8 per 128 bit lane */
+  for (; i + 16 <= samples; i += 16, src += 48) {
+    __m256i a = _mm256_inserti128_si256 (_mm256_castsi128_si256
+        (_mm_loadu_si128 ((const __m128i *) src)),
+        _mm_loadu_si128 ((const __m128i *) (src + 24)), 1);
+    __m256i b = _mm256_inserti128_si256 (_mm256_castsi128_si256
+        (_mm_loadu_si128 ((const __m128i *) (src + 8))),
+        _mm_loadu_si128 ((const __m128i *) (src + 32)), 1);
+
+    _mm256_storeu_si256 ((__m256i *) (dst + i),
+        _mm256_or_si256 (_mm256_shuffle_epi8 (a, lo),
+            _mm256_shuffle_epi8 (b, hi)));
+  }
+
+  unpack_l24_ssse3 (dst + i, src, samples - i);
+}
+
+/* 8 samples in, 16 + 8 bytes out */
+__attribute__ ((target ("ssse3")))
+static void
+pack_l24_ssse3 (guint8 * dst, const gint16 * src, gsize samples)
+{
+  const __m128i lo = _mm_setr_epi8 (0x01, 0x00, -1, 0x03, 0x02, -1,
+      0x05, 0x04, -1, 0x07, 0x06, -1, 0x09, 0x08, -1, 0x0b);
+  const __m128i hi = _mm_setr_epi8 (0x0a, -1, 0x0d, 0x0c, -1, 0x0f, 0x0e, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1);
+  gsize i = 0;
+
+  for (; i + 8 <= samples; i += 8, dst += 24) {
+    __m128i in = _mm_loadu_si128 ((const __m128i *) (src + i));
+
+    _mm_storeu_si128 ((__m128i *) dst, _mm_shuffle_epi8 (in, lo));
+    _mm_storel_epi64 ((__m128i *) (dst + 16), _mm_shuffle_epi8 (in, hi));
+  }
+
+  pack_l24_scalar (dst, src + i, samples - i);
+}
+
+/*
+  Peak from the running min and max, -32768 is only negated once out of
+  the vector. madd sums two squares into 32 bits, at most 2^31 so it is
+  treated as unsigned and widened to 64 bits before accumulating.
+*/
+__attribute__ ((target ("sse2")))
+static void
+level_s16_sse2 (const gint16 * src, gsize samples, guint32 * peak,
+    guint64 * sumsq)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  __m128i vmax = zero, vmin = zero, vsum = zero;
+  gint16 lanes[8];
+  guint64 sums[2];
+  gsize i = 0;
+
+  for (; i + 8 <= samples; i += 8) {
+    __m128i x = _mm_loadu_si128 ((const __m128i *) (src + i));
+    __m128i sq = _mm_madd_epi16 (x, x);
+
+    vmax = _mm_max_epi16 (vmax, x);
+    vmin = _mm_min_epi16 (vmin, x);
+    vsum = _mm_add_epi64 (vsum, _mm_unpacklo_epi32 (sq, zero));
+    vsum = _mm_add_epi64 (vsum, _mm_unpackhi_epi32 (sq, zero));
+  }
+
+  _mm_storeu_si128 ((__m128i *) sums, vsum);
+  *sumsq += sums[0] + sums[1];
+
+  _mm_storeu_si128 ((__m128i *) lanes, vmax);
+  for (guint l = 0; l < 8; l++)
+    *peak = MAX (*peak, (guint32) MAX (lanes[l], 0));
+  _mm_storeu_si128 ((__m128i *) lanes, vmin);
+  for (guint l = 0; l < 8; l++)
+    *peak = MAX (*peak, (guint32) - MIN ((gint32) lanes[l], 0));
+
+  level_s16_scalar (src + i, samples - i, peak, sumsq);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+level_s16_avx2 (const gint16 * src, gsize samples, guint32 * peak,
+    guint64 * sumsq)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  __m256i vmax = zero, vmin = zero, vsum = zero;
+  gint16 lanes[16];
+  guint64 sums[4];
+  gsize i = 0;
+
+  for (; i + 16 <= samples; i += 16) {
+    __m256i x = _mm256_loadu_si256 ((const __m256i *) (src + i));
+    __m256i sq = _mm256_madd_epi16 (x, x);
+
+    vmax = _mm256_max_epi16 (vmax, x);
+    vmin = _mm256_min_epi16 (vmin, x);
+    vsum = _mm256_add_epi64 (vsum, _mm256_unpacklo_epi32 (sq, zero));
+    vsum = _mm256_add_epi64 (vsum, _mm256_unpackhi_epi32 (sq, zero));
+  }
+
+  _mm256_storeu_si256 ((__m256i *) sums, vsum);
+  *sumsq += sums[0] + sums[1] + sums[2] + sums[3];
+
+  _mm256_storeu_si256 ((__m256i *) lanes, vmax);
+  for (guint l = 0; l < 16; l++)
+    *peak = MAX (*peak, (guint32) MAX (lanes[l], 0));
+  _mm256_storeu_si256 ((__m256i *) lanes, vmin);
+  for (guint l = 0; l < 16; l++)
+    *peak = MAX (*peak, (guint32) - MIN ((gint32) lanes[l], 0));
+
+  level_s16_sse2 (src + i, samples - i, peak, sumsq);
+}
+#endif
+
+typedef struct
+{
+  const gchar *name;
+  aes67_unpack_l24_func *unpack;
+  aes67_pack_l24_func *pack;
+  aes67_level_s16_func *level;
+} pcm_impl_t;
+
+static const pcm_impl_t impls[] = {
+#ifdef AES67_PCM_X86
+  {"avx2", unpack_l24_avx2, pack_l24_ssse3, level_s16_avx2},
+  {"ssse3", unpack_l24_ssse3, pack_l24_ssse3, level_s16_sse2},
+#endif
+  {"scalar", unpack_l24_scalar, pack_l24_scalar, level_s16_scalar},
+};
+
+aes67_unpack_l24_func *aes67_unpack_l24 = unpack_l24_scalar;
+aes67_pack_l24_func *aes67_pack_l24 = pack_l24_scalar;
+aes67_level_s16_func *aes67_level_s16 = level_s16_scalar;
+static const gchar *impl_name = "scalar";
+
+static gboolean
+impl_supported (const pcm_impl_t * impl)
+{
+#ifdef AES67_PCM_X86
+  __builtin_cpu_init ();
+  if (!strcmp (impl->name, "avx2"))
+    return __builtin_cpu_supports ("avx2");
+  if (!strcmp (impl->name, "ssse3"))
+    return __builtin_cpu_supports ("ssse3");
+#endif
+  return TRUE;
+}
+
+/* Forces the kernels named `impl`, FALSE if this CPU can't run them */
+gboolean
+aes67_pcm_select (const gchar * impl)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (impls); i++) {
+    if (strcmp (impls[i].name, impl) || !impl_supported (&impls[i]))
+      continue;
+
+    aes67_unpack_l24 = impls[i].unpack;
+    aes67_pack_l24 = impls[i].pack;
+    aes67_level_s16 = impls[i].level;
+    impl_name = impls[i].name;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Picks the fastest kernels this CPU supports, called once at load */
+void
+aes67_pcm_init (void)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (impls); i++) {
+    if (aes67_pcm_select (impls[i].name))
+      return;
+  }
+}
+
+const gchar *
+aes67_pcm_impl (void)
+{
+  return impl_name;
+}
@@ -0,0 +1,25 @@
+#ifndef __AES67_PCM__
+#define __AES67_PCM__
+
+#include <glib.h>
+
+/* L24 is 24 bit big endian, FreeSWITCH works on native 16 bit samples */
+typedef void aes67_unpack_l24_func (gint16 * dst, const guint8 * src,
+    gsize samples);
+typedef void aes67_pack_l24_func (guint8 * dst, const gint16 * src,
+    gsize samples);
+
+/* Accumulates the peak magnitude and the sum of squares of `samples` */
+typedef void aes67_level_s16_func (const gint16 * src, gsize samples,
+    guint32 * peak, guint64 * sumsq);
+
+/* Kernels in use, scalar until aes67_pcm_init() picked better ones */
+extern aes67_unpack_l24_func *aes67_unpack_l24;
+extern aes67_pack_l24_func *aes67_pack_l24;
+extern aes67_level_s16_func *aes67_level_s16;
+
+void aes67_pcm_init (void);
+gboolean aes67_pcm_select (const gchar * impl);
+const gchar *aes67_pcm_impl (void);
+
+#endif /*__AES67_PCM__*/
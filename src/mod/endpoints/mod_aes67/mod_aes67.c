@@ -43,13 +43,14 @@
 #include <math.h>
 #include <string.h>
 #include "aes67_api.h"
+#include "aes67_pcm.h"
 #include <gst/net/net.h>
 
 #define MY_EVENT_RINGING "aes67::ringing"
 #define MY_EVENT_MAKE_CALL "aes67::makecall"
 #define MY_EVENT_CALL_HELD "aes67::callheld"
 #define MY_EVENT_CALL_RESUMED "aes67::callresumed"
-#define MY_EVENT_CALL_AUDIO_LEVEL "aes67::call_audio_level"
+#define MY_EVENT_STREAM_AUDIO_LEVEL "aes67::stream_audio_level"
 #define MY_EVENT_ERROR_AUDIO_DEV "aes67::audio_dev_error"
 #define MY_EVENT_PTP_STATS "aes67::ptp_stats"
 #define MY_EVENT_PTP_GM_CHANGE "aes67::ptp_grandmaster_change"
@@ -177,6 +178,10 @@ typedef struct _shared_audio_stream_t
   switch_bool_t is_backup_sender;
   /* Timeout in ms to wait for other sender packets arrival*/
   int backup_sender_idle_wait_ms;
+  /* Tx through one interleaved appsrc paced on the stream clock */
+  switch_bool_t tx_interleaved;
+  /* Paces the endpoint sessions, runs while channels are taken */
+  g_media_clock_t *media_clock;
 } shared_audio_stream_t;
 
 typedef struct private_object private_t;
@@ -221,15 +226,12 @@ struct private_object
   unsigned char holdbuf[SWITCH_RECOMMENDED_BUFFER_SIZE];
   audio_endpoint_t *audio_endpoint;
   struct private_object *next;
-  float average_level_rx;
-  float average_level_tx;
-  float new_value_weight;
-  float old_value_weight;
-  uint32_t scount_rx;
-  uint32_t scount_tx;
-  /*! For timed read and writes */
-  switch_timer_t read_timer;
-  switch_timer_t write_timer;
+  /*! Listener slot of this session on the endpoint's input channel */
+  int rx_slot;
+  /*! For timed read and writes, the clock of the endpoint's stream */
+  g_media_clock_t *media_clock;
+  guint64 read_tick;
+  guint64 write_tick;
 
   /* We need our own read frame */
   switch_frame_t read_frame;
@@ -300,6 +302,10 @@ static struct
   switch_bool_t enable_ptp_stats;
   long long int ptp_stats_cb_id;
   int level_report;
+  /* Interval of the stream level events, in ms */
+  int level_report_ms;
+  /* Cleared at shutdown under sh_shtreams_lock, stops the level reports */
+  int running;
   uint64_t ptp_gm_id;
   uint64_t ptp_gm_mac_addr;
   gboolean ptp_synced;
@@ -444,8 +450,9 @@ channel_on_routing (switch_core_session_t * session)
 		  switch_mutex_lock (tech_pvt->audio_endpoint->mutex);
 		  STREAM_READER_LOCK(tech_pvt->audio_endpoint->in_stream);
 
-		  if (add_appsink(tech_pvt->audio_endpoint->in_stream->stream,
-			   tech_pvt->audio_endpoint->inchan, session_id)) {
+		  if (tech_pvt->rx_slot < 0 &&
+			  (tech_pvt->rx_slot = add_listener(tech_pvt->audio_endpoint->in_stream->stream,
+			   tech_pvt->audio_endpoint->inchan, session_id)) >= 0) {
 			   tech_pvt->audio_endpoint->active_listen_sessions++;
 		  }
 
@@ -588,6 +595,7 @@ free_shared_audio_stream (shared_audio_stream_t *stream)
 
     clear_shared_audio_stream(stream);
     /* Deinit here since clear_shared_audio_stream() allows the stream to be reused when reloading */
+    media_clock_free(stream->media_clock);
     g_rw_lock_clear(&stream->rwlock);
     switch_safe_free(stream->indev);
     switch_safe_free(stream->outdev);
@@ -888,6 +896,7 @@ channel_on_hangup (switch_core_session_t * session)
   if (tech_pvt->audio_endpoint) {
     audio_endpoint_t *endpoint = tech_pvt->audio_endpoint;
     char session_id[SESSION_ID_LEN];
+    int release_in = 0;
 
     switch_mutex_lock (endpoint->mutex);
 
@@ -895,24 +904,28 @@ channel_on_hangup (switch_core_session_t * session)
 
     STREAM_READER_LOCK(endpoint->in_stream);
 
-    if (remove_appsink(endpoint->in_stream->stream,
+    if (tech_pvt->rx_slot >= 0 && remove_listener(endpoint->in_stream->stream,
         endpoint->inchan, session_id)) {
         endpoint->active_listen_sessions--;
     }
+    tech_pvt->rx_slot = -1;
 
     STREAM_READER_UNLOCK(endpoint->in_stream);
 
     if (endpoint->active_listen_sessions == 0) {
         switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "releasing inchan \n");
-        release_stream_channel(endpoint->in_stream, endpoint->inchan, 1);
+        release_in = 1;
     }
-    release_stream_channel(endpoint->out_stream, endpoint->outchan, 0);
-    switch_core_timer_destroy(&tech_pvt->read_timer);
-    switch_core_timer_destroy(&tech_pvt->write_timer);
     switch_core_codec_destroy(&tech_pvt->read_codec);
     switch_core_codec_destroy(&tech_pvt->write_codec);
 
     switch_mutex_unlock (endpoint->mutex);
+
+    /* The last release joins the clock thread, which must not happen
+       with the endpoint locked */
+    if (release_in)
+      release_stream_channel(endpoint->in_stream, endpoint->inchan, 1);
+    release_stream_channel(endpoint->out_stream, endpoint->outchan, 0);
     tech_pvt->audio_endpoint = NULL;
   }
 
@@ -976,8 +989,9 @@ channel_on_exchange_media (switch_core_session_t * session)
     switch_mutex_lock (tech_pvt->audio_endpoint->mutex);
     STREAM_READER_LOCK(tech_pvt->audio_endpoint->in_stream);
 
-    if (add_appsink(tech_pvt->audio_endpoint->in_stream->stream,
-        tech_pvt->audio_endpoint->inchan, session_id)) {
+    if (tech_pvt->rx_slot < 0 &&
+        (tech_pvt->rx_slot = add_listener(tech_pvt->audio_endpoint->in_stream->stream,
+        tech_pvt->audio_endpoint->inchan, session_id)) >= 0) {
         tech_pvt->audio_endpoint->active_listen_sessions++;
     }
 
@@ -1005,14 +1019,15 @@ channel_send_dtmf (switch_core_session_t * session, const switch_dtmf_t * dtmf)
 }
 
 static switch_status_t
-channel_endpoint_read (private_t * tech_pvt, switch_frame_t ** frame, char *session_id)
+channel_endpoint_read (private_t * tech_pvt, switch_frame_t ** frame)
 {
   int bytes = 0;
   int samples = 0;
   audio_endpoint_t *endpoint = tech_pvt->audio_endpoint;
 
+  media_clock_wait (tech_pvt->media_clock, &tech_pvt->read_tick);
+
   if (!endpoint->in_stream) {
-    switch_core_timer_next (&tech_pvt->read_timer);
     *frame = &globals.cng_frame;
     return SWITCH_STATUS_SUCCESS;
   }
@@ -1030,7 +1045,7 @@ channel_endpoint_read (private_t * tech_pvt, switch_frame_t ** frame, char *sess
           (unsigned char *) tech_pvt->read_frame.data,
           STREAM_SAMPLES_PER_PACKET (endpoint->in_stream) *
           2 /* FIXME: non-S16LE */ ,
-          endpoint->inchan, &tech_pvt->read_timer, session_id);
+          endpoint->inchan, NULL, tech_pvt->rx_slot);
     STREAM_READER_UNLOCK(endpoint->in_stream);
   } else {
     // Pipeline is being reset, feed some silence
@@ -1041,7 +1056,6 @@ channel_endpoint_read (private_t * tech_pvt, switch_frame_t ** frame, char *sess
   // FIXME: Only works for S16LE
   samples = bytes / sizeof (int16_t);
   if (!bytes) {
-    switch_core_timer_next (&tech_pvt->read_timer);
     *frame = &globals.cng_frame;
     return SWITCH_STATUS_SUCCESS;
   }
@@ -1053,73 +1067,6 @@ channel_endpoint_read (private_t * tech_pvt, switch_frame_t ** frame, char *sess
   return SWITCH_STATUS_SUCCESS;
 }
 
-static void update_level (private_t *tech_pvt, switch_frame_t *frame, uint8_t rx)
-{
-  uint32_t i, samples;
-  int16_t *pcm = frame->data;
-  float level = rx ? tech_pvt->average_level_rx : tech_pvt->average_level_tx;
-  uint32_t scount = rx ? tech_pvt->scount_rx : tech_pvt->scount_tx;
-
-  if (globals.level_report == SWITCH_FALSE) {
-    return;
-  }
-
-  // calculate signal level
-  for (i = 0; i < frame->samples; i++, scount++) {
-    level = (abs(pcm[i]) * tech_pvt->new_value_weight) + (level * tech_pvt->old_value_weight);
-  }
-
-  if (rx) {
-    tech_pvt->average_level_rx = level;
-  } else {
-    tech_pvt->average_level_tx = level;
-  }
-
-  // Fire an event when hitting the per-second rate
-  // we only fire a single event for both rx/tx and do it on the rx cycle for simplicity
-  samples = tech_pvt ?
-    tech_pvt->read_codec.implementation->actual_samples_per_second :
-    globals.read_codec.implementation->actual_samples_per_second;
-
-  if (scount >= samples) {
-    if (rx) {
-      switch_event_t *event;
-      if (switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, MY_EVENT_CALL_AUDIO_LEVEL) == SWITCH_STATUS_SUCCESS) {
-        double rxdb;
-        double txdb;
-        float avg_rx;
-        float avg_tx;
-
-        switch_mutex_t *mutex = tech_pvt->audio_endpoint ? tech_pvt->audio_endpoint->mutex : globals.pvt_lock;
-
-        switch_mutex_lock(mutex);
-        avg_rx = tech_pvt->average_level_rx;
-        avg_tx = tech_pvt->average_level_tx;
-        switch_mutex_unlock(mutex);
-
-        switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(tech_pvt->session),
-            SWITCH_LOG_DEBUG, "firing level event at scount=%u with rate %u rx=%f tx=%f\n", scount, samples,
-            avg_rx,
-            avg_tx);
-
-        rxdb = avg_rx > 0.0 ? 20 * log10(tech_pvt->average_level_rx / (float)SWITCH_SMAX) : -90;
-        txdb = avg_tx > 0.0 ? 20 * log10(tech_pvt->average_level_tx / (float)SWITCH_SMAX) : -90;
-        switch_event_add_header(event, SWITCH_STACK_BOTTOM, "rx-level", "%.2f", rxdb);
-        switch_event_add_header(event, SWITCH_STACK_BOTTOM, "tx-level", "%.2f", txdb);
-        switch_channel_event_set_data(switch_core_session_get_channel(tech_pvt->session), event);
-        switch_event_fire(&event);
-      }
-    }
-    scount = 0;
-  }
-
-  if (rx) {
-    tech_pvt->scount_rx = scount;
-  } else {
-    tech_pvt->scount_tx = scount;
-  }
-}
-
 static switch_status_t
 channel_read_frame (switch_core_session_t * session, switch_frame_t ** frame,
     switch_io_flag_t flags, int stream_id)
@@ -1129,12 +1076,9 @@ channel_read_frame (switch_core_session_t * session, switch_frame_t ** frame,
   int bytes = 0;
   switch_status_t status = SWITCH_STATUS_FALSE;
   switch_assert (tech_pvt != NULL);
-  char session_id[SESSION_ID_LEN];
-  switch_snprintf(session_id, SESSION_ID_LEN, "%llu", switch_core_session_get_id(session));
-
 
   if (tech_pvt->audio_endpoint) {
-    status = channel_endpoint_read (tech_pvt, frame, session_id);
+    status = channel_endpoint_read (tech_pvt, frame);
     goto normal_return;
   }
 
@@ -1211,7 +1155,7 @@ channel_read_frame (switch_core_session_t * session, switch_frame_t ** frame,
       (unsigned char *) globals.read_frame.data,
       globals.read_codec.implementation->samples_per_packet *
       2 /* FIXME: S16LE-only */ ,
-      0, &globals.read_timer, session_id);
+      0, &globals.read_timer, tech_pvt->rx_slot);
   // FIXME: won't work for L24/L32
   samples = bytes / sizeof (int16_t);
   switch_mutex_unlock (globals.device_lock);
@@ -1231,9 +1175,6 @@ channel_read_frame (switch_core_session_t * session, switch_frame_t ** frame,
   }
 
 normal_return:
-  if (*frame) {
-    update_level (tech_pvt, *frame, 1);
-  }
   return status;
 
 cng_nowait:
@@ -1251,8 +1192,10 @@ static switch_status_t
 channel_endpoint_write (private_t * tech_pvt, switch_frame_t * frame)
 {
   audio_endpoint_t *endpoint = tech_pvt->audio_endpoint;
+
+  media_clock_wait (tech_pvt->media_clock, &tech_pvt->write_tick);
+
   if (!endpoint->out_stream) {
-    switch_core_timer_next (&tech_pvt->write_timer);
     return SWITCH_STATUS_SUCCESS;
   }
 
@@ -1271,7 +1214,7 @@ channel_endpoint_write (private_t * tech_pvt, switch_frame_t * frame)
     // Pipeline is not being reset, we can push data
     push_buffer (endpoint->out_stream->stream,
             (unsigned char *) frame->data, frame->datalen, endpoint->outchan,
-            &(tech_pvt->write_timer));
+            NULL);
     STREAM_READER_UNLOCK(endpoint->out_stream);
   }
 
@@ -1286,8 +1229,6 @@ channel_write_frame (switch_core_session_t * session, switch_frame_t * frame,
   private_t *tech_pvt = switch_core_session_get_private (session);
   switch_assert (tech_pvt != NULL);
 
-  update_level (tech_pvt, frame, 0);
-
   if (tech_pvt->audio_endpoint) {
     return channel_endpoint_write (tech_pvt, frame);
   }
@@ -1397,12 +1338,15 @@ take_stream_channel (shared_audio_stream_t * stream, int index, int input, const
       rc = -1;
       goto done;
     }
+    if (!stream->inchan_used[index])
+      media_clock_attach (stream->media_clock);
     stream->inchan_used[index] = 1;
   } else {
     if (!input && stream->outchan_used[index]) {
       rc = -1;
       goto done;
     }
+    media_clock_attach (stream->media_clock);
     stream->outchan_used[index] = 1;
   }
 
@@ -1415,6 +1359,7 @@ static int
 release_stream_channel (shared_audio_stream_t * stream, int index, int input)
 {
   int rc = 0;
+  int detach = 0;
 
   if (!stream) {
     return rc;
@@ -1422,27 +1367,22 @@ release_stream_channel (shared_audio_stream_t * stream, int index, int input)
 
   switch_mutex_lock (stream->mutex);
 
+  /* Every taken channel holds the stream clock once */
   if (input) {
+    detach = stream->inchan_used[index];
     stream->inchan_used[index] = 0;
   } else {
+    detach = stream->outchan_used[index];
     stream->outchan_used[index] = 0;
   }
 
   switch_mutex_unlock (stream->mutex);
-  return rc;
-}
 
-static void init_pvt_level (private_t *tech_pvt)
-{
-  // Init audio level weight factors
-  // FIXME: Have to adjust this if we decide on a different avg window
-  float window = 1000.0f; // window in ms
-  uint32_t samples = tech_pvt?
-    tech_pvt->read_codec.implementation->actual_samples_per_second :
-    globals.read_codec.implementation->actual_samples_per_second;
+  /* The last detach joins the clock thread, don't hold up the stream for it */
+  if (detach)
+    media_clock_detach (stream->media_clock);
 
-  tech_pvt->new_value_weight = 1.0f / ((float)samples * (window / 1000.0f));
-  tech_pvt->old_value_weight = 1.0f - tech_pvt->new_value_weight;
+  return rc;
 }
 
 /* Make sure when you have 2 sessions in the same scope that you pass the appropriate one to the routines
@@ -1461,12 +1401,12 @@ channel_outgoing_channel (switch_core_session_t * session,
   switch_caller_profile_t *caller_profile = NULL;
   switch_call_cause_t retcause = SWITCH_CAUSE_DESTINATION_OUT_OF_ORDER;
   int codec_ms = -1;
-  int samples_per_packet = -1;
   int sample_rate = 0;
   audio_endpoint_t *endpoint = NULL;
   char *endpoint_name = NULL;
   const char *endpoint_answer = NULL;
   char new_sess_id[SESSION_ID_LEN];
+  int release_in = 0;
 
   if (!outbound_profile) {
     switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
@@ -1491,6 +1431,7 @@ channel_outgoing_channel (switch_core_session_t * session,
     channel = switch_core_session_get_channel (*new_session);
     switch_core_session_set_private (*new_session, tech_pvt);
     tech_pvt->session = *new_session;
+    tech_pvt->rx_slot = -1;
   } else {
     switch_log_printf (SWITCH_CHANNEL_SESSION_LOG (*new_session),
         SWITCH_LOG_CRIT, "Hey where is my memory pool?\n");
@@ -1539,28 +1480,18 @@ channel_outgoing_channel (switch_core_session_t * session,
     codec_ms =
         endpoint->in_stream ? endpoint->in_stream->
         codec_ms : endpoint->out_stream->codec_ms;
-    samples_per_packet =
-        endpoint->
-        in_stream ? STREAM_SAMPLES_PER_PACKET (endpoint->in_stream) :
-        STREAM_SAMPLES_PER_PACKET (endpoint->out_stream);
     sample_rate =
         endpoint->in_stream ? endpoint->in_stream->
         sample_rate : endpoint->out_stream->sample_rate;
 
-    if (switch_core_timer_init (&tech_pvt->read_timer,
-            globals.timer_name, codec_ms,
-            samples_per_packet, module_pool) != SWITCH_STATUS_SUCCESS) {
-      switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-          "failed to setup read timer for endpoint '%s'!\n", endpoint->name);
-      goto error;
-    }
-
-    /* The write timer must be setup regardless */
-    if (switch_core_timer_init (&tech_pvt->write_timer,
-            globals.timer_name, codec_ms,
-            samples_per_packet, module_pool) != SWITCH_STATUS_SUCCESS) {
+    /* Reads and writes are paced on the clock of the stream the codec
+       timing comes from */
+    tech_pvt->media_clock =
+        endpoint->in_stream ? endpoint->in_stream->
+        media_clock : endpoint->out_stream->media_clock;
+    if (!tech_pvt->media_clock) {
       switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-          "failed to setup read timer for endpoint '%s'!\n", endpoint->name);
+          "no media clock for endpoint '%s'!\n", endpoint->name);
       goto error;
     }
     //hardcode to Raw 16bit
@@ -1592,7 +1523,7 @@ channel_outgoing_channel (switch_core_session_t * session,
       goto error;
     }
     if (take_stream_channel (endpoint->out_stream, endpoint->outchan, 0, NULL)) {
-      release_stream_channel (endpoint->in_stream, endpoint->inchan, 1);
+      release_in = 1;
       retcause = SWITCH_CAUSE_USER_BUSY;
       goto error;
     }
@@ -1629,19 +1560,11 @@ channel_outgoing_channel (switch_core_session_t * session,
   switch_channel_set_state (channel, CS_INIT);
   switch_channel_set_flag (channel, CF_AUDIO);
 
-  init_pvt_level (tech_pvt);
-
   return SWITCH_CAUSE_SUCCESS;
 
 error:
   if (tech_pvt) {
-    if (tech_pvt->read_timer.interval) {
-          switch_core_timer_destroy(&tech_pvt->read_timer);
-    }
-	  if (tech_pvt->write_timer.interval) {
-          switch_core_timer_destroy(&tech_pvt->write_timer);
-    }
-	  if (tech_pvt->read_codec.codec_interface) {
+    if (tech_pvt->read_codec.codec_interface) {
           switch_core_codec_destroy(&tech_pvt->read_codec);
     }
 	  if (tech_pvt->write_codec.codec_interface) {
@@ -1652,12 +1575,83 @@ error:
   if (endpoint)
     switch_mutex_unlock (endpoint->mutex);
 
+  if (release_in)
+    release_stream_channel (endpoint->in_stream, endpoint->inchan, 1);
+
   if (new_session && *new_session) {
     switch_core_session_destroy (new_session);
   }
   return retcause;
 }
 
+/* L24 (RFC 3190) <-> native 16 bit, using the module's pack/unpack kernels */
+static switch_status_t
+l24_init (switch_codec_t * codec, switch_codec_flag_t flags,
+    const switch_codec_settings_t * codec_settings)
+{
+  if (!(flags & (SWITCH_CODEC_FLAG_ENCODE | SWITCH_CODEC_FLAG_DECODE)))
+    return SWITCH_STATUS_FALSE;
+
+  return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t
+l24_encode (switch_codec_t * codec, switch_codec_t * other_codec,
+    void *decoded_data, uint32_t decoded_data_len, uint32_t decoded_rate,
+    void *encoded_data, uint32_t * encoded_data_len, uint32_t * encoded_rate,
+    unsigned int *flag)
+{
+  uint32_t samples = decoded_data_len / sizeof (int16_t);
+
+  if (samples * 3 > SWITCH_RECOMMENDED_BUFFER_SIZE)
+    return SWITCH_STATUS_FALSE;
+
+  aes67_pack_l24 (encoded_data, decoded_data, samples);
+  *encoded_data_len = samples * 3;
+
+  return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t
+l24_decode (switch_codec_t * codec, switch_codec_t * other_codec,
+    void *encoded_data, uint32_t encoded_data_len, uint32_t encoded_rate,
+    void *decoded_data, uint32_t * decoded_data_len, uint32_t * decoded_rate,
+    unsigned int *flag)
+{
+  uint32_t samples = encoded_data_len / 3;
+
+  aes67_unpack_l24 (decoded_data, encoded_data, samples);
+  *decoded_data_len = samples * sizeof (int16_t);
+
+  return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t
+l24_destroy (switch_codec_t * codec)
+{
+  return SWITCH_STATUS_SUCCESS;
+}
+
+static void
+add_l24_codec (switch_loadable_module_interface_t ** module_interface,
+    switch_memory_pool_t * pool)
+{
+  switch_codec_interface_t *codec_interface;
+  int ms;
+
+  SWITCH_ADD_CODEC (codec_interface, "L24 Signed Linear (24 bit)");
+
+  /* Only the intervals switch_check_interval() accepts get registered */
+  for (ms = 2; ms <= 40; ms += 2) {
+    uint32_t samples = 48 * ms;
+
+    switch_core_codec_add_implementation (pool, codec_interface,
+        SWITCH_CODEC_TYPE_AUDIO, 100, "L24", NULL, 48000, 48000, 48000 * 24,
+        ms * 1000, samples, samples * 2, samples * 3, 1, samples,
+        l24_init, l24_encode, l24_decode, l24_destroy);
+  }
+}
+
 static void
 gst_logger (GstDebugCategory * category, GstDebugLevel level,
     const gchar * file, const gchar * function, gint line,
@@ -1757,6 +1751,9 @@ SWITCH_MODULE_LOAD_FUNCTION (mod_aes67_load)
   // gst_debug_remove_log_function (NULL);
   // gst_debug_set_default_threshold (GST_LEVEL_WARNING);
   gst_debug_add_log_function ((GstLogFunction) gst_logger, NULL, NULL);
+  aes67_pcm_init ();
+  switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO,
+      "Using %s L24 pack/unpack\n", aes67_pcm_impl ());
   switch_core_hash_init (&globals.call_hash);
   switch_core_hash_init (&globals.sh_streams);
   switch_core_hash_init (&globals.endpoints);
@@ -1828,6 +1825,13 @@ SWITCH_MODULE_LOAD_FUNCTION (mod_aes67_load)
     return SWITCH_STATUS_GENERR;
   }
 
+  if (switch_event_reserve_subclass (MY_EVENT_STREAM_AUDIO_LEVEL) !=
+      SWITCH_STATUS_SUCCESS) {
+    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+        "Couldn't register subclass!\n");
+    return SWITCH_STATUS_GENERR;
+  }
+
 
   /* connect my internal structure to the blank pointer passed to me */
   *module_interface =
@@ -1839,6 +1843,8 @@ SWITCH_MODULE_LOAD_FUNCTION (mod_aes67_load)
   aes67_endpoint_interface->io_routines = &aes67_io_routines;
   aes67_endpoint_interface->state_handler = &aes67_event_handlers;
 
+  add_l24_codec (module_interface, pool);
+
   SWITCH_ADD_API(api_interface, "aes67", "aes67 cli", aes_cmd, "<command> [<args>]");
   switch_console_set_complete("add aes67 help");
   switch_console_set_complete("add aes67 streams");
@@ -1848,6 +1854,8 @@ SWITCH_MODULE_LOAD_FUNCTION (mod_aes67_load)
   switch_console_set_complete("add aes67 txflow");
   switch_console_set_complete("add aes67 reloadconf");
 
+  globals.running = 1;
+
   /* indicate that the module should continue to be loaded */
   return SWITCH_STATUS_SUCCESS;
 }
@@ -1915,6 +1923,107 @@ ptp_stats_cb (guint8 d, const GstStructure * stats, gpointer user_data)
   return TRUE;
 }
 
+static void
+add_level_headers (switch_event_t *event, const char *dir, g_level_t *levels,
+    int channels)
+{
+  switch_stream_handle_t rms = { 0 };
+  switch_stream_handle_t peak = { 0 };
+  char name[16];
+  int i;
+
+  SWITCH_STANDARD_STREAM (rms);
+  SWITCH_STANDARD_STREAM (peak);
+
+  for (i = 0; i < channels; i++) {
+    double rms_level = levels[i].samples ?
+        sqrt ((double) levels[i].sumsq / levels[i].samples) : 0.0;
+    double rms_db = rms_level > 0.0 ? 20 * log10 (rms_level / SWITCH_SMAX) : -90;
+    double peak_db = levels[i].peak > 0 ?
+        20 * log10 ((double) levels[i].peak / SWITCH_SMAX) : -90;
+
+    rms.write_function (&rms, "%s%.2f", i ? "," : "", rms_db);
+    peak.write_function (&peak, "%s%.2f", i ? "," : "", peak_db);
+  }
+
+  switch_snprintf (name, sizeof (name), "%s-level", dir);
+  switch_event_add_header_string (event, SWITCH_STACK_BOTTOM, name,
+      (char *) rms.data);
+  switch_snprintf (name, sizeof (name), "%s-peak", dir);
+  switch_event_add_header_string (event, SWITCH_STACK_BOTTOM, name,
+      (char *) peak.data);
+
+  switch_safe_free (rms.data);
+  switch_safe_free (peak.data);
+}
+
+/*
+  Fires one event per stream and interval carrying the RMS and peak level,
+  in dBFS, of every channel as comma separated lists in channel order. The
+  meters run on the stream, streams without a channel taken by a session
+  are reset but do not report.
+*/
+static void
+report_stream_levels (void)
+{
+  /* Only ever called from the runtime thread */
+  static g_level_t rx[MAX_IO_CHANNELS];
+  static g_level_t tx[MAX_IO_CHANNELS];
+  switch_hash_index_t *hi;
+
+  switch_mutex_lock (globals.sh_shtreams_lock);
+  if (!globals.running) {
+    switch_mutex_unlock (globals.sh_shtreams_lock);
+    return;
+  }
+
+  for (hi = switch_core_hash_first (globals.sh_streams); hi; hi = switch_core_hash_next (&hi)) {
+    void *val;
+    shared_audio_stream_t *shstream;
+    switch_event_t *event;
+    int channels = 0;
+    int in_use = 0;
+    int i;
+
+    switch_core_hash_this (hi, NULL, NULL, &val);
+    shstream = (shared_audio_stream_t *) val;
+
+    if (!STREAM_READER_TRYLOCK (shstream)) {
+      continue;
+    }
+    if (shstream->stream) {
+      channels = shstream->stream->channels;
+      take_stream_levels (shstream->stream, rx, tx);
+    }
+    STREAM_READER_UNLOCK (shstream);
+
+    for (i = 0; i < channels && !in_use; i++) {
+      in_use = shstream->inchan_used[i] || shstream->outchan_used[i];
+    }
+    if (!in_use) {
+      continue;
+    }
+
+    if (switch_event_create_subclass (&event, SWITCH_EVENT_CUSTOM,
+            MY_EVENT_STREAM_AUDIO_LEVEL) == SWITCH_STATUS_SUCCESS) {
+      switch_event_add_header_string (event, SWITCH_STACK_BOTTOM, "stream",
+          shstream->name);
+      switch_event_add_header (event, SWITCH_STACK_BOTTOM, "channels", "%d",
+          channels);
+      switch_event_add_header (event, SWITCH_STACK_BOTTOM, "interval-ms", "%d",
+          globals.level_report_ms);
+      if (shstream->indev) {
+        add_level_headers (event, "rx", rx, channels);
+      }
+      if (shstream->outdev) {
+        add_level_headers (event, "tx", tx, channels);
+      }
+      switch_event_fire (&event);
+    }
+  }
+  switch_mutex_unlock (globals.sh_shtreams_lock);
+}
+
 static void
 link_rx_stream (shared_audio_stream_t *stream)
 {
@@ -1937,8 +2046,14 @@ link_rx_stream (shared_audio_stream_t *stream)
       // stream lock aleady done before calling link_rx_stream
 
       if (state == CCS_ACTIVE) {
-        if (add_appsink(tech_pvt->audio_endpoint->in_stream->stream,
-            tech_pvt->audio_endpoint->inchan, session_id)) {
+        /* The pipeline was rebuilt, the old listener slot is gone with it */
+        if (tech_pvt->rx_slot >= 0) {
+          tech_pvt->audio_endpoint->active_listen_sessions--;
+          tech_pvt->rx_slot = -1;
+        }
+
+        if ((tech_pvt->rx_slot = add_listener(tech_pvt->audio_endpoint->in_stream->stream,
+            tech_pvt->audio_endpoint->inchan, session_id)) >= 0) {
 			    tech_pvt->audio_endpoint->active_listen_sessions++;
         }
       }
@@ -2048,6 +2163,11 @@ stream_compare (shared_audio_stream_t *current, shared_audio_stream_t *new)
     stream_changed = TRUE;
   }
 
+  if (current->tx_interleaved != new->tx_interleaved) {
+    current->tx_interleaved = new->tx_interleaved;
+    stream_changed = TRUE;
+  }
+
   return stream_changed;
 }
 
@@ -2201,6 +2321,7 @@ again:
 	stream->multiple_listen = FALSE;
     stream->is_backup_sender = FALSE;
     stream->backup_sender_idle_wait_ms = 1000;
+    stream->tx_interleaved = FALSE;
 
     memset(stream->ts_context_name, 0, TS_CONTEXT_NAME_LEN);
     switch_snprintf (stream->name, sizeof (stream->name), "%s", stream_name);
@@ -2293,6 +2414,8 @@ again:
         stream->is_backup_sender = atoi(val);
       } else if (!strcasecmp(var, "backup-sender-idle-wait-ms")) {
         stream->backup_sender_idle_wait_ms = atoi (val);
+      } else if (!strcasecmp(var, "tx-interleaved")) {
+        stream->tx_interleaved = switch_true(val);
       }
     }
     if (stream->indev == NULL && stream->outdev == NULL) {
@@ -2680,6 +2803,14 @@ load_globals (switch_xml_t cfg)
         globals.rtp_jitbuf_latency = atoi(val);
       } else if (!strcmp(var, "level-report")) {
         globals.level_report = switch_true(val);
+      } else if (!strcmp(var, "level-report-interval")) {
+        int tmp = atoi(val);
+        if (tmp >= 100) {
+          globals.level_report_ms = tmp;
+        } else {
+          switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING,
+              "level-report-interval must be at least 100 ms\n");
+        }
       }
     }
   }
@@ -2726,6 +2857,7 @@ load_config (void)
   globals.rtp_payload_type = 96; /* gstreamer default value*/
   globals.ptp_stats_cb_id = -1; /* default to -1 */
   globals.rtp_jitbuf_latency = 10;
+  globals.level_report_ms = 1000;
   memset(globals.ptp_iface, 0, NW_IFACE_LEN);
 
   if(SWITCH_STATUS_SUCCESS != (status = load_globals(cfg))) {
@@ -2795,13 +2927,23 @@ load_config (void)
   Macro expands to: switch_status_t mod_aes67_runtime() */
 SWITCH_MODULE_RUNTIME_FUNCTION (mod_aes67_runtime)
 {
-  switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO,
-      "Returning from runtime\n");
-  return SWITCH_STATUS_TERM;
+  if (!globals.level_report || !globals.running) {
+    switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO,
+        "Returning from runtime\n");
+    return SWITCH_STATUS_TERM;
+  }
+
+  switch_yield (globals.level_report_ms * 1000);
+  report_stream_levels ();
+
+  return SWITCH_STATUS_SUCCESS;
 }
 
 SWITCH_MODULE_SHUTDOWN_FUNCTION (mod_aes67_shutdown)
 {
+  switch_mutex_lock (globals.sh_shtreams_lock);
+  globals.running = 0;
+  switch_mutex_unlock (globals.sh_shtreams_lock);
 
   if (globals.ptp_stats_cb_id != -1)
     gst_ptp_statistics_callback_remove(globals.ptp_stats_cb_id);
@@ -2823,6 +2965,7 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION (mod_aes67_shutdown)
   switch_event_free_subclass (MY_EVENT_ERROR_AUDIO_DEV);
   switch_event_free_subclass (MY_EVENT_CALL_HELD);
   switch_event_free_subclass (MY_EVENT_CALL_RESUMED);
+  switch_event_free_subclass (MY_EVENT_STREAM_AUDIO_LEVEL);
 
 
   switch_safe_free (globals.dialplan);
@@ -2969,6 +3112,8 @@ open_audio_stream (g_stream_t ** stream, udp_sock_t * indev,
   data.rtp_iface = globals.rtp_iface;
   data.rtp_payload_type = globals.rtp_payload_type;
   data.rtp_jitbuf_latency = globals.rtp_jitbuf_latency;
+  data.tx_interleaved = FALSE;
+  data.metering = FALSE;
 
   *stream = create_pipeline (&data, error_callback);
 
@@ -3015,6 +3160,8 @@ int open_shared_audio_stream (shared_audio_stream_t * shstream)
   data.ts_context_name = shstream->ts_context_name;
   data.is_backup_sender = shstream->is_backup_sender;
   data.backup_sender_idle_wait_ms = shstream->backup_sender_idle_wait_ms;
+  data.tx_interleaved = shstream->tx_interleaved;
+  data.metering = globals.level_report;
 
   shstream->stream = create_pipeline (&data, error_callback);
   return 0;
@@ -3026,6 +3173,10 @@ create_shared_audio_stream (shared_audio_stream_t * shstream)
 
   switch_event_t *event;
 
+  /* Kept across reloads, sessions stay attached while the pipeline changes */
+  if (!shstream->media_clock)
+    shstream->media_clock = media_clock_new ();
+
   if (-1 == open_shared_audio_stream (shstream)) {
     switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
         "Can't open audio device (indev = %s:%d, outdev = %s:%d)\n",
@@ -3039,6 +3190,8 @@ create_shared_audio_stream (shared_audio_stream_t * shstream)
     }
     return -1;
   }
+  media_clock_set_pipeline (shstream->media_clock, shstream->stream->pipeline,
+      shstream->codec_ms);
   // switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Created shared audio stream %s: %d channels %d\n",
   //              shstream->name, shstream->sample_rate, shstream->channels);
   return 0;
@@ -3049,6 +3202,8 @@ clear_shared_audio_stream (shared_audio_stream_t * shstream)
 {
   switch_log_printf (SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG,
       "Destroying shared audio stream %s\n", shstream->name);
+  if (shstream->media_clock)
+    media_clock_set_pipeline (shstream->media_clock, NULL, 0);
   if (shstream->stream)
     stop_pipeline (shstream->stream);
 
@@ -3170,16 +3325,23 @@ static switch_status_t list_shared_streams(switch_stream_handle_t *stream)
     const void *var;
     void *val;
     shared_audio_stream_t *s = NULL;
+    gsize memory = 0;
     switch_core_hash_this(hi, &var, NULL, &val);
     s = val;
+    STREAM_READER_LOCK(s);
+    if (s->stream)
+      memory = get_stream_memory(s->stream);
+    STREAM_READER_UNLOCK(s);
 	stream->write_function(stream, "stream name: %s \t indev.ip_addr: %s, indev.port: %d, "
                     "outdev.ip_addr: %s, outdev.port: %d, sample-rate: %d, "
-                    "codec-ms: %d, channels: %d, sythentic_ptp: %d, txflow: %s\n",
+                    "codec-ms: %d, channels: %d, sythentic_ptp: %d, txflow: %s, tx-mode: %s, "
+                    "memory: %" G_GSIZE_FORMAT " bytes\n",
                     s->name,
                     s->indev ? s->indev->ip_addr: "None", s->indev? s->indev->port : 0,
                     s->outdev ? s->outdev->ip_addr: "None", s->outdev? s->outdev->port : 0,
                     s->sample_rate, s->codec_ms, s->channels,
-                    s->synthetic_ptp, s->txflow?"on":"off");
+                    s->synthetic_ptp, s->txflow?"on":"off",
+                    s->tx_interleaved?"interleaved":"per-channel", memory);
     cnt++;
   }
   switch_mutex_unlock(globals.sh_shtreams_lock);
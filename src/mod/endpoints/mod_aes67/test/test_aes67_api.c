@@ -0,0 +1,251 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2019, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ *
+ * test_aes67_api.c -- tests the aes67 gstreamer helpers
+ *
+ */
+#include <switch.h>
+#include <stdlib.h>
+#include <aes67_api.h>
+#include <aes67_pcm.h>
+
+#include <test/switch_test.h>
+
+#define TEST_RATE 48000
+#define TEST_PTIME 1
+#define TEST_FRAMES 1000
+
+static g_stream_t *tx_stream_new(gboolean pooled)
+{
+	g_stream_t *stream = g_new0(g_stream_t, 1);
+	GstElement *pipeline;
+
+	pipeline = gst_parse_launch("appsrc name=appsrc-ch0 format=time is-live=true "
+								"caps=audio/x-raw,format=S16LE,rate=48000,channels=1,layout=interleaved "
+								"! fakesink sync=false", NULL);
+	if (!pipeline) {
+		g_free(stream);
+		return NULL;
+	}
+
+	stream->pipeline = pipeline;
+	stream->channels = 1;
+	stream->ch[0].appsrc = gst_bin_get_by_name(GST_BIN(pipeline), "appsrc-ch0");
+	if (pooled) {
+		stream->ch[0].pool = create_tx_pool(TEST_RATE, TEST_PTIME, 1, 2);
+	}
+
+	gst_element_set_state(pipeline, GST_STATE_PLAYING);
+	gst_element_get_state(pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+	g_atomic_int_set(&stream->state, GST_STATE_PLAYING);
+	g_atomic_int_set(&stream->clock_sync, 1);
+
+	return stream;
+}
+
+static void tx_stream_free(g_stream_t *stream)
+{
+	gst_element_set_state(stream->pipeline, GST_STATE_NULL);
+	if (stream->ch[0].pool) {
+		gst_buffer_pool_set_active(stream->ch[0].pool, FALSE);
+		gst_object_unref(stream->ch[0].pool);
+	}
+	gst_object_unref(stream->ch[0].appsrc);
+	gst_object_unref(stream->pipeline);
+	g_free(stream);
+}
+
+/* pushes TEST_FRAMES packets paced by a soft timer, returns the buffer allocations per second */
+static double tx_bench(g_stream_t *stream, switch_memory_pool_t *pool)
+{
+	unsigned char payload[TEST_RATE * TEST_PTIME * 2 / 1000] = { 0 };
+	switch_timer_t timer = { 0 };
+	switch_time_t start, elapsed;
+	int i;
+
+	if (switch_core_timer_init(&timer, "soft", TEST_PTIME, TEST_RATE * TEST_PTIME / 1000, pool) != SWITCH_STATUS_SUCCESS) {
+		return -1;
+	}
+
+	start = switch_time_now();
+	for (i = 0; i < TEST_FRAMES; i++) {
+		push_buffer(stream, payload, sizeof(payload), 0, &timer);
+	}
+	elapsed = switch_time_now() - start;
+
+	switch_core_timer_destroy(&timer);
+
+	return (double) g_atomic_int_get(&stream->tx_allocs) * 1000000 / (elapsed ? elapsed : 1);
+}
+
+FST_MINCORE_BEGIN("./conf")
+{
+	FST_SUITE_BEGIN(aes67_api)
+	{
+		FST_SETUP_BEGIN()
+		{
+			gst_init(NULL, NULL);
+		}
+		FST_SETUP_END()
+
+		FST_TEARDOWN_BEGIN()
+		{
+		}
+		FST_TEARDOWN_END()
+
+		FST_TEST_BEGIN(tx_push_buffer_pooled)
+		{
+			g_stream_t *stream;
+			double plain_rate, pooled_rate;
+
+			stream = tx_stream_new(FALSE);
+			fst_requires(stream);
+			plain_rate = tx_bench(stream, fst_pool);
+			fst_check(plain_rate > 0);
+			fst_check(g_atomic_int_get(&stream->tx_allocs) == TEST_FRAMES);
+			tx_stream_free(stream);
+
+			stream = tx_stream_new(TRUE);
+			fst_requires(stream);
+			fst_requires(stream->ch[0].pool);
+			pooled_rate = tx_bench(stream, fst_pool);
+			fst_check(pooled_rate == 0);
+			fst_check(g_atomic_int_get(&stream->tx_allocs) == 0);
+			tx_stream_free(stream);
+
+			printf("TX buffer allocations/sec: unpooled %.0f pooled %.0f\n", plain_rate, pooled_rate);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(media_clock_shared_tick)
+		{
+			g_media_clock_t *mclock = media_clock_new();
+			guint64 cursors[8] = { 0 };
+			switch_time_t start, elapsed;
+			int i, n;
+
+			media_clock_set_pipeline(mclock, NULL, 5);
+			media_clock_attach(mclock);
+			media_clock_attach(mclock);
+			fst_requires(mclock->thread);
+
+			/* every session serves each tick once, all on the same tick */
+			start = switch_time_now();
+			for (n = 0; n < 50; n++) {
+				for (i = 0; i < 8; i++) {
+					media_clock_wait(mclock, &cursors[i]);
+				}
+				for (i = 1; i < 8; i++) {
+					fst_check(cursors[i] == cursors[0]);
+				}
+			}
+			elapsed = switch_time_now() - start;
+			fst_check(elapsed >= 40 * 5000);
+
+			media_clock_detach(mclock);
+			fst_check(mclock->thread != NULL);
+			media_clock_detach(mclock);
+			fst_check(mclock->thread == NULL);
+			media_clock_free(mclock);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(l24_kernels)
+		{
+			const char *impls[] = { "scalar", "ssse3", "avx2" };
+			guint8 l24[3 * 67], packed[3 * 67];
+			gint16 expected[67], s16[67];
+			int i, n, len;
+
+			for (i = 0; i < (int) sizeof(l24); i++) {
+				l24[i] = (guint8) (i * 37 + 11);
+			}
+
+			for (i = 0; i < 67; i++) {
+				expected[i] = (gint16) ((l24[3 * i] << 8) | l24[3 * i + 1]);
+			}
+
+			for (n = 0; n < 3; n++) {
+				if (!aes67_pcm_select(impls[n])) {
+					continue;
+				}
+
+				/* odd lengths run the tails after the vector loops */
+				for (len = 0; len <= 67; len++) {
+					memset(s16, 0, sizeof(s16));
+					aes67_unpack_l24(s16, l24, len);
+					fst_check(!memcmp(s16, expected, len * sizeof(gint16)));
+
+					memset(packed, 0xff, sizeof(packed));
+					aes67_pack_l24(packed, expected, len);
+					for (i = 0; i < len; i++) {
+						fst_check(packed[3 * i] == l24[3 * i] && packed[3 * i + 1] == l24[3 * i + 1] && packed[3 * i + 2] == 0);
+					}
+					if (len < 67) {
+						fst_check(packed[3 * len] == 0xff);
+					}
+				}
+			}
+
+			aes67_pcm_init();
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(level_kernels)
+		{
+			const char *impls[] = { "ssse3", "avx2" };
+			gint16 pcm[203];
+			int i, n, len;
+
+			for (i = 0; i < 203; i++) {
+				pcm[i] = (gint16) (i * 2311 - 17000);
+			}
+			pcm[101] = -32768;
+
+			for (n = 0; n < 2; n++) {
+				if (!aes67_pcm_select(impls[n])) {
+					continue;
+				}
+
+				for (len = 0; len <= 203; len++) {
+					guint32 peak = 0, ref_peak = 0;
+					guint64 sumsq = 0, ref_sumsq = 0;
+
+					aes67_level_s16(pcm, len, &peak, &sumsq);
+					aes67_pcm_select("scalar");
+					aes67_level_s16(pcm, len, &ref_peak, &ref_sumsq);
+					aes67_pcm_select(impls[n]);
+					fst_check(peak == ref_peak && sumsq == ref_sumsq);
+				}
+			}
+
+			aes67_pcm_init();
+		}
+		FST_TEST_END()
+	}
+	FST_SUITE_END()
+}
+FST_MINCORE_END()
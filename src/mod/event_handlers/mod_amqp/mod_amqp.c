@@ -76,6 +76,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_amqp_load)
 	SWITCH_ADD_API(api_interface, "amqp", "amqp API", amqp_reload, "syntax");
 
 	switch_log_bind_logger(mod_amqp_logging_recv, SWITCH_LOG_DEBUG, SWITCH_FALSE);
+	mod_amqp_logging_refresh_mask();
 
 	return SWITCH_STATUS_SUCCESS;
 }
@@ -229,6 +229,7 @@ char *amqp_util_encode(char *key, char *dest);
 
 /* logging */
 switch_status_t mod_amqp_logging_recv(const switch_log_node_t *node, switch_log_level_t level);
+void mod_amqp_logging_refresh_mask(void);
 switch_status_t mod_amqp_logging_create(char *name, switch_xml_t cfg);
 switch_status_t mod_amqp_logging_destroy(mod_amqp_logging_profile_t **prof);
 void * SWITCH_THREAD_FUNC mod_amqp_logging_thread(switch_thread_t *thread, void *data);
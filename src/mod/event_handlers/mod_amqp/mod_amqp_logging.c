@@ -38,6 +38,23 @@
 
 #include "mod_amqp.h"
 
+/* tell the core which levels any logging profile wants so it can skip formatting the rest */
+void mod_amqp_logging_refresh_mask(void)
+{
+	switch_hash_index_t *hi = NULL;
+	mod_amqp_logging_profile_t *logging = NULL;
+	uint32_t mask = 0;
+
+	for (hi = switch_core_hash_first(mod_amqp_globals.logging_hash); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, (void **)&logging);
+		if (logging) {
+			mask |= logging->log_level_mask;
+		}
+	}
+
+	switch_log_binding_set_mask(mod_amqp_logging_recv, mask);
+}
+
 switch_status_t mod_amqp_logging_recv(const switch_log_node_t *node, switch_log_level_t level)
 {
 	switch_hash_index_t *hi = NULL;
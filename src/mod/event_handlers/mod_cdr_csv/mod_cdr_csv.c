@@ -34,14 +34,36 @@ typedef enum {
 	CDR_LEG_B = (1 << 1)
 } cdr_leg_t;
 
+#define CDR_QUEUE_LEN 10000
+#define CDR_FLUSH_BYTES 65536
+#define CDR_SYNC_NEVER -1
+
 struct cdr_fd {
 	int fd;
 	char *path;
 	int64_t bytes;
 	switch_mutex_t *mutex;
+	/* lines waiting for the next commit, only touched by the writer thread */
+	char *buf;
+	switch_size_t buf_len;
+	switch_size_t buf_size;
+	struct cdr_fd *next_dirty;
+	int dirty;
+	/* where lines go while path can't be written, replayed into path once it can */
+	char *backlog_path;
+	int backlogged;
+	int64_t backlog_offset;
+	switch_time_t last_sync;
 };
 typedef struct cdr_fd cdr_fd_t;
 
+typedef struct cdr_line {
+	cdr_fd_t *fd;
+	struct cdr_line *next;
+	switch_size_t len;
+	char data[1];
+} cdr_line_t;
+
 const char *default_template =
 	"\"${caller_id_name}\",\"${caller_id_number}\",\"${destination_number}\",\"${context}\",\"${start_stamp}\","
 	"\"${answer_stamp}\",\"${end_stamp}\",\"${duration}\",\"${billsec}\",\"${hangup_cause}\",\"${uuid}\",\"${bleg_uuid}\", \"${accountcode}\"\n";
@@ -52,12 +74,25 @@ static struct {
 	switch_hash_t *fd_hash;
 	switch_hash_t *template_hash;
 	char *log_dir;
+	char *backlog_dir;
 	char *default_template;
 	int masterfileonly;
 	int shutdown;
 	int rotate;
 	int debug;
 	cdr_leg_t legs;
+	switch_queue_t *write_queue;
+	uint32_t queue_len;
+	switch_thread_t *writer_thread;
+	/* CDR_SYNC_NEVER, 0 for every commit or the least time between two fsyncs */
+	switch_interval_time_t sync_interval;
+	/* lines that did not fit in write_queue, up to queue_len more of them, for the writer thread to pick up */
+	switch_mutex_t *overflow_mutex;
+	cdr_line_t *overflow_head;
+	cdr_line_t *overflow_tail;
+	uint32_t overflow_len;
+	switch_atomic_t overflows;
+	switch_atomic_t drops;
 } globals;
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load);
@@ -71,7 +106,7 @@ static off_t fd_size(int fd)
 	return s.st_size;
 }
 
-static void do_reopen(cdr_fd_t *fd)
+static void do_reopen(cdr_fd_t *fd, int attempts)
 {
 	int x = 0;
 
@@ -80,7 +115,7 @@ static void do_reopen(cdr_fd_t *fd)
 		fd->fd = -1;
 	}
 
-	for (x = 0; x < 10; x++) {
+	for (x = 0; x < attempts; x++) {
 #ifdef _MSC_VER
 		if ((fd->fd = open(fd->path, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR)) > -1) {
 #else
@@ -89,7 +124,9 @@ static void do_reopen(cdr_fd_t *fd)
 			fd->bytes = fd_size(fd->fd);
 			break;
 		}
-		switch_yield(100000);
+		if (x + 1 < attempts) {
+			switch_yield(100000);
+		}
 	}
 }
 
@@ -114,7 +151,7 @@ static void do_rotate(cdr_fd_t *fd)
 		free(p);
 	}
 
-	do_reopen(fd);
+	do_reopen(fd, 10);
 
 	if (fd->fd < 0) {
 		switch_event_t *event;
@@ -129,52 +166,346 @@ static void do_rotate(cdr_fd_t *fd)
 
 }
 
-static void write_cdr(const char *path, const char *log_line)
+static switch_bool_t cdr_write_all(int fd, const char *data, switch_size_t len, switch_size_t *written)
+{
+	*written = 0;
+
+	while (*written < len) {
+		int bytes = write(fd, data + *written, (unsigned) (len - *written));
+
+		if (bytes <= 0) {
+			if (bytes < 0 && errno == EINTR) {
+				continue;
+			}
+			return SWITCH_FALSE;
+		}
+
+		*written += bytes;
+	}
+
+	return SWITCH_TRUE;
+}
+
+static void cdr_sync(cdr_fd_t *fd)
+{
+	switch_time_t now;
+
+	if (globals.sync_interval == CDR_SYNC_NEVER || fd->fd < 0) {
+		return;
+	}
+
+	now = switch_micro_time_now();
+
+	if (globals.sync_interval && now - fd->last_sync < globals.sync_interval) {
+		return;
+	}
+
+#ifdef _MSC_VER
+	_commit(fd->fd);
+#else
+	fsync(fd->fd);
+#endif
+	fd->last_sync = now;
+}
+
+/* keep what could not be written to the target in the backlog dir, must be called with fd->mutex locked */
+static void cdr_spill(cdr_fd_t *fd, const char *data, switch_size_t len)
+{
+	int bfd;
+	switch_size_t written = 0;
+
+#ifdef _MSC_VER
+	bfd = open(fd->backlog_path, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+#else
+	bfd = open(fd->backlog_path, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+#endif
+
+	if (bfd > -1) {
+		cdr_write_all(bfd, data, len, &written);
+		close(bfd);
+	}
+
+	if (written == len) {
+		if (!fd->backlogged) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Can't write to %s, keeping CDRs in %s until it is writable again\n",
+							  fd->path, fd->backlog_path);
+		}
+		fd->backlogged = 1;
+	} else {
+		switch_event_t *event;
+
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Lost %ld bytes of CDRs for %s, backlog %s is not writable either\n",
+						  (long) (len - written), fd->path, fd->backlog_path);
+		if (switch_event_create(&event, SWITCH_EVENT_TRAP) == SWITCH_STATUS_SUCCESS) {
+			switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Critical-Error", "Error writing cdr file %s\n", fd->path);
+			switch_event_fire(&event);
+		}
+	}
+}
+
+/* move the backlog back into the target, must be called with fd->mutex locked and fd->fd open */
+static switch_bool_t cdr_replay_backlog(cdr_fd_t *fd)
+{
+	char data[CDR_FLUSH_BYTES];
+	int bfd;
+	int bytes;
+	switch_bool_t ok = SWITCH_TRUE;
+
+	if ((bfd = open(fd->backlog_path, O_RDONLY)) < 0) {
+		fd->backlogged = 0;
+		fd->backlog_offset = 0;
+		return SWITCH_TRUE;
+	}
+
+	if (fd->backlog_offset && lseek(bfd, (off_t) fd->backlog_offset, SEEK_SET) < 0) {
+		close(bfd);
+		return SWITCH_FALSE;
+	}
+
+	while ((bytes = read(bfd, data, sizeof(data))) > 0) {
+		switch_size_t written = 0;
+
+		ok = cdr_write_all(fd->fd, data, bytes, &written);
+		fd->bytes += written;
+		/* remember how far we got so a retry doesn't write anything twice */
+		fd->backlog_offset += written;
+
+		if (!ok) {
+			break;
+		}
+	}
+
+	close(bfd);
+
+	if (ok && bytes == 0) {
+		unlink(fd->backlog_path);
+		fd->backlogged = 0;
+		fd->backlog_offset = 0;
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Replayed the CDR backlog into %s\n", fd->path);
+		return SWITCH_TRUE;
+	}
+
+	return SWITCH_FALSE;
+}
+
+/* write data to fd's file or its backlog, must be called with fd->mutex locked */
+static void cdr_commit(cdr_fd_t *fd, const char *data, switch_size_t len)
+{
+	switch_size_t written = 0;
+
+	if (fd->fd < 0) {
+		do_reopen(fd, 1);
+	}
+
+	if (fd->fd > -1 && fd->backlogged && !cdr_replay_backlog(fd)) {
+		close(fd->fd);
+		fd->fd = -1;
+	}
+
+	if (fd->fd > -1 && !fd->backlogged) {
+		if (fd->bytes + len > UINT_MAX) {
+			do_rotate(fd);
+		}
+
+		if (fd->fd > -1) {
+			if (!cdr_write_all(fd->fd, data, len, &written)) {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Write error to file %s %ld/%ld\n", fd->path, (long) written, (long) len);
+				close(fd->fd);
+				fd->fd = -1;
+			}
+			fd->bytes += written;
+			cdr_sync(fd);
+		}
+	}
+
+	if (written < len) {
+		cdr_spill(fd, data + written, len - written);
+	}
+}
+
+static cdr_fd_t *cdr_get_fd(const char *path)
 {
 	cdr_fd_t *fd = NULL;
-	unsigned int bytes_in, bytes_out;
-	int loops = 0;
 
 	switch_mutex_lock(globals.mutex);
 	if (!(fd = switch_core_hash_find(globals.fd_hash, path))) {
+		char *p;
+
 		fd = switch_core_alloc(globals.pool, sizeof(*fd));
 		switch_assert(fd);
 		memset(fd, 0, sizeof(*fd));
 		fd->fd = -1;
 		switch_mutex_init(&fd->mutex, SWITCH_MUTEX_NESTED, globals.pool);
 		fd->path = switch_core_strdup(globals.pool, path);
+
+		fd->backlog_path = switch_core_sprintf(globals.pool, "%s%s%s", globals.backlog_dir, SWITCH_PATH_SEPARATOR, path);
+		for (p = fd->backlog_path + strlen(globals.backlog_dir) + strlen(SWITCH_PATH_SEPARATOR); *p; p++) {
+			if (*p == '/' || *p == '\\' || *p == ':') {
+				*p = '_';
+			}
+		}
+		/* left over from before a restart */
+		fd->backlogged = switch_file_exists(fd->backlog_path, globals.pool) == SWITCH_STATUS_SUCCESS;
+
 		switch_core_hash_insert(globals.fd_hash, path, fd);
 	}
 	switch_mutex_unlock(globals.mutex);
 
-	switch_mutex_lock(fd->mutex);
-	bytes_out = (unsigned) strlen(log_line);
+	return fd;
+}
 
-	if (fd->fd < 0) {
-		do_reopen(fd);
-		if (fd->fd < 0) {
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error opening %s\n", path);
-			goto end;
+static void write_cdr(const char *path, const char *log_line)
+{
+	cdr_fd_t *fd = cdr_get_fd(path);
+	switch_size_t len = strlen(log_line);
+	cdr_line_t *line;
+
+	if (globals.writer_thread) {
+		switch_malloc(line, sizeof(*line) + len);
+		line->fd = fd;
+		line->len = len;
+		memcpy(line->data, log_line, len + 1);
+
+		line->next = NULL;
+
+		/* shutdown flips the flag under this mutex before it drains, so nothing queued here can be missed */
+		switch_mutex_lock(globals.overflow_mutex);
+		if (globals.shutdown) {
+			switch_mutex_unlock(globals.overflow_mutex);
+			free(line);
+			goto direct;
 		}
+
+		if (switch_queue_trypush(globals.write_queue, line) == SWITCH_STATUS_SUCCESS) {
+			switch_mutex_unlock(globals.overflow_mutex);
+			return;
+		}
+
+		/* never wait on the disk from here, park the line for the writer thread or drop it */
+		if (globals.overflow_len < globals.queue_len) {
+			if (globals.overflow_tail) {
+				globals.overflow_tail->next = line;
+			} else {
+				globals.overflow_head = line;
+			}
+			globals.overflow_tail = line;
+			globals.overflow_len++;
+			line = NULL;
+		}
+		switch_mutex_unlock(globals.overflow_mutex);
+
+		if (line) {
+			if (switch_atomic_read(&globals.drops) == 0) {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "CDR write queue and overflow are full, dropping CDRs\n");
+			}
+			switch_atomic_inc(&globals.drops);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Dropped CDR for %s: %s", path, log_line);
+			free(line);
+		} else {
+			if (switch_atomic_read(&globals.overflows) == 0) {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "CDR write queue is full, holding CDRs for the writer thread\n");
+			}
+			switch_atomic_inc(&globals.overflows);
+		}
+
+		return;
 	}
 
-	if (fd->bytes + bytes_out > UINT_MAX) {
-		do_rotate(fd);
+  direct:
+	switch_mutex_lock(fd->mutex);
+	cdr_commit(fd, log_line, len);
+	switch_mutex_unlock(fd->mutex);
+}
+
+static void cdr_flush(cdr_fd_t *fd)
+{
+	if (!fd->buf_len) {
+		return;
 	}
 
-	while ((bytes_in = write(fd->fd, log_line, bytes_out)) != bytes_out && ++loops < 10) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Write error to file %s %d/%d\n", path, (int) bytes_in, (int) bytes_out);
-		do_rotate(fd);
-		switch_yield(250000);
+	switch_mutex_lock(fd->mutex);
+	cdr_commit(fd, fd->buf, fd->buf_len);
+	switch_mutex_unlock(fd->mutex);
+
+	fd->buf_len = 0;
+}
+
+static cdr_line_t *cdr_overflow_take(void)
+{
+	cdr_line_t *head;
+
+	switch_mutex_lock(globals.overflow_mutex);
+	head = globals.overflow_head;
+	globals.overflow_head = globals.overflow_tail = NULL;
+	globals.overflow_len = 0;
+	switch_mutex_unlock(globals.overflow_mutex);
+
+	return head;
+}
+
+/* append line to its file's pending buffer and free it, the file is put on the dirty list */
+static void cdr_buffer_line(cdr_line_t *line, cdr_fd_t **dirty)
+{
+	cdr_fd_t *fd = line->fd;
+
+	if (fd->buf_len + line->len > fd->buf_size) {
+		if (fd->buf_len >= CDR_FLUSH_BYTES) {
+			cdr_flush(fd);
+		}
+
+		if (fd->buf_len + line->len > fd->buf_size) {
+			fd->buf_size = fd->buf_len + line->len > CDR_FLUSH_BYTES ? fd->buf_len + line->len : CDR_FLUSH_BYTES;
+			fd->buf = realloc(fd->buf, fd->buf_size);
+			switch_assert(fd->buf);
+		}
 	}
 
-	if (bytes_in > 0) {
-		fd->bytes += bytes_in;
+	memcpy(fd->buf + fd->buf_len, line->data, line->len);
+	fd->buf_len += line->len;
+	free(line);
+
+	if (!fd->dirty) {
+		fd->dirty = 1;
+		fd->next_dirty = *dirty;
+		*dirty = fd;
 	}
+}
 
-  end:
+static void *SWITCH_THREAD_FUNC cdr_writer_thread(switch_thread_t *thread, void *obj)
+{
+	int running = 1;
+
+	while (running) {
+		cdr_fd_t *dirty = NULL, *fd;
+		cdr_line_t *line, *next;
+		void *pop = NULL;
+
+		/* gather everything already queued and commit it with one write per file */
+		if (switch_queue_pop_timeout(globals.write_queue, &pop, 1000000) == SWITCH_STATUS_SUCCESS) {
+			do {
+				if (!pop) {
+					running = 0;
+					continue;
+				}
 
-	switch_mutex_unlock(fd->mutex);
+				cdr_buffer_line((cdr_line_t *) pop, &dirty);
+			} while (switch_queue_trypop(globals.write_queue, &pop) == SWITCH_STATUS_SUCCESS);
+		}
+
+		for (line = cdr_overflow_take(); line; line = next) {
+			next = line->next;
+			cdr_buffer_line(line, &dirty);
+		}
+
+		while ((fd = dirty)) {
+			dirty = fd->next_dirty;
+			fd->next_dirty = NULL;
+			fd->dirty = 0;
+			cdr_flush(fd);
+		}
+	}
+
+	return NULL;
 }
 
 static switch_status_t my_on_reporting(switch_core_session_t *session)
@@ -308,6 +639,7 @@ static void do_teardown(void)
 			close(fd->fd);
 			fd->fd = -1;
 		}
+		switch_safe_free(fd->buf);
 		switch_mutex_unlock(fd->mutex);
 	}
 	switch_mutex_unlock(globals.mutex);
@@ -332,6 +664,24 @@ SWITCH_STANDARD_API(cdr_csv_function)
 		return SWITCH_STATUS_SUCCESS;
 	}
 
+	if (!strcmp(cmd, "status")) {
+		switch_hash_index_t *hi;
+		void *val;
+
+		stream->write_function(stream, "queued: %d/%u overflows: %u dropped: %u\n", globals.write_queue ? switch_queue_size(globals.write_queue) : 0,
+							   globals.queue_len, switch_atomic_read(&globals.overflows), switch_atomic_read(&globals.drops));
+		switch_mutex_lock(globals.mutex);
+		for (hi = switch_core_hash_first(globals.fd_hash); hi; hi = switch_core_hash_next(&hi)) {
+			cdr_fd_t *fd;
+
+			switch_core_hash_this(hi, NULL, NULL, &val);
+			fd = (cdr_fd_t *) val;
+			stream->write_function(stream, "%s %s\n", fd->path, fd->backlogged ? fd->backlog_path : "ok");
+		}
+		switch_mutex_unlock(globals.mutex);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
 	return SWITCH_STATUS_FALSE;
 }
 
@@ -363,6 +713,8 @@ static switch_status_t load_config(switch_memory_pool_t *pool)
 	switch_core_hash_init(&globals.template_hash);
 
 	globals.pool = pool;
+	globals.queue_len = CDR_QUEUE_LEN;
+	globals.sync_interval = CDR_SYNC_NEVER;
 
 	switch_core_hash_insert(globals.template_hash, "default", default_template);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Adding default template.\n");
@@ -394,6 +746,16 @@ static switch_status_t load_config(switch_memory_pool_t *pool)
 					globals.default_template = switch_core_strdup(pool, val);
 				} else if (!strcasecmp(var, "master-file-only")) {
 					globals.masterfileonly = switch_true(val);
+				} else if (!strcasecmp(var, "queue-size")) {
+					globals.queue_len = switch_atoui(val);
+				} else if (!strcasecmp(var, "fsync")) {
+					if (switch_is_number(val)) {
+						globals.sync_interval = (switch_interval_time_t) atoi(val) * 1000000;
+					} else {
+						globals.sync_interval = switch_true(val) ? 0 : CDR_SYNC_NEVER;
+					}
+				} else if (!strcasecmp(var, "backlog-dir")) {
+					globals.backlog_dir = switch_core_strdup(pool, val);
 				}
 			}
 		}
@@ -428,6 +790,10 @@ static switch_status_t load_config(switch_memory_pool_t *pool)
 		globals.log_dir = switch_core_sprintf(pool, "%s%scdr-csv", SWITCH_GLOBAL_dirs.log_dir, SWITCH_PATH_SEPARATOR);
 	}
 
+	if (!globals.backlog_dir) {
+		globals.backlog_dir = switch_core_sprintf(pool, "%s%scdr-csv-backlog", SWITCH_GLOBAL_dirs.storage_dir, SWITCH_PATH_SEPARATOR);
+	}
+
 	return status;
 }
 
@@ -446,6 +812,24 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load)
 		return status;
 	}
 
+	if (switch_dir_make_recursive(globals.backlog_dir, SWITCH_DEFAULT_DIR_PERMS, pool) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Error creating %s, CDRs will be lost while a csv file is not writable\n",
+						  globals.backlog_dir);
+	}
+
+	if (globals.queue_len) {
+		switch_threadattr_t *thd_attr = NULL;
+
+		switch_queue_create(&globals.write_queue, globals.queue_len, pool);
+		switch_mutex_init(&globals.overflow_mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_threadattr_create(&thd_attr, pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		if (switch_thread_create(&globals.writer_thread, thd_attr, cdr_writer_thread, NULL, pool) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't start the writer thread, writing from the session threads\n");
+			globals.writer_thread = NULL;
+		}
+	}
+
 	if ((status = switch_event_bind(modname, SWITCH_EVENT_TRAP, SWITCH_EVENT_SUBCLASS_ANY, event_handler, NULL)) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind!\n");
 		return status;
@@ -454,8 +838,9 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load)
 	switch_core_add_state_handler(&state_handlers);
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 
-	SWITCH_ADD_API(api_interface, "cdr_csv", "cdr_csv controls", cdr_csv_function, "parameters");
+	SWITCH_ADD_API(api_interface, "cdr_csv", "cdr_csv controls", cdr_csv_function, "<rotate|status>");
 	switch_console_set_complete("add cdr_csv rotate");
+	switch_console_set_complete("add cdr_csv status");
 
 	return status;
 }
@@ -465,10 +850,45 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_cdr_csv_shutdown)
 {
 	switch_console_set_complete("del cdr_csv");
 
+	if (globals.overflow_mutex) {
+		switch_mutex_lock(globals.overflow_mutex);
+	}
 	globals.shutdown = 1;
+	if (globals.overflow_mutex) {
+		switch_mutex_unlock(globals.overflow_mutex);
+	}
+
 	switch_event_unbind_callback(event_handler);
 	switch_core_remove_state_handler(&state_handlers);
 
+	if (globals.writer_thread) {
+		switch_status_t st;
+		cdr_line_t *line, *next;
+		void *pop = NULL;
+
+		switch_queue_push(globals.write_queue, NULL);
+		switch_thread_join(&st, globals.writer_thread);
+		globals.writer_thread = NULL;
+
+		/* nothing is queued once the flag is set, this only catches what the writer thread left behind */
+		while (switch_queue_trypop(globals.write_queue, &pop) == SWITCH_STATUS_SUCCESS) {
+			if ((line = (cdr_line_t *) pop)) {
+				switch_mutex_lock(line->fd->mutex);
+				cdr_commit(line->fd, line->data, line->len);
+				switch_mutex_unlock(line->fd->mutex);
+				free(line);
+			}
+		}
+
+		for (line = cdr_overflow_take(); line; line = next) {
+			next = line->next;
+			switch_mutex_lock(line->fd->mutex);
+			cdr_commit(line->fd, line->data, line->len);
+			switch_mutex_unlock(line->fd->mutex);
+			free(line);
+		}
+	}
+
 	do_teardown();
 	switch_core_hash_destroy(&globals.fd_hash);
 	switch_core_hash_destroy(&globals.template_hash);
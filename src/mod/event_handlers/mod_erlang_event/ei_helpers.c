@@ -112,8 +112,16 @@ void ei_encode_switch_event_headers(ei_x_buff * ebuf, switch_event_t *event)
 	for (hp = event->headers; hp; hp = hp->next) {
 		ei_x_encode_tuple_header(ebuf, 2);
 		_ei_x_encode_string(ebuf, hp->name);
-		switch_url_decode(hp->value);
-		_ei_x_encode_string(ebuf, hp->value);
+		/* the event may be shared with other listeners, don't decode it in place */
+		if (strchr(hp->value, '%')) {
+			char *value = strdup(hp->value);
+			switch_assert(value);
+			switch_url_decode(value);
+			_ei_x_encode_string(ebuf, value);
+			free(value);
+		} else {
+			_ei_x_encode_string(ebuf, hp->value);
+		}
 	}
 
 	if (event->body) {
@@ -252,6 +252,7 @@ static switch_status_t handle_msg_set_log_level(listener_t *listener, int arity,
 
 		if (ltype && ltype != SWITCH_LOG_INVALID) {
 			listener->level = ltype;
+			refresh_log_mask();
 			ei_x_encode_atom(rbuf, "ok");
 		} else {
 			ei_x_encode_tuple_header(rbuf, 2);
@@ -1114,6 +1115,7 @@ static switch_status_t handle_msg_atom(listener_t *listener, erlang_msg * msg, e
 			/*purge the log queue */
 			while (switch_queue_trypop(listener->log_queue, &pop) == SWITCH_STATUS_SUCCESS);
 			switch_clear_flag_locked(listener, LFLAG_LOG);
+			refresh_log_mask();
 		}
 		ei_x_encode_atom(rbuf, "ok");
 	} else if (!strncmp(atom, "register_log_handler", MAXATOMLEN)) {
@@ -1122,6 +1124,7 @@ static switch_status_t handle_msg_atom(listener_t *listener, erlang_msg * msg, e
 		memcpy(&listener->log_process.pid, &msg->from, sizeof(erlang_pid));
 		listener->level = SWITCH_LOG_DEBUG;
 		switch_set_flag(listener, LFLAG_LOG);
+		refresh_log_mask();
 		ei_x_encode_atom(rbuf, "ok");
 	} else if (!strncmp(atom, "register_event_handler", MAXATOMLEN)) {
 		ei_link(listener, ei_self(listener->ec), &msg->from);
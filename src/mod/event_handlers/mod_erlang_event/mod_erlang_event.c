@@ -92,6 +92,33 @@ static switch_status_t socket_logger(const switch_log_node_t *node, switch_log_l
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/* publish the most verbose level any listener is logging at so the core skips formatting the rest,
+   never call this holding listener_rwlock, the log thread takes it under the binding lock */
+void refresh_log_mask(void)
+{
+	listener_t *l;
+	int32_t level = SWITCH_LOG_DISABLE, i;
+	uint32_t mask = 0;
+
+	switch_mutex_lock(mod_erlang_event_globals.log_mask_mutex);
+
+	switch_thread_rwlock_rdlock(mod_erlang_event_globals.listener_rwlock);
+	for (l = listen_list.listeners; l; l = l->next) {
+		if (switch_test_flag(l, LFLAG_LOG) && (int32_t) l->level > level) {
+			level = l->level;
+		}
+	}
+	switch_thread_rwlock_unlock(mod_erlang_event_globals.listener_rwlock);
+
+	for (i = 0; i <= level && i <= SWITCH_LOG_DEBUG; i++) {
+		mask |= (1 << i);
+	}
+
+	switch_log_binding_set_mask(socket_logger, mask);
+
+	switch_mutex_unlock(mod_erlang_event_globals.log_mask_mutex);
+}
+
 
 static void remove_binding(listener_t *listener, erlang_pid * pid)
 {
@@ -156,7 +183,7 @@ static void send_event_to_attached_sessions(listener_t *listener, switch_event_t
 		if (send) {
 			switch_log_printf(SWITCH_CHANNEL_UUID_LOG(s->uuid_str), SWITCH_LOG_DEBUG, "Sending event %s to attached session %s\n",
 					switch_event_name(event->event_id), s->uuid_str);
-			if (switch_event_dup(&clone, event) == SWITCH_STATUS_SUCCESS) {
+			if ((clone = switch_event_ref(event))) {
 				/* add the event to the queue for this session */
 				if (switch_queue_trypush(s->event_queue, clone) != SWITCH_STATUS_SUCCESS) {
 					switch_log_printf(SWITCH_CHANNEL_UUID_LOG(s->uuid_str), SWITCH_LOG_ERROR, "Lost event!\n");
@@ -282,7 +309,7 @@ static void event_handler(switch_event_t *event)
 		switch_thread_rwlock_unlock(l->event_rwlock);
 
 		if (send) {
-			if (switch_event_dup(&clone, event) == SWITCH_STATUS_SUCCESS) {
+			if ((clone = switch_event_ref(event))) {
 				if (switch_queue_trypush(l->event_queue, clone) == SWITCH_STATUS_SUCCESS) {
 					if (l->lost_events) {
 						int le = l->lost_events;
@@ -326,6 +353,8 @@ static void add_listener(listener_t *listener)
 	listener->next = listen_list.listeners;
 	listen_list.listeners = listener;
 	switch_thread_rwlock_unlock(mod_erlang_event_globals.listener_rwlock);
+
+	refresh_log_mask();
 }
 
 
@@ -345,6 +374,8 @@ static void remove_listener(listener_t *listener)
 		last = l;
 	}
 	switch_thread_rwlock_unlock(mod_erlang_event_globals.listener_rwlock);
+
+	refresh_log_mask();
 }
 
 /* Search for a listener already talking to the specified node and lock for reading*/
@@ -940,6 +971,7 @@ static void handle_exit(listener_t *listener, erlang_pid * pid)
 
 		if (switch_test_flag(listener, LFLAG_LOG)) {
 			switch_clear_flag_locked(listener, LFLAG_LOG);
+			refresh_log_mask();
 		}
 	}
 
@@ -1946,6 +1978,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_erlang_event_load)
 	switch_mutex_init(&mod_erlang_event_globals.fetch_reply_mutex, SWITCH_MUTEX_DEFAULT, pool);
 	switch_mutex_init(&mod_erlang_event_globals.listener_count_mutex, SWITCH_MUTEX_UNNESTED, pool);
 	switch_mutex_init(&mod_erlang_event_globals.listener_mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_mutex_init(&mod_erlang_event_globals.log_mask_mutex, SWITCH_MUTEX_NESTED, pool);
 	switch_core_hash_init(&mod_erlang_event_globals.fetch_reply_hash);
 
 	/* intialize the unique reference stuff */
@@ -1962,6 +1995,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_erlang_event_load)
 	}
 
 	switch_log_bind_logger(socket_logger, SWITCH_LOG_DEBUG, SWITCH_FALSE);
+	refresh_log_mask();
 
 	memset(&bindings, 0, sizeof(bindings));
 
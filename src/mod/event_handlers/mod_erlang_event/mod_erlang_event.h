@@ -173,6 +173,7 @@ struct globals_struct {
 	switch_mutex_t *ref_mutex;
 	switch_mutex_t *fetch_reply_mutex;
 	switch_mutex_t *listener_count_mutex;
+	switch_mutex_t *log_mask_mutex;
 	switch_hash_t *fetch_reply_hash;
 	unsigned int reference0;
 	unsigned int reference1;
@@ -273,6 +274,7 @@ session_elem_t *attach_call_to_pid(listener_t *listener, erlang_pid * pid, switc
 session_elem_t *attach_call_to_spawned_process(listener_t *listener, char *module, char *function, switch_core_session_t *session);
 session_elem_t *find_session_elem_by_pid(listener_t *listener, erlang_pid *pid);
 void put_reply_unlock(fetch_reply_t *p, char *uuid_str);
+void refresh_log_mask(void);
 
 fetch_reply_t *find_fetch_reply(const char *uuid);
 
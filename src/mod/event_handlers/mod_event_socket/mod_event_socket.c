@@ -67,6 +67,16 @@ typedef enum {
 	EVENT_FORMAT_JSON
 } event_format_t;
 
+/* a filter header parsed once when it is set instead of on every event */
+typedef struct listener_filter {
+	/* name and value point into listener->filters */
+	const char *header;
+	const char *value;
+	switch_regex_t *re;
+	int is_regex;
+	int pos;
+} listener_filter_t;
+
 struct listener {
 	switch_socket_t *sock;
 	switch_queue_t *event_queue;
@@ -95,6 +105,8 @@ struct listener {
 	char remote_ip[50];
 	switch_port_t remote_port;
 	switch_event_t *filters;
+	listener_filter_t *compiled_filters;
+	int compiled_filter_count;
 	time_t linger_timeout;
 	struct listener *next;
 	switch_pollfd_t *pollfd;
@@ -106,6 +118,7 @@ typedef struct listener listener_t;
 
 static struct {
 	switch_mutex_t *listener_mutex;
+	switch_mutex_t *log_mask_mutex;
 	switch_event_node_t *node;
 	int debug;
 } globals;
@@ -202,6 +215,33 @@ static switch_status_t socket_logger(const switch_log_node_t *node, switch_log_l
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/* publish the most verbose level any listener is logging at so the core skips formatting the rest,
+   never call this with listener_mutex held, the log thread takes it under the binding lock */
+static void refresh_log_mask(void)
+{
+	listener_t *l;
+	int32_t level = SWITCH_LOG_DISABLE, i;
+	uint32_t mask = 0;
+
+	switch_mutex_lock(globals.log_mask_mutex);
+
+	switch_mutex_lock(globals.listener_mutex);
+	for (l = listen_list.listeners; l; l = l->next) {
+		if (switch_test_flag(l, LFLAG_LOG) && (int32_t) l->level > level) {
+			level = l->level;
+		}
+	}
+	switch_mutex_unlock(globals.listener_mutex);
+
+	for (i = 0; i <= level && i <= SWITCH_LOG_DEBUG; i++) {
+		mask |= (1 << i);
+	}
+
+	switch_log_binding_set_mask(socket_logger, mask);
+
+	switch_mutex_unlock(globals.log_mask_mutex);
+}
+
 static void flush_listener(listener_t *listener, switch_bool_t flush_log, switch_bool_t flush_events)
 {
 	void *pop;
@@ -225,6 +265,68 @@ static void flush_listener(listener_t *listener, switch_bool_t flush_log, switch
 	}
 }
 
+
+static void free_compiled_filters(listener_t *listener)
+{
+	int i;
+
+	for (i = 0; i < listener->compiled_filter_count; i++) {
+		switch_regex_safe_free(listener->compiled_filters[i].re);
+	}
+
+	switch_safe_free(listener->compiled_filters);
+	listener->compiled_filter_count = 0;
+}
+
+/* must be called with filter_mutex locked every time listener->filters changes */
+static void compile_filters(listener_t *listener)
+{
+	switch_event_header_t *hp;
+	int count = 0;
+
+	free_compiled_filters(listener);
+
+	if (!listener->filters) {
+		return;
+	}
+
+	for (hp = listener->filters->headers; hp; hp = hp->next) {
+		count++;
+	}
+
+	if (!count) {
+		return;
+	}
+
+	switch_zmalloc(listener->compiled_filters, count * sizeof(listener_filter_t));
+
+	for (hp = listener->filters->headers; hp; hp = hp->next) {
+		listener_filter_t *filter = &listener->compiled_filters[listener->compiled_filter_count++];
+		const char *comp_to = hp->value;
+		int pos = 1;
+
+		while (comp_to && *comp_to) {
+			if (*comp_to == '+') {
+				pos = 1;
+			} else if (*comp_to == '-') {
+				pos = 0;
+			} else if (*comp_to != ' ') {
+				break;
+			}
+			comp_to++;
+		}
+
+		filter->header = hp->name;
+		filter->value = comp_to;
+		filter->pos = pos;
+
+		if (*hp->value == '/') {
+			filter->is_regex = 1;
+			filter->re = switch_regex_compile_expression(comp_to);
+		}
+	}
+}
+
 static switch_status_t expire_listener(listener_t ** listener)
 {
 	listener_t *l;
@@ -256,6 +358,7 @@ static switch_status_t expire_listener(listener_t ** listener)
 
 
 	switch_mutex_lock(l->filter_mutex);
+	free_compiled_filters(l);
 	if (l->filters) {
 		switch_event_destroy(&l->filters);
 	}
@@ -274,6 +377,7 @@ static void event_handler(switch_event_t *event)
 	listener_t *l, *lp, *last = NULL;
 	time_t now = switch_epoch_time_now(NULL);
 	switch_status_t qstatus;
+	int expired = 0;
 
 	switch_assert(event != NULL);
 
@@ -298,6 +402,7 @@ static void event_handler(switch_event_t *event)
 				} else {
 					listen_list.listeners = lp;
 				}
+				expired++;
 				continue;
 			}
 		}
@@ -318,52 +423,37 @@ static void event_handler(switch_event_t *event)
 		if (send) {
 			switch_mutex_lock(l->filter_mutex);
 
-			if (l->filters && l->filters->headers) {
-				switch_event_header_t *hp;
-				const char *hval;
+			if (l->compiled_filter_count) {
+				int i;
 
 				send = 0;
 
-				for (hp = l->filters->headers; hp; hp = hp->next) {
-					if ((hval = switch_event_get_header(event, hp->name))) {
-						const char *comp_to = hp->value;
-						int pos = 1, cmp = 0;
-
-						while (comp_to && *comp_to) {
-							if (*comp_to == '+') {
-								pos = 1;
-							} else if (*comp_to == '-') {
-								pos = 0;
-							} else if (*comp_to != ' ') {
-								break;
-							}
-							comp_to++;
-						}
+				for (i = 0; i < l->compiled_filter_count; i++) {
+					listener_filter_t *filter = &l->compiled_filters[i];
+					const char *hval;
+					int cmp = 0;
 
-						if (send && pos) {
-							continue;
-						}
+					if (send && filter->pos) {
+						continue;
+					}
 
-						if (!comp_to) {
-							continue;
-						}
+					if (!(hval = switch_event_get_header(event, filter->header))) {
+						continue;
+					}
 
-						if (*hp->value == '/') {
-							switch_regex_t *re = NULL;
-							int ovector[30];
-							cmp = !!switch_regex_perform(hval, comp_to, &re, ovector, sizeof(ovector) / sizeof(ovector[0]));
-							switch_regex_safe_free(re);
-						} else {
-							cmp = !strcasecmp(hval, comp_to);
-						}
+					if (filter->is_regex) {
+						int ovector[30];
+						cmp = !!switch_regex_exec(filter->re, hval, ovector, sizeof(ovector) / sizeof(ovector[0]));
+					} else {
+						cmp = !strcasecmp(hval, filter->value);
+					}
 
-						if (cmp) {
-							if (pos) {
-								send = 1;
-							} else {
-								send = 0;
-								break;
-							}
+					if (cmp) {
+						if (filter->pos) {
+							send = 1;
+						} else {
+							send = 0;
+							break;
 						}
 					}
 				}
@@ -383,7 +473,7 @@ static void event_handler(switch_event_t *event)
 		}
 
 		if (send) {
-			if (switch_event_dup(&clone, event) == SWITCH_STATUS_SUCCESS) {
+			if ((clone = switch_event_ref(event))) {
 				qstatus = switch_queue_trypush(l->event_queue, clone); 
 				if (qstatus == SWITCH_STATUS_SUCCESS) {
 					if (l->lost_events) {
@@ -410,6 +500,10 @@ static void event_handler(switch_event_t *event)
 		last = l;
 	}
 	switch_mutex_unlock(globals.listener_mutex);
+
+	if (expired) {
+		refresh_log_mask();
+	}
 }
 
 SWITCH_STANDARD_APP(socket_function)
@@ -608,6 +702,8 @@ static void add_listener(listener_t *listener)
 	listener->next = listen_list.listeners;
 	listen_list.listeners = listener;
 	switch_mutex_unlock(globals.listener_mutex);
+
+	refresh_log_mask();
 }
 
 static void remove_listener(listener_t *listener)
@@ -626,6 +722,8 @@ static void remove_listener(listener_t *listener)
 		last = l;
 	}
 	switch_mutex_unlock(globals.listener_mutex);
+
+	refresh_log_mask();
 }
 
 static void send_disconnect(listener_t *listener, const char *message)
@@ -808,6 +906,7 @@ SWITCH_STANDARD_API(event_sink_function)
 
 	  filter_end:
 
+		compile_filters(listener);
 		switch_mutex_unlock(listener->filter_mutex);
 
 	} else if (!strcasecmp(wcmd, "stop-logging")) {
@@ -825,6 +924,7 @@ SWITCH_STANDARD_API(event_sink_function)
 
 		if (switch_test_flag(listener, LFLAG_LOG)) {
 			switch_clear_flag_locked(listener, LFLAG_LOG);
+			refresh_log_mask();
 			stream->write_function(stream, "<data><reply type=\"success\">Not Logging</reply></data>\n");
 		} else {
 			stream->write_function(stream, "<data><reply type=\"error\">Not Logging</reply></data>\n");
@@ -851,6 +951,7 @@ SWITCH_STANDARD_API(event_sink_function)
 			if (ltype != SWITCH_LOG_INVALID) {
 				listener->level = ltype;
 				switch_set_flag(listener, LFLAG_LOG);
+				refresh_log_mask();
 				stream->write_function(stream, "<data><reply type=\"success\">Log Level %s</reply></data>\n", loglevel);
 			} else {
 				stream->write_function(stream, "<data><reply type=\"error\">Invalid Level</reply></data>\n");
@@ -1185,6 +1286,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_event_socket_load)
 	memset(&globals, 0, sizeof(globals));
 
 	switch_mutex_init(&globals.listener_mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_mutex_init(&globals.log_mask_mutex, SWITCH_MUTEX_NESTED, pool);
 
 	memset(&listen_list, 0, sizeof(listen_list));
 	switch_mutex_init(&listen_list.sock_mutex, SWITCH_MUTEX_NESTED, pool);
@@ -1195,6 +1297,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_event_socket_load)
 	}
 
 	switch_log_bind_logger(socket_logger, SWITCH_LOG_DEBUG, SWITCH_FALSE);
+	refresh_log_mask();
 
 	/* connect my internal structure to the blank pointer passed to me */
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
@@ -1412,41 +1515,37 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 				while (switch_queue_trypop(listener->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
 					char hbuf[512];
 					switch_event_t *pevent = (switch_event_t *) pop;
+					const char *ebuf;
 					char *etype;
 
 					do_sleep = 0;
+
+					/* the serialized form is built once per event and shared by every listener using the same format */
 					if (listener->format == EVENT_FORMAT_PLAIN) {
 						etype = "plain";
-						switch_event_serialize(pevent, &listener->ebuf, SWITCH_TRUE);
+						ebuf = switch_event_get_serialized(pevent, SWITCH_EVENT_FORMAT_PLAIN);
 					} else if (listener->format == EVENT_FORMAT_JSON) {
 						etype = "json";
-						switch_event_serialize_json(pevent, &listener->ebuf);
+						ebuf = switch_event_get_serialized(pevent, SWITCH_EVENT_FORMAT_JSON);
 					} else {
-						switch_xml_t xml;
 						etype = "xml";
-
-						if ((xml = switch_event_xmlize(pevent, SWITCH_VA_NONE))) {
-							listener->ebuf = switch_xml_toxml(xml, SWITCH_FALSE);
-							switch_xml_free(xml);
-						} else {
-							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(listener->session), SWITCH_LOG_ERROR, "XML ERROR!\n");
-							goto endloop;
-						}
+						ebuf = switch_event_get_serialized(pevent, SWITCH_EVENT_FORMAT_XML);
 					}
 
-					switch_assert(listener->ebuf);
+					if (!ebuf) {
+						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(listener->session), SWITCH_LOG_ERROR, "%s serialization ERROR!\n", etype);
+						goto endloop;
+					}
 
-					len = strlen(listener->ebuf);
+					len = strlen(ebuf);
 
 					switch_snprintf(hbuf, sizeof(hbuf), "Content-Length: %" SWITCH_SSIZE_T_FMT "\n" "Content-Type: text/event-%s\n" "\n", len, etype);
 
 					len = strlen(hbuf);
 					switch_socket_send(listener->sock, hbuf, &len);
 
-					len = strlen(listener->ebuf);
-					switch_socket_send(listener->sock, listener->ebuf, &len);
-
-					switch_safe_free(listener->ebuf);
+					len = strlen(ebuf);
+					switch_socket_send(listener->sock, ebuf, &len);
 
 				  endloop:
 
@@ -1993,6 +2092,7 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 		} else {
 			switch_snprintf(reply, reply_len, "-ERR invalid syntax");
 		}
+		compile_filters(listener);
 		switch_mutex_unlock(listener->filter_mutex);
 
 		goto done;
@@ -2416,6 +2516,7 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 		if (ltype != SWITCH_LOG_INVALID) {
 			listener->level = ltype;
 			switch_set_flag(listener, LFLAG_LOG);
+			refresh_log_mask();
 			switch_snprintf(reply, reply_len, "+OK log level %s [%d]", level_s, listener->level);
 		} else {
 			switch_snprintf(reply, reply_len, "-ERR invalid log level");
@@ -2450,6 +2551,7 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 		flush_listener(listener, SWITCH_TRUE, SWITCH_FALSE);
 		if (switch_test_flag(listener, LFLAG_LOG)) {
 			switch_clear_flag_locked(listener, LFLAG_LOG);
+			refresh_log_mask();
 			switch_snprintf(reply, reply_len, "+OK no longer logging");
 		} else {
 			switch_snprintf(reply, reply_len, "-ERR not loging");
@@ -2797,6 +2899,7 @@ static void *SWITCH_THREAD_FUNC listener_run(switch_thread_t *thread, void *obj)
 	switch_thread_rwlock_wrlock(listener->rwlock);
 	flush_listener(listener, SWITCH_TRUE, SWITCH_TRUE);
 	switch_mutex_lock(listener->filter_mutex);
+	free_compiled_filters(listener);
 	if (listener->filters) {
 		switch_event_destroy(&listener->filters);
 	}
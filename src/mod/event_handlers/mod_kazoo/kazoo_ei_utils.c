@@ -112,10 +112,16 @@ void ei_encode_switch_event_headers_2(ei_x_buff *ebuf, switch_event_t *event, in
 	for (hp = event->headers; hp; hp = hp->next) {
 		ei_x_encode_tuple_header(ebuf, 2);
 		ei_x_encode_binary(ebuf, hp->name, strlen(hp->name));
-		if (encode) {
-			switch_url_decode(hp->value);
+		/* the event may be shared with other listeners, don't decode it in place */
+		if (encode && strchr(hp->value, '%')) {
+			char *value = strdup(hp->value);
+			switch_assert(value);
+			switch_url_decode(value);
+			ei_x_encode_binary(ebuf, value, strlen(value));
+			free(value);
+		} else {
+			ei_x_encode_binary(ebuf, hp->value, strlen(hp->value));
 		}
-		ei_x_encode_binary(ebuf, hp->value, strlen(hp->value));
 	}
 
 	if (event->body) {
@@ -579,6 +579,10 @@ void kz_event_decode(switch_event_t *event)
 {
 	switch_event_header_t *hp;
 	int i;
+
+	/* the values are decoded in place, other listeners may hold a reference to this event */
+	switch_event_unshare(event);
+
 	for (hp = event->headers; hp; hp = hp->next) {
 		if (strncmp(hp->name, "_json_", 6)) {
 			if (hp->idx) {
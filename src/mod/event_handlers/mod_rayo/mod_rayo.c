@@ -3528,7 +3528,7 @@ static void on_call_end_event(switch_event_t *event)
 
 		switch_mutex_lock(RAYO_ACTOR(call)->mutex);
 		if (zstr(call->dial_request_id) && !call->dial_request_failed) {
-			switch_event_dup(&call->end_event, event);
+			call->end_event = switch_event_ref(event);
 			RAYO_DESTROY(call);
 			RAYO_RELEASE(call); /* decrement ref from creation */
 		}
@@ -3555,7 +3555,7 @@ static void on_call_answer_event(struct rayo_client *rclient, switch_event_t *ev
 			RAYO_SEND_MESSAGE(call, RAYO_JID(rclient), revent);
 		} else if (!call->answer_event) {
 			/* delay sending this event until the rayo APP has started */
-			switch_event_dup(&call->answer_event, event);
+			call->answer_event = switch_event_ref(event);
 		}
 		switch_mutex_unlock(RAYO_ACTOR(call)->mutex);
 		RAYO_RELEASE(call);
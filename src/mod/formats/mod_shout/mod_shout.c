@@ -1494,14 +1494,12 @@ void do_broadcast(switch_stream_handle_t *stream)
 
 void do_index(switch_stream_handle_t *stream)
 {
-	switch_cache_db_handle_t *db;
-	const char *sql = "select uuid, created, cid_name, cid_num, dest, application, application_data, read_codec, read_rate from channels";
+	const char *columns[] = { "uuid", "created", "cid_name", "cid_num", "dest", "application", "application_data", "read_codec", "read_rate", NULL };
+	switch_channel_registry_query_t query = { 0 };
 	struct holder holder;
-	char *errmsg;
 
-	if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
-		return;
-	}
+	query.view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
+	query.columns = columns;
 
 	holder.host = switch_event_get_header(stream->param_event, "http-host");
 	holder.port = switch_event_get_header(stream->param_event, "http-port");
@@ -1514,14 +1512,9 @@ void do_index(switch_stream_handle_t *stream)
 						   "<tr><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td></tr>\n",
 						   "Created", "CID Name", "CID Num", "Ext", "App", "Data", "Codec", "Rate", "Listen");
 
-	switch_cache_db_execute_sql_callback(db, sql, web_callback, &holder, &errmsg);
+	switch_channel_registry_query(&query, web_callback, &holder);
 
 	stream->write_function(stream, "</table>");
-
-	if (errmsg) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error [%s]\n", errmsg);
-		switch_safe_free(errmsg);
-	}
 }
 
 #define TELECAST_SYNTAX ""
@@ -350,6 +350,30 @@ static switch_status_t switch_console_logger(const switch_log_node_t *node, swit
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/* tell the core which levels can make it to the console so it can skip formatting the rest */
+static void publish_log_mask(void)
+{
+	switch_hash_index_t *hi;
+	uint32_t wanted = all_level;
+	uint32_t mask = 0;
+	int32_t i;
+
+	if (log_hash) {
+		for (hi = switch_core_hash_first(log_hash); hi; hi = switch_core_hash_next(&hi)) {
+			void *val;
+
+			switch_core_hash_this(hi, NULL, NULL, &val);
+			wanted |= (uint32_t) (intptr_t) val;
+		}
+	}
+
+	for (i = 0; i <= hard_log_level && i <= SWITCH_LOG_DEBUG; i++) {
+		mask |= (1 << i);
+	}
+
+	switch_log_binding_set_mask(switch_console_logger, mask & wanted);
+}
+
 SWITCH_STANDARD_API(console_api_function)
 {
 	int argc;
@@ -414,6 +438,7 @@ SWITCH_STANDARD_API(console_api_function)
 			stream->write_function(stream, "-ERR Invalid console loglevel (%s)!\n\n", argc > 1 ? argv[1] : "");
 		} else {
 			hard_log_level = level;
+			publish_log_mask();
 			stream->write_function(stream, "+OK console log level set to %s\n", switch_log_level2str(hard_log_level));
 		}
 
@@ -503,6 +528,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_console_load)
 	switch_log_bind_logger(switch_console_logger, SWITCH_LOG_DEBUG, SWITCH_TRUE);
 
 	config_logger();
+	publish_log_mask();
 	RUNNING = 1;
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
@@ -39,16 +39,36 @@ SWITCH_MODULE_DEFINITION(mod_logfile, mod_logfile_load, mod_logfile_shutdown, NU
 #define DEFAULT_LIMIT	 0xA00000	/* About 10 MB */
 #define WARM_FUZZY_OFFSET 256
 #define MAX_ROT 4096			/* why not */
+#define DEFAULT_FLUSH_INTERVAL 500	/* ms */
+#define URGENT_FLUSH_WAIT 1000000	/* us the logging thread waits for the writer to catch up on a crit line */
+#define WRITE_QUEUE_LEN 256
 
 static switch_memory_pool_t *module_pool = NULL;
 static switch_hash_t *profile_hash = NULL;
 
 static struct {
 	int rotate;
-	switch_mutex_t *mutex;
 	switch_event_node_t *node;
+	/* every level any profile maps, the core drops the rest before formatting them */
+	uint32_t log_mask;
+	/* full buffers waiting for the writer thread, in the order they were filled */
+	switch_queue_t *write_queue;
+	switch_thread_t *writer_thread;
+	int running;
+	switch_interval_time_t flush_interval;
 } globals;
 
+typedef struct logfile_profile logfile_profile_t;
+
+typedef struct logfile_chunk {
+	logfile_profile_t *profile;
+	char *data;
+	switch_size_t len;
+	switch_size_t size;
+	/* when the first line went in, the writer flushes it once it gets older than flush-interval */
+	switch_time_t started;
+} logfile_chunk_t;
+
 struct logfile_profile {
 	char *name;
 	switch_size_t log_size;		/* keep the log size in check for rotation */
@@ -60,10 +80,14 @@ struct logfile_profile {
 	uint32_t all_level;
 	uint32_t suffix;			/* suffix of the highest logfile name */
 	switch_bool_t log_uuid;
+	switch_size_t buffer_size;	/* 0 (the default) writes every line to the file from the logging thread */
+	switch_bool_t sync;			/* fdatasync after every flush */
+	switch_mutex_t *mutex;		/* guards the file: writes, rotation and reopening */
+	switch_mutex_t *chunk_mutex;	/* guards chunk */
+	logfile_chunk_t *chunk;		/* the buffer being filled */
+	switch_atomic_t pending;	/* buffers queued for the writer and not written yet */
 };
 
-typedef struct logfile_profile logfile_profile_t;
-
 static switch_status_t load_profile(switch_xml_t xml);
 
 #if 0
@@ -75,12 +99,16 @@ static void del_mapping(char *var, logfile_profile_t *profile)
 
 static void add_mapping(logfile_profile_t *profile, char *var, char *val)
 {
+	uint32_t mask = switch_log_str2mask(val);
+
+	globals.log_mask |= mask;
+
 	if (!strcasecmp(var, "all")) {
-		profile->all_level |= (uint32_t) switch_log_str2mask(val);
+		profile->all_level |= mask;
 		return;
 	}
 
-	switch_core_hash_insert(profile->log_hash, var, (void *) (intptr_t) switch_log_str2mask(val));
+	switch_core_hash_insert(profile->log_hash, var, (void *) (intptr_t) mask);
 }
 
 static switch_status_t mod_logfile_rotate(logfile_profile_t *profile);
@@ -127,7 +155,7 @@ static switch_status_t mod_logfile_rotate(logfile_profile_t *profile)
 	switch_size_t retsize;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
 
-	switch_mutex_lock(globals.mutex);
+	switch_mutex_lock(profile->mutex);
 
 	switch_time_exp_lt(&tm, switch_micro_time_now());
 	switch_strftime_nocheck(date, &retsize, sizeof(date), "%Y-%m-%d-%H-%M-%S", &tm);
@@ -222,33 +250,35 @@ static switch_status_t mod_logfile_rotate(logfile_profile_t *profile)
 		switch_core_destroy_memory_pool(&pool);
 	}
 
-	switch_mutex_unlock(globals.mutex);
+	switch_mutex_unlock(profile->mutex);
 
 	return status;
 }
 
 /* write to the actual logfile */
-static switch_status_t mod_logfile_raw_write(logfile_profile_t *profile, char *log_data)
+static switch_status_t mod_logfile_file_write(logfile_profile_t *profile, const void * const *bufs, const switch_size_t *lens, int count)
 {
-	switch_size_t len;
+	switch_size_t len = 0;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
-	len = strlen(log_data);
 
-	if (len <= 0 || !profile->log_afd) {
+	if (!profile->log_afd) {
 		return SWITCH_STATUS_FALSE;
 	}
 
-	switch_mutex_lock(globals.mutex);
+	switch_mutex_lock(profile->mutex);
 
-	if (switch_file_write(profile->log_afd, log_data, &len) != SWITCH_STATUS_SUCCESS) {
+	if (switch_file_writev(profile->log_afd, bufs, lens, count, &len) != SWITCH_STATUS_SUCCESS) {
 		switch_file_close(profile->log_afd);
 		if ((status = mod_logfile_openlogfile(profile, SWITCH_TRUE)) == SWITCH_STATUS_SUCCESS) {
-			len = strlen(log_data);
-			switch_file_write(profile->log_afd, log_data, &len);
+			switch_file_writev(profile->log_afd, bufs, lens, count, &len);
 		}
 	}
 
-	switch_mutex_unlock(globals.mutex);
+	if (status == SWITCH_STATUS_SUCCESS && profile->sync) {
+		switch_file_datasync(profile->log_afd);
+	}
+
+	switch_mutex_unlock(profile->mutex);
 
 	if (status == SWITCH_STATUS_SUCCESS) {
 		profile->log_size += len;
@@ -261,6 +291,184 @@ static switch_status_t mod_logfile_raw_write(logfile_profile_t *profile, char *l
 	return status;
 }
 
+static logfile_chunk_t *logfile_chunk_new(logfile_profile_t *profile, switch_size_t size)
+{
+	logfile_chunk_t *chunk;
+
+	switch_zmalloc(chunk, sizeof(*chunk));
+	switch_malloc(chunk->data, size);
+	chunk->profile = profile;
+	chunk->size = size;
+	chunk->started = switch_micro_time_now();
+
+	return chunk;
+}
+
+static void logfile_chunk_free(logfile_chunk_t **chunk)
+{
+	if (*chunk) {
+		switch_safe_free((*chunk)->data);
+		free(*chunk);
+		*chunk = NULL;
+	}
+}
+
+/* hands the filled buffer to the writer, must be called with chunk_mutex locked so buffers stay in order */
+static void logfile_queue_chunk(logfile_profile_t *profile)
+{
+	logfile_chunk_t *chunk = profile->chunk;
+
+	if (!chunk) {
+		return;
+	}
+
+	profile->chunk = NULL;
+
+	if (!globals.running) {
+		mod_logfile_file_write(profile, (const void * const *) &chunk->data, &chunk->len, 1);
+		logfile_chunk_free(&chunk);
+		return;
+	}
+
+	/* only blocks when the disk is WRITE_QUEUE_LEN buffers behind */
+	switch_atomic_inc(&profile->pending);
+	switch_queue_push(globals.write_queue, chunk);
+}
+
+/* urgent lines (crit and worse) are on disk before this returns, they are what's left to read after a crash */
+static switch_status_t mod_logfile_raw_write(logfile_profile_t *profile, char *log_data, switch_bool_t urgent)
+{
+	switch_size_t len = strlen(log_data);
+	switch_interval_time_t waited = 0;
+
+	if (len <= 0 || !profile->log_afd) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!profile->buffer_size || !globals.running) {
+		const void *buf = log_data;
+		mod_logfile_file_write(profile, &buf, &len, 1);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_mutex_lock(profile->chunk_mutex);
+
+	if (profile->chunk && profile->chunk->len + len > profile->chunk->size) {
+		logfile_queue_chunk(profile);
+	}
+
+	if (!profile->chunk) {
+		profile->chunk = logfile_chunk_new(profile, len > profile->buffer_size ? len : profile->buffer_size);
+	}
+
+	memcpy(profile->chunk->data + profile->chunk->len, log_data, len);
+	profile->chunk->len += len;
+
+	if (urgent) {
+		logfile_queue_chunk(profile);
+	}
+
+	switch_mutex_unlock(profile->chunk_mutex);
+
+	/* only the logging thread fills buffers so this can't starve, the bound is there in case the writer is stuck */
+	while (urgent && switch_atomic_read(&profile->pending) && waited < URGENT_FLUSH_WAIT) {
+		switch_yield(1000);
+		waited += 1000;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void logfile_write_batch(logfile_chunk_t **batch, int count)
+{
+	const void *bufs[SWITCH_FILE_IOVEC_MAX];
+	switch_size_t lens[SWITCH_FILE_IOVEC_MAX];
+	int i;
+
+	if (!count) {
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		bufs[i] = batch[i]->data;
+		lens[i] = batch[i]->len;
+	}
+
+	mod_logfile_file_write(batch[0]->profile, bufs, lens, count);
+
+	for (i = 0; i < count; i++) {
+		switch_atomic_dec(&batch[i]->profile->pending);
+		logfile_chunk_free(&batch[i]);
+	}
+}
+
+/* queue the buffers that have been sitting around longer than flush-interval, or all of them */
+static void logfile_flush_idle(switch_bool_t all)
+{
+	switch_hash_index_t *hi;
+	void *val;
+	const void *var;
+	switch_time_t now = switch_micro_time_now();
+
+	for (hi = switch_core_hash_first(profile_hash); hi; hi = switch_core_hash_next(&hi)) {
+		logfile_profile_t *profile;
+
+		switch_core_hash_this(hi, &var, NULL, &val);
+		profile = val;
+
+		if (all) {
+			switch_mutex_lock(profile->chunk_mutex);
+		} else if (switch_mutex_trylock(profile->chunk_mutex) != SWITCH_STATUS_SUCCESS) {
+			/* the logging thread has it, it's not idle */
+			continue;
+		}
+
+		if (profile->chunk && (all || now - profile->chunk->started >= globals.flush_interval)) {
+			logfile_queue_chunk(profile);
+		}
+
+		switch_mutex_unlock(profile->chunk_mutex);
+	}
+}
+
+static void *SWITCH_THREAD_FUNC logfile_writer_thread(switch_thread_t *thread, void *obj)
+{
+	logfile_chunk_t *batch[SWITCH_FILE_IOVEC_MAX];
+
+	for (;;) {
+		void *pop = NULL;
+		int count = 0;
+
+		if (switch_queue_pop_timeout(globals.write_queue, &pop, globals.flush_interval) == SWITCH_STATUS_SUCCESS) {
+			/* take whatever else is already waiting and write each profile's run of buffers with one writev */
+			do {
+				logfile_chunk_t *chunk = (logfile_chunk_t *) pop;
+
+				if (!chunk) {
+					continue;
+				}
+
+				if (count && (count == SWITCH_FILE_IOVEC_MAX || batch[0]->profile != chunk->profile)) {
+					logfile_write_batch(batch, count);
+					count = 0;
+				}
+
+				batch[count++] = chunk;
+			} while (switch_queue_trypop(globals.write_queue, &pop) == SWITCH_STATUS_SUCCESS);
+
+			logfile_write_batch(batch, count);
+		}
+
+		if (!globals.running) {
+			break;
+		}
+
+		logfile_flush_idle(SWITCH_FALSE);
+	}
+
+	return NULL;
+}
+
 static switch_status_t process_node(const switch_log_node_t *node, switch_log_level_t level)
 {
 	switch_hash_index_t *hi;
@@ -295,6 +503,8 @@ static switch_status_t process_node(const switch_log_node_t *node, switch_log_le
 		}
 
 		if (ok) {
+			switch_bool_t urgent = level <= SWITCH_LOG_CRIT ? SWITCH_TRUE : SWITCH_FALSE;
+
 			if (profile->log_uuid && !zstr(node->userdata)) {
 				char buf[2048];
 				char *dup = strdup(node->data);
@@ -304,13 +514,13 @@ static switch_status_t process_node(const switch_log_node_t *node, switch_log_le
 				argc = switch_split(dup, '\n', lines);
 				for (i = 0; i < argc; i++) {
 					switch_snprintf(buf, sizeof(buf), "%s %s\n", node->userdata, lines[i]);
-					mod_logfile_raw_write(profile, buf);
+					mod_logfile_raw_write(profile, buf, urgent && i == argc - 1);
 				}
 
 				free(dup);
 
 			} else {
-				mod_logfile_raw_write(profile, node->data);
+				mod_logfile_raw_write(profile, node->data, urgent);
 			}
 		}
 
@@ -328,6 +538,8 @@ static void cleanup_profile(void *ptr)
 {
 	logfile_profile_t *profile = (logfile_profile_t *) ptr;
 
+	logfile_chunk_free(&profile->chunk);
+
 	switch_core_hash_destroy(&profile->log_hash);
 	switch_file_close(profile->log_afd);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Closing %s\n", profile->logfile);
@@ -348,6 +560,8 @@ static switch_status_t load_profile(switch_xml_t xml)
 
 	new_profile->suffix = 1;
 	new_profile->log_uuid = SWITCH_TRUE;
+	switch_mutex_init(&new_profile->mutex, SWITCH_MUTEX_NESTED, module_pool);
+	switch_mutex_init(&new_profile->chunk_mutex, SWITCH_MUTEX_NESTED, module_pool);
 
 	if ((settings = switch_xml_child(xml, "settings"))) {
 		for (param = switch_xml_child(settings, "param"); param; param = param->next) {
@@ -364,6 +578,10 @@ static switch_status_t load_profile(switch_xml_t xml)
 				}
 			} else if (!strcmp(var, "uuid")) {
 				new_profile->log_uuid = switch_true(val);
+			} else if (!strcmp(var, "buffer-size")) {
+				new_profile->buffer_size = switch_atoui(val);
+			} else if (!strcmp(var, "sync")) {
+				new_profile->sync = switch_true(val);
 			}
 		}
 	}
@@ -408,16 +626,16 @@ static void event_handler(switch_event_t *event)
 				mod_logfile_rotate(profile);
 			}
 		} else {
-			switch_mutex_lock(globals.mutex);
 			for (hi = switch_core_hash_first(profile_hash); hi; hi = switch_core_hash_next(&hi)) {
 				switch_core_hash_this(hi, &var, NULL, &val);
 				profile = val;
+				switch_mutex_lock(profile->mutex);
 				switch_file_close(profile->log_afd);
 				if (mod_logfile_openlogfile(profile, SWITCH_TRUE) != SWITCH_STATUS_SUCCESS) {
 					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Error Re-opening Log!\n");
 				}
+				switch_mutex_unlock(profile->mutex);
 			}
-			switch_mutex_unlock(globals.mutex);
 		}
 	}
 }
@@ -426,11 +644,12 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_logfile_load)
 {
 	char *cf = "logfile.conf";
 	switch_xml_t cfg, xml, settings, param, profiles, xprofile;
+	switch_threadattr_t *thd_attr = NULL;
 
 	module_pool = pool;
 
 	memset(&globals, 0, sizeof(globals));
-	switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, module_pool);
+	globals.flush_interval = DEFAULT_FLUSH_INTERVAL * 1000;
 
 	if (profile_hash) {
 		switch_core_hash_destroy(&profile_hash);
@@ -454,6 +673,11 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_logfile_load)
 				char *val = (char *) switch_xml_attr_soft(param, "value");
 				if (!strcmp(var, "rotate-on-hup")) {
 					globals.rotate = switch_true(val);
+				} else if (!strcmp(var, "flush-interval")) {
+					int tmp = atoi(val);
+					if (tmp > 0) {
+						globals.flush_interval = tmp * 1000;
+					}
 				}
 			}
 		}
@@ -469,15 +693,36 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_logfile_load)
 		switch_xml_free(xml);
 	}
 
+	switch_queue_create(&globals.write_queue, WRITE_QUEUE_LEN, module_pool);
+	globals.running = 1;
+	switch_threadattr_create(&thd_attr, module_pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+	if (switch_thread_create(&globals.writer_thread, thd_attr, logfile_writer_thread, NULL, module_pool) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't start the writer thread, writing unbuffered\n");
+		globals.running = 0;
+	}
+
 	switch_log_bind_logger(mod_logfile_logger, SWITCH_LOG_DEBUG, SWITCH_FALSE);
+	switch_log_binding_set_mask(mod_logfile_logger, globals.log_mask);
 
 	return SWITCH_STATUS_SUCCESS;
 }
 
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_logfile_shutdown)
 {
+	switch_status_t st;
+
 	switch_log_unbind_logger(mod_logfile_logger);
 	switch_event_unbind(&globals.node);
+
+	if (globals.writer_thread) {
+		logfile_flush_idle(SWITCH_TRUE);
+		globals.running = 0;
+		switch_queue_push(globals.write_queue, NULL);
+		switch_thread_join(&st, globals.writer_thread);
+		globals.writer_thread = NULL;
+	}
+
 	switch_core_hash_destroy(&profile_hash);
 	return SWITCH_STATUS_SUCCESS;
 }
@@ -68,6 +68,10 @@
 #endif
 #endif
 
+#if defined(HAVE_RECVMMSG) || defined(HAVE_SENDMMSG)
+#include <sys/socket.h>
+#endif
+
 /* fspr_vformatter_buff_t definition*/
 #include <fspr_lib.h>
 
@@ -464,6 +468,41 @@ SWITCH_DECLARE(switch_status_t) switch_file_write(switch_file_t *thefile, const
 	return fspr_file_write(thefile, buf, nbytes);
 }
 
+SWITCH_DECLARE(switch_status_t) switch_file_writev(switch_file_t *thefile, const void * const *bufs, const switch_size_t *lens, int count, switch_size_t *nbytes)
+{
+	struct iovec vec[SWITCH_FILE_IOVEC_MAX];
+	int i;
+
+	if (count <= 0 || count > SWITCH_FILE_IOVEC_MAX) {
+		*nbytes = 0;
+		return SWITCH_STATUS_FALSE;
+	}
+
+	for (i = 0; i < count; i++) {
+		vec[i].iov_base = (void *) bufs[i];
+		vec[i].iov_len = lens[i];
+	}
+
+	return fspr_file_writev_full(thefile, vec, count, nbytes);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_file_datasync(switch_file_t *thefile)
+{
+	fspr_os_file_t fd;
+
+	if (fspr_os_file_get(&fd, thefile) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+#ifdef WIN32
+	return FlushFileBuffers(fd) ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+#elif defined(__APPLE__)
+	return fsync(fd) ? SWITCH_STATUS_FALSE : SWITCH_STATUS_SUCCESS;
+#else
+	return fdatasync(fd) ? SWITCH_STATUS_FALSE : SWITCH_STATUS_SUCCESS;
+#endif
+}
+
 SWITCH_DECLARE(int) switch_file_printf(switch_file_t *thefile, const char *format, ...)
 {
 	va_list ap;
@@ -1036,6 +1075,161 @@ SWITCH_DECLARE(switch_status_t) switch_socket_recvfrom(switch_sockaddr_t *from,
 	return (switch_status_t)r;
 }
 
+#ifdef HAVE_RECVMMSG
+static void batch_sockaddr_set(switch_sockaddr_t *sa, socklen_t salen)
+{
+	sa->salen = salen;
+	sa->family = sa->sa.sin.sin_family;
+	sa->port = ntohs(sa->sa.sin.sin_port);
+
+#if APR_HAVE_IPV6
+	if (sa->family == APR_INET6) {
+		sa->addr_str_len = 46;
+		sa->ipaddr_ptr = &(sa->sa.sin6.sin6_addr);
+		sa->ipaddr_len = sizeof(struct in6_addr);
+		return;
+	}
+#endif
+
+	sa->addr_str_len = 16;
+	sa->ipaddr_ptr = &(sa->sa.sin.sin_addr);
+	sa->ipaddr_len = sizeof(struct in_addr);
+}
+#endif
+
+SWITCH_DECLARE(switch_status_t) switch_socket_recvfrom_batch(switch_sockaddr_t **from, switch_socket_t *sock, int32_t flags,
+															 char **bufs, switch_size_t *lens, int *count)
+{
+#ifdef HAVE_RECVMMSG
+	struct mmsghdr msgs[SWITCH_SOCKET_BATCH_MAX];
+	struct iovec iov[SWITCH_SOCKET_BATCH_MAX];
+	fspr_os_sock_t fd;
+	int i, n, r;
+
+	if (!from || !sock || !bufs || !lens || !count || *count < 1) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	if (fspr_os_sock_get(&fd, sock) != APR_SUCCESS) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	n = *count > SWITCH_SOCKET_BATCH_MAX ? SWITCH_SOCKET_BATCH_MAX : *count;
+	*count = 0;
+	memset(msgs, 0, sizeof(msgs[0]) * n);
+
+	for (i = 0; i < n; i++) {
+		iov[i].iov_base = bufs[i];
+		iov[i].iov_len = lens[i];
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &from[i]->sa;
+		msgs[i].msg_hdr.msg_namelen = sizeof(from[i]->sa);
+	}
+
+	do {
+		r = recvmmsg(fd, msgs, n, flags | MSG_WAITFORONE, NULL);
+	} while (r < 0 && errno == EINTR);
+
+	if (r < 0) {
+		r = errno;
+		if (r == 35 || r == 730035) {
+			r = SWITCH_STATUS_BREAK;
+		}
+		return (switch_status_t)r;
+	}
+
+	for (i = 0; i < r; i++) {
+		batch_sockaddr_set(from[i], msgs[i].msg_hdr.msg_namelen);
+		lens[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : msgs[i].msg_len;
+	}
+
+	*count = r;
+
+	return SWITCH_STATUS_SUCCESS;
+#else
+	switch_status_t status;
+
+	if (!from || !sock || !bufs || !lens || !count || *count < 1) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	status = switch_socket_recvfrom(from[0], sock, flags, bufs[0], lens);
+	*count = (status == SWITCH_STATUS_SUCCESS && lens[0]) ? 1 : 0;
+
+	return status;
+#endif
+}
+
+SWITCH_DECLARE(switch_status_t) switch_socket_sendto_batch(switch_socket_t *sock, switch_sockaddr_t *where, int32_t flags,
+														   const void * const *bufs, const switch_size_t *lens, int *count)
+{
+#ifdef HAVE_SENDMMSG
+	struct mmsghdr msgs[SWITCH_SOCKET_BATCH_MAX];
+	struct iovec iov[SWITCH_SOCKET_BATCH_MAX];
+	fspr_os_sock_t fd;
+	int i, n, r;
+
+	if (!sock || !where || !bufs || !lens || !count || *count < 1) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	if (fspr_os_sock_get(&fd, sock) != APR_SUCCESS) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	n = *count > SWITCH_SOCKET_BATCH_MAX ? SWITCH_SOCKET_BATCH_MAX : *count;
+	*count = 0;
+	memset(msgs, 0, sizeof(msgs[0]) * n);
+
+	for (i = 0; i < n; i++) {
+		iov[i].iov_base = (void *) bufs[i];
+		iov[i].iov_len = lens[i];
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &where->sa;
+		msgs[i].msg_hdr.msg_namelen = where->salen;
+	}
+
+	do {
+		r = sendmmsg(fd, msgs, n, flags);
+	} while (r < 0 && errno == EINTR);
+
+	if (r < 0) {
+		r = errno;
+		if (r == 35 || r == 730035) {
+			r = SWITCH_STATUS_BREAK;
+		}
+		return (switch_status_t)r;
+	}
+
+	*count = r;
+
+	return SWITCH_STATUS_SUCCESS;
+#else
+	switch_status_t status = SWITCH_STATUS_GENERR;
+	int i, n;
+
+	if (!sock || !where || !bufs || !lens || !count || *count < 1) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	n = *count;
+	*count = 0;
+
+	for (i = 0; i < n; i++) {
+		switch_size_t len = lens[i];
+
+		if ((status = switch_socket_sendto(sock, where, flags, (const char *) bufs[i], &len)) != SWITCH_STATUS_SUCCESS) {
+			break;
+		}
+		(*count)++;
+	}
+
+	return status;
+#endif
+}
+
 /* poll stubs */
 
 SWITCH_DECLARE(switch_status_t) switch_pollset_create(switch_pollset_t ** pollset, uint32_t size, switch_memory_pool_t *pool, uint32_t flags)
@@ -1437,6 +1631,11 @@ SWITCH_DECLARE(int) switch_atomic_dec(volatile switch_atomic_t *mem)
 #endif
 }
 
+SWITCH_DECLARE(void *) switch_atomic_casptr(volatile void **mem, void *with, const void *cmp)
+{
+	return fspr_atomic_casptr(mem, with, cmp);
+}
+
 SWITCH_DECLARE(char *) switch_strerror(switch_status_t statcode, char *buf, switch_size_t bufsize)
 {
 	return fspr_strerror(statcode, buf, bufsize);
@@ -0,0 +1,1182 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * switch_channel_registry.c -- In memory index of the live channels and calls
+ *
+ */
+
+#include <switch.h>
+#include "private/switch_core_pvt.h"
+
+/*
+ * The registry keeps the same rows the core db keeps in its channels and calls tables, fed
+ * from the same channel events with the same headers, so "show channels" and friends can be
+ * answered without a database round trip. Channels are hashed by uuid over
+ * CHANNEL_REGISTRY_STRIPES locks; a channel that is the a leg of a call remembers its b leg
+ * and the other way around, which is all the calls table is ever used for. The channels of each
+ * call_uuid are indexed on the side so renames and unbridges only touch the members of that call.
+ *
+ * Like the tables it replaces the registry is fed by an event handler, so it trails the channels by
+ * however long the event dispatch queue takes to get to them. Updating it from switch_channel would
+ * put a stripe lock on every state change in the session threads, for the benefit of a listing that
+ * is a snapshot either way.
+ */
+#define CHANNEL_REGISTRY_STRIPES 16
+
+typedef enum {
+	RCOL_UUID,
+	RCOL_DIRECTION,
+	RCOL_CREATED,
+	RCOL_CREATED_EPOCH,
+	RCOL_NAME,
+	RCOL_STATE,
+	RCOL_CID_NAME,
+	RCOL_CID_NUM,
+	RCOL_IP_ADDR,
+	RCOL_DEST,
+	RCOL_APPLICATION,
+	RCOL_APPLICATION_DATA,
+	RCOL_DIALPLAN,
+	RCOL_CONTEXT,
+	RCOL_READ_CODEC,
+	RCOL_READ_RATE,
+	RCOL_READ_BIT_RATE,
+	RCOL_WRITE_CODEC,
+	RCOL_WRITE_RATE,
+	RCOL_WRITE_BIT_RATE,
+	RCOL_SECURE,
+	RCOL_HOSTNAME,
+	RCOL_PRESENCE_ID,
+	RCOL_PRESENCE_DATA,
+	RCOL_ACCOUNTCODE,
+	RCOL_CALLSTATE,
+	RCOL_CALLEE_NAME,
+	RCOL_CALLEE_NUM,
+	RCOL_CALLEE_DIRECTION,
+	RCOL_CALL_UUID,
+	RCOL_SENT_CALLEE_NAME,
+	RCOL_SENT_CALLEE_NUM,
+	RCOL_INITIAL_CID_NAME,
+	RCOL_INITIAL_CID_NUM,
+	RCOL_INITIAL_IP_ADDR,
+	RCOL_INITIAL_DEST,
+	RCOL_INITIAL_DIALPLAN,
+	RCOL_INITIAL_CONTEXT,
+	RCOL_MAX
+} registry_col_t;
+
+/* same names and order as the channels table */
+static const char *registry_col_names[RCOL_MAX] = {
+	"uuid",
+	"direction",
+	"created",
+	"created_epoch",
+	"name",
+	"state",
+	"cid_name",
+	"cid_num",
+	"ip_addr",
+	"dest",
+	"application",
+	"application_data",
+	"dialplan",
+	"context",
+	"read_codec",
+	"read_rate",
+	"read_bit_rate",
+	"write_codec",
+	"write_rate",
+	"write_bit_rate",
+	"secure",
+	"hostname",
+	"presence_id",
+	"presence_data",
+	"accountcode",
+	"callstate",
+	"callee_name",
+	"callee_num",
+	"callee_direction",
+	"call_uuid",
+	"sent_callee_name",
+	"sent_callee_num",
+	"initial_cid_name",
+	"initial_cid_num",
+	"initial_ip_addr",
+	"initial_dest",
+	"initial_dialplan",
+	"initial_context"
+};
+
+/* the a and b leg columns of the basic_calls view, detailed_calls takes uuid through sent_callee_num for both */
+static const registry_col_t basic_calls_a_cols[] = {
+	RCOL_UUID, RCOL_DIRECTION, RCOL_CREATED, RCOL_CREATED_EPOCH, RCOL_NAME, RCOL_STATE, RCOL_CID_NAME, RCOL_CID_NUM,
+	RCOL_IP_ADDR, RCOL_DEST, RCOL_PRESENCE_ID, RCOL_PRESENCE_DATA, RCOL_ACCOUNTCODE, RCOL_CALLSTATE, RCOL_CALLEE_NAME,
+	RCOL_CALLEE_NUM, RCOL_CALLEE_DIRECTION, RCOL_CALL_UUID, RCOL_HOSTNAME, RCOL_SENT_CALLEE_NAME, RCOL_SENT_CALLEE_NUM
+};
+
+static const registry_col_t basic_calls_b_cols[] = {
+	RCOL_UUID, RCOL_DIRECTION, RCOL_CREATED, RCOL_CREATED_EPOCH, RCOL_NAME, RCOL_STATE, RCOL_CID_NAME, RCOL_CID_NUM,
+	RCOL_IP_ADDR, RCOL_DEST, RCOL_PRESENCE_ID, RCOL_PRESENCE_DATA, RCOL_ACCOUNTCODE, RCOL_CALLSTATE, RCOL_CALLEE_NAME,
+	RCOL_CALLEE_NUM, RCOL_CALLEE_DIRECTION, RCOL_SENT_CALLEE_NAME, RCOL_SENT_CALLEE_NUM
+};
+
+#define REGISTRY_DETAILED_COLS (RCOL_SENT_CALLEE_NUM + 1)
+
+typedef enum {
+	REGISTRY_SIDE_A,
+	REGISTRY_SIDE_B,
+	REGISTRY_SIDE_CALL
+} registry_side_t;
+
+typedef struct {
+	int len;
+	const char **names;
+	registry_side_t *side;
+	int *col;
+} registry_view_t;
+
+typedef struct {
+	registry_col_t col;
+	const char *header;
+} registry_field_t;
+
+typedef struct {
+	char *col[RCOL_MAX];
+	uint64_t seq;
+	/* b leg while this channel is the caller of a call */
+	char *callee_uuid;
+	/* a leg while this channel is the callee of a call */
+	char *caller_uuid;
+	char *call_created_epoch;
+} registry_entry_t;
+
+typedef struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	uint32_t count;
+} registry_stripe_t;
+
+typedef struct registry_member_s {
+	char *uuid;
+	struct registry_member_s *next;
+} registry_member_t;
+
+static struct {
+	switch_memory_pool_t *pool;
+	registry_stripe_t stripes[CHANNEL_REGISTRY_STRIPES];
+	switch_mutex_t *seq_mutex;
+	uint64_t seq;
+	/* call_uuid to registry_member_t list, taken inside a stripe lock, never the other way around */
+	switch_mutex_t *call_mutex;
+	switch_hash_t *calls;
+	registry_view_t views[SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS + 1];
+	int ready;
+} registry;
+
+static const registry_field_t create_fields[] = {
+	{RCOL_DIRECTION, "call-direction"},
+	{RCOL_CREATED, "event-date-local"},
+	{RCOL_NAME, "channel-name"},
+	{RCOL_STATE, "channel-state"},
+	{RCOL_CALLSTATE, "channel-call-state"},
+	{RCOL_DIALPLAN, "caller-dialplan"},
+	{RCOL_CONTEXT, "caller-context"},
+	{RCOL_INITIAL_CID_NAME, "caller-caller-id-name"},
+	{RCOL_INITIAL_CID_NUM, "caller-caller-id-number"},
+	{RCOL_INITIAL_IP_ADDR, "caller-network-addr"},
+	{RCOL_INITIAL_DEST, "caller-destination-number"},
+	{RCOL_INITIAL_DIALPLAN, "caller-dialplan"},
+	{RCOL_INITIAL_CONTEXT, "caller-context"}
+};
+
+static const registry_field_t codec_fields[] = {
+	{RCOL_READ_CODEC, "channel-read-codec-name"},
+	{RCOL_READ_RATE, "channel-read-codec-rate"},
+	{RCOL_READ_BIT_RATE, "channel-read-codec-bit-rate"},
+	{RCOL_WRITE_CODEC, "channel-write-codec-name"},
+	{RCOL_WRITE_RATE, "channel-write-codec-rate"},
+	{RCOL_WRITE_BIT_RATE, "channel-write-codec-bit-rate"}
+};
+
+static const registry_field_t execute_fields[] = {
+	{RCOL_APPLICATION, "application"},
+	{RCOL_APPLICATION_DATA, "application-data"},
+	{RCOL_PRESENCE_ID, "channel-presence-id"},
+	{RCOL_PRESENCE_DATA, "channel-presence-data"},
+	{RCOL_ACCOUNTCODE, "variable_accountcode"}
+};
+
+static const registry_field_t originate_fields[] = {
+	{RCOL_PRESENCE_ID, "channel-presence-id"},
+	{RCOL_PRESENCE_DATA, "channel-presence-data"},
+	{RCOL_ACCOUNTCODE, "variable_accountcode"},
+	{RCOL_CALL_UUID, "channel-call-uuid"}
+};
+
+static const registry_field_t call_update_fields[] = {
+	{RCOL_CALLEE_NAME, "caller-callee-id-name"},
+	{RCOL_CALLEE_NUM, "caller-callee-id-number"},
+	{RCOL_SENT_CALLEE_NAME, "sent-callee-id-name"},
+	{RCOL_SENT_CALLEE_NUM, "sent-callee-id-number"},
+	{RCOL_CALLEE_DIRECTION, "direction"},
+	{RCOL_CID_NAME, "caller-caller-id-name"},
+	{RCOL_CID_NUM, "caller-caller-id-number"}
+};
+
+static const registry_field_t callstate_fields[] = {
+	{RCOL_CALLSTATE, "channel-call-state"}
+};
+
+static const registry_field_t state_fields[] = {
+	{RCOL_STATE, "channel-state"}
+};
+
+static const registry_field_t routing_fields[] = {
+	{RCOL_STATE, "channel-state"},
+	{RCOL_CID_NAME, "caller-caller-id-name"},
+	{RCOL_CID_NUM, "caller-caller-id-number"},
+	{RCOL_CALLEE_NAME, "caller-callee-id-name"},
+	{RCOL_CALLEE_NUM, "caller-callee-id-number"},
+	{RCOL_SENT_CALLEE_NAME, "sent-callee-id-name"},
+	{RCOL_SENT_CALLEE_NUM, "sent-callee-id-number"},
+	{RCOL_IP_ADDR, "caller-network-addr"},
+	{RCOL_DEST, "caller-destination-number"},
+	{RCOL_DIALPLAN, "caller-dialplan"},
+	{RCOL_CONTEXT, "caller-context"},
+	{RCOL_PRESENCE_ID, "channel-presence-id"},
+	{RCOL_PRESENCE_DATA, "channel-presence-data"},
+	{RCOL_ACCOUNTCODE, "variable_accountcode"}
+};
+
+#define registry_fields(_f) _f, (sizeof(_f) / sizeof(_f[0]))
+
+static registry_stripe_t *registry_stripe(const char *uuid)
+{
+	const unsigned char *p;
+	uint32_t hash = 2166136261u;
+
+	for (p = (const unsigned char *) uuid; *p; p++) {
+		hash = (hash ^ *p) * 16777619u;
+	}
+
+	return &registry.stripes[hash % CHANNEL_REGISTRY_STRIPES];
+}
+
+static void registry_call_add(const char *call_uuid, const char *uuid)
+{
+	registry_member_t *member;
+
+	if (zstr(call_uuid) || zstr(uuid)) {
+		return;
+	}
+
+	switch_zmalloc(member, sizeof(*member));
+	member->uuid = strdup(uuid);
+
+	switch_mutex_lock(registry.call_mutex);
+	member->next = switch_core_hash_find(registry.calls, call_uuid);
+	switch_core_hash_insert(registry.calls, call_uuid, member);
+	switch_mutex_unlock(registry.call_mutex);
+}
+
+static void registry_call_del(const char *call_uuid, const char *uuid)
+{
+	registry_member_t *head, *member, *last = NULL;
+
+	if (zstr(call_uuid) || zstr(uuid)) {
+		return;
+	}
+
+	switch_mutex_lock(registry.call_mutex);
+	head = switch_core_hash_find(registry.calls, call_uuid);
+	for (member = head; member; member = member->next) {
+		if (!strcmp(member->uuid, uuid)) {
+			if (last) {
+				last->next = member->next;
+			} else if (member->next) {
+				switch_core_hash_insert(registry.calls, call_uuid, member->next);
+			} else {
+				switch_core_hash_delete(registry.calls, call_uuid);
+			}
+			break;
+		}
+		last = member;
+	}
+	switch_mutex_unlock(registry.call_mutex);
+
+	if (member) {
+		free(member->uuid);
+		free(member);
+	}
+}
+
+/* detach and return the members of call_uuid, the caller frees the list */
+static registry_member_t *registry_call_take(const char *call_uuid)
+{
+	registry_member_t *head;
+
+	switch_mutex_lock(registry.call_mutex);
+	if ((head = switch_core_hash_find(registry.calls, call_uuid))) {
+		switch_core_hash_delete(registry.calls, call_uuid);
+	}
+	switch_mutex_unlock(registry.call_mutex);
+
+	return head;
+}
+
+/* every write of the uuid and call_uuid columns goes through here to keep the call index in step */
+static void registry_set(registry_entry_t *entry, registry_col_t col, const char *val)
+{
+	if (col == RCOL_UUID || col == RCOL_CALL_UUID) {
+		registry_call_del(entry->col[RCOL_CALL_UUID], entry->col[RCOL_UUID]);
+	}
+
+	switch_safe_free(entry->col[col]);
+	entry->col[col] = strdup(switch_str_nil(val));
+
+	if (col == RCOL_UUID || col == RCOL_CALL_UUID) {
+		registry_call_add(entry->col[RCOL_CALL_UUID], entry->col[RCOL_UUID]);
+	}
+}
+
+static void registry_entry_free(registry_entry_t *entry)
+{
+	int i;
+
+	registry_call_del(entry->col[RCOL_CALL_UUID], entry->col[RCOL_UUID]);
+
+	for (i = 0; i < RCOL_MAX; i++) {
+		switch_safe_free(entry->col[i]);
+	}
+
+	switch_safe_free(entry->callee_uuid);
+	switch_safe_free(entry->caller_uuid);
+	switch_safe_free(entry->call_created_epoch);
+	free(entry);
+}
+
+static void registry_update(const char *uuid, switch_event_t *event, const registry_field_t *fields, size_t len)
+{
+	registry_stripe_t *stripe;
+	registry_entry_t *entry;
+	size_t i;
+
+	if (zstr(uuid)) {
+		return;
+	}
+
+	stripe = registry_stripe(uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((entry = switch_core_hash_find(stripe->hash, uuid))) {
+		for (i = 0; i < len; i++) {
+			registry_set(entry, fields[i].col, switch_event_get_header_nil(event, fields[i].header));
+		}
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+static void registry_set_col(const char *uuid, registry_col_t col, const char *val)
+{
+	registry_stripe_t *stripe;
+	registry_entry_t *entry;
+
+	if (zstr(uuid)) {
+		return;
+	}
+
+	stripe = registry_stripe(uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((entry = switch_core_hash_find(stripe->hash, uuid))) {
+		registry_set(entry, col, val);
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+static void registry_create(switch_event_t *event)
+{
+	const char *uuid = switch_event_get_header(event, "unique-id");
+	registry_stripe_t *stripe;
+	registry_entry_t *entry, *old;
+	char epoch[32];
+	size_t i;
+
+	if (zstr(uuid) || !switch_ivr_uuid_exists(uuid)) {
+		return;
+	}
+
+	switch_zmalloc(entry, sizeof(*entry));
+
+	registry_set(entry, RCOL_UUID, uuid);
+	switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+	registry_set(entry, RCOL_CREATED_EPOCH, epoch);
+	registry_set(entry, RCOL_HOSTNAME, switch_core_get_switchname());
+
+	for (i = 0; i < sizeof(create_fields) / sizeof(create_fields[0]); i++) {
+		registry_set(entry, create_fields[i].col, switch_event_get_header_nil(event, create_fields[i].header));
+	}
+
+	switch_mutex_lock(registry.seq_mutex);
+	entry->seq = ++registry.seq;
+	switch_mutex_unlock(registry.seq_mutex);
+
+	stripe = registry_stripe(uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((old = switch_core_hash_find(stripe->hash, uuid))) {
+		switch_core_hash_delete(stripe->hash, uuid);
+		registry_entry_free(old);
+		stripe->count--;
+	}
+	switch_core_hash_insert(stripe->hash, uuid, entry);
+	stripe->count++;
+	switch_mutex_unlock(stripe->mutex);
+}
+
+/* swap the leg pointer of uuid that names old_partner for new_partner, NULL drops the link */
+static void registry_relink(const char *uuid, const char *old_partner, const char *new_partner)
+{
+	registry_stripe_t *stripe = registry_stripe(uuid);
+	registry_entry_t *entry;
+
+	switch_mutex_lock(stripe->mutex);
+	if ((entry = switch_core_hash_find(stripe->hash, uuid))) {
+		if (entry->callee_uuid && !strcmp(entry->callee_uuid, old_partner)) {
+			switch_safe_free(entry->callee_uuid);
+			if (new_partner) {
+				entry->callee_uuid = strdup(new_partner);
+			} else {
+				switch_safe_free(entry->call_created_epoch);
+			}
+		}
+		if (entry->caller_uuid && !strcmp(entry->caller_uuid, old_partner)) {
+			switch_safe_free(entry->caller_uuid);
+			if (new_partner) {
+				entry->caller_uuid = strdup(new_partner);
+			}
+		}
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+/* delete from calls where (caller_uuid=uuid or callee_uuid=uuid) */
+static void registry_unlink(const char *uuid)
+{
+	registry_stripe_t *stripe;
+	registry_entry_t *entry;
+	char *callee = NULL, *caller = NULL;
+
+	if (zstr(uuid)) {
+		return;
+	}
+
+	stripe = registry_stripe(uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((entry = switch_core_hash_find(stripe->hash, uuid))) {
+		callee = entry->callee_uuid;
+		caller = entry->caller_uuid;
+		entry->callee_uuid = NULL;
+		entry->caller_uuid = NULL;
+		switch_safe_free(entry->call_created_epoch);
+	}
+	switch_mutex_unlock(stripe->mutex);
+
+	if (callee) {
+		registry_relink(callee, uuid, NULL);
+		free(callee);
+	}
+
+	if (caller) {
+		registry_relink(caller, uuid, NULL);
+		free(caller);
+	}
+}
+
+/* update channels set call_uuid=to where call_uuid=from, a NULL to resets it to the channel's own uuid */
+static void registry_replace_call_uuid(const char *from, const char *to)
+{
+	registry_member_t *member, *next;
+	registry_entry_t *entry;
+
+	if (zstr(from)) {
+		return;
+	}
+
+	for (member = registry_call_take(from); member; member = next) {
+		registry_stripe_t *stripe = registry_stripe(member->uuid);
+
+		next = member->next;
+
+		switch_mutex_lock(stripe->mutex);
+		if ((entry = switch_core_hash_find(stripe->hash, member->uuid)) &&
+			entry->col[RCOL_CALL_UUID] && !strcmp(entry->col[RCOL_CALL_UUID], from)) {
+			registry_set(entry, RCOL_CALL_UUID, to ? to : entry->col[RCOL_UUID]);
+		}
+		switch_mutex_unlock(stripe->mutex);
+
+		free(member->uuid);
+		free(member);
+	}
+}
+
+static void registry_rename(const char *old_uuid, const char *new_uuid)
+{
+	registry_stripe_t *stripe;
+	registry_entry_t *entry;
+
+	if (zstr(old_uuid) || zstr(new_uuid)) {
+		return;
+	}
+
+	stripe = registry_stripe(old_uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((entry = switch_core_hash_find(stripe->hash, old_uuid))) {
+		switch_core_hash_delete(stripe->hash, old_uuid);
+		stripe->count--;
+	}
+	switch_mutex_unlock(stripe->mutex);
+
+	if (entry) {
+		registry_entry_t *old;
+
+		registry_set(entry, RCOL_UUID, new_uuid);
+
+		if (entry->callee_uuid) {
+			registry_relink(entry->callee_uuid, old_uuid, new_uuid);
+		}
+
+		if (entry->caller_uuid) {
+			registry_relink(entry->caller_uuid, old_uuid, new_uuid);
+		}
+
+		stripe = registry_stripe(new_uuid);
+		switch_mutex_lock(stripe->mutex);
+		if ((old = switch_core_hash_find(stripe->hash, new_uuid))) {
+			switch_core_hash_delete(stripe->hash, new_uuid);
+			registry_entry_free(old);
+			stripe->count--;
+		}
+		switch_core_hash_insert(stripe->hash, new_uuid, entry);
+		stripe->count++;
+		switch_mutex_unlock(stripe->mutex);
+	}
+
+	registry_replace_call_uuid(old_uuid, new_uuid);
+}
+
+static void registry_destroy_channel(const char *uuid)
+{
+	registry_stripe_t *stripe;
+	registry_entry_t *entry;
+
+	if (zstr(uuid)) {
+		return;
+	}
+
+	registry_unlink(uuid);
+
+	stripe = registry_stripe(uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((entry = switch_core_hash_find(stripe->hash, uuid))) {
+		switch_core_hash_delete(stripe->hash, uuid);
+		registry_entry_free(entry);
+		stripe->count--;
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+static void registry_bridge(switch_event_t *event)
+{
+	const char *a_uuid, *b_uuid, *call_uuid;
+	registry_stripe_t *stripe;
+	registry_entry_t *entry;
+	char epoch[32];
+
+	a_uuid = switch_event_get_header(event, "Bridge-A-Unique-ID");
+	b_uuid = switch_event_get_header(event, "Bridge-B-Unique-ID");
+
+	if (zstr(a_uuid) || zstr(b_uuid)) {
+		a_uuid = switch_event_get_header_nil(event, "caller-unique-id");
+		b_uuid = switch_event_get_header_nil(event, "other-leg-unique-id");
+	}
+
+	if (zstr(a_uuid) || zstr(b_uuid)) {
+		return;
+	}
+
+	call_uuid = switch_event_get_header_nil(event, "channel-call-uuid");
+	switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+
+	stripe = registry_stripe(a_uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((entry = switch_core_hash_find(stripe->hash, a_uuid))) {
+		registry_set(entry, RCOL_CALL_UUID, call_uuid);
+		switch_safe_free(entry->callee_uuid);
+		switch_safe_free(entry->call_created_epoch);
+		entry->callee_uuid = strdup(b_uuid);
+		entry->call_created_epoch = strdup(epoch);
+	}
+	switch_mutex_unlock(stripe->mutex);
+
+	stripe = registry_stripe(b_uuid);
+	switch_mutex_lock(stripe->mutex);
+	if ((entry = switch_core_hash_find(stripe->hash, b_uuid))) {
+		registry_set(entry, RCOL_CALL_UUID, call_uuid);
+		switch_safe_free(entry->caller_uuid);
+		entry->caller_uuid = strdup(a_uuid);
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+static void registry_clear(void)
+{
+	switch_hash_index_t *hi;
+	void *val;
+	int i;
+
+	for (i = 0; i < CHANNEL_REGISTRY_STRIPES; i++) {
+		registry_stripe_t *stripe = &registry.stripes[i];
+
+		switch_mutex_lock(stripe->mutex);
+		for (hi = switch_core_hash_first(stripe->hash); hi; hi = switch_core_hash_next(&hi)) {
+			switch_core_hash_this(hi, NULL, NULL, &val);
+			registry_entry_free((registry_entry_t *) val);
+		}
+		switch_core_hash_destroy(&stripe->hash);
+		switch_core_hash_init(&stripe->hash);
+		stripe->count = 0;
+		switch_mutex_unlock(stripe->mutex);
+	}
+}
+
+static void registry_event_handler(switch_event_t *event)
+{
+	const char *uuid = switch_event_get_header(event, "unique-id");
+
+	switch (event->event_id) {
+	case SWITCH_EVENT_CHANNEL_CREATE:
+		registry_create(event);
+		break;
+	case SWITCH_EVENT_CHANNEL_DESTROY:
+		registry_destroy_channel(uuid);
+		break;
+	case SWITCH_EVENT_CHANNEL_UUID:
+		registry_rename(switch_event_get_header(event, "old-unique-id"), uuid);
+		break;
+	case SWITCH_EVENT_CHANNEL_ANSWER:
+	case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
+	case SWITCH_EVENT_CODEC:
+		registry_update(uuid, event, registry_fields(codec_fields));
+		break;
+	case SWITCH_EVENT_CHANNEL_HOLD:
+	case SWITCH_EVENT_CHANNEL_UNHOLD:
+	case SWITCH_EVENT_CHANNEL_EXECUTE:
+		registry_update(uuid, event, registry_fields(execute_fields));
+		break;
+	case SWITCH_EVENT_CHANNEL_ORIGINATE:
+		registry_update(uuid, event, registry_fields(originate_fields));
+		break;
+	case SWITCH_EVENT_CALL_UPDATE:
+		registry_update(uuid, event, registry_fields(call_update_fields));
+		break;
+	case SWITCH_EVENT_CHANNEL_CALLSTATE:
+		{
+			char *num = switch_event_get_header_nil(event, "channel-call-state-number");
+			switch_channel_callstate_t callstate = CCS_DOWN;
+
+			if (num) {
+				callstate = atoi(num);
+			}
+
+			if (callstate != CCS_DOWN && callstate != CCS_HANGUP) {
+				registry_update(uuid, event, registry_fields(callstate_fields));
+			}
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_STATE:
+		{
+			char *state = switch_event_get_header_nil(event, "channel-state-number");
+			switch_channel_state_t state_i = CS_DESTROY;
+
+			if (!zstr(state)) {
+				state_i = atoi(state);
+			}
+
+			switch (state_i) {
+			case CS_NEW:
+			case CS_DESTROY:
+			case CS_REPORTING:
+#ifndef SWITCH_DEPRECATED_CORE_DB
+			case CS_HANGUP:
+#endif
+			case CS_INIT:
+				break;
+			case CS_ROUTING:
+				registry_update(uuid, event, registry_fields(routing_fields));
+				break;
+			default:
+				registry_update(uuid, event, registry_fields(state_fields));
+				break;
+			}
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_BRIDGE:
+		if (uuid && switch_ivr_uuid_exists(uuid)) {
+			registry_bridge(event);
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_UNBRIDGE:
+		registry_replace_call_uuid(switch_event_get_header(event, "channel-call-uuid"), NULL);
+		registry_unlink(switch_event_get_header(event, "caller-unique-id"));
+		break;
+	case SWITCH_EVENT_CALL_SECURE:
+		{
+			const char *type = switch_event_get_header(event, "secure_type");
+
+			if (!zstr(type)) {
+				registry_set_col(switch_event_get_header(event, "caller-unique-id"), RCOL_SECURE, type);
+			}
+		}
+		break;
+	case SWITCH_EVENT_SHUTDOWN:
+		registry_clear();
+		break;
+	default:
+		break;
+	}
+}
+
+static void registry_view_add(registry_view_t *view, const char *prefix, registry_side_t side, int col)
+{
+	view->names[view->len] = prefix ? switch_core_sprintf(registry.pool, "%s%s", prefix, registry_col_names[col]) : registry_col_names[col];
+	view->side[view->len] = side;
+	view->col[view->len] = col;
+	view->len++;
+}
+
+static void registry_view_init(registry_view_t *view, int max)
+{
+	view->len = 0;
+	view->names = switch_core_alloc(registry.pool, sizeof(char *) * max);
+	view->side = switch_core_alloc(registry.pool, sizeof(registry_side_t) * max);
+	view->col = switch_core_alloc(registry.pool, sizeof(int) * max);
+}
+
+static void registry_views_init(void)
+{
+	registry_view_t *view;
+	size_t i;
+
+	view = &registry.views[SWITCH_CHANNEL_REGISTRY_CHANNELS];
+	registry_view_init(view, RCOL_MAX);
+	for (i = 0; i < RCOL_MAX; i++) {
+		registry_view_add(view, NULL, REGISTRY_SIDE_A, i);
+	}
+
+	view = &registry.views[SWITCH_CHANNEL_REGISTRY_CALLS];
+	registry_view_init(view, RCOL_MAX * 2 + 1);
+	for (i = 0; i < sizeof(basic_calls_a_cols) / sizeof(basic_calls_a_cols[0]); i++) {
+		registry_view_add(view, NULL, REGISTRY_SIDE_A, basic_calls_a_cols[i]);
+	}
+	for (i = 0; i < sizeof(basic_calls_b_cols) / sizeof(basic_calls_b_cols[0]); i++) {
+		registry_view_add(view, "b_", REGISTRY_SIDE_B, basic_calls_b_cols[i]);
+	}
+	registry_view_add(view, NULL, REGISTRY_SIDE_CALL, 0);
+	view->names[view->len - 1] = "call_created_epoch";
+
+	view = &registry.views[SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS];
+	registry_view_init(view, RCOL_MAX * 2 + 1);
+	for (i = 0; i < REGISTRY_DETAILED_COLS; i++) {
+		registry_view_add(view, NULL, REGISTRY_SIDE_A, i);
+	}
+	for (i = 0; i < REGISTRY_DETAILED_COLS; i++) {
+		registry_view_add(view, "b_", REGISTRY_SIDE_B, i);
+	}
+	registry_view_add(view, NULL, REGISTRY_SIDE_CALL, 0);
+	view->names[view->len - 1] = "call_created_epoch";
+}
+
+void switch_channel_registry_init(switch_memory_pool_t *pool)
+{
+	int i;
+
+	if (registry.ready) {
+		return;
+	}
+
+	registry.pool = pool;
+	switch_mutex_init(&registry.seq_mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_mutex_init(&registry.call_mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_core_hash_init(&registry.calls);
+
+	for (i = 0; i < CHANNEL_REGISTRY_STRIPES; i++) {
+		switch_mutex_init(&registry.stripes[i].mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_core_hash_init(&registry.stripes[i].hash);
+	}
+
+	registry_views_init();
+
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_CREATE, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_DESTROY, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_UUID, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_ANSWER, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CODEC, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_HOLD, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_UNHOLD, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_EXECUTE, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_ORIGINATE, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CALL_UPDATE, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_CALLSTATE, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_STATE, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_BRIDGE, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CHANNEL_UNBRIDGE, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_CALL_SECURE, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+	switch_event_bind("core_channel_registry", SWITCH_EVENT_SHUTDOWN, SWITCH_EVENT_SUBCLASS_ANY, registry_event_handler, NULL);
+
+	registry.ready = 1;
+}
+
+void switch_channel_registry_destroy(void)
+{
+	int i;
+
+	if (!registry.ready) {
+		return;
+	}
+
+	switch_event_unbind_callback(registry_event_handler);
+	registry_clear();
+	registry.ready = 0;
+
+	for (i = 0; i < CHANNEL_REGISTRY_STRIPES; i++) {
+		switch_core_hash_destroy(&registry.stripes[i].hash);
+	}
+
+	switch_core_hash_destroy(&registry.calls);
+}
+
+/* sql LIKE: % is any run, _ any one character, ascii case does not matter */
+static int registry_like(const char *pattern, const char *str)
+{
+	if (!str) {
+		return 0;
+	}
+
+	while (*pattern) {
+		if (*pattern == '%') {
+			while (*pattern == '%') {
+				pattern++;
+			}
+
+			if (!*pattern) {
+				return 1;
+			}
+
+			for (; *str; str++) {
+				if (registry_like(pattern, str)) {
+					return 1;
+				}
+			}
+
+			return 0;
+		}
+
+		if (!*str) {
+			return 0;
+		}
+
+		if (*pattern != '_' && switch_tolower((unsigned char) *pattern) != switch_tolower((unsigned char) *str)) {
+			return 0;
+		}
+
+		pattern++;
+		str++;
+	}
+
+	return !*str;
+}
+
+typedef struct {
+	char *col[RCOL_MAX];
+	uint64_t seq;
+	long call_epoch;
+	char *callee_uuid;
+	char *caller_uuid;
+	char *call_created_epoch;
+} registry_row_t;
+
+static int registry_row_cmp(const void *a, const void *b)
+{
+	const registry_row_t *ra = *(const registry_row_t * const *) a;
+	const registry_row_t *rb = *(const registry_row_t * const *) b;
+
+	return ra->seq < rb->seq ? -1 : (ra->seq > rb->seq ? 1 : 0);
+}
+
+static int registry_row_call_cmp(const void *a, const void *b)
+{
+	const registry_row_t *ra = *(const registry_row_t * const *) a;
+	const registry_row_t *rb = *(const registry_row_t * const *) b;
+
+	if (ra->call_epoch != rb->call_epoch) {
+		return ra->call_epoch < rb->call_epoch ? -1 : 1;
+	}
+
+	return registry_row_cmp(a, b);
+}
+
+static switch_bool_t registry_row_like(registry_row_t *row, const char *like)
+{
+	return registry_like(like, row->col[RCOL_UUID]) || registry_like(like, row->col[RCOL_NAME]) ||
+		registry_like(like, row->col[RCOL_CID_NAME]) || registry_like(like, row->col[RCOL_CID_NUM]) ||
+		registry_like(like, row->col[RCOL_PRESENCE_DATA]) || registry_like(like, row->col[RCOL_ACCOUNTCODE]);
+}
+
+/* copy every entry out from under the stripe locks so the callbacks run without holding any */
+static registry_row_t **registry_snapshot(switch_memory_pool_t *pool, uint32_t *countp)
+{
+	registry_row_t **rows = NULL;
+	uint32_t count = 0, max = 0;
+	switch_hash_index_t *hi;
+	void *val;
+	int i, c;
+
+	for (i = 0; i < CHANNEL_REGISTRY_STRIPES; i++) {
+		registry_stripe_t *stripe = &registry.stripes[i];
+
+		switch_mutex_lock(stripe->mutex);
+
+		if (count + stripe->count > max) {
+			max = count + stripe->count + 16;
+			rows = realloc(rows, sizeof(*rows) * max);
+			switch_assert(rows);
+		}
+
+		for (hi = switch_core_hash_first(stripe->hash); hi; hi = switch_core_hash_next(&hi)) {
+			registry_entry_t *entry;
+			registry_row_t *row;
+
+			switch_core_hash_this(hi, NULL, NULL, &val);
+			entry = (registry_entry_t *) val;
+
+			row = switch_core_alloc(pool, sizeof(*row));
+
+			for (c = 0; c < RCOL_MAX; c++) {
+				row->col[c] = switch_core_strdup(pool, entry->col[c]);
+			}
+
+			row->seq = entry->seq;
+			row->callee_uuid = switch_core_strdup(pool, entry->callee_uuid);
+			row->caller_uuid = switch_core_strdup(pool, entry->caller_uuid);
+			row->call_created_epoch = switch_core_strdup(pool, entry->call_created_epoch);
+			row->call_epoch = entry->call_created_epoch ? atol(entry->call_created_epoch) : 0;
+
+			rows[count++] = row;
+		}
+
+		switch_mutex_unlock(stripe->mutex);
+	}
+
+	*countp = count;
+
+	return rows;
+}
+
+SWITCH_DECLARE(int) switch_channel_registry_query(const switch_channel_registry_query_t *query,
+												   switch_core_db_callback_func_t callback, void *pArg)
+{
+	switch_memory_pool_t *pool;
+	registry_view_t *view;
+	registry_row_t **rows = NULL;
+	switch_hash_t *index = NULL;
+	uint32_t count = 0, matched = 0, i;
+	int *map = NULL, argc, c;
+	char **argv = NULL, **names = NULL;
+
+	switch_assert(query);
+
+	if (!registry.ready || query->view > SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS) {
+		return -1;
+	}
+
+	view = &registry.views[query->view];
+
+	switch_core_new_memory_pool(&pool);
+
+	if (query->columns) {
+		const char **col;
+
+		for (argc = 0; query->columns[argc]; argc++);
+
+		map = switch_core_alloc(pool, sizeof(int) * (argc + 1));
+		names = switch_core_alloc(pool, sizeof(char *) * (argc + 1));
+
+		for (c = 0; c < argc; c++) {
+			int x;
+
+			col = &query->columns[c];
+
+			for (x = 0; x < view->len; x++) {
+				if (!strcasecmp(*col, view->names[x])) {
+					break;
+				}
+			}
+
+			if (x == view->len) {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Channel registry has no column %s\n", *col);
+				switch_core_destroy_memory_pool(&pool);
+				return -1;
+			}
+
+			map[c] = x;
+			names[c] = (char *) view->names[x];
+		}
+	} else {
+		argc = view->len;
+		map = switch_core_alloc(pool, sizeof(int) * (argc + 1));
+		names = switch_core_alloc(pool, sizeof(char *) * (argc + 1));
+
+		for (c = 0; c < argc; c++) {
+			map[c] = c;
+			names[c] = (char *) view->names[c];
+		}
+	}
+
+	argv = switch_core_alloc(pool, sizeof(char *) * (argc + 1));
+
+	rows = registry_snapshot(pool, &count);
+
+	if (query->view != SWITCH_CHANNEL_REGISTRY_CHANNELS) {
+		switch_core_hash_init(&index);
+
+		for (i = 0; i < count; i++) {
+			switch_core_hash_insert(index, rows[i]->col[RCOL_UUID], rows[i]);
+		}
+	}
+
+	if (count > 1) {
+		qsort(rows, count, sizeof(*rows), query->order_by_call ? registry_row_call_cmp : registry_row_cmp);
+	}
+
+	for (i = 0; i < count; i++) {
+		registry_row_t *a = rows[i], *b = NULL;
+
+		if (index) {
+			/* where a.uuid = c.caller_uuid or a.uuid not in (select callee_uuid from calls) */
+			if (!a->callee_uuid && a->caller_uuid) {
+				continue;
+			}
+
+			if (a->callee_uuid) {
+				b = switch_core_hash_find(index, a->callee_uuid);
+			}
+
+			if (query->bridged_only && !b) {
+				continue;
+			}
+		}
+
+		if (!zstr(query->like) && !registry_row_like(a, query->like)) {
+			continue;
+		}
+
+		matched++;
+
+		if (query->count_only) {
+			continue;
+		}
+
+		for (c = 0; c < argc; c++) {
+			int x = map[c];
+
+			switch (view->side[x]) {
+			case REGISTRY_SIDE_A:
+				argv[c] = a->col[view->col[x]];
+				break;
+			case REGISTRY_SIDE_B:
+				argv[c] = b ? b->col[view->col[x]] : NULL;
+				break;
+			case REGISTRY_SIDE_CALL:
+				argv[c] = a->call_created_epoch;
+				break;
+			}
+		}
+
+		if (callback(pArg, argc, argv, names)) {
+			break;
+		}
+	}
+
+	if (query->count_only) {
+		char buf[32];
+		char *count_argv[1];
+		char *count_names[1];
+
+		switch_snprintf(buf, sizeof(buf), "%u", matched);
+		count_argv[0] = buf;
+		count_names[0] = "count";
+		callback(pArg, 1, count_argv, count_names);
+	}
+
+	if (index) {
+		switch_core_hash_destroy(&index);
+	}
+
+	switch_safe_free(rows);
+	switch_core_destroy_memory_pool(&pool);
+
+	return (int) matched;
+}
+
+SWITCH_DECLARE(uint32_t) switch_channel_registry_count(void)
+{
+	uint32_t count = 0;
+	int i;
+
+	if (!registry.ready) {
+		return 0;
+	}
+
+	for (i = 0; i < CHANNEL_REGISTRY_STRIPES; i++) {
+		switch_mutex_lock(registry.stripes[i].mutex);
+		count += registry.stripes[i].count;
+		switch_mutex_unlock(registry.stripes[i].mutex);
+	}
+
+	return count;
+}
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
@@ -1858,6 +1858,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	runtime.min_dtmf_duration = SWITCH_MIN_DTMF_DURATION;
 	runtime.odbc_dbtype = DBTYPE_DEFAULT;
 	runtime.dbname = NULL;
+	runtime.core_db_channels = 1;
 #ifndef WIN32
 	runtime.cpu_count = sysconf (_SC_NPROCESSORS_ONLN);
 #else
@@ -1964,6 +1965,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	switch_console_init(runtime.memory_pool);
 	switch_event_init(runtime.memory_pool);
 	switch_channel_global_init(runtime.memory_pool);
+	switch_regex_cache_init(runtime.memory_pool, SWITCH_REGEX_CACHE_SIZE);
+	switch_channel_registry_init(runtime.memory_pool);
 
 	if (switch_xml_init(runtime.memory_pool, err) != SWITCH_STATUS_SUCCESS) {
 		/* allow missing configuration if MINIMAL */
@@ -2338,6 +2341,8 @@ static void switch_load_core_config(const char *file)
 					runtime.dbname = switch_core_strdup(runtime.memory_pool, val);
 				} else if (!strcasecmp(var, "core-db-dsn") && !zstr(val)) {
 					runtime.odbc_dsn = switch_core_strdup(runtime.memory_pool, val);
+				} else if (!strcasecmp(var, "core-db-channels") && !zstr(val)) {
+					runtime.core_db_channels = switch_true(val);
 				} else if (!strcasecmp(var, "core-non-sqlite-db-required") && !zstr(val)) {
 					switch_set_flag((&runtime), SCF_CORE_NON_SQLITE_DB_REQ);
 				} else if (!strcasecmp(var, "core-dbtype") && !zstr(val)) {
@@ -3124,6 +3129,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 	switch_xml_destroy();
 	switch_console_shutdown();
 	switch_channel_global_uninit();
+	switch_regex_cache_destroy();
+	switch_channel_registry_destroy();
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Closing Event Engine.\n");
 	switch_event_shutdown();
@@ -1873,6 +1873,8 @@ static void set_stats(switch_core_session_t *session, switch_media_type_t type,
 		add_stat(stats->inbound.cng_packet_count, "in_cng_packet_count");
 		add_stat(stats->inbound.flush_packet_count, "in_flush_packet_count");
 		add_stat(stats->inbound.largest_jb_size, "in_largest_jb_size");
+		add_stat(stats->inbound.io_call_count, "in_io_call_count");
+		add_stat(stats->inbound.io_packet_count, "in_io_packet_count");
 		add_stat_double(stats->inbound.min_variance, "in_jitter_min_variance");
 		add_stat_double(stats->inbound.max_variance, "in_jitter_max_variance");
 		add_stat_double(stats->inbound.lossrate, "in_jitter_loss_rate");
@@ -1890,6 +1892,8 @@ static void set_stats(switch_core_session_t *session, switch_media_type_t type,
 		add_stat(stats->outbound.skip_packet_count, "out_skip_packet_count");
 		add_stat(stats->outbound.dtmf_packet_count, "out_dtmf_packet_count");
 		add_stat(stats->outbound.cng_packet_count, "out_cng_packet_count");
+		add_stat(stats->outbound.io_call_count, "out_io_call_count");
+		add_stat(stats->outbound.io_packet_count, "out_io_packet_count");
 
 		add_stat(stats->rtcp.packet_count, "rtcp_packet_count");
 		add_stat(stats->rtcp.octet_count, "rtcp_octet_count");
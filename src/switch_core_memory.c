@@ -51,6 +51,11 @@
 #define DEBUG_ALLOC_CUTOFF 500
 #endif
 
+/* session thread allocations are carved out of chunks of this size, anything
+   bigger than a quarter of a chunk goes straight to the pool */
+#define SESSION_ARENA_CHUNK 16384
+#define SESSION_ARENA_MAX_ALLOC (SESSION_ARENA_CHUNK / 4)
+
 static struct {
 #ifdef USE_MEM_LOCK
 	switch_mutex_t *mem_lock;
@@ -68,6 +73,58 @@ SWITCH_DECLARE(switch_memory_pool_t *) switch_core_session_get_pool(switch_core_
 	return session->pool;
 }
 
+static inline switch_bool_t session_arena_owner(switch_core_session_t *session)
+{
+	return session->thread_id && switch_thread_equal(session->thread_id, switch_thread_self());
+}
+
+/* returns NULL when the caller has to fall back to the locked pool */
+static void *session_arena_alloc(switch_core_session_t *session, switch_size_t memory)
+{
+	switch_session_arena_t *arena = &session->arena;
+	switch_size_t size = APR_ALIGN_DEFAULT(memory);
+	char *ptr;
+
+	if (!session_arena_owner(session) || size > SESSION_ARENA_MAX_ALLOC) {
+		return NULL;
+	}
+
+	if (size > (switch_size_t) (arena->end - arena->pos)) {
+		/* the tail of the old chunk is abandoned, it goes away with the pool */
+		if (!(ptr = fspr_palloc(session->pool, SESSION_ARENA_CHUNK))) {
+			return NULL;
+		}
+		arena->pos = ptr;
+		arena->end = ptr + SESSION_ARENA_CHUNK;
+		arena->reserved += SESSION_ARENA_CHUNK;
+	}
+
+	ptr = arena->pos;
+	arena->pos += size;
+	arena->bytes += memory;
+	arena->allocs++;
+
+	return ptr;
+}
+
+static inline void session_pool_count(switch_core_session_t *session, switch_size_t memory)
+{
+	switch_atomic_add(&session->arena.shared_bytes, (uint32_t) memory);
+	switch_atomic_inc(&session->arena.shared_allocs);
+}
+
+SWITCH_DECLARE(void) switch_core_session_memory_stats(switch_core_session_t *session, switch_memory_stats_t *stats)
+{
+	switch_assert(session != NULL);
+	switch_assert(stats != NULL);
+
+	stats->arena_bytes = session->arena.bytes;
+	stats->arena_allocs = session->arena.allocs;
+	stats->arena_reserved = session->arena.reserved;
+	stats->pool_bytes = switch_atomic_read(&session->arena.shared_bytes);
+	stats->pool_allocs = switch_atomic_read(&session->arena.shared_allocs);
+}
+
 /* **ONLY** alloc things with this function that **WILL NOT** outlive
    the session itself or expect an earth shattering KABOOM!*/
 SWITCH_DECLARE(void *) switch_core_perform_session_alloc(switch_core_session_t *session, switch_size_t memory, const char *file, const char *func,
@@ -91,8 +148,12 @@ SWITCH_DECLARE(void *) switch_core_perform_session_alloc(switch_core_session_t *
 
 #if APR_POOL_DEBUG
 	ptr = fspr_palloc_debug(session->pool, memory, func);
+	session_pool_count(session, memory);
 #else
-	ptr = fspr_palloc(session->pool, memory);
+	if (!(ptr = session_arena_alloc(session, memory))) {
+		ptr = fspr_palloc(session->pool, memory);
+		session_pool_count(session, memory);
+	}
 #endif
 	switch_assert(ptr != NULL);
 
@@ -183,7 +244,7 @@ SWITCH_DECLARE(char *) switch_core_session_sprintf(switch_core_session_t *sessio
 	char *result = NULL;
 
 	va_start(ap, fmt);
-	result = switch_core_vsprintf(session->pool, fmt, ap);
+	result = switch_core_session_vsprintf(session, fmt, ap);
 	va_end(ap);
 
 	return result;
@@ -191,7 +252,28 @@ SWITCH_DECLARE(char *) switch_core_session_sprintf(switch_core_session_t *sessio
 
 SWITCH_DECLARE(char *) switch_core_session_vsprintf(switch_core_session_t *session, const char *fmt, va_list ap)
 {
-	return switch_core_vsprintf(session->pool, fmt, ap);
+	char *result = NULL;
+
+#if !APR_POOL_DEBUG
+	if (session_arena_owner(session)) {
+		va_list ap2;
+		int len;
+
+		va_copy(ap2, ap);
+		len = vsnprintf(NULL, 0, fmt, ap2);
+		va_end(ap2);
+
+		if (len >= 0 && (result = session_arena_alloc(session, (switch_size_t) len + 1))) {
+			vsnprintf(result, (size_t) len + 1, fmt, ap);
+			return result;
+		}
+	}
+#endif
+
+	result = switch_core_vsprintf(session->pool, fmt, ap);
+	session_pool_count(session, strlen(result) + 1);
+
+	return result;
 }
 
 SWITCH_DECLARE(char *) switch_core_vsprintf(switch_memory_pool_t *pool, const char *fmt, va_list ap)
@@ -261,7 +343,21 @@ SWITCH_DECLARE(char *) switch_core_perform_session_strdup(switch_core_session_t
 						  (void *) session->pool, (void *)session, fspr_pool_tag(session->pool, NULL), strlen(todup));
 #endif
 
+#if !APR_POOL_DEBUG
+	{
+		switch_size_t len = strlen(todup) + 1;
+
+		if ((duped = session_arena_alloc(session, len))) {
+			memcpy(duped, todup, len);
+		} else {
+			duped = fspr_pstrmemdup(session->pool, todup, len - 1);
+			session_pool_count(session, len);
+		}
+	}
+#else
 	duped = fspr_pstrdup(session->pool, todup);
+	session_pool_count(session, strlen(todup) + 1);
+#endif
 	switch_assert(duped != NULL);
 
 #ifdef LOCK_MORE
@@ -381,11 +477,12 @@ SWITCH_DECLARE(void) switch_core_pool_stats(switch_stream_handle_t *stream)
 	}
 #else
 	if (stream) {
-		stream->write_function(stream, "Unable to get core pool statictics. Please rebuild FreeSWITCH with --enable-pool-debug");
+		stream->write_function(stream, "Unable to get core pool statictics. Please rebuild FreeSWITCH with --enable-pool-debug\n");
 	} else {
-		printf("Unable to get core pool statictics. Please rebuild FreeSWITCH with --enable-pool-debug");
+		printf("Unable to get core pool statictics. Please rebuild FreeSWITCH with --enable-pool-debug\n");
 	}
 #endif
+	switch_core_session_pool_stats(stream);
 }
 
 SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memory_pool_t **pool, const char *file, const char *func, int line)
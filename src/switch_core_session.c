@@ -2520,6 +2520,36 @@ SWITCH_DECLARE(uint32_t) switch_core_session_count(void)
 	return session_manager.session_count;
 }
 
+void switch_core_session_pool_stats(switch_stream_handle_t *stream)
+{
+	switch_hash_index_t *hi;
+	void *val;
+	switch_core_session_t *session;
+	switch_memory_stats_t stats;
+
+	switch_mutex_lock(runtime.session_hash_mutex);
+	for (hi = switch_core_hash_first(session_manager.session_table); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		if (val) {
+			session = (switch_core_session_t *) val;
+			if (switch_core_session_read_lock(session) == SWITCH_STATUS_SUCCESS) {
+				switch_core_session_memory_stats(session, &stats);
+				if (stream) {
+					stream->write_function(stream, "Session %s arena: %" SWITCH_SIZE_T_FMT " bytes, %u allocs, %" SWITCH_SIZE_T_FMT
+										   " reserved, pool: %" SWITCH_SIZE_T_FMT " bytes, %u allocs\n", session->uuid_str,
+										   stats.arena_bytes, stats.arena_allocs, stats.arena_reserved, stats.pool_bytes, stats.pool_allocs);
+				} else {
+					printf("Session %s arena: %" SWITCH_SIZE_T_FMT " bytes, %u allocs, %" SWITCH_SIZE_T_FMT
+						   " reserved, pool: %" SWITCH_SIZE_T_FMT " bytes, %u allocs\n", session->uuid_str,
+						   stats.arena_bytes, stats.arena_allocs, stats.arena_reserved, stats.pool_bytes, stats.pool_allocs);
+				}
+				switch_core_session_rwunlock(session);
+			}
+		}
+	}
+	switch_mutex_unlock(runtime.session_hash_mutex);
+}
+
 SWITCH_DECLARE(switch_size_t) switch_core_session_get_id(switch_core_session_t *session)
 {
 	return session->id;
@@ -54,6 +54,8 @@ struct switch_cache_db_handle {
 	char last_user[CACHE_DB_LEN];
 	uint32_t use_count;
 	uint64_t total_used_count;
+	/* core db statements prepared on this connection, keyed by their sql */
+	switch_hash_t *prepared;
 	struct switch_cache_db_handle *next;
 };
 
@@ -69,6 +71,8 @@ static struct {
 	uint32_t total_used_handles;
 	switch_cache_db_handle_t *dbh;
 	switch_sql_queue_manager_t *qm;
+	switch_sql_queue_manager_t *qm_list;
+	uint32_t channel_insert_stmt;
 	int paused;
 } sql_manager;
 
@@ -259,6 +263,22 @@ SWITCH_DECLARE(switch_status_t) _switch_core_db_handle(switch_cache_db_handle_t
 #define SQL_CACHE_TIMEOUT 30
 #define SQL_REG_TIMEOUT 15
 
+static void cache_db_finalize_prepared(switch_cache_db_handle_t *dbh)
+{
+	switch_hash_index_t *hi;
+	void *val;
+
+	if (!dbh->prepared) {
+		return;
+	}
+
+	for (hi = switch_core_hash_first(dbh->prepared); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		switch_core_db_finalize((switch_core_db_stmt_t *) val);
+	}
+
+	switch_core_hash_destroy(&dbh->prepared);
+}
 
 static void sql_close(time_t prune)
 {
@@ -298,6 +318,7 @@ static void sql_close(time_t prune)
 				break;
 			case SCDB_TYPE_CORE_DB:
 				{
+					cache_db_finalize_prepared(dbh);
 					switch_core_db_close(dbh->native_handle.core_db_dbh->handle);
 					dbh->native_handle.core_db_dbh->handle = NULL;
 				}
@@ -812,6 +833,54 @@ SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_sql(switch_cache_db_hand
 }
 
 
+/* run sql with ? placeholders on a core db handle, it is prepared the first time this handle sees it */
+static switch_status_t cache_db_execute_prepared(switch_cache_db_handle_t *dbh, const char *sql, int argc, char **argv, char **err)
+{
+	switch_core_db_t *db = dbh->native_handle.core_db_dbh->handle;
+	switch_core_db_stmt_t *stmt;
+	int i, ret, tries;
+
+	if (err) {
+		*err = NULL;
+	}
+
+	if (!dbh->prepared) {
+		switch_core_hash_init(&dbh->prepared);
+	}
+
+	for (tries = 0; tries < 2; tries++) {
+		if (!(stmt = switch_core_hash_find(dbh->prepared, sql))) {
+			if (switch_core_db_prepare(db, sql, -1, &stmt, NULL) != SWITCH_CORE_DB_OK || !stmt) {
+				break;
+			}
+
+			switch_core_hash_insert(dbh->prepared, sql, stmt);
+		}
+
+		for (i = 0; i < argc; i++) {
+			switch_core_db_bind_text(stmt, i + 1, argv[i], -1, SWITCH_CORE_DB_STATIC);
+		}
+
+		ret = switch_core_db_step(stmt);
+
+		if (switch_core_db_reset(stmt) == SWITCH_CORE_DB_OK && (ret == SWITCH_CORE_DB_DONE || ret == SWITCH_CORE_DB_ROW)) {
+			return SWITCH_STATUS_SUCCESS;
+		}
+
+		/* the schema may have changed under it, prepare it again once */
+		switch_core_hash_delete(dbh->prepared, sql);
+		switch_core_db_finalize(stmt);
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] NATIVE SQL ERR [%s]\n%s\n", dbh->name, switch_core_db_errmsg(db), sql);
+
+	if (err) {
+		*err = strdup(switch_core_db_errmsg(db));
+	}
+
+	return SWITCH_STATUS_FALSE;
+}
+
 SWITCH_DECLARE(int) switch_cache_db_affected_rows(switch_cache_db_handle_t *dbh)
 {
 	switch (dbh->type) {
@@ -1546,6 +1615,39 @@ static void *SWITCH_THREAD_FUNC switch_core_sql_db_thread(switch_thread_t *threa
 
 static void *SWITCH_THREAD_FUNC switch_user_sql_thread(switch_thread_t *thread, void *obj);
 
+/*
+ * Queue entries are either plain sql text or a statement registered with
+ * switch_sql_queue_manager_add_statement() plus the values for its ? placeholders.
+ * The core db runs those as statements prepared once per handle, other backends get
+ * runs of the same insert from one queue folded into a single multi-row insert.
+ */
+#define SQL_QM_MAX_STMTS 32
+#define SQL_QM_BATCH_MAX 50
+#define SQL_QM_LATENCY_BUCKETS 14
+
+typedef struct {
+	char *sql;
+	/* "insert into t (a,b) values " and "(?,?)" when more rows can be appended */
+	char *head;
+	char *tuple;
+	int params;
+} qm_stmt_t;
+
+typedef struct {
+	char *sql;
+	uint32_t stmt;
+	int argc;
+	char **argv;
+	switch_time_t queued;
+} qm_item_t;
+
+typedef struct {
+	uint64_t written;
+	uint64_t multi_row;
+	/* time from push to commit, bucket n holds waits under 2^n ms, the last one everything longer */
+	uint64_t latency[SQL_QM_LATENCY_BUCKETS];
+} qm_stats_t;
+
 struct switch_sql_queue_manager {
 	const char *name;
 	switch_cache_db_handle_t *event_db;
@@ -1570,8 +1672,146 @@ struct switch_sql_queue_manager {
 	uint32_t confirm;
 	uint8_t paused;
 	int skip_wait;
+	qm_stmt_t stmts[SQL_QM_MAX_STMTS];
+	uint32_t nstmts;
+	qm_stats_t *stats;
+	switch_time_t started;
+	struct switch_sql_queue_manager *next;
 };
 
+static qm_item_t *qm_item_sql(char *sql)
+{
+	qm_item_t *item;
+
+	switch_zmalloc(item, sizeof(*item));
+	item->sql = sql;
+	item->queued = switch_micro_time_now();
+
+	return item;
+}
+
+static void qm_item_free(qm_item_t *item)
+{
+	if (item) {
+		switch_safe_free(item->sql);
+		free(item);
+	}
+}
+
+static qm_stmt_t *qm_item_stmt(switch_sql_queue_manager_t *qm, qm_item_t *item)
+{
+	return item->stmt ? &qm->stmts[item->stmt - 1] : NULL;
+}
+
+static const char *qm_item_text(switch_sql_queue_manager_t *qm, qm_item_t *item)
+{
+	return item->stmt ? qm->stmts[item->stmt - 1].sql : item->sql;
+}
+
+/* write tpl with every ? outside a quoted string swapped for the next value */
+static void qm_render(switch_stream_handle_t *stream, const char *tpl, qm_item_t *item)
+{
+	const char *p, *s = tpl;
+	int quoted = 0, x = 0;
+
+	for (p = tpl; *p; p++) {
+		if (*p == '\'') {
+			quoted = !quoted;
+		} else if (*p == '?' && !quoted) {
+			stream->write_function(stream, "%.*s", (int) (p - s), s);
+
+			if (x < item->argc && item->argv[x]) {
+				stream->write_function(stream, "'%q'", item->argv[x]);
+			} else {
+				stream->write_function(stream, "NULL");
+			}
+
+			x++;
+			s = p + 1;
+		}
+	}
+
+	stream->write_function(stream, "%s", s);
+}
+
+/* the sql sent to backends without prepared statements, a multi-row insert when n > 1 */
+static char *qm_render_items(qm_stmt_t *stmt, qm_item_t **items, uint32_t n)
+{
+	switch_stream_handle_t stream = { 0 };
+	uint32_t x;
+
+	SWITCH_STANDARD_STREAM(stream);
+
+	if (n > 1) {
+		stream.write_function(&stream, "%s", stmt->head);
+
+		for (x = 0; x < n; x++) {
+			if (x) {
+				stream.write_function(&stream, ",");
+			}
+			qm_render(&stream, stmt->tuple, items[x]);
+		}
+	} else {
+		qm_render(&stream, stmt->sql, items[0]);
+	}
+
+	return (char *) stream.data;
+}
+
+static switch_status_t qm_execute(switch_sql_queue_manager_t *qm, switch_cache_db_handle_t *dbh, qm_item_t **items, uint32_t n)
+{
+	qm_stmt_t *stmt = qm_item_stmt(qm, items[0]);
+	switch_status_t status = SWITCH_STATUS_FALSE;
+	char *sql;
+	uint32_t x;
+
+	if (!stmt) {
+		return switch_cache_db_execute_sql(dbh, items[0]->sql, NULL);
+	}
+
+	if (dbh->type == SCDB_TYPE_CORE_DB) {
+		for (x = 0; x < n; x++) {
+			if ((status = cache_db_execute_prepared(dbh, stmt->sql, items[x]->argc, items[x]->argv, NULL)) != SWITCH_STATUS_SUCCESS) {
+				break;
+			}
+		}
+
+		return status;
+	}
+
+	sql = qm_render_items(stmt, items, n);
+	status = switch_cache_db_execute_sql(dbh, sql, NULL);
+	switch_safe_free(sql);
+
+	return status;
+}
+
+static void qm_account(switch_sql_queue_manager_t *qm, uint32_t i, qm_item_t **items, uint32_t n)
+{
+	switch_time_t now = switch_micro_time_now();
+	qm_stats_t *stats = &qm->stats[i];
+	uint32_t x;
+
+	qm->pre_written[i] += n;
+	stats->written += n;
+
+	if (n > 1) {
+		stats->multi_row += n;
+	}
+
+	for (x = 0; x < n; x++) {
+		switch_time_t ms = (now - items[x]->queued) / 1000;
+		int b = 0;
+
+		while (ms > 0 && b < SQL_QM_LATENCY_BUCKETS - 1) {
+			ms >>= 1;
+			b++;
+		}
+
+		stats->latency[b]++;
+	}
+}
+
 static int qm_wake(switch_sql_queue_manager_t *qm)
 {
 	switch_status_t status;
@@ -1749,10 +1989,12 @@ static void do_flush(switch_sql_queue_manager_t *qm, int i, switch_cache_db_hand
 	switch_mutex_lock(qm->mutex);
 	while (switch_queue_trypop(q, &pop) == SWITCH_STATUS_SUCCESS) {
 		if (pop) {
+			qm_item_t *item = (qm_item_t *) pop;
+
 			if (dbh) {
-				switch_cache_db_execute_sql(dbh, (char *) pop, NULL);
+				qm_execute(qm, dbh, &item, 1);
 			}
-			switch_safe_free(pop);
+			qm_item_free(item);
 		}
 	}
 	switch_mutex_unlock(qm->mutex);
@@ -1875,7 +2117,23 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queu
 
 	switch_sql_queue_manager_stop(qm);
 
+	if (sql_manager.dbh_mutex) {
+		switch_sql_queue_manager_t *qp, *last = NULL;
 
+		switch_mutex_lock(sql_manager.dbh_mutex);
+		for (qp = sql_manager.qm_list; qp; qp = qp->next) {
+			if (qp == qm) {
+				if (last) {
+					last->next = qm->next;
+				} else {
+					sql_manager.qm_list = qm->next;
+				}
+				break;
+			}
+			last = qp;
+		}
+		switch_mutex_unlock(sql_manager.dbh_mutex);
+	}
 
 	for(i = 0; i < qm->numq; i++) {
 		do_flush(qm, i, NULL);
@@ -1887,33 +2145,25 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queu
 	return status;
 }
 
-SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup)
+static switch_status_t qm_push(switch_sql_queue_manager_t *qm, qm_item_t *item, uint32_t pos)
 {
-	char *sqlptr = NULL;
 	switch_status_t status;
 	int x = 0;
 
 	if (sql_manager.paused || qm->thread_running != 1) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "DROP [%s]\n", sql);
-		if (!dup) free((char *)sql);
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "DROP [%s]\n", qm_item_text(qm, item));
+		qm_item_free(item);
 		qm_wake(qm);
 		return SWITCH_STATUS_SUCCESS;
 	}
 
-	if (qm->thread_running != 1) {
-		if (!dup) free((char *)sql);
-		return SWITCH_STATUS_FALSE;
-	}
-
 	if (pos > qm->numq - 1) {
 		pos = 0;
 	}
 
-	sqlptr = dup ? strdup(sql) : (char *)sql;
-
 	do {
 		switch_mutex_lock(qm->mutex);
-		status = switch_queue_trypush(qm->sql_queue[pos], sqlptr);
+		status = switch_queue_trypush(qm->sql_queue[pos], item);
 		switch_mutex_unlock(qm->mutex);
 		if (status != SWITCH_STATUS_SUCCESS) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "Delay %d sending sql\n", x);
@@ -1928,6 +2178,149 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_m
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup)
+{
+	return qm_push(qm, qm_item_sql(dup ? strdup(sql) : (char *)sql), pos);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_add_statement(switch_sql_queue_manager_t *qm, const char *sql, uint32_t *stmt_id)
+{
+	qm_stmt_t *stmt;
+	const char *p, *v;
+	int quoted = 0;
+	uint32_t i;
+
+	switch_assert(qm && sql && stmt_id);
+
+	switch_mutex_lock(qm->mutex);
+
+	for (i = 0; i < qm->nstmts; i++) {
+		if (!strcmp(qm->stmts[i].sql, sql)) {
+			*stmt_id = i + 1;
+			switch_mutex_unlock(qm->mutex);
+			return SWITCH_STATUS_SUCCESS;
+		}
+	}
+
+	if (qm->nstmts == SQL_QM_MAX_STMTS) {
+		switch_mutex_unlock(qm->mutex);
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "%s Too many statements, cannot add [%s]\n", qm->name, sql);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	stmt = &qm->stmts[qm->nstmts];
+	stmt->sql = switch_core_strdup(qm->pool, sql);
+
+	for (p = sql; *p; p++) {
+		if (*p == '\'') {
+			quoted = !quoted;
+		} else if (*p == '?' && !quoted) {
+			stmt->params++;
+		}
+	}
+
+	/* only a single trailing values (...) group can be repeated */
+	if (!strncasecmp(sql, "insert into ", 12) && (v = switch_stristr(" values", sql))) {
+		const char *open = v + 7, *close = NULL;
+
+		while (*open == ' ') {
+			open++;
+		}
+
+		if (*open == '(' && (close = strrchr(open, ')')) && !strchr(open + 1, '(')) {
+			const char *e = close + 1;
+
+			while (*e == ' ' || *e == ';') {
+				e++;
+			}
+
+			if (!*e) {
+				stmt->head = switch_core_strndup(qm->pool, sql, open - sql);
+				stmt->tuple = switch_core_strndup(qm->pool, open, close - open + 1);
+			}
+		}
+	}
+
+	*stmt_id = ++qm->nstmts;
+
+	switch_mutex_unlock(qm->mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(char *) switch_sql_queue_manager_render_params(switch_sql_queue_manager_t *qm, uint32_t stmt_id, uint32_t rows, int argc, const char **argv)
+{
+	qm_item_t items[SQL_QM_BATCH_MAX] = { { 0 } };
+	qm_item_t *ptrs[SQL_QM_BATCH_MAX];
+	qm_stmt_t *stmt;
+	uint32_t r;
+
+	if (!stmt_id || stmt_id > qm->nstmts || !rows || rows > SQL_QM_BATCH_MAX) {
+		return NULL;
+	}
+
+	stmt = &qm->stmts[stmt_id - 1];
+
+	if (argc != stmt->params || (rows > 1 && !stmt->head)) {
+		return NULL;
+	}
+
+	for (r = 0; r < rows; r++) {
+		items[r].stmt = stmt_id;
+		items[r].argc = argc;
+		items[r].argv = (char **) argv + r * argc;
+		ptrs[r] = &items[r];
+	}
+
+	return qm_render_items(stmt, ptrs, rows);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_params(switch_sql_queue_manager_t *qm, uint32_t stmt_id, uint32_t pos, int argc, const char **argv)
+{
+	qm_item_t *item;
+	switch_size_t len = sizeof(*item) + sizeof(char *) * argc;
+	char *p;
+	int x;
+
+	if (!stmt_id || stmt_id > qm->nstmts) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "%s Unknown statement %u\n", qm->name, stmt_id);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (argc != qm->stmts[stmt_id - 1].params) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "%s Statement %u takes %d values, got %d\n",
+						  qm->name, stmt_id, qm->stmts[stmt_id - 1].params, argc);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	for (x = 0; x < argc; x++) {
+		if (argv[x]) {
+			len += strlen(argv[x]) + 1;
+		}
+	}
+
+	/* one block for the entry, the value pointers and the values */
+	switch_zmalloc(item, len);
+	item->stmt = stmt_id;
+	item->argc = argc;
+	item->argv = (char **) (item + 1);
+	item->queued = switch_micro_time_now();
+
+	p = (char *) (item->argv + argc);
+
+	for (x = 0; x < argc; x++) {
+		if (argv[x]) {
+			switch_size_t vlen = strlen(argv[x]) + 1;
+
+			memcpy(p, argv[x], vlen);
+			item->argv[x] = p;
+			p += vlen;
+		}
+	}
+
+	return qm_push(qm, item, pos);
+}
+
 
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup)
 {
@@ -1971,7 +2364,7 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql
 
 	switch_mutex_lock(qm->mutex);
 	qm->confirm++;
-	switch_queue_push(qm->sql_queue[pos], dup ? strdup(sql) : (char *)sql);
+	switch_queue_push(qm->sql_queue[pos], qm_item_sql(dup ? strdup(sql) : (char *)sql));
 	written = qm->pre_written[pos];
 	size = switch_sql_queue_manager_size(qm, pos);
 	want = written + size;
@@ -2034,6 +2427,8 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *n
 	qm->sql_queue = switch_core_alloc(qm->pool, sizeof(switch_queue_t *) * numq);
 	qm->written = switch_core_alloc(qm->pool, sizeof(uint32_t) * numq);
 	qm->pre_written = switch_core_alloc(qm->pool, sizeof(uint32_t) * numq);
+	qm->stats = switch_core_alloc(qm->pool, sizeof(qm_stats_t) * numq);
+	qm->started = switch_micro_time_now();
 
 	for (i = 0; i < qm->numq; i++) {
 		switch_queue_create(&qm->sql_queue[i], SWITCH_SQL_QUEUE_LEN, qm->pool);
@@ -2052,6 +2447,13 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *n
 		qm->inner_post_trans_execute = switch_core_strdup(qm->pool, inner_post_trans_execute);
 	}
 
+	if (sql_manager.dbh_mutex) {
+		switch_mutex_lock(sql_manager.dbh_mutex);
+		qm->next = sql_manager.qm_list;
+		sql_manager.qm_list = qm;
+		switch_mutex_unlock(sql_manager.dbh_mutex);
+	}
+
 	*qmp = qm;
 
 	return SWITCH_STATUS_SUCCESS;
@@ -2064,8 +2466,11 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 	void *pop;
 	switch_status_t status;
 	uint32_t ttl = 0;
-	uint32_t i;
+	uint32_t i = 0;
 	switch_status_t res;
+	qm_item_t *batch[SQL_QM_BATCH_MAX];
+	qm_item_t *next = NULL;
+	uint32_t n, x;
 
 	if (!zstr(qm->pre_trans_execute)) {
 		switch_cache_db_execute_sql_real(qm->event_db, qm->pre_trans_execute, &errmsg);
@@ -2122,32 +2527,94 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 	}
 
 
-	while(qm->max_trans == 0 || ttl <= qm->max_trans) {
+	while(next || qm->max_trans == 0 || ttl <= qm->max_trans) {
+		qm_stmt_t *stmt;
+
 		pop = NULL;
 
-		for (i = 0; (qm->max_trans == 0 || ttl <= qm->max_trans) && (i < qm->numq); i++) {
-			switch_mutex_lock(qm->mutex);
-			res = switch_queue_trypop(qm->sql_queue[i], &pop);
-			(void)res;
-			switch_mutex_unlock(qm->mutex);
-			if (pop) break;
+		if (next) {
+			/* left over from the last batch, it came off queue i */
+			pop = next;
+			next = NULL;
+		} else {
+			for (i = 0; (qm->max_trans == 0 || ttl <= qm->max_trans) && (i < qm->numq); i++) {
+				switch_mutex_lock(qm->mutex);
+				res = switch_queue_trypop(qm->sql_queue[i], &pop);
+				(void)res;
+				switch_mutex_unlock(qm->mutex);
+				if (pop) break;
+			}
 		}
 
-		if (pop) {
-			if ((status = switch_cache_db_execute_sql(qm->event_db, (char *) pop, NULL)) == SWITCH_STATUS_SUCCESS) {
+		if (!pop) {
+			break;
+		}
+
+		n = 0;
+		batch[n++] = (qm_item_t *) pop;
+		stmt = qm_item_stmt(qm, batch[0]);
+
+		if (stmt && stmt->head && qm->event_db->type != SCDB_TYPE_CORE_DB) {
+			while (n < SQL_QM_BATCH_MAX && (qm->max_trans == 0 || ttl + n <= qm->max_trans)) {
+				pop = NULL;
 				switch_mutex_lock(qm->mutex);
-				qm->pre_written[i]++;
+				res = switch_queue_trypop(qm->sql_queue[i], &pop);
 				switch_mutex_unlock(qm->mutex);
-				ttl++;
+
+				if (!pop) {
+					break;
+				}
+
+				if (((qm_item_t *) pop)->stmt != batch[0]->stmt) {
+					next = (qm_item_t *) pop;
+					break;
+				}
+
+				batch[n++] = (qm_item_t *) pop;
 			}
+		}
 
-			switch_safe_free(pop);
-			if (status != SWITCH_STATUS_SUCCESS) break;
-		} else {
+		if ((status = qm_execute(qm, qm->event_db, batch, n)) == SWITCH_STATUS_SUCCESS) {
+			switch_mutex_lock(qm->mutex);
+			qm_account(qm, i, batch, n);
+			switch_mutex_unlock(qm->mutex);
+			ttl += n;
+		} else if (n > 1) {
+			/* one bad row fails the whole insert, retry the rows one at a time so only the bad ones are lost */
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "%s multi-row insert of %u rows failed, retrying them one at a time\n", qm->name, n);
+			status = SWITCH_STATUS_SUCCESS;
+
+			for (x = 0; x < n; x++) {
+				if (qm_execute(qm, qm->event_db, &batch[x], 1) == SWITCH_STATUS_SUCCESS) {
+					switch_mutex_lock(qm->mutex);
+					qm_account(qm, i, &batch[x], 1);
+					switch_mutex_unlock(qm->mutex);
+					ttl++;
+				} else {
+					status = SWITCH_STATUS_FALSE;
+				}
+			}
+		}
+
+		for (x = 0; x < n; x++) {
+			qm_item_free(batch[x]);
+		}
+
+		if (status != SWITCH_STATUS_SUCCESS) {
 			break;
 		}
 	}
 
+	if (next) {
+		if (qm_execute(qm, qm->event_db, &next, 1) == SWITCH_STATUS_SUCCESS) {
+			switch_mutex_lock(qm->mutex);
+			qm_account(qm, i, &next, 1);
+			switch_mutex_unlock(qm->mutex);
+			ttl++;
+		}
+		qm_item_free(next);
+	}
+
 	if (!zstr(qm->inner_post_trans_execute)) {
 		switch_cache_db_execute_sql_real(qm->event_db, qm->inner_post_trans_execute, &errmsg);
 		if (errmsg) {
@@ -2380,6 +2847,31 @@ static void core_event_handler(switch_event_t *event)
 
 	switch_assert(event);
 
+	if (!runtime.core_db_channels) {
+		/* the channel registry answers for these, only mirror them when asked to */
+		switch (event->event_id) {
+		case SWITCH_EVENT_CHANNEL_DESTROY:
+		case SWITCH_EVENT_CHANNEL_UUID:
+		case SWITCH_EVENT_CHANNEL_CREATE:
+		case SWITCH_EVENT_CHANNEL_ANSWER:
+		case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
+		case SWITCH_EVENT_CODEC:
+		case SWITCH_EVENT_CHANNEL_HOLD:
+		case SWITCH_EVENT_CHANNEL_UNHOLD:
+		case SWITCH_EVENT_CHANNEL_EXECUTE:
+		case SWITCH_EVENT_CHANNEL_ORIGINATE:
+		case SWITCH_EVENT_CALL_UPDATE:
+		case SWITCH_EVENT_CHANNEL_CALLSTATE:
+		case SWITCH_EVENT_CHANNEL_STATE:
+		case SWITCH_EVENT_CHANNEL_BRIDGE:
+		case SWITCH_EVENT_CHANNEL_UNBRIDGE:
+		case SWITCH_EVENT_CALL_SECURE:
+			return;
+		default:
+			break;
+		}
+	}
+
 	switch (event->event_id) {
 	case SWITCH_EVENT_CHANNEL_UUID:
 	case SWITCH_EVENT_CHANNEL_CREATE:
@@ -2474,24 +2966,31 @@ static void core_event_handler(switch_event_t *event)
 			break;
 		}
 	case SWITCH_EVENT_CHANNEL_CREATE:
-		new_sql() = switch_mprintf("insert into channels (uuid,direction,created,created_epoch, name,state,callstate,dialplan,context,hostname,initial_cid_name,initial_cid_num,initial_ip_addr,initial_dest,initial_dialplan,initial_context) "
-								   "values('%q','%q','%q','%ld','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q')",
-								   switch_event_get_header_nil(event, "unique-id"),
-								   switch_event_get_header_nil(event, "call-direction"),
-								   switch_event_get_header_nil(event, "event-date-local"),
-								   (long) switch_epoch_time_now(NULL),
-								   switch_event_get_header_nil(event, "channel-name"),
-								   switch_event_get_header_nil(event, "channel-state"),
-								   switch_event_get_header_nil(event, "channel-call-state"),
-								   switch_event_get_header_nil(event, "caller-dialplan"),
-								   switch_event_get_header_nil(event, "caller-context"), switch_core_get_switchname(),
-								   switch_event_get_header_nil(event, "caller-caller-id-name"),
-								   switch_event_get_header_nil(event, "caller-caller-id-number"),
-								   switch_event_get_header_nil(event, "caller-network-addr"),
-								   switch_event_get_header_nil(event, "caller-destination-number"),
-								   switch_event_get_header_nil(event, "caller-dialplan"),
-								   switch_event_get_header_nil(event, "caller-context")
-								   );
+		if (exists) {
+			char epoch[32];
+			const char *vals[16];
+
+			switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+
+			vals[0] = switch_event_get_header_nil(event, "unique-id");
+			vals[1] = switch_event_get_header_nil(event, "call-direction");
+			vals[2] = switch_event_get_header_nil(event, "event-date-local");
+			vals[3] = epoch;
+			vals[4] = switch_event_get_header_nil(event, "channel-name");
+			vals[5] = switch_event_get_header_nil(event, "channel-state");
+			vals[6] = switch_event_get_header_nil(event, "channel-call-state");
+			vals[7] = switch_event_get_header_nil(event, "caller-dialplan");
+			vals[8] = switch_event_get_header_nil(event, "caller-context");
+			vals[9] = switch_core_get_switchname();
+			vals[10] = switch_event_get_header_nil(event, "caller-caller-id-name");
+			vals[11] = switch_event_get_header_nil(event, "caller-caller-id-number");
+			vals[12] = switch_event_get_header_nil(event, "caller-network-addr");
+			vals[13] = switch_event_get_header_nil(event, "caller-destination-number");
+			vals[14] = switch_event_get_header_nil(event, "caller-dialplan");
+			vals[15] = switch_event_get_header_nil(event, "caller-context");
+
+			switch_sql_queue_manager_push_params(sql_manager.qm, sql_manager.channel_insert_stmt, 0, 16, vals);
+		}
 		break;
 	case SWITCH_EVENT_CHANNEL_ANSWER:
 	case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
@@ -3907,6 +4406,12 @@ static void switch_core_sqldb_start_thread(void)
 											   runtime.core_db_inner_pre_trans_execute,
 											   runtime.core_db_inner_post_trans_execute);
 
+			switch_sql_queue_manager_add_statement(sql_manager.qm,
+												   "insert into channels (uuid,direction,created,created_epoch,name,state,callstate,dialplan,context,hostname,"
+												   "initial_cid_name,initial_cid_num,initial_ip_addr,initial_dest,initial_dialplan,initial_context) "
+												   "values (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)",
+												   &sql_manager.channel_insert_stmt);
+
 		}
 		switch_sql_queue_manager_start(sql_manager.qm);
 	} else {
@@ -3942,6 +4447,7 @@ SWITCH_DECLARE(void) switch_cache_db_status(switch_stream_handle_t *stream)
 	char *pos1 = NULL;
 	char *pos2 = NULL;
 	int count = 0, used = 0;
+	switch_sql_queue_manager_t *qm;
 
 	switch_mutex_lock(sql_manager.dbh_mutex);
 
@@ -4003,6 +4509,45 @@ SWITCH_DECLARE(void) switch_cache_db_status(switch_stream_handle_t *stream)
 
 	stream->write_function(stream, "%d total. %d in use.\n", count, used);
 
+	for (qm = sql_manager.qm_list; qm; qm = qm->next) {
+		switch_time_t secs = (switch_micro_time_now() - qm->started) / 1000000;
+		uint32_t q;
+
+		if (secs < 1) {
+			secs = 1;
+		}
+
+		stream->write_function(stream, "\nSQL queue %s (%s)\n", qm->name,
+							   qm->event_db ? switch_cache_db_type_name(qm->event_db->type) : "Not connected");
+
+		for (q = 0; q < qm->numq; q++) {
+			qm_stats_t stats;
+			int pending, b;
+
+			switch_mutex_lock(qm->mutex);
+			stats = qm->stats[q];
+			pending = switch_queue_size(qm->sql_queue[q]);
+			switch_mutex_unlock(qm->mutex);
+
+			stream->write_function(stream, "\tQueue %u: Pending: %d Written: %" SWITCH_UINT64_T_FMT " (%.1f/s) Multi-row: %" SWITCH_UINT64_T_FMT "\n\t\tLatency:",
+								   q, pending, stats.written, (double) stats.written / secs, stats.multi_row);
+
+			for (b = 0; b < SQL_QM_LATENCY_BUCKETS; b++) {
+				if (!stats.latency[b]) {
+					continue;
+				}
+
+				if (b < SQL_QM_LATENCY_BUCKETS - 1) {
+					stream->write_function(stream, " <%dms: %" SWITCH_UINT64_T_FMT, 1 << b, stats.latency[b]);
+				} else {
+					stream->write_function(stream, " >=%dms: %" SWITCH_UINT64_T_FMT, 1 << (b - 1), stats.latency[b]);
+				}
+			}
+
+			stream->write_function(stream, "\n");
+		}
+	}
+
 	switch_mutex_unlock(sql_manager.dbh_mutex);
 }
 
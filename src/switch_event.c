@@ -44,6 +44,31 @@
 #define DISPATCH_QUEUE_LEN 10000
 //#define DEBUG_DISPATCH_QUEUES
 
+#define EVENT_SUBSCRIBER_QUEUE_LEN 10000
+
+/*! \brief A queue and a thread of its own for a binding made with SEBF_QUEUED */
+typedef struct switch_event_subscriber {
+	switch_memory_pool_t *pool;
+	switch_queue_t *queue;
+	switch_thread_t *thread;
+	switch_event_callback_t callback;
+	void *user_data;
+	switch_event_bind_flag_t flags;
+	uint32_t queue_len;
+	volatile int running;
+	switch_atomic_t delivered;
+	switch_atomic_t dropped;
+	/*! time between the event being fired and reaching the callback, in microseconds */
+	switch_time_t last_lag;
+	switch_time_t max_lag;
+} switch_event_subscriber_t;
+
+typedef enum {
+	EVENT_ROUTE_FILTER_NONE,
+	EVENT_ROUTE_FILTER_FILE,
+	EVENT_ROUTE_FILTER_FUNC
+} switch_event_route_filter_t;
+
 /*! \brief A node to store binded events */
 struct switch_event_node {
 	/*! the id of the node */
@@ -56,7 +81,14 @@ struct switch_event_node {
 	switch_event_callback_t callback;
 	/*! private data */
 	void *user_data;
+	/*! the queue and worker of a SEBF_QUEUED binding */
+	switch_event_subscriber_t *subscriber;
+	/*! the file: or func: filter of the subclass_name, if any */
+	switch_event_route_filter_t filter;
+	const char *filter_value;
 	struct switch_event_node *next;
+	/*! next node on the same routing chain, see event_route_rebuild() */
+	struct switch_event_node *route_next;
 };
 
 /*! \brief A registered custom event subclass  */
@@ -85,6 +117,18 @@ static unsigned int SOFT_MAX_DISPATCH = 0;
 static char guess_ip_v4[80] = "";
 static char guess_ip_v6[80] = "";
 static switch_event_node_t *EVENT_NODES[SWITCH_EVENT_ALL + 1] = { NULL };
+
+/*! \brief The bindings of one event id split up by what they need to be matched against */
+typedef struct {
+	/*! bindings without a subclass, they get every event of the id */
+	switch_event_node_t *any;
+	/*! bindings on a file: or func: header filter */
+	switch_event_node_t *filtered;
+	/*! bindings on an exact subclass, keyed by subclass name */
+	switch_hash_t *subclass;
+} switch_event_route_t;
+
+static switch_event_route_t EVENT_ROUTES[SWITCH_EVENT_ALL + 1] = { { 0 } };
 static switch_thread_rwlock_t *RWLOCK = NULL;
 static switch_mutex_t *BLOCK = NULL;
 static switch_mutex_t *POOL_LOCK = NULL;
@@ -131,6 +175,264 @@ static char *my_dup(const char *s)
 
 static void free_header(switch_event_header_t **header);
 
+/* Headers are kept in a list, in insertion order, for serialization.  Once an
+   event carries this many headers an open addressing (linear probing) index
+   keyed on the header hash is built next to the list and kept in sync by the
+   add/del/rename paths.  It is only ever built on the write side so readers
+   sharing an event under a read lock never modify it. */
+#define EVENT_INDEX_MIN_HEADERS 16
+#define EVENT_INDEX_MIN_SIZE 64
+
+static switch_event_header_t **event_index_slot(switch_event_t *event, const char *header_name, unsigned long hash)
+{
+	uint32_t mask = event->header_index_size - 1;
+	uint32_t i = (uint32_t) hash & mask;
+	switch_event_header_t *hp;
+
+	while ((hp = event->header_index[i])) {
+		if (hp->hash == hash && !strcasecmp(hp->name, header_name)) {
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+
+	return &event->header_index[i];
+}
+
+static void event_index_build(switch_event_t *event, uint32_t size)
+{
+	switch_event_header_t *hp, **slot;
+
+	FREE(event->header_index);
+	event->header_index = calloc(size, sizeof(*event->header_index));
+	switch_assert(event->header_index);
+	event->header_index_size = size;
+	event->header_index_used = 0;
+
+	/* the first header with a given name wins, like a list walk */
+	for (hp = event->headers; hp; hp = hp->next) {
+		slot = event_index_slot(event, hp->name, hp->hash);
+		if (!*slot) {
+			*slot = hp;
+			event->header_index_used++;
+		}
+	}
+}
+
+static void event_index_insert(switch_event_t *event, switch_event_header_t *header, switch_bool_t replace)
+{
+	switch_event_header_t **slot;
+
+	if (!event->header_index) {
+		if (event->header_count >= EVENT_INDEX_MIN_HEADERS) {
+			event_index_build(event, EVENT_INDEX_MIN_SIZE);
+		}
+		return;
+	}
+
+	slot = event_index_slot(event, header->name, header->hash);
+
+	if (*slot) {
+		if (replace) {
+			*slot = header;
+		}
+		return;
+	}
+
+	*slot = header;
+
+	if (++event->header_index_used * 2 > event->header_index_size) {
+		event_index_build(event, event->header_index_size * 2);
+	}
+}
+
+static void event_index_remove(switch_event_t *event, switch_event_header_t *header)
+{
+	uint32_t mask, i, j, k;
+	switch_event_header_t **slot;
+
+	if (!event->header_index) {
+		return;
+	}
+
+	slot = event_index_slot(event, header->name, header->hash);
+
+	if (*slot != header) {
+		return;
+	}
+
+	/* backward shift deletion, keeps the probe chains intact without tombstones */
+	mask = event->header_index_size - 1;
+	i = (uint32_t) (slot - event->header_index);
+	j = i;
+
+	for (;;) {
+		j = (j + 1) & mask;
+		if (!event->header_index[j]) {
+			break;
+		}
+		k = (uint32_t) event->header_index[j]->hash & mask;
+		if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+			event->header_index[i] = event->header_index[j];
+			i = j;
+		}
+	}
+
+	event->header_index[i] = NULL;
+	event->header_index_used--;
+}
+
+/* point the index at the first remaining header called header_name, if any */
+static void event_index_refresh(switch_event_t *event, const char *header_name, unsigned long hash)
+{
+	switch_event_header_t *hp, **slot;
+
+	if (!event->header_index) {
+		return;
+	}
+
+	slot = event_index_slot(event, header_name, hash);
+
+	if (*slot) {
+		event_index_remove(event, *slot);
+	}
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		if (hp->hash == hash && !strcasecmp(hp->name, header_name)) {
+			event_index_insert(event, hp, SWITCH_FALSE);
+			break;
+		}
+	}
+}
+
+/*! \brief State shared by every handle of a referenced event */
+struct switch_event_share {
+	switch_atomic_t refs;
+	/*! serialized forms, built on first use and published with a compare and swap */
+	char *serialized[SWITCH_EVENT_FORMAT_MAX];
+};
+
+static void free_event_share(struct switch_event_share **sharep)
+{
+	struct switch_event_share *share = *sharep;
+	int i;
+
+	for (i = 0; i < SWITCH_EVENT_FORMAT_MAX; i++) {
+		FREE(share->serialized[i]);
+	}
+	FREE(share);
+	*sharep = NULL;
+}
+
+static struct switch_event_share *new_event_share(void)
+{
+	struct switch_event_share *share;
+
+	switch_zmalloc(share, sizeof(*share));
+	switch_atomic_set(&share->refs, 1);
+
+	return share;
+}
+
+/* rough size of the headers and body, used to size the serializer buffers up front */
+static switch_size_t event_size_hint(switch_event_t *event, switch_size_t per_header)
+{
+	switch_event_header_t *hp;
+	switch_size_t len = 0;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		len += strlen(hp->name) + strlen(hp->value) + per_header;
+	}
+
+	if (event->body) {
+		len += strlen(event->body) + per_header;
+	}
+
+	return len;
+}
+
+static void free_event_payload(switch_event_t *event)
+{
+	switch_event_header_t *hp, *this;
+
+	for (hp = event->headers; hp;) {
+		this = hp;
+		hp = hp->next;
+		free_header(&this);
+	}
+	FREE(event->body);
+	FREE(event->subclass_name);
+	FREE(event->header_index);
+}
+
+static switch_event_header_t *new_header(const char *header_name);
+
+SWITCH_DECLARE(void) switch_event_unshare(switch_event_t *event)
+{
+	struct switch_event_share *share = event->share;
+	switch_event_t old;
+	switch_event_header_t *hp, *header;
+	uint32_t size = EVENT_INDEX_MIN_SIZE;
+
+	if (!share) {
+		return;
+	}
+
+	event->share = NULL;
+
+	if (switch_atomic_read(&share->refs) == 1) {
+		/* every other handle is gone already, only the cached forms are stale */
+		free_event_share(&share);
+		return;
+	}
+
+	old = *event;
+	event->headers = event->last_header = NULL;
+	event->header_count = 0;
+	event->header_index = NULL;
+	event->header_index_size = event->header_index_used = 0;
+	event->body = old.body ? DUP(old.body) : NULL;
+	event->subclass_name = old.subclass_name ? DUP(old.subclass_name) : NULL;
+
+	for (hp = old.headers; hp; hp = hp->next) {
+		header = new_header(hp->name);
+		header->hash = hp->hash;
+		header->value = hp->value ? DUP(hp->value) : NULL;
+
+		if (hp->idx) {
+			int i;
+
+			header->array = ALLOC(sizeof(char *) * hp->idx);
+			switch_assert(header->array);
+			for (i = 0; i < hp->idx; i++) {
+				header->array[i] = hp->array[i] ? DUP(hp->array[i]) : NULL;
+			}
+			header->idx = hp->idx;
+		}
+
+		if (event->last_header) {
+			event->last_header->next = header;
+		} else {
+			event->headers = header;
+		}
+		event->last_header = header;
+		event->header_count++;
+	}
+
+	if (event->header_count >= EVENT_INDEX_MIN_HEADERS) {
+		while (size < event->header_count * 2) {
+			size <<= 1;
+		}
+		event_index_build(event, size);
+	}
+
+	if (!switch_atomic_dec(&share->refs)) {
+		/* the other handles went away while we were copying */
+		free_event_payload(&old);
+		free_event_share(&share);
+	}
+}
+
 /* make sure this is synced with the switch_event_types_t enum in switch_types.h
    also never put any new ones before EVENT_ALL
 */
@@ -230,44 +532,79 @@ static char *EVENT_NAMES[] = {
 	"ALL"
 };
 
-static int switch_events_match(switch_event_t *event, switch_event_node_t *node)
+static void event_node_parse_filter(switch_event_node_t *node)
 {
-	int match = 0;
+	node->filter = EVENT_ROUTE_FILTER_NONE;
+	node->filter_value = NULL;
 
-	if (node->event_id == SWITCH_EVENT_ALL) {
-		match++;
+	if (!node->subclass_name) {
+		return;
+	}
 
-		if (!node->subclass_name) {
-			return match;
-		}
+	if (!strncasecmp(node->subclass_name, "file:", 5)) {
+		node->filter = EVENT_ROUTE_FILTER_FILE;
+		node->filter_value = node->subclass_name + 5;
+	} else if (!strncasecmp(node->subclass_name, "func:", 5)) {
+		node->filter = EVENT_ROUTE_FILTER_FUNC;
+		node->filter_value = node->subclass_name + 5;
 	}
+}
 
-	if (match || event->event_id == node->event_id) {
+static int event_node_filter_match(switch_event_t *event, switch_event_node_t *node)
+{
+	const char *val = switch_event_get_header(event, node->filter == EVENT_ROUTE_FILTER_FILE ? "file" : "function");
 
-		if (event->subclass_name && node->subclass_name) {
-			if (!strncasecmp(node->subclass_name, "file:", 5)) {
-				char *file_header;
-				if ((file_header = switch_event_get_header(event, "file")) != 0) {
-					match = !strcmp(node->subclass_name + 5, file_header) ? 1 : 0;
-				}
-			} else if (!strncasecmp(node->subclass_name, "func:", 5)) {
-				char *func_header;
-				if ((func_header = switch_event_get_header(event, "function")) != 0) {
-					match = !strcmp(node->subclass_name + 5, func_header) ? 1 : 0;
-				}
-			} else if (event->subclass_name && node->subclass_name) {
-				match = !strcmp(event->subclass_name, node->subclass_name) ? 1 : 0;
-			}
-		} else if ((event->subclass_name && !node->subclass_name) || (!event->subclass_name && !node->subclass_name)) {
-			match = 1;
-		} else {
-			match = 0;
-		}
+	if (!val) {
+		/* an ALL binding was already a match before the filter was looked at */
+		return node->event_id == SWITCH_EVENT_ALL;
 	}
 
-	return match;
+	return !strcmp(node->filter_value, val);
 }
 
+static void event_route_append(switch_event_node_t **head, switch_event_node_t *node)
+{
+	switch_event_node_t **np;
+
+	for (np = head; *np; np = &(*np)->route_next);
+	*np = node;
+}
+
+/* must be called with RWLOCK write locked */
+static void event_route_rebuild(switch_event_types_t id)
+{
+	switch_event_route_t *route = &EVENT_ROUTES[id];
+	switch_event_node_t *np;
+
+	route->any = NULL;
+	route->filtered = NULL;
+
+	if (route->subclass) {
+		switch_core_hash_destroy(&route->subclass);
+	}
+
+	for (np = EVENT_NODES[id]; np; np = np->next) {
+		np->route_next = NULL;
+
+		if (!np->subclass_name) {
+			event_route_append(&route->any, np);
+		} else if (np->filter != EVENT_ROUTE_FILTER_NONE) {
+			event_route_append(&route->filtered, np);
+		} else {
+			switch_event_node_t *head;
+
+			if (!route->subclass) {
+				switch_core_hash_init(&route->subclass);
+			}
+
+			if ((head = switch_core_hash_find(route->subclass, np->subclass_name))) {
+				event_route_append(&head, np);
+			} else {
+				switch_core_hash_insert(route->subclass, np->subclass_name, np);
+			}
+		}
+	}
+}
 
 static void *SWITCH_THREAD_FUNC switch_event_deliver_thread(switch_thread_t *thread, void *obj)
 {
@@ -397,6 +734,136 @@ static switch_status_t switch_event_queue_dispatch_event(switch_event_t **eventp
 	return SWITCH_STATUS_SUCCESS;
 }
 
+static void *SWITCH_THREAD_FUNC switch_event_subscriber_thread(switch_thread_t *thread, void *obj)
+{
+	switch_event_subscriber_t *sub = (switch_event_subscriber_t *) obj;
+
+	while (sub->running) {
+		void *pop = NULL;
+		switch_event_t *event;
+		const char *ts;
+
+		if (switch_queue_pop_timeout(sub->queue, &pop, 500000) != SWITCH_STATUS_SUCCESS || !pop) {
+			continue;
+		}
+
+		event = (switch_event_t *) pop;
+
+		if ((ts = switch_event_get_header(event, "Event-Date-Timestamp"))) {
+			switch_time_t lag = switch_micro_time_now() - (switch_time_t) atoll(ts);
+
+			sub->last_lag = lag > 0 ? lag : 0;
+			if (sub->last_lag > sub->max_lag) {
+				sub->max_lag = sub->last_lag;
+			}
+		}
+
+		event->bind_user_data = sub->user_data;
+		sub->callback(event);
+		switch_atomic_inc(&sub->delivered);
+		switch_event_destroy(&event);
+	}
+
+	return NULL;
+}
+
+static switch_event_subscriber_t *switch_event_subscriber_create(switch_event_callback_t callback, void *user_data,
+																	switch_event_bind_flag_t flags, uint32_t queue_len)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_event_subscriber_t *sub;
+	switch_threadattr_t *thd_attr;
+
+	switch_core_new_memory_pool(&pool);
+	sub = switch_core_alloc(pool, sizeof(*sub));
+	sub->pool = pool;
+	sub->callback = callback;
+	sub->user_data = user_data;
+	sub->flags = flags;
+	sub->queue_len = queue_len ? queue_len : EVENT_SUBSCRIBER_QUEUE_LEN;
+	sub->running = 1;
+	switch_queue_create(&sub->queue, sub->queue_len, pool);
+
+	switch_threadattr_create(&thd_attr, pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+	if (switch_thread_create(&sub->thread, thd_attr, switch_event_subscriber_thread, sub, pool) != SWITCH_STATUS_SUCCESS) {
+		switch_core_destroy_memory_pool(&pool);
+		return NULL;
+	}
+
+	return sub;
+}
+
+static void switch_event_subscriber_destroy(switch_event_subscriber_t **subp)
+{
+	switch_event_subscriber_t *sub = *subp;
+	switch_memory_pool_t *pool;
+	switch_status_t st;
+	void *pop = NULL;
+
+	if (!sub) {
+		return;
+	}
+
+	*subp = NULL;
+	sub->running = 0;
+	switch_queue_trypush(sub->queue, NULL);
+	switch_thread_join(&st, sub->thread);
+
+	while (switch_queue_trypop(sub->queue, &pop) == SWITCH_STATUS_SUCCESS) {
+		switch_event_t *event = (switch_event_t *) pop;
+
+		if (event) {
+			switch_event_destroy(&event);
+		}
+	}
+
+	pool = sub->pool;
+	switch_core_destroy_memory_pool(&pool);
+}
+
+static void switch_event_subscriber_push(switch_event_subscriber_t *sub, switch_event_t *event)
+{
+	switch_event_t *clone = NULL;
+
+	/* don't bother referencing an event that is going to be dropped */
+	if (!(sub->flags & SEBF_BLOCK) && switch_queue_size(sub->queue) >= sub->queue_len) {
+		switch_atomic_inc(&sub->dropped);
+		return;
+	}
+
+	clone = switch_event_ref(event);
+
+	if ((sub->flags & SEBF_BLOCK)) {
+		switch_queue_push(sub->queue, clone);
+	} else if (switch_queue_trypush(sub->queue, clone) != SWITCH_STATUS_SUCCESS) {
+		switch_atomic_inc(&sub->dropped);
+		switch_event_unref(&clone);
+	}
+}
+
+static void free_event_node(switch_event_node_t **node)
+{
+	switch_event_node_t *n = *node;
+
+	switch_event_subscriber_destroy(&n->subscriber);
+	FREE(n->subclass_name);
+	FREE(n->id);
+	FREE(n);
+	*node = NULL;
+}
+
+static inline void event_route_call(switch_event_t *event, switch_event_node_t *node)
+{
+	if (node->subscriber) {
+		switch_event_subscriber_push(node->subscriber, event);
+		return;
+	}
+
+	event->bind_user_data = node->user_data;
+	node->callback(event);
+}
+
 SWITCH_DECLARE(void) switch_event_deliver(switch_event_t **event)
 {
 	switch_event_types_t e;
@@ -405,10 +872,23 @@ SWITCH_DECLARE(void) switch_event_deliver(switch_event_t **event)
 	if (SYSTEM_RUNNING) {
 		switch_thread_rwlock_rdlock(RWLOCK);
 		for (e = (*event)->event_id;; e = SWITCH_EVENT_ALL) {
-			for (node = EVENT_NODES[e]; node; node = node->next) {
-				if (switch_events_match(*event, node)) {
-					(*event)->bind_user_data = node->user_data;
-					node->callback(*event);
+			switch_event_route_t *route = &EVENT_ROUTES[e];
+
+			for (node = route->any; node; node = node->route_next) {
+				event_route_call(*event, node);
+			}
+
+			if ((*event)->subclass_name) {
+				if (route->subclass) {
+					for (node = switch_core_hash_find(route->subclass, (*event)->subclass_name); node; node = node->route_next) {
+						event_route_call(*event, node);
+					}
+				}
+
+				for (node = route->filtered; node; node = node->route_next) {
+					if (event_node_filter_match(*event, node)) {
+						event_route_call(*event, node);
+					}
 				}
 			}
 
@@ -626,6 +1106,13 @@ SWITCH_DECLARE(switch_status_t) switch_event_shutdown(void)
 	switch_core_hash_destroy(&event_channel_manager.perm_hash);
 
 	switch_core_hash_destroy(&CUSTOM_HASH);
+
+	for (x = 0; x <= SWITCH_EVENT_ALL; x++) {
+		if (EVENT_ROUTES[x].subclass) {
+			switch_core_hash_destroy(&EVENT_ROUTES[x].subclass);
+		}
+	}
+
 	switch_core_memory_reclaim_events();
 
 	return SWITCH_STATUS_SUCCESS;
@@ -806,10 +1293,12 @@ SWITCH_DECLARE(switch_status_t) switch_event_rename_header(switch_event_t *event
 		return SWITCH_STATUS_FALSE;
 	}
 
+	switch_event_unshare(event);
 	hash = switch_ci_hashfunc_default(header_name, &hlen);
 
 	for (hp = event->headers; hp; hp = hp->next) {
 		if ((!hp->hash || hash == hp->hash) && !strcasecmp(hp->name, header_name)) {
+			event_index_remove(event, hp);
 			FREE(hp->name);
 			hp->name = DUP(new_header_name);
 			hlen = -1;
@@ -818,6 +1307,11 @@ SWITCH_DECLARE(switch_status_t) switch_event_rename_header(switch_event_t *event
 		}
 	}
 
+	if (x) {
+		hlen = -1;
+		event_index_refresh(event, new_header_name, switch_ci_hashfunc_default(new_header_name, &hlen));
+	}
+
 	return x ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
 }
 
@@ -835,6 +1329,10 @@ SWITCH_DECLARE(switch_event_header_t *) switch_event_get_header_ptr(switch_event
 
 	hash = switch_ci_hashfunc_default(header_name, &hlen);
 
+	if (event->header_index) {
+		return *event_index_slot(event, header_name, hash);
+	}
+
 	for (hp = event->headers; hp; hp = hp->next) {
 		if ((!hp->hash || hash == hp->hash) && !strcasecmp(hp->name, header_name)) {
 			return hp;
@@ -877,6 +1375,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *even
 	switch_ssize_t hlen = -1;
 	unsigned long hash = 0;
 
+	switch_event_unshare(event);
 	tp = event->headers;
 	hash = switch_ci_hashfunc_default(header_name, &hlen);
 	while (tp) {
@@ -895,6 +1394,8 @@ SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *even
 			if (hp == event->last_header || !hp->next) {
 				event->last_header = lp;
 			}
+			event_index_remove(event, hp);
+			event->header_count--;
 			free_header(&hp);
 			status = SWITCH_STATUS_SUCCESS;
 		} else {
@@ -902,6 +1403,11 @@ SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *even
 		}
 	}
 
+	if (status == SWITCH_STATUS_SUCCESS && !zstr(val)) {
+		/* only some of the values went away, a later header may be the first one now */
+		event_index_refresh(event, header_name, hash);
+	}
+
 	return status;
 }
 
@@ -1011,6 +1517,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 	int index = 0;
 	char *real_header_name = NULL;
 
+	switch_event_unshare(event);
 
 	if (!strcmp(header_name, "_body")) {
 		switch_event_set_body(event, data);
@@ -1198,6 +1705,9 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 			}
 			event->last_header = header;
 		}
+
+		event->header_count++;
+		event_index_insert(event, header, (stack & SWITCH_STACK_TOP) ? SWITCH_TRUE : SWITCH_FALSE);
 	}
 
  end:
@@ -1229,6 +1739,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_set_subclass_name(switch_event_t *e
 	if (!event || !subclass_name)
 		return SWITCH_STATUS_GENERR;
 
+	switch_event_unshare(event);
 	switch_safe_free(event->subclass_name);
 	event->subclass_name = DUP(subclass_name);
 	switch_event_del_header(event, "Event-Subclass");
@@ -1254,6 +1765,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_add_header_string(switch_event_t *e
 
 SWITCH_DECLARE(switch_status_t) switch_event_set_body(switch_event_t *event, const char *body)
 {
+	switch_event_unshare(event);
 	switch_safe_free(event->body);
 
 	if (body) {
@@ -1277,6 +1789,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_add_body(switch_event_t *event, con
 		if (ret == -1) {
 			return SWITCH_STATUS_GENERR;
 		} else {
+			switch_event_unshare(event);
 			switch_safe_free(event->body);
 			event->body = data;
 			return SWITCH_STATUS_SUCCESS;
@@ -1289,16 +1802,19 @@ SWITCH_DECLARE(switch_status_t) switch_event_add_body(switch_event_t *event, con
 SWITCH_DECLARE(void) switch_event_destroy(switch_event_t **event)
 {
 	switch_event_t *ep = *event;
-	switch_event_header_t *hp, *this;
 
 	if (ep) {
-		for (hp = ep->headers; hp;) {
-			this = hp;
-			hp = hp->next;
-			free_header(&this);
+		if (ep->share) {
+			if (switch_atomic_dec(&ep->share->refs)) {
+				/* the headers belong to the remaining handles */
+				FREE(ep);
+				*event = NULL;
+				return;
+			}
+			free_event_share(&ep->share);
 		}
-		FREE(ep->body);
-		FREE(ep->subclass_name);
+
+		free_event_payload(ep);
 #ifdef SWITCH_EVENT_RECYCLE
 		if (switch_queue_trypush(EVENT_RECYCLE_QUEUE, ep) != SWITCH_STATUS_SUCCESS) {
 			FREE(ep);
@@ -1312,6 +1828,81 @@ SWITCH_DECLARE(void) switch_event_destroy(switch_event_t **event)
 }
 
 
+SWITCH_DECLARE(const char *) switch_event_get_serialized(switch_event_t *event, switch_event_format_t format)
+{
+	struct switch_event_share *share;
+	char *str = NULL, *cur;
+
+	switch_assert(event);
+
+	if (format >= SWITCH_EVENT_FORMAT_MAX) {
+		return NULL;
+	}
+
+	if (!(share = event->share)) {
+		/* nobody else can see this handle yet */
+		share = event->share = new_event_share();
+	}
+
+	if ((cur = share->serialized[format])) {
+		return cur;
+	}
+
+	switch (format) {
+	case SWITCH_EVENT_FORMAT_PLAIN:
+		switch_event_serialize(event, &str, SWITCH_TRUE);
+		break;
+	case SWITCH_EVENT_FORMAT_JSON:
+		switch_event_serialize_json(event, &str);
+		break;
+	case SWITCH_EVENT_FORMAT_XML:
+		{
+			switch_xml_t xml;
+			switch_size_t hint = (event_size_hint(event, 24) * 2) + 64;
+
+			if ((xml = switch_event_xmlize(event, SWITCH_VA_NONE))) {
+				str = switch_xml_toxml_buf(xml, switch_must_malloc(hint), hint, 0, SWITCH_FALSE);
+				switch_xml_free(xml);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+
+	if (!str) {
+		return NULL;
+	}
+
+	if ((cur = switch_atomic_casptr((volatile void **) &share->serialized[format], str, NULL))) {
+		/* another reference got there first */
+		free(str);
+		return cur;
+	}
+
+	return str;
+}
+
+SWITCH_DECLARE(switch_event_t *) switch_event_ref(switch_event_t *event)
+{
+	switch_event_t *ref;
+
+	switch_assert(event);
+
+	if (!event->share) {
+		event->share = new_event_share();
+	}
+
+	switch_atomic_inc(&event->share->refs);
+
+	ref = ALLOC(sizeof(*ref));
+	switch_assert(ref);
+	*ref = *event;
+	ref->next = NULL;
+
+	return ref;
+}
+
 SWITCH_DECLARE(void) switch_event_merge(switch_event_t *event, switch_event_t *tomerge)
 {
 	switch_event_header_t *hp;
@@ -1526,110 +2117,57 @@ SWITCH_DECLARE(switch_status_t) switch_event_binary_serialize(switch_event_t *ev
 
 SWITCH_DECLARE(switch_status_t) switch_event_serialize(switch_event_t *event, char **str, switch_bool_t encode)
 {
-	switch_size_t len = 0;
+	switch_size_t len = 0, dlen = 32, blen = 0;
 	switch_event_header_t *hp;
-	switch_size_t llen = 0, dlen = 0, blocksize = 512, encode_len = 1536, new_len = 0;
 	char *buf;
-	char *encode_buf = NULL;	/* used for url encoding of variables to make sure unsafe things stay out of the serialized copy */
 
 	*str = NULL;
 
-	dlen = blocksize * 2;
+	/*
+	 * size the whole thing in one pass so it is built with a single allocation: url encoding
+	 * can turn every byte of a value into %XX, and an empty value is written as _undef_
+	 */
+	for (hp = event->headers; hp; hp = hp->next) {
+		dlen += strlen(hp->name) + (strlen(hp->value) * 3) + 12;
+	}
 
-	if (!(buf = malloc(dlen))) {
-		abort();
+	if (event->body) {
+		blen = strlen(event->body);
+		dlen += blen + 32;
 	}
 
-	/* go ahead and give ourselves some space to work with, should save a few reallocs */
-	if (!(encode_buf = malloc(encode_len))) {
+	if (!(buf = malloc(dlen))) {
 		abort();
 	}
 
-	/* switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "hit serialized!.\n"); */
 	for (hp = event->headers; hp; hp = hp->next) {
-		/*
-		 * grab enough memory to store 3x the string (url encode takes one char and turns it into %XX)
-		 * so we could end up with a string that is 3 times the originals length, unlikely but rather
-		 * be safe than destroy the string, also add one for the null.  And try to be smart about using
-		 * the memory, allocate and only reallocate if we need more.  This avoids an alloc, free CPU
-		 * destroying loop.
-		 */
-
-		if (hp->idx) {
-			int i;
-			new_len = 0;
-			for(i = 0; i < hp->idx; i++) {
-				new_len += (strlen(hp->array[i]) * 3) + 1;
-			}
-		} else {
-			new_len = (strlen(hp->value) * 3) + 1;
-		}
-
-		if (encode_len < new_len) {
-			char *tmp;
-
-			/* keep track of the size of our allocation */
-			encode_len = new_len;
+		switch_size_t nlen = strlen(hp->name), vlen;
 
-			if (!(tmp = realloc(encode_buf, encode_len))) {
-				abort();
-			}
-
-			encode_buf = tmp;
-		}
+		memcpy(buf + len, hp->name, nlen);
+		len += nlen;
+		buf[len++] = ':';
+		buf[len++] = ' ';
 
 		/* handle any bad things in the string like newlines : etc that screw up the serialized format */
-
-
 		if (encode) {
-			switch_url_encode(hp->value, encode_buf, encode_len);
+			buf[len] = '\0';
+			switch_url_encode(hp->value, buf + len, dlen - len);
+			vlen = strlen(buf + len);
 		} else {
-			switch_snprintf(encode_buf, encode_len, "[%s]", hp->value);
+			vlen = switch_snprintf(buf + len, dlen - len, "[%s]", hp->value);
 		}
 
-
-		llen = strlen(hp->name) + strlen(encode_buf) + 8;
-
-		if ((len + llen) > dlen) {
-			char *m = NULL;
-			dlen += (blocksize + (len + llen));
-			if (!(m = realloc(buf, dlen))) {
-				abort();
-			}
-			buf = m;
+		if (!vlen) {
+			memcpy(buf + len, "_undef_", 7);
+			vlen = 7;
 		}
 
-		switch_snprintf(buf + len, dlen - len, "%s: %s\n", hp->name, *encode_buf == '\0' ? "_undef_" : encode_buf);
-		len = strlen(buf);
+		len += vlen;
+		buf[len++] = '\n';
 	}
 
-	/* we are done with the memory we used for encoding, give it back */
-	switch_safe_free(encode_buf);
-
-	if (event->body) {
-		int blen = (int) strlen(event->body);
-		llen = blen;
-
-		if (blen) {
-			llen += 25;
-		} else {
-			llen += 5;
-		}
-
-		if ((len + llen) > dlen) {
-			char *m = NULL;
-			dlen += (blocksize + (len + llen));
-			if (!(m = realloc(buf, dlen))) {
-				abort();
-			}
-			buf = m;
-		}
-
-		if (blen) {
-			switch_snprintf(buf + len, dlen - len, "Content-Length: %d\n\n%s", blen, event->body);
-		} else {
-			switch_snprintf(buf + len, dlen - len, "\n");
-		}
+	if (blen) {
+		switch_snprintf(buf + len, dlen - len, "Content-Length: %d\n\n%s", (int) blen, event->body);
 	} else {
 		switch_snprintf(buf + len, dlen - len, "\n");
 	}
@@ -1860,7 +2398,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_serialize_json(switch_event_t *even
 	*str = NULL;
 
 	if (switch_event_serialize_json_obj(event, &cj) == SWITCH_STATUS_SUCCESS) {
-		*str = cJSON_PrintUnformatted(cj);
+		*str = cJSON_PrintBuffered(cj, (int) event_size_hint(event, 8), 0);
 		cJSON_Delete(cj);
 
 		return SWITCH_STATUS_SUCCESS;
@@ -2059,9 +2597,17 @@ SWITCH_DECLARE(switch_status_t) switch_event_get_custom_events(switch_console_ca
 
 SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, switch_event_types_t event, const char *subclass_name,
 															switch_event_callback_t callback, void *user_data, switch_event_node_t **node)
+{
+	return switch_event_bind_flags(id, event, subclass_name, callback, user_data, SEBF_NONE, 0, node);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_event_bind_flags(const char *id, switch_event_types_t event, const char *subclass_name,
+														switch_event_callback_t callback, void *user_data, switch_event_bind_flag_t flags,
+														uint32_t queue_len, switch_event_node_t **node)
 {
 	switch_event_node_t *event_node;
 	switch_event_subclass_t *subclass = NULL;
+	switch_event_subscriber_t *subscriber = NULL;
 
 	switch_assert(BLOCK != NULL);
 	switch_assert(RUNTIME_POOL != NULL);
@@ -2091,6 +2637,11 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, swit
 	}
 
 	if (event <= SWITCH_EVENT_ALL) {
+		if ((flags & SEBF_QUEUED) && !(subscriber = switch_event_subscriber_create(callback, user_data, flags, queue_len))) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Could not start the event queue for %s\n", id);
+			return SWITCH_STATUS_FALSE;
+		}
+
 		switch_zmalloc(event_node, sizeof(*event_node));
 		switch_thread_rwlock_wrlock(RWLOCK);
 		switch_mutex_lock(BLOCK);
@@ -2100,15 +2651,18 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, swit
 		if (subclass_name) {
 			event_node->subclass_name = DUP(subclass_name);
 		}
+		event_node_parse_filter(event_node);
 
 		event_node->callback = callback;
 		event_node->user_data = user_data;
+		event_node->subscriber = subscriber;
 
 		if (EVENT_NODES[event]) {
 			event_node->next = EVENT_NODES[event];
 		}
 
 		EVENT_NODES[event] = event_node;
+		event_route_rebuild(event);
 		switch_mutex_unlock(BLOCK);
 		switch_thread_rwlock_unlock(RWLOCK);
 		/* </LOCKED> ----------------------------------------------- */
@@ -2133,7 +2687,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind(const char *id, switch_event_t
 
 SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callback_t callback)
 {
-	switch_event_node_t *n, *np, *lnp = NULL;
+	switch_event_node_t *n, *np, *lnp = NULL, *dead = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int id;
 
@@ -2154,19 +2708,26 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callba
 				}
 
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
-				FREE(n->subclass_name);
-				FREE(n->id);
-				FREE(n);
+				n->next = dead;
+				dead = n;
 				status = SWITCH_STATUS_SUCCESS;
 			} else {
 				lnp = n;
 			}
 		}
+
+		event_route_rebuild(id);
 	}
 	switch_mutex_unlock(BLOCK);
 	switch_thread_rwlock_unlock(RWLOCK);
 	/* </LOCKED> ----------------------------------------------- */
 
+	/* queued bindings are joined outside the lock, their callback may still be running */
+	while ((n = dead)) {
+		dead = n->next;
+		free_event_node(&n);
+	}
+
 	return status;
 }
 
@@ -2174,7 +2735,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callba
 
 SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node)
 {
-	switch_event_node_t *n, *np, *lnp = NULL;
+	switch_event_node_t *n, *np, *lnp = NULL, *dead = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 
 	n = *node;
@@ -2194,11 +2755,10 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node)
 				EVENT_NODES[n->event_id] = n->next;
 			}
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
-			FREE(n->subclass_name);
-			FREE(n->id);
-			FREE(n);
+			dead = n;
 			*node = NULL;
 			status = SWITCH_STATUS_SUCCESS;
+			event_route_rebuild(n->event_id);
 			break;
 		}
 		lnp = np;
@@ -2207,9 +2767,39 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node)
 	switch_thread_rwlock_unlock(RWLOCK);
 	/* </LOCKED> ----------------------------------------------- */
 
+	if (dead) {
+		free_event_node(&dead);
+	}
+
 	return status;
 }
 
+SWITCH_DECLARE(void) switch_event_bindings_report(switch_stream_handle_t *stream)
+{
+	switch_event_node_t *np;
+	int id;
+
+	stream->write_function(stream, "id,event,subclass,mode,depth,capacity,delivered,dropped,lag_us,max_lag_us\n");
+
+	switch_thread_rwlock_rdlock(RWLOCK);
+	for (id = 0; id <= SWITCH_EVENT_ALL; id++) {
+		for (np = EVENT_NODES[id]; np; np = np->next) {
+			switch_event_subscriber_t *sub = np->subscriber;
+
+			if (sub) {
+				stream->write_function(stream, "%s,%s,%s,%s,%u,%u,%u,%u,%" SWITCH_TIME_T_FMT ",%" SWITCH_TIME_T_FMT "\n",
+									   np->id, switch_event_name(np->event_id), switch_str_nil(np->subclass_name),
+									   (sub->flags & SEBF_BLOCK) ? "block" : "drop", switch_queue_size(sub->queue), sub->queue_len,
+									   switch_atomic_read(&sub->delivered), switch_atomic_read(&sub->dropped), sub->last_lag, sub->max_lag);
+			} else {
+				stream->write_function(stream, "%s,%s,%s,inline,,,,,,\n",
+									   np->id, switch_event_name(np->event_id), switch_str_nil(np->subclass_name));
+			}
+		}
+	}
+	switch_thread_rwlock_unlock(RWLOCK);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_event_create_pres_in_detailed(char *file, char *func, int line,
 																	 const char *proto, const char *login,
 																	 const char *from, const char *from_domain,
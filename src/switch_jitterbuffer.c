@@ -31,17 +31,16 @@
  */
 #include <switch.h>
 #include <switch_jitterbuffer.h>
-#include "private/switch_hashtable_private.h"
 
 #define NACK_TIME 80000
 #define RENACK_TIME 100000
 #define MAX_FRAME_PADDING 2
 #define MAX_MISSING_SEQ 20
+/* both must be powers of two */
+#define MIN_SLOTS 64
+#define NACK_WINDOW 1024
 #define jb_debug(_jb, _level, _format, ...) if (_jb->debug_level >= _level) switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(_jb->session), SWITCH_LOG_ALERT, "JB:%p:%s:%d/%d lv:%d ln:%.4d sz:%.3u/%.3u/%.3u/%.3u c:%.3u %.3u/%.3u/%.3u/%.3u %.2f%% ->" _format, (void *) _jb, (jb->type == SJB_TEXT ? "txt" : (jb->type == SJB_AUDIO ? "aud" : "vid")), _jb->allocated_nodes, _jb->visible_nodes, _level, __LINE__,  _jb->min_frame_len, _jb->max_frame_len, _jb->frame_len, _jb->complete_frames, _jb->period_count, _jb->consec_good_count, _jb->period_good_count, _jb->consec_miss_count, _jb->period_miss_count, _jb->period_miss_pct, __VA_ARGS__)
 
-//const char *TOKEN_1 = "ONE";
-//const char *TOKEN_2 = "TWO";
-
 struct switch_jb_s;
 
 static inline int check_jb_size(switch_jb_t *jb);
@@ -52,12 +51,20 @@ typedef struct switch_jb_node_s {
 	uint32_t len;
 	uint8_t visible;
 	uint8_t bad_hits;
-	struct switch_jb_node_s *prev;
+	/* position in jb->live while visible */
+	uint32_t live_idx;
+	/* next free node while hidden */
 	struct switch_jb_node_s *next;
 	/* used for counting the number of partial or complete frames currently in the JB */
 	switch_bool_t complete_frame_mark;
 } switch_jb_node_t;
 
+typedef struct switch_jb_nack_s {
+	uint16_t seq;
+	/* 0 until the seq has been nacked once */
+	switch_time_t then;
+} switch_jb_nack_t;
+
 typedef struct switch_jb_stats_s {
 	uint32_t reset_too_big;
 	uint32_t reset_missing_frames;
@@ -82,7 +89,17 @@ typedef struct switch_jb_jitter_s {
 } switch_jb_jitter_t;
 
 struct switch_jb_s {
-	struct switch_jb_node_s *node_list;
+	/* visible nodes by seq & slot_mask, the ring grows instead of letting two live seqs share a slot */
+	switch_jb_node_t **slots;
+	uint32_t slot_mask;
+	/* dense array of the visible nodes for the few operations that have to look at all of them */
+	switch_jb_node_t **live;
+	uint32_t live_size;
+	switch_jb_node_t *free_nodes;
+	/* missing video seqs, one bit per seq & (NACK_WINDOW - 1) */
+	uint32_t nack_map[NACK_WINDOW / 32];
+	switch_jb_nack_t *nack_list;
+	uint32_t nack_count;
 	uint32_t last_target_seq;
 	uint32_t highest_read_ts;
 	uint32_t highest_dropped_ts;
@@ -118,8 +135,6 @@ struct switch_jb_s {
 	uint8_t debug_level;
 	uint16_t next_seq;
 	switch_size_t last_len;
-	switch_inthash_t *missing_seq_hash;
-	switch_inthash_t *node_hash;
 	switch_inthash_t *node_hash_ts;
 	switch_mutex_t *mutex;
 	switch_mutex_t *list_mutex;
@@ -143,98 +158,78 @@ struct switch_jb_s {
 };
 
 
-static int node_cmp(const void *l, const void *r)
+static inline switch_bool_t jb_nack_test(switch_jb_t *jb, uint16_t seq)
 {
-	switch_jb_node_t *a = (switch_jb_node_t *) l;
-	switch_jb_node_t *b = (switch_jb_node_t *) r;
-
-	if (!a->visible) return 0;
-	if (!b->visible) return 1;
+	uint32_t i = seq & (NACK_WINDOW - 1);
 
-	return ntohs(a->packet.header.seq) - ntohs(b->packet.header.seq);
+	return (jb->nack_map[i >> 5] & (1U << (i & 31))) && jb->nack_list[i].seq == seq;
 }
 
-//http://www.chiark.greenend.org.uk/~sgtatham/algorithms/listsort.c
-switch_jb_node_t *sort_nodes(switch_jb_node_t *list, int (*cmp)(const void *, const void *)) {
-	switch_jb_node_t *p, *q, *e, *tail;
-	int insize, nmerges, psize, qsize, i;
+static inline void jb_nack_set(switch_jb_t *jb, uint16_t seq, switch_time_t then)
+{
+	uint32_t i = seq & (NACK_WINDOW - 1);
 
-	if (!list) {
-		return NULL;
+	/* whatever seq held this bit before is NACK_WINDOW behind and long expired */
+	if (!(jb->nack_map[i >> 5] & (1U << (i & 31)))) {
+		jb->nack_map[i >> 5] |= (1U << (i & 31));
+		jb->nack_count++;
 	}
 
-	insize = 1;
+	jb->nack_list[i].seq = seq;
+	jb->nack_list[i].then = then;
+}
 
-	while (1) {
-		p = list;
-		list = NULL;
-		tail = NULL;
+static inline switch_bool_t jb_nack_clear(switch_jb_t *jb, uint16_t seq)
+{
+	uint32_t i = seq & (NACK_WINDOW - 1);
 
-		nmerges = 0;  /* count number of merges we do in this pass */
+	if (!jb_nack_test(jb, seq)) {
+		return SWITCH_FALSE;
+	}
 
-		while (p) {
-			nmerges++;  /* there exists a merge to be done */
-			            /* step `insize' places along from p */
-			q = p;
-			psize = 0;
-			for (i = 0; i < insize; i++) {
-				psize++;
-				q = q->next;
-				if (!q) break;
-			}
+	jb->nack_map[i >> 5] &= ~(1U << (i & 31));
+	jb->nack_count--;
 
-			/* if q hasn't fallen off end, we have two lists to merge */
-			qsize = insize;
-
-			/* now we have two lists; merge them */
-			while (psize > 0 || (qsize > 0 && q)) {
-
-				/* decide whether next switch_jb_node_t of merge comes from p or q */
-				if (psize == 0) {
-					/* p is empty; e must come from q. */
-					e = q; q = q->next; qsize--;
-				} else if (qsize == 0 || !q) {
-					/* q is empty; e must come from p. */
-					e = p; p = p->next; psize--;
-				} else if (cmp(p,q) <= 0) {
-					/* First switch_jb_node_t of p is lower (or same);
-					 * e must come from p. */
-					e = p; p = p->next; psize--;
-				} else {
-					/* First switch_jb_node_t of q is lower; e must come from q. */
-					e = q; q = q->next; qsize--;
-				}
+	return SWITCH_TRUE;
+}
 
-				/* add the next switch_jb_node_t to the merged list */
-				if (tail) {
-					tail->next = e;
-				} else {
-					list = e;
-				}
+static inline void jb_nack_reset(switch_jb_t *jb)
+{
+	memset(jb->nack_map, 0, sizeof(jb->nack_map));
+	jb->nack_count = 0;
+}
 
-				/* Maintain reverse pointers in a doubly linked list. */
-				e->prev = tail;
+/* seq in network order like everything else that comes out of the packet header */
+static inline switch_jb_node_t *jb_find_seq(switch_jb_t *jb, uint16_t seq)
+{
+	switch_jb_node_t *node = jb->slots[ntohs(seq) & jb->slot_mask];
 
-				tail = e;
-			}
+	return (node && node->packet.header.seq == seq) ? node : NULL;
+}
 
-			/* now p has stepped `insize' places along, and q has too */
-			p = q;
-		}
+static void grow_slots(switch_jb_t *jb)
+{
+	uint32_t size = (jb->slot_mask + 1) * 2, i;
+	switch_jb_node_t **slots;
 
-		tail->next = NULL;
+	switch_zmalloc(slots, sizeof(*slots) * size);
 
-		/* If we have done only one merge, we're finished. */
-		if (nmerges <= 1)   /* allow for nmerges==0, the empty list case */
-			return list;
+	/* seqs that did not share a slot in the smaller ring cannot share one in the bigger ring either,
+	   only the slotted nodes move, the node being added is still in live but not slotted yet */
+	for (i = 0; i <= jb->slot_mask; i++) {
+		switch_jb_node_t *np = jb->slots[i];
 
-		/* Otherwise repeat, merging lists twice the size */
-		insize *= 2;
+		if (np) {
+			slots[ntohs(np->packet.header.seq) & (size - 1)] = np;
+		}
 	}
-}
 
-// static inline void thin_frames(switch_jb_t *jb, int freq, int max);
+	free(jb->slots);
+	jb->slots = slots;
+	jb->slot_mask = size - 1;
 
+	jb_debug(jb, 2, "Grow slots to %u\n", size);
+}
 
 static inline switch_jb_node_t *new_node(switch_jb_t *jb)
 {
@@ -242,13 +237,9 @@ static inline switch_jb_node_t *new_node(switch_jb_t *jb)
 
 	switch_mutex_lock(jb->list_mutex);
 
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) {
-			break;
-		}
-	}
-
-	if (!np) {
+	if ((np = jb->free_nodes)) {
+		jb->free_nodes = np->next;
+	} else {
 		int mult = 2;
 
 		if (jb->type != SJB_VIDEO) {
@@ -266,21 +257,23 @@ static inline switch_jb_node_t *new_node(switch_jb_t *jb)
 			switch_mutex_unlock(jb->list_mutex);
 			return NULL;
 		}
-		
+
 		np = switch_core_alloc(jb->pool, sizeof(*np));
 		jb->allocated_nodes++;
-		np->next = jb->node_list;
-		if (np->next) {
-			np->next->prev = np;
-		}
-		jb->node_list = np;
 
+		if (jb->allocated_nodes > jb->live_size) {
+			jb->live_size = jb->live_size ? jb->live_size * 2 : MIN_SLOTS;
+			jb->live = realloc(jb->live, sizeof(*jb->live) * jb->live_size);
+			switch_assert(jb->live);
+		}
 	}
 
 	switch_assert(np);
+	np->next = NULL;
 	np->bad_hits = 0;
 	np->visible = 1;
-	jb->visible_nodes++;
+	np->live_idx = jb->visible_nodes;
+	jb->live[jb->visible_nodes++] = np;
 	np->parent = jb;
 
 	switch_mutex_unlock(jb->list_mutex);
@@ -288,75 +281,66 @@ static inline switch_jb_node_t *new_node(switch_jb_t *jb)
 	return np;
 }
 
-static inline void push_to_top(switch_jb_t *jb, switch_jb_node_t *node)
-{
-	if (node == jb->node_list) {
-		jb->node_list = node->next;
-	} else if (node->prev) {
-		node->prev->next = node->next;
-	}
-
-	if (node->next) {
-		node->next->prev = node->prev;
-	}
-
-	node->next = jb->node_list;
-	node->prev = NULL;
-
-	if (node->next) {
-		node->next->prev = node;
-	}
-
-	jb->node_list = node;
-
-	switch_assert(node->next != node);
-	switch_assert(node->prev != node);
-}
-
-static inline void hide_node(switch_jb_node_t *node, switch_bool_t pop)
+static inline void hide_node(switch_jb_node_t *node)
 {
 	switch_jb_t *jb = node->parent;
 
 	switch_mutex_lock(jb->list_mutex);
 
 	if (node->visible) {
+		uint32_t slot = ntohs(node->packet.header.seq) & jb->slot_mask;
+
 		node->visible = 0;
 		node->bad_hits = 0;
 		jb->visible_nodes--;
 
-		if (pop) {
-			push_to_top(jb, node);
+		jb->live[node->live_idx] = jb->live[jb->visible_nodes];
+		jb->live[node->live_idx]->live_idx = node->live_idx;
+
+		if (jb->node_hash_ts && switch_core_inthash_find(jb->node_hash_ts, node->packet.header.ts) == node) {
+			switch_core_inthash_delete(jb->node_hash_ts, node->packet.header.ts);
 		}
-	}
 
-	if (jb->node_hash_ts) {
-		switch_core_inthash_delete(jb->node_hash_ts, node->packet.header.ts);
-	}
+		if (jb->slots[slot] == node) {
+			jb->slots[slot] = NULL;
 
-	if (switch_core_inthash_delete(jb->node_hash, node->packet.header.seq)) {
-		if (node->complete_frame_mark && jb->type == SJB_VIDEO) {
-			jb->complete_frames--;
-			node->complete_frame_mark = FALSE;
+			if (node->complete_frame_mark && jb->type == SJB_VIDEO) {
+				jb->complete_frames--;
+				node->complete_frame_mark = FALSE;
+			}
 		}
+
+		node->next = jb->free_nodes;
+		jb->free_nodes = node;
 	}
 
 	switch_mutex_unlock(jb->list_mutex);
 }
 
-static inline void sort_free_nodes(switch_jb_t *jb)
+static inline void slot_node(switch_jb_t *jb, switch_jb_node_t *node)
 {
-	switch_mutex_lock(jb->list_mutex);
-	jb->node_list = sort_nodes(jb->node_list, node_cmp);
-	switch_mutex_unlock(jb->list_mutex);
+	uint16_t seq = ntohs(node->packet.header.seq);
+	switch_jb_node_t *old;
+
+	while ((old = jb->slots[seq & jb->slot_mask]) && old->packet.header.seq != node->packet.header.seq &&
+		   jb->slot_mask < USHRT_MAX && jb->slot_mask + 1 < jb->allocated_nodes * 4) {
+		grow_slots(jb);
+	}
+
+	if ((old = jb->slots[seq & jb->slot_mask]) && old != node) {
+		/* a resent seq, or a straggler so far behind that the ring had to wrap over it */
+		jb_debug(jb, 2, "REPLACE seq:%u with seq:%u\n", ntohs(old->packet.header.seq), seq);
+		hide_node(old);
+	}
+
+	jb->slots[seq & jb->slot_mask] = node;
 }
 
 static inline void hide_nodes(switch_jb_t *jb)
 {
-	switch_jb_node_t *np;
-
 	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		hide_node(np, SWITCH_FALSE);
+	while (jb->visible_nodes) {
+		hide_node(jb->live[jb->visible_nodes - 1]);
 	}
 	switch_mutex_unlock(jb->list_mutex);
 }
@@ -383,33 +367,28 @@ static inline switch_bool_t packet_vad(switch_jb_t *jb, switch_rtp_packet_t *pac
 
 static inline void drop_ts(switch_jb_t *jb, uint32_t ts)
 {
-	switch_jb_node_t *np;
-	int x = 0;
+	uint32_t i;
 
 	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
+	/* walk backwards, hide_node moves the last live node into the hole */
+	for (i = jb->visible_nodes; i > 0; i--) {
+		switch_jb_node_t *np = jb->live[i - 1];
 
 		if (ts == np->packet.header.ts) {
-			hide_node(np, SWITCH_FALSE);
-			x++;
+			hide_node(np);
 		}
 	}
-
-	if (x) {
-		sort_free_nodes(jb);
-	}
-
 	switch_mutex_unlock(jb->list_mutex);
 }
 
 static inline switch_jb_node_t *jb_find_lowest_seq(switch_jb_t *jb, uint32_t ts)
 {
 	switch_jb_node_t *np, *lowest = NULL;
+	uint32_t i;
 
 	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
+	for (i = 0; i < jb->visible_nodes; i++) {
+		np = jb->live[i];
 
 		if (ts && ts != np->packet.header.ts) continue;
 
@@ -425,10 +404,11 @@ static inline switch_jb_node_t *jb_find_lowest_seq(switch_jb_t *jb, uint32_t ts)
 static inline switch_jb_node_t *jb_find_lowest_node(switch_jb_t *jb)
 {
 	switch_jb_node_t *np, *lowest = NULL;
+	uint32_t i;
 
 	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
+	for (i = 0; i < jb->visible_nodes; i++) {
+		np = jb->live[i];
 
 		if (!lowest || ntohl(lowest->packet.header.ts) > ntohl(np->packet.header.ts)) {
 			lowest = np;
@@ -446,91 +426,6 @@ static inline uint32_t jb_find_lowest_ts(switch_jb_t *jb)
 	return lowest ? lowest->packet.header.ts : 0;
 }
 
-#if 0
-static inline void thin_frames(switch_jb_t *jb, int freq, int max)
-{
-	switch_jb_node_t *node, *this_node;
-	int i = -1;
-	int dropped = 0;
-
-	switch_mutex_lock(jb->list_mutex);
-	node = jb->node_list;
-
-	while (node && dropped <= max) {
-		this_node = node;
-		node = node->next;
-		
-		if (this_node->visible) {
-			i++;
-		} else {
-			continue;
-		}
-
-		if ((i % freq) == 0) {
-			drop_ts(jb, this_node->packet.header.ts);
-			dropped++;
-		}
-	}
-
-	sort_free_nodes(jb);
-	switch_mutex_unlock(jb->list_mutex);
-}
-
-static inline switch_jb_node_t *jb_find_highest_node(switch_jb_t *jb)
-{
-	switch_jb_node_t *np, *highest = NULL;
-
-	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
-
-		if (!highest || ntohl(highest->packet.header.ts) < ntohl(np->packet.header.ts)) {
-			highest = np;
-		}
-	}
-	switch_mutex_unlock(jb->list_mutex);
-
-	return highest ? highest : NULL;
-}
-
-
-static inline uint32_t jb_find_highest_ts(switch_jb_t *jb)
-{
-	switch_jb_node_t *highest = jb_find_highest_node(jb);
-
-	return highest ? highest->packet.header.ts : 0;
-}
-
-static inline void drop_newest_frame(switch_jb_t *jb)
-{
-	uint32_t ts = jb_find_highest_ts(jb);
-
-	drop_ts(jb, ts);
-	jb_debug(jb, 1, "Dropping highest frame ts:%u\n", ntohl(ts));
-}
-
-
-
-
-static inline switch_jb_node_t *jb_find_penultimate_node(switch_jb_t *jb)
-{
-	switch_jb_node_t *np, *highest = NULL, *second_highest = NULL;
-
-	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
-
-		if (!highest || ntohl(highest->packet.header.ts) < ntohl(np->packet.header.ts)) {
-			if (highest) second_highest = highest;
-			highest = np;
-		}
-	}
-	switch_mutex_unlock(jb->list_mutex);
-
-	return second_highest ? second_highest : highest;
-}
-#endif
-
 static inline void jb_hit(switch_jb_t *jb)
 {
 	jb->period_good_count++;
@@ -590,48 +485,6 @@ static inline void jb_miss(switch_jb_t *jb)
 	jb->consec_good_count = 0;
 }
 
-#if 0
-static inline int verify_oldest_frame(switch_jb_t *jb)
-{
-	switch_jb_node_t *lowest = NULL, *np = NULL;
-	int r = 0;
-
-	lowest = jb_find_lowest_node(jb);
-
-	if (!lowest || !(lowest = jb_find_lowest_seq(jb, lowest->packet.header.ts))) {
-		goto end;
-	}
-
-	switch_mutex_lock(jb->mutex);
-
-	jb->node_list = sort_nodes(jb->node_list, node_cmp);
-
-	for (np = lowest->next; np; np = np->next) {
-
-		if (!np->visible) continue;
-
-		if (ntohs(np->packet.header.seq) != ntohs(np->prev->packet.header.seq) + 1) {
-			uint32_t val = (uint32_t)htons(ntohs(np->prev->packet.header.seq) + 1);
-
-			if (!switch_core_inthash_find(jb->missing_seq_hash, val)) {
-				switch_core_inthash_insert(jb->missing_seq_hash, val, (void *)(intptr_t)1);
-			}
-			break;
-		}
-
-		if (np->packet.header.ts != lowest->packet.header.ts || !np->next) {
-			r = 1;
-		}
-	}
-
-	switch_mutex_unlock(jb->mutex);
-
- end:
-
-	return r;
-}
-#endif
-
 static inline void drop_oldest_frame(switch_jb_t *jb)
 {
 	uint32_t ts = jb_find_lowest_ts(jb);
@@ -642,18 +495,6 @@ static inline void drop_oldest_frame(switch_jb_t *jb)
 
 
 
-#if 0
-static inline void drop_second_newest_frame(switch_jb_t *jb)
-{
-	switch_jb_node_t *second_newest = jb_find_penultimate_node(jb);
-
-	if (second_newest) {
-		drop_ts(jb, second_newest->packet.header.ts);
-		jb_debug(jb, 1, "Dropping second highest frame ts:%u\n", ntohl(second_newest->packet.header.ts));
-	}
-}
-#endif
-
 static inline int check_seq(uint16_t a, uint16_t b)
 {
 	a = ntohs(a);
@@ -690,7 +531,7 @@ static inline void add_node(switch_jb_t *jb, switch_rtp_packet_t *packet, switch
 	node->packet = *packet;
 	node->len = len;
 
-	switch_core_inthash_insert(jb->node_hash, node->packet.header.seq, node);
+	slot_node(jb, node);
 
 	if (jb->node_hash_ts) {
 		switch_core_inthash_insert(jb->node_hash_ts, node->packet.header.ts, node);
@@ -813,7 +654,7 @@ static inline switch_status_t jb_next_packet_by_seq(switch_jb_t *jb, switch_jb_n
 	}
 
 	if (!jb->target_seq) {
-		if ((node = switch_core_inthash_find(jb->node_hash, jb->target_seq))) {
+		if ((node = jb_find_seq(jb, jb->target_seq))) {
 			jb_debug(jb, 2, "FOUND rollover seq: %u\n", ntohs(jb->target_seq));
 		} else if ((node = jb_find_lowest_seq(jb, 0))) {
 			jb_debug(jb, 2, "No target seq using seq: %u as a starting point\n", ntohs(node->packet.header.seq));
@@ -821,7 +662,7 @@ static inline switch_status_t jb_next_packet_by_seq(switch_jb_t *jb, switch_jb_n
 			jb_debug(jb, 1, "%s", "No nodes available....\n");
 		}
 		jb_hit(jb);
-	} else if ((node = switch_core_inthash_find(jb->node_hash, jb->target_seq))) {
+	} else if ((node = jb_find_seq(jb, jb->target_seq))) {
 		jb_debug(jb, 2, "FOUND desired seq: %u\n", ntohs(jb->target_seq));
 		jb_hit(jb);
 	} else {
@@ -837,7 +678,7 @@ static inline switch_status_t jb_next_packet_by_seq(switch_jb_t *jb, switch_jb_n
 
 			for (x = 0; x < 10; x++) {
 				increment_seq(jb);
-				if ((node = switch_core_inthash_find(jb->node_hash, jb->target_seq))) {
+				if ((node = jb_find_seq(jb, jb->target_seq))) {
 					jb_debug(jb, 2, "FOUND incremental seq: %u\n", ntohs(jb->target_seq));
 
 					if (node->packet.header.m ||  node->packet.header.ts == jb->highest_read_ts) {
@@ -913,6 +754,7 @@ static inline switch_status_t jb_next_packet_by_ts(switch_jb_t *jb, switch_jb_no
 static inline int check_jb_size(switch_jb_t *jb)
 {
 	switch_jb_node_t *np;
+	uint32_t i;
 	uint16_t seq_hs, target_seq_hs;
 	uint16_t l_seq = 0;
 	uint16_t h_seq = 0;
@@ -923,14 +765,12 @@ static inline int check_jb_size(switch_jb_t *jb)
 
 	target_seq_hs = ntohs(jb->target_seq);
 
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) {
-			continue;
-		}
+	for (i = jb->visible_nodes; i > 0; i--) {
+		np = jb->live[i - 1];
 
 		seq_hs = ntohs(np->packet.header.seq);
 		if (target_seq_hs > seq_hs) {
-			hide_node(np, SWITCH_FALSE);
+			hide_node(np);
 			old++;
 			continue;
 		}
@@ -982,10 +822,6 @@ static inline int check_jb_size(switch_jb_t *jb)
 		}
 	}
 
-	if (old) {
-		sort_free_nodes(jb);
-	}
-
 	switch_mutex_unlock(jb->list_mutex);
 
 	jb_debug(jb, SWITCH_LOG_INFO, "JITTER buffersize %u == %u old[%u] target[%u] seq[%u|%u]\n", count, h_seq - l_seq + 1, old, target_seq_hs, l_seq, h_seq);
@@ -1065,7 +901,10 @@ static inline switch_status_t jb_next_packet(switch_jb_t *jb, switch_jb_node_t *
 static inline void free_nodes(switch_jb_t *jb)
 {
 	switch_mutex_lock(jb->list_mutex);
-	jb->node_list = NULL;
+	jb->free_nodes = NULL;
+	jb->visible_nodes = 0;
+	switch_safe_free(jb->live);
+	switch_safe_free(jb->slots);
 	switch_mutex_unlock(jb->list_mutex);
 }
 
@@ -1184,8 +1023,7 @@ SWITCH_DECLARE(void) switch_jb_reset(switch_jb_t *jb)
 
 	if (jb->type == SJB_VIDEO) {
 		switch_mutex_lock(jb->mutex);
-		switch_core_inthash_destroy(&jb->missing_seq_hash);
-		switch_core_inthash_init(&jb->missing_seq_hash);
+		jb_nack_reset(jb);
 		switch_mutex_unlock(jb->mutex);
 
 		if (jb->session) {
@@ -1244,7 +1082,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_peek_frame(switch_jb_t *jb, uint32_t t
 	switch_jb_node_t *node = NULL;
 	if (seq) {
 		uint16_t want_seq = seq + peek;
-		node = switch_core_inthash_find(jb->node_hash, htons(want_seq));
+		node = jb_find_seq(jb, htons(want_seq));
 	} else if (ts && jb->samples_per_frame) {
 		uint32_t want_ts = ts + (peek * jb->samples_per_frame);
 		node = switch_core_inthash_find(jb->node_hash_ts, htonl(want_ts));
@@ -1339,13 +1177,14 @@ SWITCH_DECLARE(switch_status_t) switch_jb_create(switch_jb_t **jbp, switch_jb_ty
 	jb->highest_frame_len = jb->frame_len;
 
 	if (jb->type == SJB_VIDEO) {
-		switch_core_inthash_init(&jb->missing_seq_hash);
+		jb->nack_list = switch_core_alloc(pool, sizeof(*jb->nack_list) * NACK_WINDOW);
 		jb->period_len = 2500;
 	} else {
 		jb->period_len = 250;
 	}
 	
-	switch_core_inthash_init(&jb->node_hash);
+	jb->slot_mask = MIN_SLOTS - 1;
+	switch_zmalloc(jb->slots, sizeof(*jb->slots) * MIN_SLOTS);
 	switch_mutex_init(&jb->mutex, SWITCH_MUTEX_NESTED, pool);
 	switch_mutex_init(&jb->list_mutex, SWITCH_MUTEX_NESTED, pool);
 
@@ -1362,12 +1201,8 @@ SWITCH_DECLARE(switch_status_t) switch_jb_destroy(switch_jb_t **jbp)
 	if (jb->type == SJB_VIDEO && !switch_test_flag(jb, SJB_QUEUE_ONLY)) {
 		jb_debug(jb, 3, "Stats: NACK saved the day: %u\n", jb->nack_saved_the_day);
 		jb_debug(jb, 3, "Stats: NACK was late: %u\n", jb->nack_didnt_save_the_day);
-		jb_debug(jb, 3, "Stats: Hash entrycount: missing_seq_hash %u\n", switch_hashtable_count(jb->missing_seq_hash));
-	}
-	if (jb->type == SJB_VIDEO) {
-		switch_core_inthash_destroy(&jb->missing_seq_hash);
+		jb_debug(jb, 3, "Stats: NACK entrycount: %u\n", jb->nack_count);
 	}
-	switch_core_inthash_destroy(&jb->node_hash);
 
 	if (jb->node_hash_ts) {
 		switch_core_inthash_destroy(&jb->node_hash_ts);
@@ -1384,13 +1219,12 @@ SWITCH_DECLARE(switch_status_t) switch_jb_destroy(switch_jb_t **jbp)
 
 SWITCH_DECLARE(uint32_t) switch_jb_pop_nack(switch_jb_t *jb)
 {
-	switch_hash_index_t *hi = NULL;
 	uint32_t nack = 0;
 	uint16_t blp = 0;
 	uint16_t least = 0;
+	uint32_t w, b;
 	int i = 0;
-	void *val;
-	const void *var;
+	switch_time_t now;
 
 	if (jb->type != SJB_VIDEO) {
 		return 0;
@@ -1398,56 +1232,50 @@ SWITCH_DECLARE(uint32_t) switch_jb_pop_nack(switch_jb_t *jb)
 
 	switch_mutex_lock(jb->mutex);
 
- top:
+	now = switch_time_now();
 
-	for (hi = switch_core_hash_first_iter(jb->missing_seq_hash, hi); hi; hi = switch_core_hash_next(&hi)) {
-		uint16_t seq;
-		//const char *token;
-		switch_time_t then = 0;
+	for (w = 0; w < NACK_WINDOW / 32; w++) {
+		uint32_t bits = jb->nack_map[w];
 
-		switch_core_hash_this(hi, &var, NULL, &val);
-		//token = (const char *) val;
-
-		//if (token == TOKEN_2) {
-			//switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "SKIP %u %s\n", ntohs(*((uint16_t *) var)), token);
-			//printf("WTf\n");
-		//	continue;
-		//}
+		for (b = 0; bits; b++, bits >>= 1) {
+			switch_jb_nack_t *entry;
+			uint16_t seq;
 
-		seq = ntohs(*((uint16_t *) var));
-		then = (intptr_t) val;
+			if (!(bits & 1)) {
+				continue;
+			}
 
-		if (then != 1 && ((uint32_t)(switch_time_now() - then)) < RENACK_TIME) {
-			jb_debug(jb, 3, "NACKABLE seq %u too soon to repeat\n", seq);
-			continue;
-		}
+			entry = &jb->nack_list[(w << 5) | b];
+			seq = entry->seq;
 
-		//if (then != 1) {
-		//	jb_debug(jb, 3, "NACKABLE seq %u not too soon to repeat %lu\n", seq, switch_time_now() - then);
-		//}
+			if (entry->then && ((uint32_t)(now - entry->then)) < RENACK_TIME) {
+				jb_debug(jb, 3, "NACKABLE seq %u too soon to repeat\n", seq);
+				continue;
+			}
 
-		if (seq < ntohs(jb->target_seq) - jb->frame_len) {
-			jb_debug(jb, 3, "NACKABLE seq %u expired\n", seq);
-			switch_core_inthash_delete(jb->missing_seq_hash, (uint32_t)htons(seq));
-			goto top;
-		}
+			if (seq < ntohs(jb->target_seq) - jb->frame_len) {
+				jb_debug(jb, 3, "NACKABLE seq %u expired\n", seq);
+				jb_nack_clear(jb, seq);
+				continue;
+			}
 
-		if (!least || seq < least) {
-			least = seq;
+			if (!least || seq < least) {
+				least = seq;
+			}
 		}
 	}
 
-	switch_safe_free(hi);
-
-	if (least && switch_core_inthash_delete(jb->missing_seq_hash, (uint32_t)htons(least))) {
+	if (least && jb_nack_test(jb, least)) {
 		jb_debug(jb, 3, "Found NACKABLE seq %u\n", least);
 		nack = (uint32_t) htons(least);
-		switch_core_inthash_insert(jb->missing_seq_hash, nack, (void *) (intptr_t)switch_time_now());
+		jb_nack_set(jb, least, now);
 
 		for(i = 0; i < 16; i++) {
-			if (switch_core_inthash_delete(jb->missing_seq_hash, (uint32_t)htons(least + i + 1))) {
-				switch_core_inthash_insert(jb->missing_seq_hash, (uint32_t)htons(least + i + 1), (void *)(intptr_t)switch_time_now());
-				jb_debug(jb, 3, "Found addtl NACKABLE seq %u\n", least + i + 1);
+			uint16_t seq = (uint16_t) (least + i + 1);
+
+			if (jb_nack_test(jb, seq)) {
+				jb_nack_set(jb, seq, now);
+				jb_debug(jb, 3, "Found addtl NACKABLE seq %u\n", seq);
 				blp |= (1 << i);
 			}
 		}
@@ -1492,7 +1320,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_put_packet(switch_jb_t *jb, switch_rtp
 		jb->next_seq = htons(got + 1);
 	} else {
 
-		if (switch_core_inthash_delete(jb->missing_seq_hash, (uint32_t)htons(got))) {
+		if (jb_nack_clear(jb, got)) {
 			if (got < ntohs(jb->target_seq)) {
 				jb_debug(jb, 2, "got nacked seq %u too late\n", got);
 				jb_frame_inc(jb, 1);
@@ -1517,7 +1345,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_put_packet(switch_jb_t *jb, switch_rtp
 
 				for (i = want; i < got; i++) {
 					jb_debug(jb, 2, "MARK MISSING %u ts:%u\n", i, ntohl(packet->header.ts));
-					switch_core_inthash_insert(jb->missing_seq_hash, (uint32_t)htons(i), (void *)(intptr_t)1);
+					jb_nack_set(jb, (uint16_t) i, 0);
 				}
 			}
 		}
@@ -1550,7 +1378,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_get_packet_by_seq(switch_jb_t *jb, uin
 	switch_status_t status = SWITCH_STATUS_NOTFOUND;
 
 	switch_mutex_lock(jb->mutex);
-	if ((node = switch_core_inthash_find(jb->node_hash, seq))) {
+	if ((node = jb_find_seq(jb, seq))) {
 		jb_debug(jb, 2, "Found buffered seq: %u\n", ntohs(seq));
 		*packet = node->packet;
 		*len = node->len;
@@ -1723,7 +1551,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_get_packet(switch_jb_t *jb, switch_rtp
 	*len = node->len;
 	jb->last_len = *len;
 	packet->header.version = 2;
-	hide_node(node, SWITCH_TRUE);
+	hide_node(node);
 
 	jb_debug(jb, 2, "GET packet ts:%u seq:%u %s\n", ntohl(packet->header.ts), ntohs(packet->header.seq), packet->header.m ? " <MARK>" : "");
 
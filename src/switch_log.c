@@ -49,6 +49,8 @@ static const char *LEVELS[] = {
 struct switch_log_binding {
 	switch_log_function_t function;
 	switch_log_level_t level;
+	/* the levels the binding actually wants, see switch_log_binding_set_mask() */
+	uint32_t mask;
 	int is_console;
 	struct switch_log_binding *next;
 };
@@ -63,13 +65,21 @@ static switch_queue_t *LOG_QUEUE = NULL;
 static switch_queue_t *LOG_RECYCLE_QUEUE = NULL;
 #endif
 static int8_t THREAD_RUNNING = 0;
-static uint8_t MAX_LEVEL = 0;
+/* union of the binding masks, checked before anything is formatted */
+static volatile uint32_t LOG_MASK = 0;
 static int mods_loaded = 0;
 static int console_mods_loaded = 0;
 static switch_bool_t COLORIZE = SWITCH_FALSE;
 
 static int64_t log_sequence = 0;
 
+/* the date prefix only changes once a second, keep the localtime() work off the logging threads */
+static struct {
+	switch_mutex_t *mutex;
+	int64_t sec;
+	char date[32];
+} LOG_DATE;
+
 #ifdef WIN32
 static HANDLE hStdout;
 static WORD wOldColorAttrs;
@@ -422,6 +432,42 @@ SWITCH_DECLARE(switch_log_level_t) switch_log_str2level(const char *str)
 	return level;
 }
 
+#define switch_log_level_to_mask(_level) ((uint32_t) ((1 << ((_level) + 1)) - 1))
+
+/* a session loglevel lets lines through that no binding mask asks for, the loggers check node->slevel themselves */
+#define switch_log_slevel_wants(_slevel, _level) ((_slevel) != SWITCH_LOG_UNINIT && (_level) <= (_slevel))
+
+/* must be called with BINDLOCK locked */
+static void log_mask_refresh(void)
+{
+	switch_log_binding_t *ptr;
+	uint32_t mask = 0;
+
+	for (ptr = BINDINGS; ptr; ptr = ptr->next) {
+		mask |= ptr->mask;
+	}
+
+	LOG_MASK = mask;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_log_binding_set_mask(switch_log_function_t function, uint32_t mask)
+{
+	switch_log_binding_t *ptr = NULL;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	switch_mutex_lock(BINDLOCK);
+	for (ptr = BINDINGS; ptr; ptr = ptr->next) {
+		if (ptr->function == function) {
+			ptr->mask = mask & switch_log_level_to_mask(ptr->level);
+			status = SWITCH_STATUS_SUCCESS;
+		}
+	}
+	log_mask_refresh();
+	switch_mutex_unlock(BINDLOCK);
+
+	return status;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_log_unbind_logger(switch_log_function_t function)
 {
 	switch_log_binding_t *ptr = NULL, *last = NULL;
@@ -444,6 +490,7 @@ SWITCH_DECLARE(switch_status_t) switch_log_unbind_logger(switch_log_function_t f
 		}
 		last = ptr;
 	}
+	log_mask_refresh();
 	switch_mutex_unlock(BINDLOCK);
 
 	return status;
@@ -458,12 +505,9 @@ SWITCH_DECLARE(switch_status_t) switch_log_bind_logger(switch_log_function_t fun
 		return SWITCH_STATUS_MEMERR;
 	}
 
-	if ((uint8_t) level > MAX_LEVEL) {
-		MAX_LEVEL = level;
-	}
-
 	binding->function = function;
 	binding->level = level;
+	binding->mask = switch_log_level_to_mask(level);
 	binding->is_console = is_console;
 
 	switch_mutex_lock(BINDLOCK);
@@ -478,6 +522,7 @@ SWITCH_DECLARE(switch_status_t) switch_log_bind_logger(switch_log_function_t fun
 		console_mods_loaded++;
 	}
 	mods_loaded++;
+	log_mask_refresh();
 	switch_mutex_unlock(BINDLOCK);
 
 	return SWITCH_STATUS_SUCCESS;
@@ -511,7 +556,8 @@ static void *SWITCH_THREAD_FUNC log_thread(switch_thread_t *t, void *obj)
 		switch_mutex_lock(BINDLOCK);
 		node->sequence = ++log_sequence;
 		for (binding = BINDINGS; binding; binding = binding->next) {
-			if (binding->level >= node->level) {
+			if (switch_log_check_mask(binding->mask, node->level) ||
+				(switch_log_slevel_wants(node->slevel, node->level) && node->level <= binding->level)) {
 				binding->function(node, node->level);
 			}
 		}
@@ -546,6 +592,38 @@ SWITCH_DECLARE(void) switch_log_printf(switch_text_channel_t channel, const char
 }
 
 #define do_mods (LOG_QUEUE && THREAD_RUNNING)
+
+static void log_date(switch_time_t now, char *buf, switch_size_t len)
+{
+	int64_t sec = now / 1000000;
+	int usec = (int) (now % 1000000);
+	char date[32] = "";
+
+	if (LOG_DATE.mutex && switch_mutex_trylock(LOG_DATE.mutex) == SWITCH_STATUS_SUCCESS) {
+		if (LOG_DATE.sec == sec) {
+			switch_copy_string(date, LOG_DATE.date, sizeof(date));
+		}
+		switch_mutex_unlock(LOG_DATE.mutex);
+	}
+
+	if (!*date) {
+		switch_time_exp_t tm;
+
+		switch_time_exp_lt(&tm, now);
+		switch_snprintf(date, sizeof(date), "%0.4d-%0.2d-%0.2d %0.2d:%0.2d:%0.2d",
+						tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+		if (LOG_DATE.mutex && switch_mutex_trylock(LOG_DATE.mutex) == SWITCH_STATUS_SUCCESS) {
+			if (sec > LOG_DATE.sec) {
+				LOG_DATE.sec = sec;
+				switch_copy_string(LOG_DATE.date, date, sizeof(LOG_DATE.date));
+			}
+			switch_mutex_unlock(LOG_DATE.mutex);
+		}
+	}
+
+	switch_snprintf(buf, len, "%s.%0.6d %0.2f%%%%", date, usec, switch_core_idle_cpu());
+}
 SWITCH_DECLARE(void) switch_log_vprintf(switch_text_channel_t channel, const char *file, const char *func, int line,
 										const char *userdata, switch_log_level_t level, const char *fmt, va_list ap)
 {
@@ -557,6 +635,7 @@ SWITCH_DECLARE(void) switch_log_meta_vprintf(switch_text_channel_t channel, cons
 	cJSON *log_meta = NULL;
 	char *data = NULL;
 	char *new_fmt = NULL;
+	char fmt_buf[512];
 	int ret = 0;
 	FILE *handle;
 	const char *filep = (file ? switch_cut_path(file) : "");
@@ -603,33 +682,38 @@ SWITCH_DECLARE(void) switch_log_meta_vprintf(switch_text_channel_t channel, cons
 
 	switch_assert(level < SWITCH_LOG_INVALID);
 
+	/* once the console belongs to a logger module nothing but the bindings will see the line,
+	   so don't format what none of them wants */
+	if (channel != SWITCH_CHANNEL_ID_EVENT && console_mods_loaded && do_mods &&
+		!switch_log_check_mask(LOG_MASK, level) && !switch_log_slevel_wants(special_level, level)) {
+		goto end;
+	}
+
 	handle = switch_core_data_channel(channel);
 
 	if (channel != SWITCH_CHANNEL_ID_LOG_CLEAN) {
 		char date[80] = "";
-		//switch_size_t retsize;
-		switch_time_exp_t tm;
+		char *fmtp = fmt_buf;
 
-		switch_time_exp_lt(&tm, now);
-		switch_snprintf(date, sizeof(date), "%0.4d-%0.2d-%0.2d %0.2d:%0.2d:%0.2d.%0.6d %0.2f%%%%",
-						tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, tm.tm_usec, switch_core_idle_cpu());
-
-		//switch_strftime_nocheck(date, &retsize, sizeof(date), "%Y-%m-%d %T", &tm);
+		log_date(now, date, sizeof(date));
 
 #ifdef SWITCH_FUNC_IN_LOG
 		len = (uint32_t) (strlen(extra_fmt) + strlen(date) + strlen(filep) + 32 + strlen(funcp) + strlen(fmt));
 #else
 		len = (uint32_t) (strlen(extra_fmt) + strlen(date) + strlen(filep) + 32 + strlen(fmt));
 #endif
-		new_fmt = malloc(len + 1);
-		switch_assert(new_fmt);
+		if (len + 1 > sizeof(fmt_buf)) {
+			new_fmt = malloc(len + 1);
+			switch_assert(new_fmt);
+			fmtp = new_fmt;
+		}
 #ifdef SWITCH_FUNC_IN_LOG
-		switch_snprintf(new_fmt, len, extra_fmt, date, switch_log_level2str(level), filep, line, funcp, 128, fmt);
+		switch_snprintf(fmtp, len, extra_fmt, date, switch_log_level2str(level), filep, line, funcp, 128, fmt);
 #else
-		switch_snprintf(new_fmt, len, extra_fmt, date, switch_log_level2str(level), filep, line, 128, fmt);
+		switch_snprintf(fmtp, len, extra_fmt, date, switch_log_level2str(level), filep, line, 128, fmt);
 #endif
 
-		fmt = new_fmt;
+		fmt = fmtp;
 	}
 
 	ret = switch_vasprintf(&data, fmt, ap);
@@ -703,7 +787,7 @@ SWITCH_DECLARE(void) switch_log_meta_vprintf(switch_text_channel_t channel, cons
 		}
 	}
 
-	if (do_mods && level <= MAX_LEVEL) {
+	if (do_mods && (switch_log_check_mask(LOG_MASK, level) || switch_log_slevel_wants(special_level, level))) {
 		switch_log_node_t *node = switch_log_node_alloc();
 
 		node->data = data;
@@ -757,6 +841,7 @@ SWITCH_DECLARE(switch_status_t) switch_log_init(switch_memory_pool_t *pool, swit
 	switch_queue_create(&LOG_RECYCLE_QUEUE, SWITCH_CORE_QUEUE_LEN, LOG_POOL);
 #endif
 	switch_mutex_init(&BINDLOCK, SWITCH_MUTEX_NESTED, LOG_POOL);
+	switch_mutex_init(&LOG_DATE.mutex, SWITCH_MUTEX_NESTED, LOG_POOL);
 	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
 	switch_thread_create(&thread, thd_attr, log_thread, NULL, LOG_POOL);
 
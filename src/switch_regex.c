@@ -31,6 +31,7 @@
  */
 
 #include <switch.h>
+#include "private/switch_core_pvt.h"
 #include <pcre.h>
 
 SWITCH_DECLARE(switch_regex_t *) switch_regex_compile(const char *pattern,
@@ -52,21 +53,21 @@ SWITCH_DECLARE(void) switch_regex_free(void *data)
 
 }
 
-SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expression, switch_regex_t **new_re, int *ovector, uint32_t olen)
+/* compile /re/flags or a plain expression, ast selects the _ast dialplan syntax */
+static pcre *regex_compile(const char *expression, switch_bool_t ast)
 {
 	const char *error = NULL;
 	int erroffset = 0;
 	pcre *re = NULL;
-	int match_count = 0;
 	char *tmp = NULL;
 	uint32_t flags = 0;
 	char abuf[256] = "";
 
-	if (!(field && expression)) {
-		return 0;
+	if (!expression) {
+		return NULL;
 	}
 
-	if (*expression == '_') {
+	if (ast && *expression == '_') {
 		if (switch_ast2regex(expression + 1, abuf, sizeof(abuf))) {
 			expression = abuf;
 		}
@@ -103,10 +104,323 @@ SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expressi
 	if (error) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "COMPILE ERROR: %d [%s][%s]\n", erroffset, error, expression);
 		switch_regex_safe_free(re);
-		goto end;
 	}
 
-	match_count = pcre_exec(re,	/* result of pcre_compile() */
+  end:
+	switch_safe_free(tmp);
+	return re;
+}
+
+/*
+ * Process wide cache of compiled expressions.
+ *
+ * Entries are keyed by the expression as written (so /re/i and /re/ differ) plus the syntax it
+ * was compiled with, spread over REGEX_CACHE_STRIPES locks and evicted least recently used
+ * first. An entry is only freed once nobody is running it, callers of switch_regex_perform()
+ * that need the pattern afterwards get their own copy of it. An expression that does not compile
+ * is cached too, with a NULL re, so it is only compiled and logged once.
+ */
+#define REGEX_CACHE_STRIPES 16
+
+typedef struct regex_cache_entry {
+	char *key;
+	pcre *re;
+	pcre_extra *extra;
+	int refs;
+	int dead;
+	struct regex_cache_entry *prev;
+	struct regex_cache_entry *next;
+} regex_cache_entry_t;
+
+typedef struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	/* most recently used first */
+	regex_cache_entry_t *head;
+	regex_cache_entry_t *tail;
+	uint32_t count;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+} regex_cache_stripe_t;
+
+static struct {
+	switch_memory_pool_t *pool;
+	regex_cache_stripe_t stripes[REGEX_CACHE_STRIPES];
+	uint32_t stripe_max;
+	int ready;
+} regex_cache;
+
+static void regex_cache_entry_free(regex_cache_entry_t *entry)
+{
+	if (entry->extra) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+		pcre_free_study(entry->extra);
+#else
+		pcre_free(entry->extra);
+#endif
+	}
+	if (entry->re) {
+		pcre_free(entry->re);
+	}
+	free(entry->key);
+	free(entry);
+}
+
+/* must be called with the stripe locked */
+static void regex_cache_unlink(regex_cache_stripe_t *stripe, regex_cache_entry_t *entry)
+{
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		stripe->head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	} else {
+		stripe->tail = entry->prev;
+	}
+
+	entry->prev = entry->next = NULL;
+	stripe->count--;
+}
+
+/* must be called with the stripe locked */
+static void regex_cache_push_front(regex_cache_stripe_t *stripe, regex_cache_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = stripe->head;
+
+	if (stripe->head) {
+		stripe->head->prev = entry;
+	} else {
+		stripe->tail = entry;
+	}
+
+	stripe->head = entry;
+	stripe->count++;
+}
+
+/* must be called with the stripe locked */
+static void regex_cache_drop(regex_cache_stripe_t *stripe, regex_cache_entry_t *entry)
+{
+	regex_cache_unlink(stripe, entry);
+	switch_core_hash_delete(stripe->hash, entry->key);
+	entry->dead = 1;
+
+	if (!entry->refs) {
+		regex_cache_entry_free(entry);
+	}
+}
+
+static regex_cache_stripe_t *regex_cache_stripe(const char *key)
+{
+	uint32_t hash = 2166136261u;
+	const unsigned char *p;
+
+	for (p = (const unsigned char *) key; *p; p++) {
+		hash = (hash ^ *p) * 16777619u;
+	}
+
+	return &regex_cache.stripes[hash % REGEX_CACHE_STRIPES];
+}
+
+/* returns a referenced entry, give it back with regex_cache_release(), NULL only when there is no cache */
+static regex_cache_entry_t *regex_cache_get(const char *expression, switch_bool_t ast)
+{
+	regex_cache_stripe_t *stripe;
+	regex_cache_entry_t *entry, *found;
+	char *key;
+	pcre *re;
+
+	if (!regex_cache.ready) {
+		return NULL;
+	}
+
+	key = switch_mprintf("%c%s", ast ? 'a' : 'r', expression);
+	stripe = regex_cache_stripe(key);
+
+	switch_mutex_lock(stripe->mutex);
+	if ((entry = switch_core_hash_find(stripe->hash, key))) {
+		entry->refs++;
+		stripe->hits++;
+		if (entry != stripe->head) {
+			regex_cache_unlink(stripe, entry);
+			regex_cache_push_front(stripe, entry);
+		}
+	} else {
+		stripe->misses++;
+	}
+	switch_mutex_unlock(stripe->mutex);
+
+	if (entry) {
+		free(key);
+		return entry;
+	}
+
+	/* compile outside of the lock, it's the slow part */
+	re = regex_compile(expression, ast);
+
+	switch_zmalloc(entry, sizeof(*entry));
+	entry->key = key;
+	entry->re = re;
+	entry->refs = 1;
+	if (re) {
+		const char *error = NULL;
+#ifdef PCRE_STUDY_JIT_COMPILE
+		entry->extra = pcre_study(re, PCRE_STUDY_JIT_COMPILE, &error);
+#else
+		entry->extra = pcre_study(re, 0, &error);
+#endif
+	}
+
+	switch_mutex_lock(stripe->mutex);
+	if ((found = switch_core_hash_find(stripe->hash, key))) {
+		/* somebody else compiled it meanwhile */
+		found->refs++;
+		switch_mutex_unlock(stripe->mutex);
+		regex_cache_entry_free(entry);
+		return found;
+	}
+
+	while (stripe->count >= regex_cache.stripe_max && stripe->tail) {
+		stripe->evictions++;
+		regex_cache_drop(stripe, stripe->tail);
+	}
+
+	switch_core_hash_insert(stripe->hash, entry->key, entry);
+	regex_cache_push_front(stripe, entry);
+	switch_mutex_unlock(stripe->mutex);
+
+	return entry;
+}
+
+static void regex_cache_release(regex_cache_entry_t *entry)
+{
+	regex_cache_stripe_t *stripe = regex_cache_stripe(entry->key);
+	int free_it;
+
+	switch_mutex_lock(stripe->mutex);
+	free_it = !--entry->refs && entry->dead;
+	switch_mutex_unlock(stripe->mutex);
+
+	if (free_it) {
+		regex_cache_entry_free(entry);
+	}
+}
+
+/* a private copy of the compiled pattern, it is one relocatable block in pcre */
+static switch_regex_t *regex_cache_copy(regex_cache_entry_t *entry)
+{
+	size_t size = 0;
+	void *copy;
+
+	if (pcre_fullinfo(entry->re, NULL, PCRE_INFO_SIZE, &size) || !size || !(copy = pcre_malloc(size))) {
+		return NULL;
+	}
+
+	memcpy(copy, entry->re, size);
+
+	return (switch_regex_t *) copy;
+}
+
+void switch_regex_cache_init(switch_memory_pool_t *pool, uint32_t max)
+{
+	int i;
+
+	if (regex_cache.ready) {
+		return;
+	}
+
+	regex_cache.pool = pool;
+	regex_cache.stripe_max = max / REGEX_CACHE_STRIPES;
+
+	if (!regex_cache.stripe_max) {
+		regex_cache.stripe_max = 1;
+	}
+
+	for (i = 0; i < REGEX_CACHE_STRIPES; i++) {
+		switch_mutex_init(&regex_cache.stripes[i].mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_core_hash_init(&regex_cache.stripes[i].hash);
+	}
+
+	regex_cache.ready = 1;
+}
+
+void switch_regex_cache_destroy(void)
+{
+	int i;
+
+	if (!regex_cache.ready) {
+		return;
+	}
+
+	switch_regex_cache_flush();
+	regex_cache.ready = 0;
+
+	for (i = 0; i < REGEX_CACHE_STRIPES; i++) {
+		switch_core_hash_destroy(&regex_cache.stripes[i].hash);
+	}
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_flush(void)
+{
+	int i;
+
+	if (!regex_cache.ready) {
+		return;
+	}
+
+	for (i = 0; i < REGEX_CACHE_STRIPES; i++) {
+		regex_cache_stripe_t *stripe = &regex_cache.stripes[i];
+
+		switch_mutex_lock(stripe->mutex);
+		while (stripe->head) {
+			regex_cache_drop(stripe, stripe->head);
+		}
+		switch_mutex_unlock(stripe->mutex);
+	}
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_stats(switch_regex_cache_stats_t *stats)
+{
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (!regex_cache.ready) {
+		return;
+	}
+
+	stats->max = regex_cache.stripe_max * REGEX_CACHE_STRIPES;
+
+	for (i = 0; i < REGEX_CACHE_STRIPES; i++) {
+		regex_cache_stripe_t *stripe = &regex_cache.stripes[i];
+
+		switch_mutex_lock(stripe->mutex);
+		stats->entries += stripe->count;
+		stats->hits += stripe->hits;
+		stats->misses += stripe->misses;
+		stats->evictions += stripe->evictions;
+		switch_mutex_unlock(stripe->mutex);
+	}
+}
+
+SWITCH_DECLARE(switch_regex_t *) switch_regex_compile_expression(const char *expression)
+{
+	return (switch_regex_t *) regex_compile(expression, SWITCH_TRUE);
+}
+
+SWITCH_DECLARE(int) switch_regex_exec(switch_regex_t *re, const char *field, int *ovector, uint32_t olen)
+{
+	int match_count;
+
+	if (!(re && field)) {
+		return 0;
+	}
+
+	match_count = pcre_exec((pcre *) re,	/* result of pcre_compile() */
 							NULL,	/* we didn't study the pattern */
 							field,	/* the subject string */
 							(int) strlen(field),	/* the length of the subject string */
@@ -115,16 +429,54 @@ SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expressi
 							ovector,	/* vector of integers for substring information */
 							olen);	/* number of elements (NOT size in bytes) */
 
+	return match_count > 0 ? match_count : 0;
+}
+
+SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expression, switch_regex_t **new_re, int *ovector, uint32_t olen)
+{
+	switch_regex_t *re = NULL;
+	regex_cache_entry_t *entry;
+	int match_count = 0;
+
+	if (!(field && expression)) {
+		return 0;
+	}
+
+	if ((entry = regex_cache_get(expression, SWITCH_TRUE))) {
+		if (!entry->re) {
+			regex_cache_release(entry);
+			*new_re = NULL;
+			return 0;
+		}
+
+		match_count = pcre_exec(entry->re, entry->extra, field, (int) strlen(field), 0, 0, ovector, olen);
+
+		/* the caller owns *new_re so it gets a copy, and only when there is something to substitute */
+		if (match_count > 0 && !(re = regex_cache_copy(entry))) {
+			match_count = 0;
+		}
+
+		regex_cache_release(entry);
+
+		if (match_count < 0) {
+			match_count = 0;
+		}
+
+		*new_re = re;
+
+		return match_count;
+	}
 
-	if (match_count <= 0) {
+	if (!(re = switch_regex_compile_expression(expression))) {
+		return 0;
+	}
+
+	if (!(match_count = switch_regex_exec(re, field, ovector, olen))) {
 		switch_regex_safe_free(re);
-		match_count = 0;
 	}
 
-	*new_re = (switch_regex_t *) re;
+	*new_re = re;
 
-  end:
-	switch_safe_free(tmp);
 	return match_count;
 }
 
@@ -214,53 +566,23 @@ SWITCH_DECLARE(void) switch_capture_regex(switch_regex_t *re, int match_count, c
 
 SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, const char *expression, int *partial)
 {
-	const char *error = NULL;	/* Used to hold any errors                                           */
-	int error_offset = 0;		/* Holds the offset of an error                                      */
+	regex_cache_entry_t *entry = NULL;
 	pcre *pcre_prepared = NULL;	/* Holds the compiled regex                                          */
+	pcre_extra *pcre_extra = NULL;
 	int match_count = 0;		/* Number of times the regex was matched                             */
 	int offset_vectors[255];	/* not used, but has to exist or pcre won't even try to find a match */
 	int pcre_flags = 0;
-	uint32_t flags = 0;
-	char *tmp = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 
-	if (*expression == '/') {
-		char *opts = NULL;
-		tmp = strdup(expression + 1);
-		switch_assert(tmp);
-		if ((opts = strrchr(tmp, '/'))) {
-			*opts++ = '\0';
-		} else {
-			/* Note our error */
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-							  "Regular Expression Error expression[%s] missing ending '/' delimeter\n", expression);
+	/* Compile the expression, or find it already compiled */
+	if ((entry = regex_cache_get(expression, SWITCH_FALSE))) {
+		if (!entry->re) {
+			regex_cache_release(entry);
 			goto end;
 		}
-		expression = tmp;
-		if (*opts) {
-			if (strchr(opts, 'i')) {
-				flags |= PCRE_CASELESS;
-			}
-			if (strchr(opts, 's')) {
-				flags |= PCRE_DOTALL;
-			}
-		}
-	}
-
-	/* Compile the expression */
-	pcre_prepared = pcre_compile(expression, flags, &error, &error_offset, NULL);
-
-	/* See if there was an error in the expression */
-	if (error != NULL) {
-		/* Clean up after ourselves */
-		if (pcre_prepared) {
-			pcre_free(pcre_prepared);
-			pcre_prepared = NULL;
-		}
-		/* Note our error */
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-						  "Regular Expression Error expression[%s] error[%s] location[%d]\n", expression, error, error_offset);
-
+		pcre_prepared = entry->re;
+		pcre_extra = entry->extra;
+	} else if (!(pcre_prepared = regex_compile(expression, SWITCH_FALSE))) {
 		/* We definitely didn't match anything */
 		goto end;
 	}
@@ -271,13 +593,15 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, c
 
 	/* So far so good, run the regex */
 	match_count =
-		pcre_exec(pcre_prepared, NULL, target, (int) strlen(target), 0, pcre_flags, offset_vectors, sizeof(offset_vectors) / sizeof(offset_vectors[0]));
+		pcre_exec(pcre_prepared, pcre_extra, target, (int) strlen(target), 0, pcre_flags, offset_vectors, sizeof(offset_vectors) / sizeof(offset_vectors[0]));
 
 	/* Clean up */
-	if (pcre_prepared) {
+	if (entry) {
+		regex_cache_release(entry);
+	} else {
 		pcre_free(pcre_prepared);
-		pcre_prepared = NULL;
 	}
+	pcre_prepared = NULL;
 
 	/* switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "number of matches: %d\n", match_count); */
 
@@ -293,7 +617,6 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, c
 		goto end;
 	}
  end:
-	switch_safe_free(tmp);
 	return status;
 }
 
@@ -93,6 +93,7 @@ static switch_port_t START_PORT = RTP_START_PORT;
 static switch_port_t END_PORT = RTP_END_PORT;
 static switch_mutex_t *port_lock = NULL;
 static switch_size_t do_flush(switch_rtp_t *rtp_session, int force, switch_size_t bytes_in);
+static switch_status_t rtp_tx_flush(switch_rtp_t *rtp_session);
 
 typedef srtp_hdr_t rtp_hdr_t;
 
@@ -117,6 +118,18 @@ typedef struct {
 
 #define RTP_BODY(_s) (char *) (_s->recv_msg.ebody ? _s->recv_msg.ebody : _s->recv_msg.body)
 
+/* slot size for the batched socket paths; anything bigger goes through recv_msg/send_msg one at a time */
+#define RTP_BATCH_SLOT_LEN 2048
+
+typedef struct {
+	switch_sockaddr_t *from[SWITCH_SOCKET_BATCH_MAX];
+	char *bufs[SWITCH_SOCKET_BATCH_MAX];
+	switch_size_t lens[SWITCH_SOCKET_BATCH_MAX];
+	int count;
+	int pos;
+	uint32_t ts;
+} rtp_batch_t;
+
 typedef struct {
 	uint32_t ssrc;
 	uint8_t seq;
@@ -487,6 +500,10 @@ struct switch_rtp {
 	uint32_t last_max_vb_frames;
 	int skip_timer;
 	uint32_t prev_nacks_inflight;
+	uint8_t batch_rx;
+	uint8_t batch_tx;
+	rtp_batch_t *rx_batch;
+	rtp_batch_t *tx_batch;
 };
 
 struct switch_rtcp_report_block {
@@ -3137,6 +3154,7 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_set_remote_address(switch_rtp_t *rtp_
 
 	switch_mutex_lock(rtp_session->write_mutex);
 
+	rtp_tx_flush(rtp_session);
 	rtp_session->remote_addr = remote_addr;
 
 	if (change_adv_addr) {
@@ -4506,6 +4524,18 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_create(switch_rtp_t **new_rtp_session
 
 	switch_rtp_set_flags(rtp_session, flags);
 
+#ifdef HAVE_RECVMMSG
+	if (rtp_session->flags[SWITCH_RTP_FLAG_VIDEO] || (channel && switch_channel_var_true(channel, "rtp_batch_io"))) {
+		rtp_session->batch_rx = 1;
+	}
+#endif
+#ifdef HAVE_SENDMMSG
+	/* only video puts several packets on the wire per tick */
+	if (rtp_session->flags[SWITCH_RTP_FLAG_VIDEO]) {
+		rtp_session->batch_tx = 1;
+	}
+#endif
+
 	/* for from address on recvfrom calls */
 	switch_sockaddr_create(&rtp_session->from_addr, pool);
 	switch_sockaddr_create(&rtp_session->rtp_from_addr, pool);
@@ -5205,6 +5235,9 @@ SWITCH_DECLARE(void) switch_rtp_destroy(switch_rtp_t **rtp_session)
 
 	(*rtp_session)->ready = 0;
 
+	/* the rest of a frame whose marker never came, the socket is still open so send it rather than lose it */
+	rtp_tx_flush(*rtp_session);
+
 	WRITE_DEC((*rtp_session));
 	READ_DEC((*rtp_session));
 
@@ -5670,6 +5703,176 @@ static int jb_valid(switch_rtp_t *rtp_session)
 	return 1;
 }
 
+static rtp_batch_t *rtp_batch_create(switch_rtp_t *rtp_session, switch_bool_t rx)
+{
+	rtp_batch_t *batch = switch_core_alloc(rtp_session->pool, sizeof(*batch));
+	int i = 0;
+
+	if (rx) {
+		/* the first datagram of every read lands straight in recv_msg */
+		batch->bufs[0] = (char *) &rtp_session->recv_msg;
+		batch->from[0] = rtp_session->from_addr;
+		i = 1;
+	}
+
+	for (; i < SWITCH_SOCKET_BATCH_MAX; i++) {
+		batch->bufs[i] = switch_core_alloc(rtp_session->pool, RTP_BATCH_SLOT_LEN);
+		if (rx) {
+			switch_sockaddr_create(&batch->from[i], rtp_session->pool);
+		}
+	}
+
+	return batch;
+}
+
+static inline int rtp_rx_pending(switch_rtp_t *rtp_session)
+{
+	return rtp_session->rx_batch && rtp_session->rx_batch->pos < rtp_session->rx_batch->count;
+}
+
+static switch_status_t rtp_read_poll(switch_rtp_t *rtp_session, int32_t *fdr, switch_interval_time_t timeout)
+{
+	if (rtp_rx_pending(rtp_session)) {
+		*fdr = 1;
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	return switch_poll(rtp_session->read_pollfd, 1, fdr, timeout);
+}
+
+/* Receive one datagram into recv_msg/from_addr, handing out whatever the last batched read queued first */
+static switch_status_t rtp_recv(switch_rtp_t *rtp_session, switch_size_t *bytes)
+{
+	rtp_batch_t *rx = rtp_session->rx_batch;
+	switch_status_t status;
+	int i, count = SWITCH_SOCKET_BATCH_MAX;
+
+	while (rtp_rx_pending(rtp_session)) {
+		i = rx->pos++;
+
+		if (rx->lens[i]) {
+			memcpy(&rtp_session->recv_msg, rx->bufs[i], rx->lens[i]);
+			switch_cp_addr(rtp_session->from_addr, rx->from[i]);
+			*bytes = rx->lens[i];
+			return SWITCH_STATUS_SUCCESS;
+		}
+	}
+
+	if (!rtp_session->batch_rx) {
+		status = switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, bytes);
+		rtp_session->stats.inbound.io_call_count++;
+		if (*bytes) {
+			rtp_session->stats.inbound.io_packet_count++;
+		}
+		return status;
+	}
+
+	if (!rx) {
+		rx = rtp_session->rx_batch = rtp_batch_create(rtp_session, SWITCH_TRUE);
+	}
+
+	rx->lens[0] = *bytes;
+	for (i = 1; i < SWITCH_SOCKET_BATCH_MAX; i++) {
+		rx->lens[i] = RTP_BATCH_SLOT_LEN;
+	}
+
+	rx->pos = rx->count = 0;
+	status = switch_socket_recvfrom_batch(rx->from, rtp_session->sock_input, 0, rx->bufs, rx->lens, &count);
+	rtp_session->stats.inbound.io_call_count++;
+
+	if (status != SWITCH_STATUS_SUCCESS || !count) {
+		*bytes = 0;
+		return status;
+	}
+
+	rtp_session->stats.inbound.io_packet_count += count;
+
+	for (i = 1; i < count; i++) {
+		if (!rx->lens[i] && rtp_session->batch_rx) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_WARNING,
+							  "%s datagram larger than %d bytes, disabling batched reads\n", rtp_session_name(rtp_session), RTP_BATCH_SLOT_LEN);
+			rtp_session->batch_rx = 0;
+		}
+	}
+
+	rx->pos = 1;
+	rx->count = count;
+	*bytes = rx->lens[0];
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t rtp_tx_flush(switch_rtp_t *rtp_session)
+{
+	rtp_batch_t *tx = rtp_session->tx_batch;
+	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	int count;
+
+	if (!tx || !tx->count) {
+		return status;
+	}
+
+	switch_mutex_lock(rtp_session->write_mutex);
+
+	if ((count = tx->count)) {
+		status = switch_socket_sendto_batch(rtp_session->sock_output, rtp_session->remote_addr, 0, (const void * const *) tx->bufs, tx->lens, &count);
+		rtp_session->stats.outbound.io_call_count++;
+		rtp_session->stats.outbound.io_packet_count += count;
+
+		if (status != SWITCH_STATUS_SUCCESS || count < tx->count) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG,
+							  "%s batched write sent %d of %d packets\n", rtp_session_name(rtp_session), count, tx->count);
+		}
+
+		tx->count = 0;
+	}
+
+	switch_mutex_unlock(rtp_session->write_mutex);
+
+	return status;
+}
+
+/* Send one RTP packet, or queue it until the end of the frame when batched writes are on */
+static switch_status_t rtp_send(switch_rtp_t *rtp_session, void *data, switch_size_t *bytes)
+{
+	rtp_hdr_t *hdr = (rtp_hdr_t *) data;
+	rtp_batch_t *tx;
+
+	if (!rtp_session->batch_tx || *bytes > RTP_BATCH_SLOT_LEN) {
+		switch_status_t status;
+
+		rtp_tx_flush(rtp_session);
+		status = switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, data, bytes);
+		rtp_session->stats.outbound.io_call_count++;
+		if (status == SWITCH_STATUS_SUCCESS) {
+			rtp_session->stats.outbound.io_packet_count++;
+		}
+		return status;
+	}
+
+	switch_mutex_lock(rtp_session->write_mutex);
+
+	if (!(tx = rtp_session->tx_batch)) {
+		tx = rtp_session->tx_batch = rtp_batch_create(rtp_session, SWITCH_FALSE);
+	}
+
+	/* the marker normally ends the frame; a new timestamp means we missed it */
+	if (tx->count && tx->ts != hdr->ts) {
+		rtp_tx_flush(rtp_session);
+	}
+
+	memcpy(tx->bufs[tx->count], data, *bytes);
+	tx->lens[tx->count++] = *bytes;
+	tx->ts = hdr->ts;
+
+	if (hdr->m || tx->count == SWITCH_SOCKET_BATCH_MAX) {
+		rtp_tx_flush(rtp_session);
+	}
+
+	switch_mutex_unlock(rtp_session->write_mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
 
 static switch_size_t do_flush(switch_rtp_t *rtp_session, int force, switch_size_t bytes_in)
 {
@@ -5738,7 +5941,7 @@ static switch_size_t do_flush(switch_rtp_t *rtp_session, int force, switch_size_
 		do {
 			if (switch_rtp_ready(rtp_session)) {
 				bytes = sizeof(rtp_msg_t);
-				switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, &bytes);
+				rtp_recv(rtp_session, &bytes);
 
 				if (bytes) {
 					int do_cng = 0;
@@ -5879,7 +6082,7 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 			}
 		}
 
-		poll_status = switch_poll(rtp_session->read_pollfd, 1, &fdr, to);
+		poll_status = rtp_read_poll(rtp_session, &fdr, to);
 
 		if (rtp_session->flags[SWITCH_RTP_FLAG_USE_TIMER] && rtp_session->timer.interval) {
 			switch_core_timer_sync(&rtp_session->timer);
@@ -5905,7 +6108,7 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 	memset(&rtp_session->last_rtp_hdr, 0, sizeof(rtp_session->last_rtp_hdr));
 
 	if (poll_status == SWITCH_STATUS_SUCCESS) {
-		status = switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, bytes);
+		status = rtp_recv(rtp_session, bytes);
 	} else {
 		*bytes = 0;
 	}
@@ -7212,7 +7415,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 			rtp_session->read_pollfd) {
 
 			if (rtp_session->jb && !rtp_session->pause_jb && jb_valid(rtp_session)) {
-				while (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+				while (rtp_read_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
 					status = read_rtp_packet(rtp_session, &bytes, flags, pmapP, SWITCH_STATUS_SUCCESS, SWITCH_FALSE);
 
 					if (status == SWITCH_STATUS_GENERR) {
@@ -7235,7 +7438,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 
 			} else if ((rtp_session->flags[SWITCH_RTP_FLAG_AUTOFLUSH] || rtp_session->flags[SWITCH_RTP_FLAG_STICKY_FLUSH])) {
 
-				if (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+				if (rtp_read_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
 					status = read_rtp_packet(rtp_session, &bytes, flags, pmapP, SWITCH_STATUS_SUCCESS, SWITCH_FALSE);
 					if (status == SWITCH_STATUS_GENERR) {
 						ret = -1;
@@ -7254,7 +7457,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 					}
 
 					if (bytes) {
-						if (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+						if (rtp_read_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
 							rtp_session->hot_hits++;//+= rtp_session->samples_per_interval;
 
 							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG10, "%s Hot Hit %d\n",
@@ -7364,7 +7567,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 				pt = 0;
 			}
 
-			poll_status = switch_poll(rtp_session->read_pollfd, 1, &fdr, pt);
+			poll_status = rtp_read_poll(rtp_session, &fdr, pt);
 
 			if (rtp_session->flags[SWITCH_RTP_FLAG_VIDEO] && poll_status != SWITCH_STATUS_SUCCESS && rtp_session->media_timeout && rtp_session->last_media) {
 				check_timeout(rtp_session);
@@ -8597,7 +8800,7 @@ static int rtp_common_write(switch_rtp_t *rtp_session,
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ALERT,
 								  "Simulate dropping packet ......... ts: %u seq: %u\n", ntohl(send_msg->header.ts), ntohs(send_msg->header.seq));
 			} else {
-				if (switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, (void *) send_msg, &bytes) != SWITCH_STATUS_SUCCESS) {
+				if (rtp_send(rtp_session, (void *) send_msg, &bytes) != SWITCH_STATUS_SUCCESS) {
 					rtp_session->seq--;
 					ret = -1;
 					goto end;
@@ -8611,7 +8814,7 @@ static int rtp_common_write(switch_rtp_t *rtp_session,
 		//
 		//	//switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "SEND %u\n", ntohs(send_msg->header.seq));
 		//}
-		if (switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, (void *) send_msg, &bytes) != SWITCH_STATUS_SUCCESS) {
+		if (rtp_send(rtp_session, (void *) send_msg, &bytes) != SWITCH_STATUS_SUCCESS) {
 			rtp_session->seq -= delta;
 
 			ret = -1;
@@ -8803,7 +9006,7 @@ SWITCH_DECLARE(int) switch_rtp_write_frame(switch_rtp_t *rtp_session, switch_fra
 
 		}
 
-		if ((status = switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, frame->packet, &bytes)) != SWITCH_STATUS_SUCCESS) {
+		if ((status = rtp_send(rtp_session, frame->packet, &bytes)) != SWITCH_STATUS_SUCCESS) {
 			if (rtp_session->flags[SWITCH_RTP_FLAG_DEBUG_RTP_WRITE]) {
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(rtp_session->session), SWITCH_LOG_ERROR, "bytes: %" SWITCH_SIZE_T_FMT ", status: %d", bytes, status);
 			}
@@ -9055,6 +9258,7 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_write_raw(switch_rtp_t *rtp_session,
 #endif
 	}
 
+	rtp_tx_flush(rtp_session);
 	status = switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, data, bytes);
 #if defined(ENABLE_SRTP)
  end:
@@ -32,35 +32,190 @@
 
 #include <switch.h>
 
+/* Threads running the SSHF_OWN_THREAD tasks, more are started while they are all busy, past the cap tasks wait in the queue */
+#define SCHEDULER_MIN_WORKERS 2
+#define SCHEDULER_MAX_WORKERS 64
+/* Longest the task thread sleeps without looking at the next due task */
+#define SCHEDULER_MAX_WAIT 500000
+/* How long an SSHF_OWN_THREAD task is put back when even the worker queue is full */
+#define SCHEDULER_REQUEUE_DELAY 10000
+
 struct switch_scheduler_task_container {
 	switch_scheduler_task_t task;
-	int64_t executed;
-	int in_thread;
-	int destroyed;
+	/* when the task is due, in microseconds since the epoch */
+	switch_time_t due;
+	switch_time_t executed;
 	int running;
 	int destroy_requested;
+	/* slot in the heap, -1 while the task is not waiting */
+	int32_t heap_index;
 	switch_scheduler_func_t func;
-	switch_memory_pool_t *pool;
 	uint32_t flags;
 	char *desc;
-	struct switch_scheduler_task_container *next;
+	/* the other tasks of the same group */
+	struct switch_scheduler_task_container *group_next;
+	struct switch_scheduler_task_container *group_prev;
 };
 typedef struct switch_scheduler_task_container switch_scheduler_task_container_t;
 
 static struct {
-	switch_scheduler_task_container_t *task_list;
+	/* waiting tasks, a binary min-heap on due */
+	switch_scheduler_task_container_t **heap;
+	uint32_t heap_len;
+	uint32_t heap_size;
+	/* every task by id, and the first task of every group by name */
+	switch_inthash_t *task_ids;
+	switch_hash_t *task_groups;
 	switch_mutex_t *task_mutex;
 	uint32_t task_id;
 	int task_thread_running;
 	switch_queue_t *event_queue;
+	switch_queue_t *worker_queue;
+	switch_thread_t *workers[SCHEDULER_MAX_WORKERS];
+	uint32_t worker_count;
+	/* workers with nothing to do, negative when tasks are queued waiting for one */
+	int32_t idle_workers;
 	switch_memory_pool_t *memory_pool;
 } globals = { 0 };
 
-static void switch_scheduler_execute(switch_scheduler_task_container_t *tp)
+static void heap_set(uint32_t i, switch_scheduler_task_container_t *tp)
+{
+	globals.heap[i] = tp;
+	tp->heap_index = (int32_t) i;
+}
+
+static void heap_up(uint32_t i)
+{
+	switch_scheduler_task_container_t *tp = globals.heap[i];
+
+	while (i > 0) {
+		uint32_t parent = (i - 1) / 2;
+
+		if (globals.heap[parent]->due <= tp->due) {
+			break;
+		}
+		heap_set(i, globals.heap[parent]);
+		i = parent;
+	}
+	heap_set(i, tp);
+}
+
+static void heap_down(uint32_t i)
+{
+	switch_scheduler_task_container_t *tp = globals.heap[i];
+
+	for (;;) {
+		uint32_t child = 2 * i + 1;
+
+		if (child >= globals.heap_len) {
+			break;
+		}
+		if (child + 1 < globals.heap_len && globals.heap[child + 1]->due < globals.heap[child]->due) {
+			child++;
+		}
+		if (tp->due <= globals.heap[child]->due) {
+			break;
+		}
+		heap_set(i, globals.heap[child]);
+		i = child;
+	}
+	heap_set(i, tp);
+}
+
+static void heap_push(switch_scheduler_task_container_t *tp)
+{
+	if (globals.heap_len == globals.heap_size) {
+		globals.heap_size = globals.heap_size ? globals.heap_size * 2 : 1024;
+		globals.heap = realloc(globals.heap, globals.heap_size * sizeof(*globals.heap));
+		switch_assert(globals.heap);
+	}
+
+	heap_set(globals.heap_len++, tp);
+	heap_up(tp->heap_index);
+}
+
+static void heap_remove(switch_scheduler_task_container_t *tp)
+{
+	uint32_t i = (uint32_t) tp->heap_index;
+	switch_scheduler_task_container_t *last = globals.heap[--globals.heap_len];
+
+	tp->heap_index = -1;
+
+	if (last != tp) {
+		heap_set(i, last);
+		heap_up(i);
+		heap_down((uint32_t) last->heap_index);
+	}
+}
+
+static void group_link(switch_scheduler_task_container_t *tp)
+{
+	switch_scheduler_task_container_t *head = switch_core_hash_find(globals.task_groups, tp->task.group);
+
+	tp->group_prev = NULL;
+	tp->group_next = head;
+	if (head) {
+		head->group_prev = tp;
+	}
+	switch_core_hash_insert(globals.task_groups, tp->task.group, tp);
+}
+
+static void group_unlink(switch_scheduler_task_container_t *tp)
+{
+	if (tp->group_prev) {
+		tp->group_prev->group_next = tp->group_next;
+	} else if (tp->group_next) {
+		switch_core_hash_insert(globals.task_groups, tp->task.group, tp->group_next);
+	} else {
+		switch_core_hash_delete(globals.task_groups, tp->task.group);
+	}
+
+	if (tp->group_next) {
+		tp->group_next->group_prev = tp->group_prev;
+	}
+}
+
+static void queue_task_event(switch_event_types_t event_id, switch_scheduler_task_container_t *tp)
 {
 	switch_event_t *event;
+
+	if (switch_event_create(&event, event_id) == SWITCH_STATUS_SUCCESS) {
+		switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-ID", "%u", tp->task.task_id);
+		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Desc", tp->desc);
+		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Group", switch_str_nil(tp->task.group));
+		switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-Runtime", "%" SWITCH_INT64_T_FMT, tp->task.runtime);
+		switch_queue_push(globals.event_queue, event);
+		event = NULL;
+	}
+}
+
+/* Must be called with the task_mutex held, for a task that is neither waiting nor running */
+static void task_destroy(switch_scheduler_task_container_t *tp)
+{
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Deleting task %u %s (%s)\n",
+					  tp->task.task_id, tp->desc, switch_str_nil(tp->task.group));
+
+	queue_task_event(SWITCH_EVENT_DEL_SCHEDULE, tp);
+
+	switch_core_inthash_delete(globals.task_ids, tp->task.task_id);
+	group_unlink(tp);
+
+	switch_safe_free(tp->task.group);
+	if (tp->task.cmd_arg && switch_test_flag(tp, SSHF_FREE_ARG)) {
+		free(tp->task.cmd_arg);
+	}
+	switch_safe_free(tp->desc);
+	free(tp);
+}
+
+static void switch_scheduler_execute(switch_scheduler_task_container_t *tp)
+{
+	int64_t runtime = tp->task.runtime;
+	switch_time_t due;
+
 	//switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Executing task %u %s (%s)\n", tp->task.task_id, tp->desc, switch_str_nil(tp->task.group));
 
+	tp->task.runtime_us = tp->due;
 	tp->func(&tp->task);
 
 	switch_mutex_lock(globals.task_mutex);
@@ -68,133 +223,158 @@ static void switch_scheduler_execute(switch_scheduler_task_container_t *tp)
 		tp->task.runtime = switch_epoch_time_now(NULL) + tp->task.repeat;
 	}
 
-	if (!tp->destroy_requested && tp->task.runtime > tp->executed) {
-		tp->executed = 0;
-		if (switch_event_create(&event, SWITCH_EVENT_RE_SCHEDULE) == SWITCH_STATUS_SUCCESS) {
-			switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-ID", "%u", tp->task.task_id);
-			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Desc", tp->desc);
-			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Group", switch_str_nil(tp->task.group));
-			switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-Runtime", "%" SWITCH_INT64_T_FMT, tp->task.runtime);
-			switch_queue_push(globals.event_queue, event);
-			event = NULL;
-		}
+	/* the callback reschedules by moving either runtime (seconds) or runtime_us */
+	if (tp->task.runtime_us != tp->due) {
+		due = tp->task.runtime_us;
+	} else if (tp->task.runtime != runtime) {
+		due = tp->task.runtime * 1000000;
+	} else {
+		due = tp->due;
+	}
+
+	tp->running = 0;
+
+	if (!tp->destroy_requested && due > tp->executed) {
+		tp->due = tp->task.runtime_us = due;
+		tp->task.runtime = due / 1000000;
+		queue_task_event(SWITCH_EVENT_RE_SCHEDULE, tp);
+		heap_push(tp);
 	} else {
-		tp->destroyed = 1;
+		task_destroy(tp);
 	}
 	switch_mutex_unlock(globals.task_mutex);
 }
 
-static void *SWITCH_THREAD_FUNC task_own_thread(switch_thread_t *thread, void *obj)
+static void *SWITCH_THREAD_FUNC task_worker_thread(switch_thread_t *thread, void *obj)
 {
-	switch_scheduler_task_container_t *tp = (switch_scheduler_task_container_t *) obj;
-	switch_memory_pool_t *pool;
+	void *pop;
 
-	pool = tp->pool;
-	tp->pool = NULL;
+	while (switch_queue_pop(globals.worker_queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		switch_scheduler_execute((switch_scheduler_task_container_t *) pop);
 
-	switch_scheduler_execute(tp);
-	switch_core_destroy_memory_pool(&pool);
-	tp->in_thread = 0;
+		switch_mutex_lock(globals.task_mutex);
+		globals.idle_workers++;
+		switch_mutex_unlock(globals.task_mutex);
+	}
 
 	return NULL;
 }
 
-static int task_thread_loop(int done)
+/* Must be called with the task_mutex held */
+static switch_status_t task_worker_start(void)
 {
-	switch_scheduler_task_container_t *tofree, *tp, *last = NULL;
+	switch_threadattr_t *thd_attr;
 
+	if (globals.worker_count >= SCHEDULER_MAX_WORKERS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_threadattr_create(&thd_attr, globals.memory_pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+	if (switch_thread_create(&globals.workers[globals.worker_count], thd_attr, task_worker_thread, NULL, globals.memory_pool) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	globals.worker_count++;
+	globals.idle_workers++;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* Runs every task that is due and returns how long to sleep until the next one */
+static switch_interval_time_t task_thread_loop(void)
+{
+	switch_interval_time_t wait = SCHEDULER_MAX_WAIT;
 
 	switch_mutex_lock(globals.task_mutex);
 
-	for (tp = globals.task_list; tp; tp = tp->next) {
-		if (done) {
-			tp->destroyed = 1;
-		} else if (!tp->destroyed) {
-			int64_t now = switch_epoch_time_now(NULL);
-			if (now >= tp->task.runtime && !tp->in_thread) {
-				int32_t diff = (int32_t) (now - tp->task.runtime);
-				if (diff > 1) {
-					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Task was executed late by %d seconds %u %s (%s)\n",
-									  diff, tp->task.task_id, tp->desc, switch_str_nil(tp->task.group));
-				}
-				tp->executed = now;
-				if (switch_test_flag(tp, SSHF_OWN_THREAD)) {
-					switch_thread_t *thread;
-					switch_threadattr_t *thd_attr;
-					switch_core_new_memory_pool(&tp->pool);
-					switch_threadattr_create(&thd_attr, tp->pool);
-					switch_threadattr_detach_set(thd_attr, 1);
-					tp->in_thread = 1;
-					switch_thread_create(&thread, thd_attr, task_own_thread, tp, tp->pool);
-				} else {
-					tp->running = 1;
-					switch_mutex_unlock(globals.task_mutex);
-					switch_scheduler_execute(tp);
-					switch_mutex_lock(globals.task_mutex);
-					tp->running = 0;
-				}
+	while (globals.heap_len) {
+		switch_scheduler_task_container_t *tp = globals.heap[0];
+		switch_time_t now = switch_micro_time_now();
+		int32_t diff;
+
+		if (tp->due > now) {
+			if (tp->due - now < wait) {
+				wait = tp->due - now;
 			}
+			break;
+		}
+
+		heap_remove(tp);
+
+		diff = (int32_t) ((now - tp->due) / 1000000);
+		if (diff > 1) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Task was executed late by %d seconds %u %s (%s)\n",
+							  diff, tp->task.task_id, tp->desc, switch_str_nil(tp->task.group));
 		}
-	}
-	switch_mutex_unlock(globals.task_mutex);
-	switch_mutex_lock(globals.task_mutex);
-	for (tp = globals.task_list; tp;) {
-		if (tp->destroyed && !tp->in_thread) {
-			switch_event_t *event;
-
-			tofree = tp;
-			tp = tp->next;
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Deleting task %u %s (%s)\n",
-							  tofree->task.task_id, tofree->desc, switch_str_nil(tofree->task.group));
-
-
-			if (switch_event_create(&event, SWITCH_EVENT_DEL_SCHEDULE) == SWITCH_STATUS_SUCCESS) {
-				switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-ID", "%u", tofree->task.task_id);
-				switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Desc", tofree->desc);
-				switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Group", switch_str_nil(tofree->task.group));
-				switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-Runtime", "%" SWITCH_INT64_T_FMT, tofree->task.runtime);
-				switch_queue_push(globals.event_queue, event);
-				event = NULL;
-			}
 
-			if (last) {
-				last->next = tofree->next;
-			} else {
-				globals.task_list = tofree->next;
+		tp->executed = now;
+		tp->running = 1;
+
+		if (switch_test_flag(tp, SSHF_OWN_THREAD)) {
+			/* never run these inline, one slow task would hold up everything else that is due */
+			if (globals.idle_workers <= 0) {
+				task_worker_start();
 			}
-			switch_safe_free(tofree->task.group);
-			if (tofree->task.cmd_arg && switch_test_flag(tofree, SSHF_FREE_ARG)) {
-				free(tofree->task.cmd_arg);
+
+			if (switch_queue_trypush(globals.worker_queue, tp) == SWITCH_STATUS_SUCCESS) {
+				globals.idle_workers--;
+				continue;
 			}
-			switch_safe_free(tofree->desc);
-			free(tofree);
-		} else {
-			last = tp;
-			tp = tp->next;
+
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Worker queue full, delaying task %u %s (%s)\n",
+							  tp->task.task_id, tp->desc, switch_str_nil(tp->task.group));
+			tp->running = 0;
+			tp->due = tp->task.runtime_us = now + SCHEDULER_REQUEUE_DELAY;
+			heap_push(tp);
+			continue;
 		}
+
+		switch_mutex_unlock(globals.task_mutex);
+		switch_scheduler_execute(tp);
+		switch_mutex_lock(globals.task_mutex);
 	}
+
 	switch_mutex_unlock(globals.task_mutex);
 
-	return done;
+	return wait;
 }
 
 static void *SWITCH_THREAD_FUNC switch_scheduler_task_thread(switch_thread_t *thread, void *obj)
 {
 	void *pop;
+	uint32_t i;
+	switch_status_t st;
+
 	globals.task_thread_running = 1;
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Starting task thread\n");
 	while (globals.task_thread_running == 1) {
-		if (task_thread_loop(0)) {
-			break;
-		}
-		if (switch_queue_pop_timeout(globals.event_queue, &pop, 500000) == SWITCH_STATUS_SUCCESS) {
+		switch_interval_time_t wait = task_thread_loop();
+
+		/* every new task queues an event, waking us up in case it is due before the others */
+		if (switch_queue_pop_timeout(globals.event_queue, &pop, wait) == SWITCH_STATUS_SUCCESS) {
 			switch_event_t *event = (switch_event_t *) pop;
 			switch_event_fire(&event);
 		}
 	}
 
-	task_thread_loop(1);
+	/* let the workers finish what they were given */
+	for (i = 0; i < globals.worker_count; i++) {
+		switch_queue_push(globals.worker_queue, NULL);
+	}
+	for (i = 0; i < globals.worker_count; i++) {
+		switch_thread_join(&st, globals.workers[i]);
+	}
+
+	switch_mutex_lock(globals.task_mutex);
+	while (globals.heap_len) {
+		switch_scheduler_task_container_t *tp = globals.heap[0];
+
+		heap_remove(tp);
+		task_destroy(tp);
+	}
+	switch_mutex_unlock(globals.task_mutex);
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Task thread ending\n");
 
@@ -208,6 +388,54 @@ static void *SWITCH_THREAD_FUNC switch_scheduler_task_thread(switch_thread_t *th
 	return NULL;
 }
 
+static uint32_t switch_scheduler_add(switch_time_t due, uint32_t repeat,
+									 switch_scheduler_func_t func,
+									 const char *desc, const char *group, uint32_t cmd_id, void *cmd_arg, switch_scheduler_flag_t flags)
+{
+	uint32_t result;
+	switch_scheduler_task_container_t *container, *tp;
+	switch_ssize_t hlen = -1;
+
+	switch_assert(func);
+
+	switch_mutex_lock(globals.task_mutex);
+	switch_zmalloc(container, sizeof(*container));
+
+	container->func = func;
+	container->due = due;
+	container->heap_index = -1;
+	container->task.created = switch_epoch_time_now(NULL);
+	container->task.runtime = due / 1000000;
+	container->task.runtime_us = due;
+	container->task.repeat = repeat;
+	container->task.group = strdup(group ? group : "none");
+	container->task.cmd_id = cmd_id;
+	container->task.cmd_arg = cmd_arg;
+	container->flags = flags;
+	container->desc = strdup(desc ? desc : "none");
+	container->task.hash = switch_ci_hashfunc_default(container->task.group, &hlen);
+
+	do {
+		for (container->task.task_id = 0; !container->task.task_id; container->task.task_id = ++globals.task_id);
+	} while (switch_core_inthash_find(globals.task_ids, container->task.task_id));
+
+	switch_core_inthash_insert(globals.task_ids, container->task.task_id, container);
+	group_link(container);
+	heap_push(container);
+
+	tp = container;
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Added task %u %s (%s) to run at %" SWITCH_INT64_T_FMT "\n",
+					  tp->task.task_id, tp->desc, switch_str_nil(tp->task.group), tp->task.runtime);
+
+	queue_task_event(SWITCH_EVENT_ADD_SCHEDULE, tp);
+
+	result = container->task.task_id;
+
+	switch_mutex_unlock(globals.task_mutex);
+
+	return result;
+}
+
 SWITCH_DECLARE(uint32_t) switch_scheduler_add_task(time_t task_runtime,
 	switch_scheduler_func_t func,
 	const char *desc, const char *group, uint32_t cmd_id, void *cmd_arg, switch_scheduler_flag_t flags)
@@ -223,60 +451,45 @@ SWITCH_DECLARE(uint32_t) switch_scheduler_add_task_ex(time_t task_runtime,
 												   switch_scheduler_func_t func,
 												   const char *desc, const char *group, uint32_t cmd_id, void *cmd_arg, switch_scheduler_flag_t flags, uint32_t *task_id)
 {
-	uint32_t result;
-	switch_scheduler_task_container_t *container, *tp;
-	switch_event_t *event;
 	switch_time_t now = switch_epoch_time_now(NULL);
-	switch_ssize_t hlen = -1;
+	uint32_t repeat = 0;
 
-	switch_mutex_lock(globals.task_mutex);
-	switch_zmalloc(container, sizeof(*container));
-	switch_assert(func);
 	switch_assert(task_id);
 
 	if (task_runtime < now) {
-		container->task.repeat = (uint32_t)task_runtime;
+		repeat = (uint32_t)task_runtime;
 		task_runtime += now;
 	}
 
-	container->func = func;
-	container->task.created = now;
-	container->task.runtime = task_runtime;
-	container->task.group = strdup(group ? group : "none");
-	container->task.cmd_id = cmd_id;
-	container->task.cmd_arg = cmd_arg;
-	container->flags = flags;
-	container->desc = strdup(desc ? desc : "none");
-	container->task.hash = switch_ci_hashfunc_default(container->task.group, &hlen);
+	return *task_id = switch_scheduler_add((switch_time_t) task_runtime * 1000000, repeat, func, desc, group, cmd_id, cmd_arg, flags);
+}
 
-	for (tp = globals.task_list; tp && tp->next; tp = tp->next);
+SWITCH_DECLARE(uint32_t) switch_scheduler_add_task_us(switch_time_t task_runtime,
+												   switch_scheduler_func_t func,
+												   const char *desc, const char *group, uint32_t cmd_id, void *cmd_arg, switch_scheduler_flag_t flags)
+{
+	return switch_scheduler_add(task_runtime, 0, func, desc, group, cmd_id, cmd_arg, flags);
+}
 
-	if (tp) {
-		tp->next = container;
-	} else {
-		globals.task_list = container;
+/* Must be called with the task_mutex held, returns 1 if the task is (or will be, once it returns) deleted */
+static uint32_t switch_scheduler_del(switch_scheduler_task_container_t *tp)
+{
+	if (switch_test_flag(tp, SSHF_NO_DEL)) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Attempt made to delete undeletable task #%u (group %s)\n",
+						  tp->task.task_id, tp->task.group);
+		return 0;
 	}
 
-	for (container->task.task_id = 0; !container->task.task_id; container->task.task_id = ++globals.task_id);
-
-	tp = container;
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Added task %u %s (%s) to run at %" SWITCH_INT64_T_FMT "\n",
-					  tp->task.task_id, tp->desc, switch_str_nil(tp->task.group), tp->task.runtime);
-
-	if (switch_event_create(&event, SWITCH_EVENT_ADD_SCHEDULE) == SWITCH_STATUS_SUCCESS) {
-		switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-ID", "%u", tp->task.task_id);
-		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Desc", tp->desc);
-		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Group", switch_str_nil(tp->task.group));
-		switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-Runtime", "%" SWITCH_INT64_T_FMT, tp->task.runtime);
-		switch_queue_push(globals.event_queue, event);
-		event = NULL;
+	if (tp->running) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Attempt made to delete running task #%u (group %s)\n",
+						  tp->task.task_id, tp->task.group);
+		tp->destroy_requested++;
+	} else {
+		heap_remove(tp);
+		task_destroy(tp);
 	}
 
-	result = *task_id = container->task.task_id;
-
-	switch_mutex_unlock(globals.task_mutex);
-
-	return result;
+	return 1;
 }
 
 SWITCH_DECLARE(uint32_t) switch_scheduler_del_task_id(uint32_t task_id)
@@ -285,25 +498,8 @@ SWITCH_DECLARE(uint32_t) switch_scheduler_del_task_id(uint32_t task_id)
 	uint32_t delcnt = 0;
 
 	switch_mutex_lock(globals.task_mutex);
-	for (tp = globals.task_list; tp; tp = tp->next) {
-		if (tp->task.task_id == task_id) {
-			if (switch_test_flag(tp, SSHF_NO_DEL)) {
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Attempt made to delete undeletable task #%u (group %s)\n",
-								  tp->task.task_id, tp->task.group);
-				break;
-			}
-
-			if (tp->running) {
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Attempt made to delete running task #%u (group %s)\n",
-								  tp->task.task_id, tp->task.group);
-				tp->destroy_requested++;
-			} else {
-				tp->destroyed++;
-			}
-
-			delcnt++;
-			break;
-		}
+	if ((tp = switch_core_inthash_find(globals.task_ids, task_id))) {
+		delcnt = switch_scheduler_del(tp);
 	}
 	switch_mutex_unlock(globals.task_mutex);
 
@@ -312,37 +508,20 @@ SWITCH_DECLARE(uint32_t) switch_scheduler_del_task_id(uint32_t task_id)
 
 SWITCH_DECLARE(uint32_t) switch_scheduler_del_task_group(const char *group)
 {
-	switch_scheduler_task_container_t *tp;
+	switch_scheduler_task_container_t *tp, *next;
 	uint32_t delcnt = 0;
-	switch_ssize_t hlen = -1;
-	unsigned long hash = 0;
 
 	if (zstr(group)) {
 		return 0;
 	}
 
-	hash = switch_ci_hashfunc_default(group, &hlen);
-
 	switch_mutex_lock(globals.task_mutex);
-	for (tp = globals.task_list; tp; tp = tp->next) {
-		if (tp->destroyed) {
+	for (tp = switch_core_hash_find(globals.task_groups, group); tp; tp = next) {
+		next = tp->group_next;
+		if (tp->destroy_requested) {
 			continue;
 		}
-		if (hash == tp->task.hash && !strcmp(tp->task.group, group)) {
-			if (switch_test_flag(tp, SSHF_NO_DEL)) {
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Attempt made to delete undeletable task #%u (group %s)\n",
-								  tp->task.task_id, group);
-				continue;
-			}
-			if (tp->running) {
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Attempt made to delete running task #%u (group %s)\n",
-								  tp->task.task_id, tp->task.group);
-				tp->destroy_requested++;
-			} else {
-				tp->destroyed++;
-			}
-			delcnt++;
-		}
+		delcnt += switch_scheduler_del(tp);
 	}
 	switch_mutex_unlock(globals.task_mutex);
 
@@ -355,11 +534,21 @@ SWITCH_DECLARE(void) switch_scheduler_task_thread_start(void)
 {
 
 	switch_threadattr_t *thd_attr;
+	int i;
 
 	switch_core_new_memory_pool(&globals.memory_pool);
 	switch_threadattr_create(&thd_attr, globals.memory_pool);
 	switch_mutex_init(&globals.task_mutex, SWITCH_MUTEX_NESTED, globals.memory_pool);
 	switch_queue_create(&globals.event_queue, 250000, globals.memory_pool);
+	switch_queue_create(&globals.worker_queue, SCHEDULER_MAX_WORKERS * 16, globals.memory_pool);
+	switch_core_inthash_init(&globals.task_ids);
+	switch_core_hash_init(&globals.task_groups);
+
+	switch_mutex_lock(globals.task_mutex);
+	for (i = 0; i < SCHEDULER_MIN_WORKERS; i++) {
+		task_worker_start();
+	}
+	switch_mutex_unlock(globals.task_mutex);
 
 	switch_thread_create(&task_thread_p, thd_attr, switch_scheduler_task_thread, NULL, globals.memory_pool);
 }
@@ -383,6 +572,12 @@ SWITCH_DECLARE(void) switch_scheduler_task_thread_stop(void)
 		}
 	}
 
+	switch_core_inthash_destroy(&globals.task_ids);
+	switch_core_hash_destroy(&globals.task_groups);
+	switch_safe_free(globals.heap);
+	globals.heap_len = globals.heap_size = 0;
+	globals.worker_count = globals.idle_workers = 0;
+
 	switch_core_destroy_memory_pool(&globals.memory_pool);
 
 }
@@ -2382,6 +2382,9 @@ SWITCH_DECLARE(switch_xml_t) switch_xml_open_root(uint8_t reload, const char **e
 
 
 	if (root) {
+		/* the dialplan may have changed, don't keep its old expressions around */
+		switch_regex_cache_flush();
+
 		if (switch_event_create(&event, SWITCH_EVENT_RELOADXML) == SWITCH_STATUS_SUCCESS) {
 			if (switch_event_fire(&event) != SWITCH_STATUS_SUCCESS) {
 				switch_event_destroy(&event);
@@ -38,6 +38,25 @@
 
 #define ENABLE_SNPRINTFV_TESTS 0 /* Do not turn on for CI as this requires a lot of RAM */
 
+static switch_atomic_t queued_events_seen;
+
+static void queued_event_handler(switch_event_t *event)
+{
+	if (event->bind_user_data == &queued_events_seen) {
+		switch_atomic_inc(&queued_events_seen);
+	}
+}
+
+static int routed_events_seen[4];
+
+static void routed_event_handler(switch_event_t *event)
+{
+	/* the catch-all binding sees any other CUSTOM event fired while the test runs */
+	if (event->subclass_name && !strncmp(event->subclass_name, "test::routed", 12)) {
+		(*(int *) event->bind_user_data)++;
+	}
+}
+
 FST_CORE_BEGIN("./conf")
 {
 	FST_SUITE_BEGIN(switch_core)
@@ -527,6 +546,136 @@ FST_CORE_BEGIN("./conf")
 			fst_check(switch_channel_get_variable_buf(channel, "test_var_does_not_exist", buf, sizeof(buf)) == SWITCH_STATUS_FALSE);
 		}
 		FST_SESSION_END()
+
+		FST_TEST_BEGIN(test_switch_event_bind_queued)
+		{
+			switch_event_node_t *node = NULL;
+			switch_stream_handle_t stream = { 0 };
+			int i;
+
+			fst_requires(switch_event_bind_flags("test_queued", SWITCH_EVENT_CUSTOM, "test::queued", queued_event_handler,
+												 &queued_events_seen, SEBF_QUEUED, 16, &node) == SWITCH_STATUS_SUCCESS);
+			fst_requires(node);
+
+			for (i = 0; i < 10; i++) {
+				switch_event_t *event = NULL;
+
+				fst_requires(switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, "test::queued") == SWITCH_STATUS_SUCCESS);
+				switch_event_fire(&event);
+			}
+
+			for (i = 0; i < 200 && switch_atomic_read(&queued_events_seen) < 10; i++) {
+				switch_yield(10000);
+			}
+
+			fst_check(switch_atomic_read(&queued_events_seen) == 10);
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_event_bindings_report(&stream);
+			fst_check(strstr((char *) stream.data, "test_queued,CUSTOM,test::queued,drop,") != NULL);
+			switch_safe_free(stream.data);
+
+			fst_check(switch_event_unbind(&node) == SWITCH_STATUS_SUCCESS);
+			fst_check(node == NULL);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_switch_regex_cache)
+		{
+			switch_regex_cache_stats_t before, after;
+			switch_regex_t *re = NULL;
+			int ovector[30];
+			char substituted[64] = "";
+			int i, match_count;
+
+			switch_regex_cache_flush();
+			switch_regex_cache_stats(&before);
+			fst_check(before.entries == 0);
+
+			for (i = 0; i < 3; i++) {
+				match_count = switch_regex_perform("1000", "^(10)(\\d+)$", &re, ovector, sizeof(ovector) / sizeof(ovector[0]));
+				fst_check_int_equals(match_count, 3);
+				fst_requires(re);
+
+				/* each caller gets its own pattern to free */
+				switch_perform_substitution(re, match_count, "$2-$1", "1000", substituted, sizeof(substituted), ovector);
+				fst_check_string_equals(substituted, "00-10");
+				switch_regex_safe_free(re);
+			}
+
+			fst_check_int_equals(switch_regex_perform("2000", "^(10)(\\d+)$", &re, ovector, sizeof(ovector) / sizeof(ovector[0])), 0);
+			fst_check(re == NULL);
+
+			fst_check(switch_regex_match("Hello", "/^hello$/i") == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_regex_match("Hello", "^hello$") == SWITCH_STATUS_FALSE);
+
+			switch_regex_cache_stats(&after);
+			/* anything else running in the core may use the cache too */
+			fst_check(after.misses - before.misses >= 3);
+			fst_check(after.hits - before.hits >= 3);
+			fst_check(after.entries >= 3);
+
+			/* a pattern that doesn't compile is remembered too, the second try is a hit */
+			switch_regex_cache_stats(&before);
+			fst_check_int_equals(switch_regex_perform("1000", "^(10", &re, ovector, sizeof(ovector) / sizeof(ovector[0])), 0);
+			fst_check(re == NULL);
+			fst_check(switch_regex_match("1000", "^(10") == SWITCH_STATUS_FALSE);
+			fst_check_int_equals(switch_regex_perform("1000", "^(10", &re, ovector, sizeof(ovector) / sizeof(ovector[0])), 0);
+			fst_check(re == NULL);
+			switch_regex_cache_stats(&after);
+			fst_check(after.hits - before.hits >= 1);
+
+			switch_regex_cache_flush();
+			switch_regex_cache_stats(&after);
+			fst_check(after.entries == 0);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_switch_event_routing)
+		{
+			switch_event_node_t *nodes[4] = { NULL };
+			switch_event_t *event = NULL;
+			int i;
+
+			fst_requires(switch_event_bind_removable("test_routed", SWITCH_EVENT_CUSTOM, "test::routed_a", routed_event_handler,
+													 &routed_events_seen[0], &nodes[0]) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_event_bind_removable("test_routed", SWITCH_EVENT_CUSTOM, "test::routed_b", routed_event_handler,
+													 &routed_events_seen[1], &nodes[1]) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_event_bind_removable("test_routed", SWITCH_EVENT_CUSTOM, "file:test_routed.c", routed_event_handler,
+													 &routed_events_seen[2], &nodes[2]) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_event_bind_removable("test_routed", SWITCH_EVENT_CUSTOM, NULL, routed_event_handler,
+													 &routed_events_seen[3], &nodes[3]) == SWITCH_STATUS_SUCCESS);
+
+			/* delivered inline so the counters can be checked right away */
+			fst_requires(switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, "test::routed_a") == SWITCH_STATUS_SUCCESS);
+			switch_event_deliver(&event);
+
+			fst_requires(switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, "test::routed_b") == SWITCH_STATUS_SUCCESS);
+			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "file", "test_routed.c");
+			switch_event_deliver(&event);
+
+			fst_requires(switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, "test::routed_c") == SWITCH_STATUS_SUCCESS);
+			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "file", "other.c");
+			switch_event_deliver(&event);
+
+			fst_check_int_equals(routed_events_seen[0], 1);
+			fst_check_int_equals(routed_events_seen[1], 1);
+			fst_check_int_equals(routed_events_seen[2], 1);
+			fst_check_int_equals(routed_events_seen[3], 3);
+
+			fst_check(switch_event_unbind(&nodes[0]) == SWITCH_STATUS_SUCCESS);
+
+			fst_requires(switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, "test::routed_a") == SWITCH_STATUS_SUCCESS);
+			switch_event_deliver(&event);
+
+			fst_check_int_equals(routed_events_seen[0], 1);
+			fst_check_int_equals(routed_events_seen[3], 4);
+
+			for (i = 1; i < 4; i++) {
+				fst_check(switch_event_unbind(&nodes[i]) == SWITCH_STATUS_SUCCESS);
+			}
+		}
+		FST_TEST_END()
 	}
 	FST_SUITE_END()
 }
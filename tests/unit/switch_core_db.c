@@ -118,6 +118,136 @@ FST_CORE_DB_BEGIN("./conf")
 		}
 		FST_TEST_END()
 
+		FST_TEST_BEGIN(test_switch_cache_db_queue_manager_params)
+		{
+			int i;
+			uint32_t stmt = 0, again = 0;
+			switch_sql_queue_manager_t *qm = NULL;
+			switch_cache_db_handle_t *dbh = NULL;
+			switch_stream_handle_t stream = { 0 };
+			char *dsn = "test_switch_cache_db_queue_manager_params";
+			char res[256] = "";
+			const char *vals[3];
+
+			switch_sql_queue_manager_init_name("TEST_PARAMS",
+				&qm,
+				2,
+				dsn,
+				SWITCH_MAX_TRANS,
+				NULL, NULL, NULL, NULL);
+
+			switch_sql_queue_manager_start(qm);
+
+			switch_sql_queue_manager_push_confirm(qm, "DROP TABLE IF EXISTS p;", 0, SWITCH_TRUE);
+			switch_sql_queue_manager_push_confirm(qm, "CREATE TABLE p (id INT, name VARCHAR(255), note VARCHAR(255));", 0, SWITCH_TRUE);
+
+			fst_check(switch_sql_queue_manager_add_statement(qm, "insert into p (id, name, note) values (?, ?, ?)", &stmt) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_sql_queue_manager_add_statement(qm, "insert into p (id, name, note) values (?, ?, ?)", &again) == SWITCH_STATUS_SUCCESS);
+			fst_check_int_equals(stmt, again);
+
+			vals[0] = "1";
+			fst_check(switch_sql_queue_manager_push_params(qm, stmt, 0, 1, vals) == SWITCH_STATUS_FALSE);
+
+			for (i = 0; i < max_rows; i++) {
+				char id[16];
+
+				switch_snprintf(id, sizeof(id), "%d", i);
+				vals[0] = id;
+				vals[1] = "it's quoted";
+				vals[2] = (i % 2) ? NULL : "?";
+				fst_check(switch_sql_queue_manager_push_params(qm, stmt, 0, 3, vals) == SWITCH_STATUS_SUCCESS);
+			}
+
+			switch_sql_queue_manager_push(qm, "insert into p (id, name, note) values (-1, 'plain', 'text');", 0, SWITCH_TRUE);
+
+			for (i = 0; i < 100 && switch_sql_queue_manager_size(qm, 0); i++) {
+				switch_yield(20000);
+			}
+
+			switch_sleep(200 * 1000);
+
+			fst_requires(switch_cache_db_get_db_handle_dsn(&dbh, dsn) == SWITCH_STATUS_SUCCESS);
+
+			switch_cache_db_execute_sql2str(dbh, "select count(*) from p where name = 'it''s quoted'", res, sizeof(res), NULL);
+			fst_check_int_equals(atoi(res), max_rows);
+
+			switch_cache_db_execute_sql2str(dbh, "select count(*) from p where note is null", res, sizeof(res), NULL);
+			fst_check_int_equals(atoi(res), max_rows / 2);
+
+			switch_cache_db_execute_sql2str(dbh, "select count(*) from p where note = '?'", res, sizeof(res), NULL);
+			fst_check_int_equals(atoi(res), max_rows / 2);
+
+			switch_cache_db_execute_sql2str(dbh, "select name from p where id = -1", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "plain");
+
+			switch_cache_db_release_db_handle(&dbh);
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_cache_db_status(&stream);
+			fst_check(switch_stristr("SQL queue TEST_PARAMS", (char *) stream.data) != NULL);
+			fst_check(switch_stristr("Written:", (char *) stream.data) != NULL);
+			switch_safe_free(stream.data);
+
+			switch_sql_queue_manager_stop(qm);
+			switch_sql_queue_manager_destroy(&qm);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_switch_cache_db_queue_manager_render)
+		{
+			uint32_t ins = 0, lit = 0, upd = 0;
+			switch_sql_queue_manager_t *qm = NULL;
+			switch_cache_db_handle_t *dbh = NULL;
+			char *dsn = "test_switch_cache_db_queue_manager_render";
+			char res[256] = "";
+			char *sql;
+			const char *one[] = { "1", "it's", "?" };
+			const char *two[] = { "1", "a", NULL, "2", "b'c", "x" };
+			const char *quoted[] = { "1", "n", "2", NULL };
+			const char *set[] = { "z", "3" };
+
+			/* what odbc and pgsql get, rendered without needing either */
+			switch_sql_queue_manager_init_name("TEST_RENDER", &qm, 1, dsn, SWITCH_MAX_TRANS, NULL, NULL, NULL, NULL);
+
+			fst_requires(switch_sql_queue_manager_add_statement(qm, "insert into r (id, name, note) values (?, ?, ?)", &ins) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_sql_queue_manager_add_statement(qm, "insert into r (id, name, note) values (?, '?', ?)", &lit) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_sql_queue_manager_add_statement(qm, "update r set name = ? where id = ?", &upd) == SWITCH_STATUS_SUCCESS);
+
+			sql = switch_sql_queue_manager_render_params(qm, ins, 1, 3, one);
+			fst_check_string_equals(sql, "insert into r (id, name, note) values ('1', 'it''s', '?')");
+			switch_safe_free(sql);
+
+			sql = switch_sql_queue_manager_render_params(qm, ins, 2, 3, two);
+			fst_check_string_equals(sql, "insert into r (id, name, note) values ('1', 'a', NULL),('2', 'b''c', 'x')");
+
+			/* the rendered multi-row insert has to be valid sql */
+			fst_requires(switch_cache_db_get_db_handle_dsn(&dbh, dsn) == SWITCH_STATUS_SUCCESS);
+			switch_cache_db_execute_sql(dbh, "DROP TABLE IF EXISTS r;", NULL);
+			switch_cache_db_execute_sql(dbh, "CREATE TABLE r (id INT, name VARCHAR(255), note VARCHAR(255));", NULL);
+			fst_check(switch_cache_db_execute_sql(dbh, sql, NULL) == SWITCH_STATUS_SUCCESS);
+			switch_safe_free(sql);
+			switch_cache_db_execute_sql2str(dbh, "select name from r where id = 2", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "b'c");
+			switch_cache_db_execute_sql2str(dbh, "select count(*) from r where note is null", res, sizeof(res), NULL);
+			fst_check_int_equals(atoi(res), 1);
+			switch_cache_db_release_db_handle(&dbh);
+
+			sql = switch_sql_queue_manager_render_params(qm, lit, 2, 2, quoted);
+			fst_check_string_equals(sql, "insert into r (id, name, note) values ('1', '?', 'n'),('2', '?', NULL)");
+			switch_safe_free(sql);
+
+			sql = switch_sql_queue_manager_render_params(qm, upd, 1, 2, set);
+			fst_check_string_equals(sql, "update r set name = 'z' where id = '3'");
+			switch_safe_free(sql);
+
+			fst_check(switch_sql_queue_manager_render_params(qm, upd, 2, 2, quoted) == NULL);
+			fst_check(switch_sql_queue_manager_render_params(qm, ins, 1, 2, set) == NULL);
+			fst_check(switch_sql_queue_manager_render_params(qm, 99, 1, 2, set) == NULL);
+
+			switch_sql_queue_manager_destroy(&qm);
+		}
+		FST_TEST_END()
+
 
 	}
 	FST_SUITE_END()
@@ -31,6 +31,93 @@
 #include <switch.h>
 #include <test/switch_test.h>
 
+static int registry_row_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	char *uuid = (char *) pArg;
+
+	if (argc == 2 && !strcmp(columnNames[0], "uuid") && !strcmp(columnNames[1], "name")) {
+		switch_copy_string(uuid, argv[0], SWITCH_UUID_FORMATTED_LENGTH + 1);
+	}
+
+	return 0;
+}
+
+typedef struct {
+	char uuid[SWITCH_UUID_FORMATTED_LENGTH + 1];
+	char b_uuid[SWITCH_UUID_FORMATTED_LENGTH + 1];
+	char call_uuid[SWITCH_UUID_FORMATTED_LENGTH + 1];
+} registry_call_row_t;
+
+static int registry_call_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	registry_call_row_t *row = (registry_call_row_t *) pArg;
+	int i;
+
+	for (i = 0; i < argc; i++) {
+		if (!strcmp(columnNames[i], "uuid")) {
+			switch_copy_string(row->uuid, switch_str_nil(argv[i]), sizeof(row->uuid));
+		} else if (!strcmp(columnNames[i], "b_uuid")) {
+			switch_copy_string(row->b_uuid, switch_str_nil(argv[i]), sizeof(row->b_uuid));
+		} else if (!strcmp(columnNames[i], "call_uuid")) {
+			switch_copy_string(row->call_uuid, switch_str_nil(argv[i]), sizeof(row->call_uuid));
+		}
+	}
+
+	return 0;
+}
+
+/* the registry is fed from the event thread, give it up to 2s to catch up */
+static int registry_wait_rows(switch_channel_registry_query_t *query, registry_call_row_t *row, int want)
+{
+	int x, rows = -1;
+
+	for (x = 0; x < 200; x++) {
+		memset(row, 0, sizeof(*row));
+		if ((rows = switch_channel_registry_query(query, registry_call_callback, row)) == want) {
+			break;
+		}
+		switch_yield(10000);
+	}
+
+	return rows;
+}
+
+static switch_memory_stats_t arena_before, arena_after;
+static int arena_ok = 0;
+static volatile int arena_done = 0;
+
+/* runs on the session thread, which owns the arena */
+static switch_status_t arena_on_hibernate(switch_core_session_t *session)
+{
+	char *str, *fmt;
+	int *num;
+
+	switch_core_session_memory_stats(session, &arena_before);
+	num = switch_core_session_alloc(session, sizeof(*num) * 4);
+	str = switch_core_session_strdup(session, "arena");
+	fmt = switch_core_session_sprintf(session, "%s-%d", "arena", 42);
+	switch_core_session_memory_stats(session, &arena_after);
+
+	arena_ok = num && num[0] == 0 && num[3] == 0 && !strcmp(str, "arena") && !strcmp(fmt, "arena-42");
+	arena_done = 1;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_state_handler_table_t arena_state_handlers = {
+	/*.on_init */ NULL,
+	/*.on_routing */ NULL,
+	/*.on_execute */ NULL,
+	/*.on_hangup */ NULL,
+	/*.on_exchange_media */ NULL,
+	/*.on_soft_execute */ NULL,
+	/*.on_consume_media */ NULL,
+	/*.on_hibernate */ arena_on_hibernate,
+	/*.on_reset */ NULL,
+	/*.on_park */ NULL,
+	/*.on_reporting */ NULL,
+	/*.on_destroy */ NULL
+};
 
 FST_CORE_BEGIN("./conf")
 {
@@ -71,6 +158,196 @@ FST_CORE_BEGIN("./conf")
 			fst_check(session == NULL);
 		}
 		FST_SESSION_END()
+
+		FST_SESSION_BEGIN(session_memory_stats)
+		{
+			switch_memory_stats_t before, after;
+			char *str;
+			int *num;
+			int x;
+
+			switch_core_session_memory_stats(fst_session, &before);
+
+			/* the test thread does not own the session, these go through the locked pool */
+			num = switch_core_session_alloc(fst_session, sizeof(*num) * 4);
+			fst_requires(num);
+			fst_check(num[0] == 0 && num[3] == 0);
+			str = switch_core_session_strdup(fst_session, "arena");
+			fst_check_string_equals(str, "arena");
+			str = switch_core_session_sprintf(fst_session, "%s-%d", "arena", 42);
+			fst_check_string_equals(str, "arena-42");
+
+			switch_core_session_memory_stats(fst_session, &after);
+			fst_check(after.pool_allocs == before.pool_allocs + 3);
+			fst_check(after.pool_bytes == before.pool_bytes + sizeof(*num) * 4 + sizeof("arena") + sizeof("arena-42"));
+			fst_check(after.arena_allocs == before.arena_allocs);
+
+			/* the session thread itself bump-allocates from the arena */
+			switch_channel_add_state_handler(fst_channel, &arena_state_handlers);
+			switch_channel_set_state(fst_channel, CS_HIBERNATE);
+
+			for (x = 0; x < 200 && !arena_done; x++) {
+				switch_yield(10000);
+			}
+
+			fst_requires(arena_done);
+			fst_check(arena_ok);
+			fst_check(arena_after.arena_allocs == arena_before.arena_allocs + 3);
+			fst_check(arena_after.arena_bytes == arena_before.arena_bytes + sizeof(*num) * 4 + sizeof("arena") + sizeof("arena-42"));
+			fst_check(arena_after.arena_reserved > 0);
+			fst_check(arena_after.pool_allocs == arena_before.pool_allocs);
+			switch_channel_clear_state_handler(fst_channel, &arena_state_handlers);
+		}
+		FST_SESSION_END()
+
+		FST_SESSION_BEGIN(channel_registry)
+		{
+			const char *columns[] = { "uuid", "name", NULL };
+			const char *bad_columns[] = { "no_such_column", NULL };
+			switch_channel_registry_query_t query = { 0 };
+			char uuid[SWITCH_UUID_FORMATTED_LENGTH + 1] = "";
+			int x, rows = 0;
+
+			query.view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
+			query.like = switch_core_session_get_uuid(fst_session);
+			query.columns = columns;
+
+			/* the registry is fed from the event thread */
+			for (x = 0; x < 100 && rows < 1; x++) {
+				rows = switch_channel_registry_query(&query, registry_row_callback, uuid);
+				if (rows < 1) {
+					switch_yield(10000);
+				}
+			}
+
+			fst_check_int_equals(rows, 1);
+			fst_check_string_equals(uuid, switch_core_session_get_uuid(fst_session));
+			fst_check(switch_channel_registry_count() >= 1);
+
+			query.like = "%no-such-channel%";
+			fst_check_int_equals(switch_channel_registry_query(&query, registry_row_callback, uuid), 0);
+
+			query.like = NULL;
+			query.columns = bad_columns;
+			fst_check_int_equals(switch_channel_registry_query(&query, registry_row_callback, uuid), -1);
+
+			query.view = SWITCH_CHANNEL_REGISTRY_CALLS;
+			query.columns = NULL;
+			query.bridged_only = SWITCH_TRUE;
+			query.count_only = SWITCH_TRUE;
+			fst_check_int_equals(switch_channel_registry_query(&query, registry_row_callback, uuid), 0);
+
+			switch_channel_hangup(fst_channel, SWITCH_CAUSE_NORMAL_CLEARING);
+		}
+		FST_SESSION_END()
+
+		FST_SESSION_BEGIN(channel_registry_calls)
+		{
+			const char *call_columns[] = { "uuid", "b_uuid", "call_uuid", NULL };
+			const char *channel_columns[] = { "uuid", "call_uuid", NULL };
+			switch_channel_registry_query_t query = { 0 };
+			registry_call_row_t row;
+			switch_core_session_t *b_session = NULL;
+			switch_channel_t *b_channel;
+			switch_call_cause_t cause = SWITCH_CAUSE_NORMAL_CLEARING;
+			char old_a[SWITCH_UUID_FORMATTED_LENGTH + 1], old_b[SWITCH_UUID_FORMATTED_LENGTH + 1];
+			char new_a[SWITCH_UUID_FORMATTED_LENGTH + 1], new_b[SWITCH_UUID_FORMATTED_LENGTH + 1];
+			int rows;
+
+			switch_copy_string(old_a, switch_core_session_get_uuid(fst_session), sizeof(old_a));
+			switch_uuid_str(new_a, sizeof(new_a));
+			switch_uuid_str(new_b, sizeof(new_b));
+
+			fst_requires(switch_ivr_originate(NULL, &b_session, &cause, "null/+15553334445", 2, NULL, NULL, NULL, NULL, NULL, SOF_NONE, NULL, NULL) == SWITCH_STATUS_SUCCESS);
+			fst_requires(b_session);
+			b_channel = switch_core_session_get_channel(b_session);
+			switch_copy_string(old_b, switch_core_session_get_uuid(b_session), sizeof(old_b));
+
+			switch_channel_set_variable(fst_channel, "park_after_bridge", "true");
+			switch_channel_set_variable(b_channel, "park_after_bridge", "true");
+
+			/* a renamed channel moves to its new uuid */
+			fst_check(switch_core_session_set_uuid(b_session, new_b) == SWITCH_STATUS_SUCCESS);
+
+			query.view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
+			query.columns = channel_columns;
+			query.like = new_b;
+			fst_check_int_equals(registry_wait_rows(&query, &row, 1), 1);
+			fst_check_string_equals(row.uuid, new_b);
+			query.like = old_b;
+			fst_check_int_equals(registry_wait_rows(&query, &row, 0), 0);
+
+			/* show bridged_calls: one row for the a leg, with the b leg folded into it */
+			fst_check(switch_ivr_uuid_bridge(old_a, new_b) == SWITCH_STATUS_SUCCESS);
+
+			query.view = SWITCH_CHANNEL_REGISTRY_CALLS;
+			query.columns = call_columns;
+			query.bridged_only = SWITCH_TRUE;
+			query.like = old_a;
+			fst_check_int_equals(registry_wait_rows(&query, &row, 1), 1);
+			fst_check_string_equals(row.uuid, old_a);
+			fst_check_string_equals(row.b_uuid, new_b);
+			fst_check_string_equals(row.call_uuid, old_a);
+
+			/* show calls does not list the b leg as a call of its own */
+			query.bridged_only = SWITCH_FALSE;
+			query.like = new_b;
+			fst_check_int_equals(registry_wait_rows(&query, &row, 0), 0);
+
+			/* both legs of the call carry the a leg's call uuid */
+			query.view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
+			query.columns = channel_columns;
+			fst_check_int_equals(registry_wait_rows(&query, &row, 1), 1);
+			fst_check_string_equals(row.call_uuid, old_a);
+
+			/* renaming the a leg follows through to the b leg's link and to everybody's call uuid */
+			fst_check(switch_core_session_set_uuid(fst_session, new_a) == SWITCH_STATUS_SUCCESS);
+
+			query.view = SWITCH_CHANNEL_REGISTRY_CALLS;
+			query.columns = call_columns;
+			query.bridged_only = SWITCH_TRUE;
+			query.like = new_a;
+			fst_check_int_equals(registry_wait_rows(&query, &row, 1), 1);
+			fst_check_string_equals(row.uuid, new_a);
+			fst_check_string_equals(row.b_uuid, new_b);
+			fst_check_string_equals(row.call_uuid, new_a);
+
+			query.view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
+			query.columns = channel_columns;
+			query.bridged_only = SWITCH_FALSE;
+			query.like = new_b;
+			fst_check_int_equals(registry_wait_rows(&query, &row, 1), 1);
+			fst_check_string_equals(row.call_uuid, new_a);
+
+			/* unbridge: the call goes away, the b leg with it */
+			switch_channel_hangup(b_channel, SWITCH_CAUSE_NORMAL_CLEARING);
+			switch_core_session_rwunlock(b_session);
+
+			query.view = SWITCH_CHANNEL_REGISTRY_CALLS;
+			query.columns = call_columns;
+			query.bridged_only = SWITCH_TRUE;
+			query.like = new_a;
+			fst_check_int_equals(registry_wait_rows(&query, &row, 0), 0);
+
+			query.view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
+			query.columns = channel_columns;
+			query.like = new_b;
+			fst_check_int_equals(registry_wait_rows(&query, &row, 0), 0);
+
+			/* whatever is left of the a leg is a call of its own again */
+			query.view = SWITCH_CHANNEL_REGISTRY_CALLS;
+			query.columns = call_columns;
+			query.bridged_only = SWITCH_FALSE;
+			query.like = new_a;
+			rows = switch_channel_registry_query(&query, registry_call_callback, memset(&row, 0, sizeof(row)));
+			fst_check(rows <= 1);
+			if (rows == 1) {
+				fst_check_string_equals(row.b_uuid, "");
+			}
+
+			switch_channel_hangup(fst_channel, SWITCH_CAUSE_NORMAL_CLEARING);
+		}
+		FST_SESSION_END()
 	}
 	FST_SUITE_END()
 }
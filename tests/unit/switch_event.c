@@ -104,6 +104,192 @@ FST_TEST_BEGIN(benchmark)
 }
 FST_TEST_END()
 
+FST_TEST_BEGIN(header_index)
+{
+  switch_event_t *event = NULL;
+  switch_event_header_t *hp;
+  char name[32];
+  int x = 0;
+
+  switch_event_create(&event, SWITCH_EVENT_MESSAGE);
+  fst_requires(event);
+
+  for (x = 0; x < 100; x++) {
+    switch_snprintf(name, sizeof(name), "var_%d", x);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, name, "%d", x);
+  }
+
+  fst_check(event->header_index != NULL);
+
+  /* lookups are case insensitive and return the first header with the name */
+  fst_check_string_equals(switch_event_get_header(event, "VAR_42"), "42");
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "var_42", "dup");
+  fst_check_string_equals(switch_event_get_header(event, "var_42"), "42");
+  switch_event_add_header_string(event, SWITCH_STACK_TOP, "var_42", "top");
+  fst_check_string_equals(switch_event_get_header(event, "var_42"), "top");
+
+  switch_event_del_header_val(event, "var_42", "top");
+  fst_check_string_equals(switch_event_get_header(event, "var_42"), "42");
+  switch_event_del_header(event, "var_42");
+  fst_check(switch_event_get_header(event, "var_42") == NULL);
+
+  fst_check(switch_event_rename_header(event, "var_7", "renamed") == SWITCH_STATUS_SUCCESS);
+  fst_check(switch_event_get_header(event, "var_7") == NULL);
+  fst_check_string_equals(switch_event_get_header(event, "renamed"), "7");
+
+  /* the list keeps insertion order for serialization */
+  hp = event->headers;
+  while (hp && strncmp(hp->name, "var_", 4) && strcmp(hp->name, "renamed")) {
+    hp = hp->next;
+  }
+  fst_requires(hp);
+  for (x = 0; x < 100 && hp; x++, hp = hp->next) {
+    if (x == 42) {
+      x++;
+    }
+    if (x == 7) {
+      fst_check_string_equals(hp->name, "renamed");
+    } else {
+      switch_snprintf(name, sizeof(name), "var_%d", x);
+      fst_check_string_equals(hp->name, name);
+    }
+  }
+
+  switch_event_destroy(&event);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(ref_copy_on_write)
+{
+  switch_event_t *event = NULL, *ref = NULL, *ref2 = NULL;
+  char name[32];
+  int x = 0;
+
+  switch_event_create(&event, SWITCH_EVENT_MESSAGE);
+  fst_requires(event);
+
+  for (x = 0; x < 20; x++) {
+    switch_snprintf(name, sizeof(name), "var_%d", x);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, name, "%d", x);
+  }
+  switch_event_set_body(event, "body");
+
+  ref = switch_event_ref(event);
+  fst_requires(ref);
+  fst_check(ref->headers == event->headers);
+  fst_check_string_equals(switch_event_get_header(ref, "var_3"), "3");
+
+  /* the first write gets its own copy, the other handle is untouched */
+  switch_event_add_header_string(ref, SWITCH_STACK_BOTTOM, "var_3", "changed");
+  fst_check(ref->headers != event->headers);
+  switch_event_del_header(ref, "var_4");
+  fst_check_string_equals(switch_event_get_header(event, "var_4"), "4");
+  fst_check(switch_event_get_header(ref, "var_4") == NULL);
+  fst_check_string_equals(switch_event_get_body(ref), "body");
+
+  switch_event_set_body(event, "new body");
+  fst_check_string_equals(switch_event_get_body(ref), "body");
+
+  /* releasing the original leaves the other reference intact */
+  ref2 = switch_event_ref(event);
+  switch_event_unref(&event);
+  fst_check(event == NULL);
+  fst_check_string_equals(switch_event_get_header(ref2, "var_19"), "19");
+  fst_check_string_equals(switch_event_get_body(ref2), "new body");
+
+  switch_event_unref(&ref2);
+  switch_event_unref(&ref);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(serialize_cache)
+{
+  switch_event_t *event = NULL, *ref = NULL;
+  const char *plain, *json;
+  char *str = NULL;
+
+  switch_event_create(&event, SWITCH_EVENT_MESSAGE);
+  fst_requires(event);
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "unsafe", "a b\nc:%");
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "empty", "");
+  switch_event_set_body(event, "the body");
+
+  switch_event_serialize(event, &str, SWITCH_TRUE);
+  fst_requires(str);
+  fst_check(strstr(str, "unsafe: a%20b%0Ac%3A%25\n") != NULL);
+  fst_check(strstr(str, "Content-Length: 8\n\nthe body") != NULL);
+
+  plain = switch_event_get_serialized(event, SWITCH_EVENT_FORMAT_PLAIN);
+  fst_check_string_equals(plain, str);
+  free(str);
+
+  /* every reference gets the same string */
+  ref = switch_event_ref(event);
+  fst_check(switch_event_get_serialized(ref, SWITCH_EVENT_FORMAT_PLAIN) == plain);
+  json = switch_event_get_serialized(ref, SWITCH_EVENT_FORMAT_JSON);
+  fst_requires(json);
+  fst_check(strstr(json, "\"_body\":\"the body\"") != NULL);
+  fst_check(switch_event_get_serialized(event, SWITCH_EVENT_FORMAT_JSON) == json);
+  fst_check(switch_event_get_serialized(event, SWITCH_EVENT_FORMAT_XML) != NULL);
+
+  /* a modified handle serializes its own headers */
+  switch_event_add_header_string(ref, SWITCH_STACK_BOTTOM, "added", "yes");
+  fst_check(strstr(switch_event_get_serialized(ref, SWITCH_EVENT_FORMAT_PLAIN), "added: yes\n") != NULL);
+  fst_check(strstr(switch_event_get_serialized(event, SWITCH_EVENT_FORMAT_PLAIN), "added: yes\n") == NULL);
+
+  switch_event_unref(&ref);
+  switch_event_destroy(&event);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(lookup_benchmark)
+{
+  int sizes[] = { 10, 100, 1000 };
+  int lookups = 100000, i, x;
+  char name[32];
+
+  for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+    switch_event_t *event = NULL;
+    switch_time_t start_ts, end_ts;
+    char **names = calloc(sizes[i], sizeof(char *));
+    double micro_per = 0;
+
+    switch_event_create(&event, SWITCH_EVENT_CHANNEL_DATA);
+    fst_requires(event);
+
+    for (x = 0; x < sizes[i]; x++) {
+      switch_snprintf(name, sizeof(name), "variable_%d", x);
+      names[x] = strdup(name);
+      switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, names[x], names[x]);
+    }
+
+    start_ts = switch_time_now();
+    for (x = 0; x < lookups; x++) {
+      if (!switch_event_get_header(event, names[x % sizes[i]])) {
+        fst_fail("Failed to lookup event header value");
+      }
+    }
+    /* misses walk the whole list without the index */
+    for (x = 0; x < lookups; x++) {
+      if (switch_event_get_header(event, "variable_missing")) {
+        fst_fail("Found a header that was never added");
+      }
+    }
+    end_ts = switch_time_now();
+
+    micro_per = (end_ts - start_ts) / (double) (lookups * 2);
+    printf("switch_event get_header with %d headers: %.3f us per lookup, %.0f lookups per second\n",
+       sizes[i], micro_per, micro_per > 0 ? 1000000 / micro_per : 0);
+
+    for (x = 0; x < sizes[i]; x++) {
+      free(names[x]);
+    }
+    free(names);
+    switch_event_destroy(&event);
+  }
+}
+FST_TEST_END()
+
 FST_SUITE_END()
 
 FST_MINCORE_END()
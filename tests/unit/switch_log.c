@@ -33,6 +33,10 @@
 
 #include <test/switch_test.h>
 
+#ifdef __GLIBC__
+#include <printf.h>
+#endif
+
 switch_memory_pool_t *pool = NULL;
 static switch_mutex_t *mutex = NULL;
 switch_thread_cond_t *cond = NULL;
@@ -67,6 +71,45 @@ static switch_status_t test_logger(const switch_log_node_t *node, switch_log_lev
 	return SWITCH_STATUS_SUCCESS;
 }
 
+static switch_atomic_t mask_log_seen[SWITCH_LOG_DEBUG + 1];
+
+static switch_status_t mask_logger(const switch_log_node_t *node, switch_log_level_t level)
+{
+	if (node->content && strstr(node->content, "switch_log mask test")) {
+		switch_atomic_inc(&mask_log_seen[level]);
+	}
+	return SWITCH_STATUS_SUCCESS;
+}
+
+#ifdef __GLIBC__
+/* %W prints an int and counts how often a line was actually formatted */
+static switch_atomic_t format_count;
+
+static int count_printf(FILE *stream, const struct printf_info *info, const void *const *args)
+{
+	switch_atomic_inc(&format_count);
+	return fprintf(stream, "%d", *(const int *) args[0]);
+}
+
+static int count_printf_arginfo(const struct printf_info *info, size_t n, int *argtypes, int *size)
+{
+	if (n > 0) {
+		argtypes[0] = PA_INT;
+		size[0] = sizeof(int);
+	}
+	return 1;
+}
+
+static void counted_log(switch_log_level_t level, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	switch_log_vprintf(SWITCH_CHANNEL_LOG, level, fmt, ap);
+	va_end(ap);
+}
+#endif
+
 static char *wait_for_log(switch_interval_time_t timeout_ms)
 {
 	char *log_str = NULL;
@@ -189,6 +232,61 @@ FST_CORE_BEGIN("./conf")
 			switch_log_unbind_logger(test_logger);
 		}
 		FST_SESSION_END()
+
+		FST_TEST_BEGIN(switch_log_binding_set_mask)
+		{
+			int i;
+
+			fst_requires(switch_log_bind_logger(mask_logger, SWITCH_LOG_DEBUG, SWITCH_FALSE) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_log_binding_set_mask(mask_logger, switch_log_str2mask("alert,notice")) == SWITCH_STATUS_SUCCESS);
+
+			/* the queue is drained in order so once the alert shows up the others have been handled */
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "switch_log mask test %d\n", 0);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "switch_log mask test %d\n", 1);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ALERT, "switch_log mask test %d\n", 2);
+
+			for (i = 0; i < 100 && !switch_atomic_read(&mask_log_seen[SWITCH_LOG_ALERT]); i++) {
+				switch_yield(10000);
+			}
+
+			fst_check(switch_atomic_read(&mask_log_seen[SWITCH_LOG_ALERT]) == 1);
+			fst_check(switch_atomic_read(&mask_log_seen[SWITCH_LOG_NOTICE]) == 1);
+			fst_check(switch_atomic_read(&mask_log_seen[SWITCH_LOG_ERROR]) == 0);
+
+			fst_check(switch_log_unbind_logger(mask_logger) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_log_binding_set_mask(mask_logger, 0xFF) == SWITCH_STATUS_FALSE);
+		}
+		FST_TEST_END()
+
+#ifdef __GLIBC__
+		FST_TEST_BEGIN(switch_log_unwanted_level_not_formatted)
+		{
+			switch_stream_handle_t stream = { 0 };
+
+			fst_requires(register_printf_specifier('W', count_printf, count_printf_arginfo) == 0);
+
+			/* mod_console is the only logger bound, once it is turned down to err nobody wants debug */
+			SWITCH_STANDARD_STREAM(stream);
+			fst_requires(switch_api_execute("console", "loglevel err", NULL, &stream) == SWITCH_STATUS_SUCCESS);
+			switch_safe_free(stream.data);
+
+			counted_log(SWITCH_LOG_DEBUG, "switch_log format test %W\n", 1);
+			fst_check(switch_atomic_read(&format_count) == 0);
+
+			counted_log(SWITCH_LOG_ERROR, "switch_log format test %W\n", 2);
+			fst_check(switch_atomic_read(&format_count) == 1);
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_api_execute("console", "loglevel debug", NULL, &stream);
+			switch_safe_free(stream.data);
+
+			counted_log(SWITCH_LOG_DEBUG, "switch_log format test %W\n", 3);
+			fst_check(switch_atomic_read(&format_count) == 2);
+
+			register_printf_specifier('W', NULL, NULL);
+		}
+		FST_TEST_END()
+#endif
 	}
 	FST_SUITE_END()
 
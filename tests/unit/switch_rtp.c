@@ -42,6 +42,24 @@ static void send_rtcp_event_handler(switch_event_t *event)
 	show_event(event);
 }
 
+static switch_socket_t *test_udp_socket(switch_port_t *port)
+{
+	switch_socket_t *sock = NULL;
+	switch_sockaddr_t *addr = NULL, *local = NULL;
+
+	if (switch_sockaddr_info_get(&addr, "127.0.0.1", SWITCH_UNSPEC, 0, 0, pool) != SWITCH_STATUS_SUCCESS ||
+		switch_socket_create(&sock, switch_sockaddr_get_family(addr), SOCK_DGRAM, 0, pool) != SWITCH_STATUS_SUCCESS ||
+		switch_socket_bind(sock, addr) != SWITCH_STATUS_SUCCESS ||
+		switch_socket_addr_get(&local, SWITCH_FALSE, sock) != SWITCH_STATUS_SUCCESS) {
+		return NULL;
+	}
+
+	switch_socket_timeout_set(sock, 500000);
+	*port = switch_sockaddr_get_port(local);
+
+	return sock;
+}
+
 FST_CORE_BEGIN("./conf")
 {
 FST_SUITE_BEGIN(switch_rtp)
@@ -277,6 +295,179 @@ FST_TEARDOWN_END()
 	}
 	FST_TEST_END()
 
+	FST_TEST_BEGIN(test_socket_batch_loopback)
+	{
+		switch_socket_t *rx, *tx0, *tx1;
+		switch_port_t rx_bound = 0, tx0_port = 0, tx1_port = 0;
+		switch_sockaddr_t *to = NULL, *from[SWITCH_SOCKET_BATCH_MAX];
+		char *bufs[SWITCH_SOCKET_BATCH_MAX];
+		switch_size_t lens[SWITCH_SOCKET_BATCH_MAX];
+		const void *out[2] = { "one", "two" };
+		switch_size_t out_lens[2] = { 3, 3 };
+		const char *expect[4] = { "one", "two", "three", "four" };
+		switch_port_t expect_port[4];
+		switch_size_t len;
+		char *big;
+		int i, count;
+
+		switch_core_new_memory_pool(&pool);
+
+		fst_requires((rx = test_udp_socket(&rx_bound)));
+		fst_requires((tx0 = test_udp_socket(&tx0_port)));
+		fst_requires((tx1 = test_udp_socket(&tx1_port)));
+		fst_requires(switch_sockaddr_info_get(&to, "127.0.0.1", SWITCH_UNSPEC, rx_bound, 0, pool) == SWITCH_STATUS_SUCCESS);
+
+		for (i = 0; i < SWITCH_SOCKET_BATCH_MAX; i++) {
+			switch_sockaddr_create(&from[i], pool);
+			bufs[i] = switch_core_alloc(pool, 2048);
+			lens[i] = 2048;
+		}
+
+		count = 2;
+		fst_check(switch_socket_sendto_batch(tx0, to, 0, out, out_lens, &count) == SWITCH_STATUS_SUCCESS);
+		fst_check_int_equals(count, 2);
+		len = 5;
+		fst_check(switch_socket_sendto(tx1, to, 0, "three", &len) == SWITCH_STATUS_SUCCESS);
+		len = 4;
+		fst_check(switch_socket_sendto(tx0, to, 0, "four", &len) == SWITCH_STATUS_SUCCESS);
+
+		expect_port[0] = expect_port[1] = expect_port[3] = tx0_port;
+		expect_port[2] = tx1_port;
+
+#ifdef __linux__
+		/* everything already queued comes back from one call, in order */
+		count = SWITCH_SOCKET_BATCH_MAX;
+		fst_check(switch_socket_recvfrom_batch(from, rx, 0, bufs, lens, &count) == SWITCH_STATUS_SUCCESS);
+		fst_check_int_equals(count, 4);
+
+		for (i = 0; i < count && i < 4; i++) {
+			fst_check_int_equals(lens[i], strlen(expect[i]));
+			fst_check(!memcmp(bufs[i], expect[i], lens[i]));
+			fst_check_int_equals(switch_sockaddr_get_port(from[i]), expect_port[i]);
+		}
+#else
+		for (i = 0; i < 4; i++) {
+			lens[0] = 2048;
+			count = SWITCH_SOCKET_BATCH_MAX;
+			fst_check(switch_socket_recvfrom_batch(from, rx, 0, bufs, lens, &count) == SWITCH_STATUS_SUCCESS);
+			fst_check_int_equals(count, 1);
+			fst_check_int_equals(lens[0], strlen(expect[i]));
+			fst_check(!memcmp(bufs[0], expect[i], lens[0]));
+			fst_check_int_equals(switch_sockaddr_get_port(from[0]), expect_port[i]);
+		}
+#endif
+
+#ifdef __linux__
+		/* a datagram that does not fit its slot reports 0 and does not disturb the ones around it */
+		big = switch_core_alloc(pool, 3000);
+		memset(big, 'x', 3000);
+
+		len = 5;
+		switch_socket_sendto(tx0, to, 0, "small", &len);
+		len = 3000;
+		switch_socket_sendto(tx0, to, 0, big, &len);
+		len = 5;
+		switch_socket_sendto(tx0, to, 0, "after", &len);
+
+		for (i = 0; i < SWITCH_SOCKET_BATCH_MAX; i++) {
+			lens[i] = 2048;
+		}
+
+		count = SWITCH_SOCKET_BATCH_MAX;
+		fst_check(switch_socket_recvfrom_batch(from, rx, 0, bufs, lens, &count) == SWITCH_STATUS_SUCCESS);
+		fst_check_int_equals(count, 3);
+		fst_check_int_equals(lens[0], 5);
+		fst_check(!memcmp(bufs[0], "small", 5));
+		fst_check_int_equals(lens[1], 0);
+		fst_check_int_equals(lens[2], 5);
+		fst_check(!memcmp(bufs[2], "after", 5));
+#else
+		(void) big;
+#endif
+
+		switch_socket_close(rx);
+		switch_socket_close(tx0);
+		switch_socket_close(tx1);
+		switch_core_destroy_memory_pool(&pool);
+	}
+	FST_TEST_END()
+
+	FST_TEST_BEGIN(test_rtp_video_batch_send)
+	{
+		switch_rtp_flag_t video_flags[SWITCH_RTP_FLAG_INVALID] = {0};
+		switch_rtp_stats_t *stats;
+		switch_size_t calls, packets, len;
+		switch_socket_t *sink;
+		switch_port_t sink_port = 0;
+		switch_sockaddr_t *from = NULL;
+		switch_rtp_packet_t pkt, rpkt;
+		switch_frame_t frame = { 0 };
+		int i;
+
+		switch_core_new_memory_pool(&pool);
+
+		fst_requires((sink = test_udp_socket(&sink_port)));
+		switch_sockaddr_create(&from, pool);
+
+		video_flags[SWITCH_RTP_FLAG_VIDEO] = 1;
+		rtp_session = switch_rtp_new(rx_host, rx_port + 10, tx_host, sink_port, 96, 1, 90000, video_flags, NULL, &err, pool, 0, 0);
+		fst_requires(rtp_session);
+		fst_requires(switch_rtp_ready(rtp_session));
+
+		stats = switch_rtp_get_stats(rtp_session, pool);
+		calls = stats->outbound.io_call_count;
+		packets = stats->outbound.io_packet_count;
+
+		memset(&pkt, 0, sizeof(pkt));
+		pkt.header.version = 2;
+		pkt.header.pt = 96;
+		pkt.header.ts = htonl(90000);
+		memset(pkt.body, 'v', 100);
+
+		frame.packet = &pkt;
+		frame.packetlen = SWITCH_RTP_HEADER_LEN + 100;
+		frame.data = pkt.body;
+		frame.datalen = 100;
+		frame.flags = SFF_PROXY_PACKET;
+
+		for (i = 0; i < 4; i++) {
+			pkt.header.m = (i == 3);
+			fst_check(switch_rtp_write_frame(rtp_session, &frame) > 0);
+
+#ifdef __linux__
+			if (i < 3) {
+				/* held back until the marker closes the frame */
+				switch_socket_timeout_set(sink, 20000);
+				len = sizeof(rpkt);
+				switch_socket_recvfrom(from, sink, 0, (void *) &rpkt, &len);
+				fst_check_int_equals(len, 0);
+			}
+#endif
+		}
+
+		switch_socket_timeout_set(sink, 500000);
+
+		for (i = 0; i < 4; i++) {
+			len = sizeof(rpkt);
+			fst_check(switch_socket_recvfrom(from, sink, 0, (void *) &rpkt, &len) == SWITCH_STATUS_SUCCESS);
+			fst_check_int_equals(len, SWITCH_RTP_HEADER_LEN + 100);
+			fst_check_int_equals(rpkt.header.m, (i == 3));
+		}
+
+		stats = switch_rtp_get_stats(rtp_session, pool);
+		fst_check_int_equals(stats->outbound.io_packet_count - packets, 4);
+#ifdef __linux__
+		fst_check_int_equals(stats->outbound.io_call_count - calls, 1);
+#else
+		fst_check_int_equals(stats->outbound.io_call_count - calls, 4);
+#endif
+
+		switch_rtp_destroy(&rtp_session);
+		switch_socket_close(sink);
+		switch_core_destroy_memory_pool(&pool);
+	}
+	FST_TEST_END()
+
 }
 FST_SUITE_END()
 }
@@ -450,6 +450,180 @@ FST_TEARDOWN_END()
 	FST_TEST_END()
 #endif
 
+	FST_TEST_BEGIN(test_jb_pcap_replay)
+	{
+		pcap_t *pcap;
+		const unsigned char *packet;
+		char errbuf[PCAP_ERRBUF_SIZE];
+		struct pcap_pkthdr pcap_header;
+		switch_rtp_packet_t *packets;
+		switch_size_t *lens;
+		switch_jb_t *jb = NULL;
+		uint32_t count = 0, max = 1024, i, pass, passes = 50, reads = 0, total = 0;
+		uint16_t base_seq = 0, last_seq = 0, missing;
+		uint32_t base_ts = 0, nack;
+		switch_time_t start, elapsed;
+		switch_memory_pool_t *pool = NULL;
+
+		switch_core_new_memory_pool(&pool);
+		packets = switch_core_alloc(pool, sizeof(*packets) * max);
+		lens = switch_core_alloc(pool, sizeof(*lens) * max);
+
+		pcap = pcap_open_offline_with_tstamp_precision("pcap/milliwatt.long.pcmu.rtp.pcap", PCAP_TSTAMP_PRECISION_MICRO, errbuf);
+		fst_requires(pcap);
+
+		while ((packet = pcap_next(pcap, &pcap_header)) && count < max) {
+			const struct sniff_ip *ip;
+			int jump_over;
+
+			if (pcap_header.caplen <= 42) {
+				continue;
+			}
+
+			ip = (struct sniff_ip*)(packet + 14);
+			jump_over = 14 /*SIZE_ETHERNET*/ + IP_HL(ip) * 4 /*IP HDR size*/ + 8 /* UDP HDR SIZE */;
+
+			if (pcap_header.caplen - jump_over > sizeof(switch_rtp_packet_t)) {
+				continue;
+			}
+
+			lens[count] = pcap_header.caplen - jump_over;
+			memcpy(&packets[count], packet + jump_over, lens[count]);
+			count++;
+		}
+
+		pcap_close(pcap);
+		fst_requires(count > 100);
+
+		base_seq = ntohs(packets[0].header.seq);
+		base_ts = ntohl(packets[0].header.ts);
+
+		/* replay the capture over and over with every 7th pair swapped, the seqs wrap around 65535 on the way */
+		switch_jb_create(&jb, SJB_AUDIO, 3, 10, pool);
+		fst_requires(jb);
+
+		start = switch_time_now();
+
+		for (pass = 0; pass < passes; pass++) {
+			for (i = 0; i < count; i++) {
+				uint32_t n = (i % 7 == 3 && i + 1 < count) ? i + 1 : (i % 7 == 4 ? i - 1 : i);
+				switch_rtp_packet_t put = packets[n], got;
+				switch_size_t len = lens[n];
+
+				put.header.seq = htons((uint16_t)(base_seq + pass * count + n));
+				put.header.ts = htonl(base_ts + (pass * count + n) * 160);
+
+				switch_jb_put_packet(jb, &put, len);
+				total++;
+
+				len = sizeof(got);
+				if (switch_jb_get_packet(jb, &got, &len) == SWITCH_STATUS_SUCCESS) {
+					if (reads) {
+						fst_check(ntohs(got.header.seq) == (uint16_t)(last_seq + 1));
+					}
+					last_seq = ntohs(got.header.seq);
+					reads++;
+				}
+			}
+		}
+
+		elapsed = switch_time_now() - start;
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "jb replay: %u packets put, %u read in %" SWITCH_TIME_T_FMT "us\n", total, reads, elapsed);
+		fst_check(reads + 10 >= total);
+
+		switch_jb_destroy(&jb);
+
+		/* a hole in a video stream has to come back out of pop_nack and count as saved once it shows up */
+		switch_jb_create(&jb, SJB_VIDEO, 1, 10, pool);
+		fst_requires(jb);
+
+		missing = (uint16_t)(base_seq + 5);
+
+		for (i = 0; i < 10; i++) {
+			switch_rtp_packet_t put = packets[i];
+
+			if ((uint16_t)(base_seq + i) == missing) {
+				continue;
+			}
+
+			switch_jb_put_packet(jb, &put, lens[i]);
+		}
+
+		/* one read so the target seq is past zero, nacks behind the read pointer are expired */
+		{
+			switch_rtp_packet_t got;
+			switch_size_t len = sizeof(got);
+
+			fst_check(switch_jb_get_packet(jb, &got, &len) == SWITCH_STATUS_SUCCESS);
+		}
+
+		nack = switch_jb_pop_nack(jb);
+		fst_check(ntohs((uint16_t)(nack & 0xffff)) == missing);
+		fst_check(switch_jb_pop_nack(jb) == 0);
+
+		switch_jb_put_packet(jb, &packets[5], lens[5]);
+		fst_check(switch_jb_get_nack_success(jb) == 1);
+
+		switch_jb_destroy(&jb);
+		switch_core_destroy_memory_pool(&pool);
+	}
+	FST_TEST_END()
+
+	FST_TEST_BEGIN(test_jb_video_slot_grow)
+	{
+		switch_jb_t *jb = NULL;
+		switch_memory_pool_t *pool = NULL;
+		switch_rtp_packet_t put = { {0} }, got;
+		switch_size_t len;
+		uint16_t seq;
+		int frames;
+
+		switch_core_new_memory_pool(&pool);
+		switch_jb_create(&jb, SJB_VIDEO, 1, 50, pool);
+		fst_requires(jb);
+
+		put.header.version = 2;
+		put.header.pt = 96;
+		put.header.m = 1;
+		put.header.ssrc = htonl(0x1234);
+
+		for (seq = 100; seq <= 116; seq++) {
+			put.header.seq = htons(seq);
+			put.header.ts = htonl(seq * 3000);
+			fst_check(switch_jb_put_packet(jb, &put, 12 + 100) == SWITCH_STATUS_SUCCESS);
+		}
+
+		frames = switch_jb_frame_count(jb);
+
+		/* 164 lands on the slot of 100 in the initial 64 slot ring, the ring has to grow and keep both */
+		put.header.seq = htons(164);
+		put.header.ts = htonl(164 * 3000);
+		fst_check(switch_jb_put_packet(jb, &put, 12 + 100) == SWITCH_STATUS_SUCCESS);
+
+		put.header.seq = htons(165);
+		put.header.ts = htonl(165 * 3000);
+		fst_check(switch_jb_put_packet(jb, &put, 12 + 100) == SWITCH_STATUS_SUCCESS);
+
+		for (seq = 100; seq <= 116; seq++) {
+			len = sizeof(got);
+			fst_check(switch_jb_get_packet_by_seq(jb, htons(seq), &got, &len) == SWITCH_STATUS_SUCCESS);
+		}
+
+		len = sizeof(got);
+		fst_check(switch_jb_get_packet_by_seq(jb, htons(164), &got, &len) == SWITCH_STATUS_SUCCESS);
+		fst_check_int_equals(ntohs(got.header.seq), 164);
+
+		len = sizeof(got);
+		fst_check(switch_jb_get_packet_by_seq(jb, htons(165), &got, &len) == SWITCH_STATUS_SUCCESS);
+		fst_check_int_equals(ntohs(got.header.seq), 165);
+
+		fst_check(switch_jb_frame_count(jb) >= frames);
+
+		switch_jb_destroy(&jb);
+		switch_core_destroy_memory_pool(&pool);
+	}
+	FST_TEST_END()
+
 	FST_TEST_BEGIN(test_rtp_media_timeout)
 	{
 		switch_core_session_t *session = NULL;
@@ -0,0 +1,188 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2020, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ *
+ * switch_scheduler.c -- tests the scheduler
+ *
+ */
+#include <switch.h>
+#include <test/switch_test.h>
+
+#define BENCH_TASKS 50000
+/* more than the scheduler will start workers for */
+#define SLOW_TASKS 70
+
+static int order[8];
+static int order_len;
+static int repeats;
+
+static void record_task(switch_scheduler_task_t *task)
+{
+	if (order_len < 8) {
+		order[order_len++] = task->cmd_id;
+	}
+}
+
+static void repeat_task(switch_scheduler_task_t *task)
+{
+	if (++repeats < 3) {
+		task->runtime_us += 10000;
+	}
+}
+
+static void idle_task(switch_scheduler_task_t *task)
+{
+}
+
+static switch_atomic_t slow_done;
+static switch_time_t stamp;
+
+static void slow_task(switch_scheduler_task_t *task)
+{
+	switch_yield(200000);
+	switch_atomic_inc(&slow_done);
+}
+
+static void stamp_task(switch_scheduler_task_t *task)
+{
+	stamp = switch_micro_time_now();
+}
+
+FST_CORE_BEGIN("./conf")
+{
+	FST_SUITE_BEGIN(switch_scheduler)
+	{
+		FST_SETUP_BEGIN()
+		{
+		}
+		FST_SETUP_END()
+
+		FST_TEARDOWN_BEGIN()
+		{
+		}
+		FST_TEARDOWN_END()
+
+		FST_TEST_BEGIN(sub_second_order)
+		{
+			switch_time_t now = switch_micro_time_now();
+
+			order_len = 0;
+			switch_scheduler_add_task_us(now + 60000, record_task, "test", "sched-test", 3, NULL, SSHF_NONE);
+			switch_scheduler_add_task_us(now + 20000, record_task, "test", "sched-test", 1, NULL, SSHF_NONE);
+			switch_scheduler_add_task_us(now + 40000, record_task, "test", "sched-test", 2, NULL, SSHF_OWN_THREAD);
+
+			switch_yield(300000);
+
+			fst_check_int_equals(order_len, 3);
+			fst_check_int_equals(order[0], 1);
+			fst_check_int_equals(order[1], 2);
+			fst_check_int_equals(order[2], 3);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(reschedule_us)
+		{
+			repeats = 0;
+			switch_scheduler_add_task_us(switch_micro_time_now(), repeat_task, "test", "sched-test", 0, NULL, SSHF_NONE);
+
+			switch_yield(300000);
+
+			fst_check_int_equals(repeats, 3);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(own_thread_never_inline)
+		{
+			switch_time_t now = switch_micro_time_now();
+			int i;
+
+			stamp = 0;
+			for (i = 0; i < SLOW_TASKS; i++) {
+				switch_scheduler_add_task_us(now, slow_task, "test", "sched-slow", i, NULL, SSHF_OWN_THREAD);
+			}
+			switch_scheduler_add_task_us(now + 20000, stamp_task, "test", "sched-slow", 0, NULL, SSHF_NONE);
+
+			/* with every worker busy the slow ones queue up instead of holding up the task thread */
+			switch_yield(150000);
+			fst_check(stamp != 0 && stamp - now < 150000);
+
+			for (i = 0; i < 100 && switch_atomic_read(&slow_done) < SLOW_TASKS; i++) {
+				switch_yield(20000);
+			}
+			fst_check_int_equals(switch_atomic_read(&slow_done), SLOW_TASKS);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(del_task_id_and_group)
+		{
+			time_t later = switch_epoch_time_now(NULL) + 3600;
+			uint32_t id;
+			int i;
+
+			id = switch_scheduler_add_task(later, idle_task, "test", "sched-del", 0, NULL, SSHF_NONE);
+			for (i = 0; i < 9; i++) {
+				switch_scheduler_add_task(later, idle_task, "test", "sched-del", 0, NULL, SSHF_NONE);
+			}
+
+			fst_check_int_equals(switch_scheduler_del_task_id(id), 1);
+			fst_check_int_equals(switch_scheduler_del_task_id(id), 0);
+			fst_check_int_equals(switch_scheduler_del_task_group("sched-del"), 9);
+			fst_check_int_equals(switch_scheduler_del_task_group("sched-del"), 0);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(benchmark)
+		{
+			time_t later = switch_epoch_time_now(NULL) + 3600;
+			uint32_t *ids = calloc(BENCH_TASKS, sizeof(uint32_t));
+			char group[32];
+			switch_time_t start, added, deleted;
+			uint32_t delcnt = 0;
+			int i;
+
+			fst_requires(ids);
+
+			start = switch_time_now();
+			for (i = 0; i < BENCH_TASKS; i++) {
+				switch_snprintf(group, sizeof(group), "bench-%d", i);
+				ids[i] = switch_scheduler_add_task(later, idle_task, "bench", group, 0, NULL, SSHF_NONE);
+			}
+			added = switch_time_now();
+			for (i = 0; i < BENCH_TASKS; i++) {
+				delcnt += switch_scheduler_del_task_id(ids[BENCH_TASKS - 1 - i]);
+			}
+			deleted = switch_time_now();
+
+			fst_check_int_equals(delcnt, BENCH_TASKS);
+			printf("scheduler: %d tasks added in %" SWITCH_TIME_T_FMT "us, deleted by id in %" SWITCH_TIME_T_FMT "us\n",
+				   BENCH_TASKS, added - start, deleted - added);
+
+			free(ids);
+		}
+		FST_TEST_END()
+	}
+	FST_SUITE_END()
+}
+FST_CORE_END()